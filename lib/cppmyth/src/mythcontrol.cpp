@@ -20,6 +20,7 @@
  */
 
 #include "mythcontrol.h"
+#include "private/metrics.h"
 
 using namespace Myth;
 
@@ -62,6 +63,16 @@ void Control::Close()
   m_wsapi.InvalidateService();
 }
 
+std::string Control::GetMetrics()
+{
+  return Metrics::Snapshot();
+}
+
+void Control::ResetMetrics()
+{
+  Metrics::Reset();
+}
+
 std::string Control::GetBackendServerIP(const std::string& hostName)
 {
   std::string backend_addr;
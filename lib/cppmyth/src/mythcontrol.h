@@ -530,34 +530,38 @@ namespace Myth
      * @brief Request a set of cut list marks for a recording
      * @param program
      * @param unit 0 = Frame count, 1 = Position, 2 = Duration ms
+     * @param ok if not null, set to false when the request failed
      * @return MarkListPtr
      */
-    MarkListPtr GetCutList(const Program& program, int unit = 0)
+    MarkListPtr GetCutList(const Program& program, int unit = 0, bool *ok = NULL)
     {
       WSServiceVersion_t wsv = m_wsapi.CheckService(WS_Dvr);
       if (wsv.ranking >= 0x00060001)
-        return m_wsapi.GetRecordedCutList(program.recording.recordedId, unit);
+        return m_wsapi.GetRecordedCutList(program.recording.recordedId, unit, ok);
       if (unit == 0)
-        return m_monitor.GetCutList(program);
-      else
-        return MarkListPtr(new MarkList);
+        return m_monitor.GetCutList(program, ok);
+      if (ok)
+        *ok = true;
+      return MarkListPtr(new MarkList);
     }
 
     /**
      * @brief Request a set of commercial break marks for a recording
      * @param program
      * @param unit 0 = Frame count, 1 = Position, 2 = Duration ms
+     * @param ok if not null, set to false when the request failed
      * @return MarkListPtr
      */
-    MarkListPtr GetCommBreakList(const Program& program, int unit = 0)
+    MarkListPtr GetCommBreakList(const Program& program, int unit = 0, bool *ok = NULL)
     {
       WSServiceVersion_t wsv = m_wsapi.CheckService(WS_Dvr);
       if (wsv.ranking >= 0x00060001)
-        return m_wsapi.GetRecordedCommBreak(program.recording.recordedId, unit);
+        return m_wsapi.GetRecordedCommBreak(program.recording.recordedId, unit, ok);
       if (unit == 0)
-        return m_monitor.GetCommBreakList(program);
-      else
-        return MarkListPtr(new MarkList);
+        return m_monitor.GetCommBreakList(program, ok);
+      if (ok)
+        *ok = true;
+      return MarkListPtr(new MarkList);
     }
 
     /**
@@ -600,6 +604,18 @@ namespace Myth
       return m_wsapi.GetSavedBookmark(program.recording.recordedId, unit);
     }
 
+    /**
+     * @brief Report the metrics of the library (protocol commands, services,
+     * transfers and events), one per line
+     * @return string
+     */
+    static std::string GetMetrics();
+
+    /**
+     * @brief Clear the metrics of the library
+     */
+    static void ResetMetrics();
+
   private:
     ProtoMonitor m_monitor;
     WSAPI m_wsapi;
@@ -36,6 +36,23 @@ namespace Myth
   void DBGAll(void);
   void DBGNone(void);
   void SetDBGMsgCallback(void (*msgcb)(int level, char*));
+  /**
+   * Record the data exchanged by every new connection into a file of the
+   * given directory, else NULL to stop.
+   */
+  void DBGCapture(const char* directory);
+  /**
+   * Serve every new connection by the next capture of the server and port in
+   * the given directory, instead of the server, else NULL to stop. The speed
+   * is the pace in percent of the original, 0 for no delay.
+   */
+  void DBGReplay(const char* directory, unsigned speed = 100);
+  /**
+   * Deliver the messages to the callback from a background thread. When it
+   * lags behind, the messages are dropped and counted. Disabling flushes the
+   * pending messages: it must be done before the callback goes away.
+   */
+  void DBGAsync(bool enable);
 }
 
 #endif	/* MYTHDEBUG_H */
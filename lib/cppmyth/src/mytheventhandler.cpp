@@ -24,8 +24,10 @@
 #include "proto/mythprotoevent.h"
 #include "private/os/threads/thread.h"
 #include "private/os/threads/event.h"
+#include "private/os/threads/threadpool.h"
 #include "private/cppdef.h"
 #include "private/builtin.h"
+#include "private/metrics.h"
 
 #include <vector>
 #include <map>
@@ -50,100 +52,126 @@ EventHandler::EventHandlerThread::~EventHandlerThread()
 
 ///////////////////////////////////////////////////////////////////////////////
 ////
-//// SubscriptionHandlerThread
+//// SubscriptionHandler
 ////
 
 namespace Myth
 {
-  class SubscriptionHandlerThread : private OS::CThread
+  /*
+   * The messages of a subscription are delivered in order by a worker of the
+   * shared thread pool. At most one delivery worker is queued or running for
+   * a subscription, so no thread is held while the subscription is idle.
+   */
+  class SubscriptionHandler
   {
   public:
-    SubscriptionHandlerThread(EventSubscriber *handle, unsigned subid);
-    virtual ~SubscriptionHandlerThread();
-    EventSubscriber *GetHandle() { return m_handle; }
-    bool IsRunning() { return OS::CThread::IsRunning(); }
+    SubscriptionHandler(EventSubscriber *handle, unsigned subid);
+    virtual ~SubscriptionHandler();
+    EventSubscriber *GetHandle() { return m_state->handle; }
+    bool IsRunning();
     void PostMessage(const EventMessagePtr& msg);
 
   private:
-    EventSubscriber *m_handle;
-    unsigned m_subId;
-    mutable OS::CMutex m_mutex;
-    OS::CEvent m_queueContent;
-    std::list<EventMessagePtr> m_msgQueue;
+    struct State
+    {
+      EventSubscriber *handle;
+      unsigned subId;
+      OS::CMutex mutex;
+      OS::CMutex callMutex;
+      std::list<EventMessagePtr> msgQueue;
+      bool scheduled;
+      bool stopped;
+    };
+    typedef MYTH_SHARED_PTR<State> StatePtr;
+
+    class Delivery : public OS::CWorker
+    {
+    public:
+      Delivery(const StatePtr& state) : m_state(state) { }
+      virtual void Process();
+    private:
+      StatePtr m_state;
+    };
+
+    StatePtr m_state;
 
-    bool Start();
     void Stop();
-    void *Process();
   };
 }
 
-SubscriptionHandlerThread::SubscriptionHandlerThread(EventSubscriber *handle, unsigned subid)
-: OS::CThread()
-, m_handle(handle)
-, m_subId(subid)
-, m_mutex()
-, m_queueContent()
-, m_msgQueue()
+SubscriptionHandler::SubscriptionHandler(EventSubscriber *handle, unsigned subid)
+: m_state(new State())
 {
-  if (m_handle && Start())
-    DBG(DBG_DEBUG, "%s: subscription is started (%p:%u)\n", __FUNCTION__, m_handle, m_subId);
+  m_state->handle = handle;
+  m_state->subId = subid;
+  m_state->scheduled = false;
+  m_state->stopped = (handle == NULL);
+  if (m_state->handle)
+    DBG(DBG_DEBUG, "%s: subscription is started (%p:%u)\n", __FUNCTION__, m_state->handle, m_state->subId);
   else
-    DBG(DBG_ERROR, "%s: subscription failed (%p:%u)\n", __FUNCTION__, m_handle, m_subId);
+    DBG(DBG_ERROR, "%s: subscription failed (%p:%u)\n", __FUNCTION__, m_state->handle, m_state->subId);
 }
 
-SubscriptionHandlerThread::~SubscriptionHandlerThread()
+SubscriptionHandler::~SubscriptionHandler()
 {
   Stop();
-  m_handle = NULL;
 }
 
-bool SubscriptionHandlerThread::Start()
+bool SubscriptionHandler::IsRunning()
 {
-  if (OS::CThread::IsRunning())
-    return true;
-  return OS::CThread::StartThread();
+  OS::CLockGuard lock(m_state->mutex);
+  return !m_state->stopped;
 }
 
-void SubscriptionHandlerThread::Stop()
+void SubscriptionHandler::Stop()
 {
-  if (OS::CThread::IsRunning())
-  {
-    DBG(DBG_DEBUG, "%s: subscription thread (%p:%u)\n", __FUNCTION__, m_handle, m_subId);
-    // Set stopping. don't wait as we need to signal the thread first
-    OS::CThread::StopThread(false);
-    m_queueContent.Signal();
-    // Wait for thread to stop
-    OS::CThread::StopThread(true);
-    DBG(DBG_DEBUG, "%s: subscription thread (%p:%u) stopped\n", __FUNCTION__, m_handle, m_subId);
-  }
+  OS::CLockGuard lock(m_state->mutex);
+  if (m_state->stopped)
+    return;
+  DBG(DBG_DEBUG, "%s: subscription (%p:%u)\n", __FUNCTION__, m_state->handle, m_state->subId);
+  m_state->stopped = true;
+  m_state->msgQueue.clear();
+  lock.Unlock();
+  // Wait for the delivery in progress
+  OS::CLockGuard call(m_state->callMutex);
+  DBG(DBG_DEBUG, "%s: subscription (%p:%u) stopped\n", __FUNCTION__, m_state->handle, m_state->subId);
 }
 
-void SubscriptionHandlerThread::PostMessage(const EventMessagePtr& msg)
+void SubscriptionHandler::PostMessage(const EventMessagePtr& msg)
 {
   // Critical section
-  OS::CLockGuard lock(m_mutex);
-  m_msgQueue.push_back(msg);
-  m_queueContent.Signal();
+  OS::CLockGuard lock(m_state->mutex);
+  if (m_state->stopped)
+    return;
+  m_state->msgQueue.push_back(msg);
+  static const Metrics::Id s_queueMetric = Metrics::Register("event.queue", Metrics::GAUGE);
+  Metrics::Gauge(s_queueMetric, (int64_t)m_state->msgQueue.size());
+  if (m_state->scheduled)
+    return;
+  m_state->scheduled = OS::CThreadPool::Shared().Enqueue(new Delivery(m_state), OS::CThreadPool::PRIORITY_HIGH);
+  if (!m_state->scheduled)
+    DBG(DBG_ERROR, "%s: delivery failed (%p:%u)\n", __FUNCTION__, m_state->handle, m_state->subId);
 }
 
-void *SubscriptionHandlerThread::Process()
+void SubscriptionHandler::Delivery::Process()
 {
-  while (!IsStopped())
+  for (;;)
   {
-    while (!m_msgQueue.empty() && !IsStopped())
+    // Critical section
+    OS::CLockGuard lock(m_state->mutex);
+    if (m_state->stopped || m_state->msgQueue.empty())
     {
-      // Critical section
-      OS::CLockGuard lock(m_mutex);
-      EventMessagePtr msg = m_msgQueue.front();
-      m_msgQueue.pop_front();
-      lock.Unlock();
-      // Do work
-      m_handle->HandleBackendMessage(msg);
+      m_state->scheduled = false;
+      break;
     }
-    // The tread is woken up by m_queueContent.Signal();
-    m_queueContent.Wait();
+    EventMessagePtr msg = m_state->msgQueue.front();
+    m_state->msgQueue.pop_front();
+    lock.Unlock();
+    // Do work
+    OS::CLockGuard call(m_state->callMutex);
+    if (!m_state->stopped)
+      m_state->handle->HandleBackendMessage(msg);
   }
-  return NULL;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -176,7 +204,7 @@ namespace Myth
     // About subscriptions
     typedef std::map<EVENT_t, std::list<unsigned> > subscriptionsByEvent_t;
     subscriptionsByEvent_t m_subscriptionsByEvent;
-    typedef std::map<unsigned, SubscriptionHandlerThread*> subscriptions_t;
+    typedef std::map<unsigned, SubscriptionHandler*> subscriptions_t;
     subscriptions_t m_subscriptions;
 
     void DispatchEvent(const EventMessagePtr& msg);
@@ -219,6 +247,9 @@ void BasicEventHandler::Stop()
   if (OS::CThread::IsRunning())
   {
     DBG(DBG_DEBUG, "%s: event handler thread (%p)\n", __FUNCTION__, this);
+    // Signal stop, then break the wait for message
+    OS::CThread::StopThread(false);
+    m_event->Interrupt();
     OS::CThread::StopThread(true);
     DBG(DBG_DEBUG, "%s: event handler thread (%p) stopped\n", __FUNCTION__, this);
   }
@@ -249,7 +280,7 @@ unsigned BasicEventHandler::CreateSubscription(EventSubscriber* sub)
   subscriptions_t::const_reverse_iterator it = m_subscriptions.rbegin();
   if (it != m_subscriptions.rend())
     id = it->first;
-  SubscriptionHandlerThread *handler = new SubscriptionHandlerThread(sub, ++id);
+  SubscriptionHandler *handler = new SubscriptionHandler(sub, ++id);
   if (handler->IsRunning())
   {
     m_subscriptions.insert(std::make_pair(id, handler));
@@ -342,7 +373,7 @@ void *BasicEventHandler::Process()
       AnnounceStatus(EVENTHANDLER_DISCONNECTED);
       RetryConnect();
     }
-    else
+    else if (!OS::CThread::IsStopped())
     {
       AnnounceTimer();
       // Reconnect if any held reset
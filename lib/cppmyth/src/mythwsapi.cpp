@@ -1551,10 +1551,12 @@ bool WSAPI::UpdateRecordedWatchedStatus6_0(uint32_t recordedid, bool watched)
   return true;
 }
 
-MarkListPtr WSAPI::GetRecordedCommBreak6_1(uint32_t recordedid, int unit)
+MarkListPtr WSAPI::GetRecordedCommBreak6_1(uint32_t recordedid, int unit, bool *ok)
 {
   char buf[32];
   MarkListPtr ret(new MarkList);
+  if (ok)
+    *ok = false;
   unsigned proto = (unsigned)m_version.protocol;
 
   // Get bindings for protocol version
@@ -1599,13 +1601,17 @@ MarkListPtr WSAPI::GetRecordedCommBreak6_1(uint32_t recordedid, int unit)
     JSON::BindObject(vcut, mark.get(), bindcut);
     ret->push_back(mark);
   }
+  if (ok)
+    *ok = true;
   return ret;
 }
 
-MarkListPtr WSAPI::GetRecordedCutList6_1(uint32_t recordedid, int unit)
+MarkListPtr WSAPI::GetRecordedCutList6_1(uint32_t recordedid, int unit, bool *ok)
 {
   char buf[32];
   MarkListPtr ret(new MarkList);
+  if (ok)
+    *ok = false;
   unsigned proto = (unsigned)m_version.protocol;
 
   // Get bindings for protocol version
@@ -1650,6 +1656,8 @@ MarkListPtr WSAPI::GetRecordedCutList6_1(uint32_t recordedid, int unit)
     JSON::BindObject(vcut, mark.get(), bindcut);
     ret->push_back(mark);
   }
+  if (ok)
+    *ok = true;
   return ret;
 }
 
@@ -458,12 +458,14 @@ namespace Myth
      * @brief GET Dvr/GetRecordedCommBreak
      * @param recordedid
      * @param unit 0 = Frame count, 1 = Position, 2 = Duration ms
+     * @param ok if not null, set to false when the request failed
      * @return MarkListPtr
      */
-    MarkListPtr GetRecordedCommBreak(uint32_t recordedid, int unit)
+    MarkListPtr GetRecordedCommBreak(uint32_t recordedid, int unit, bool *ok = NULL)
     {
       WSServiceVersion_t wsv = CheckService(WS_Dvr);
-      if (wsv.ranking >= 0x00060001) return GetRecordedCommBreak6_1(recordedid, unit);
+      if (wsv.ranking >= 0x00060001) return GetRecordedCommBreak6_1(recordedid, unit, ok);
+      if (ok) *ok = true;
       return MarkListPtr(new MarkList);
     }
 
@@ -471,12 +473,14 @@ namespace Myth
      * @brief GET Dvr/GetRecordedCutList
      * @param recordedid
      * @param unit 0 = Frame count, 1 = Position, 2 = Duration ms
+     * @param ok if not null, set to false when the request failed
      * @return MarkListPtr
      */
-    MarkListPtr GetRecordedCutList(uint32_t recordedid, int unit)
+    MarkListPtr GetRecordedCutList(uint32_t recordedid, int unit, bool *ok = NULL)
     {
       WSServiceVersion_t wsv = CheckService(WS_Dvr);
-      if (wsv.ranking >= 0x00060001) return GetRecordedCutList6_1(recordedid, unit);
+      if (wsv.ranking >= 0x00060001) return GetRecordedCutList6_1(recordedid, unit, ok);
+      if (ok) *ok = true;
       return MarkListPtr(new MarkList);
     }
 
@@ -555,8 +559,8 @@ namespace Myth
     bool UnDeleteRecording6_0(uint32_t recordedid);
     bool UpdateRecordedWatchedStatus4_5(uint32_t chanid, time_t recstartts, bool watched);
     bool UpdateRecordedWatchedStatus6_0(uint32_t recordedid, bool watched);
-    MarkListPtr GetRecordedCommBreak6_1(uint32_t recordedid, int unit);
-    MarkListPtr GetRecordedCutList6_1(uint32_t recordedid, int unit);
+    MarkListPtr GetRecordedCommBreak6_1(uint32_t recordedid, int unit, bool *ok);
+    MarkListPtr GetRecordedCutList6_1(uint32_t recordedid, int unit, bool *ok);
     bool SetSavedBookmark6_2(uint32_t recordedid, int unit, int64_t value);
     int64_t GetSavedBookmark6_2(uint32_t recordedid, int unit);
 
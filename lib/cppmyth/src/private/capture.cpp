@@ -0,0 +1,336 @@
+/*
+ *      Copyright (C) 2014-2016 Jean-Luc Barriere
+ *
+ *  This library is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation; either version 3, or (at your option)
+ *  any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301 USA
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "capture.h"
+#include "socketpoll.h"
+#include "debug.h"
+#include "os/threads/timeout.h"
+
+#include <errno.h>
+#include <cstring>
+#include <map>
+
+#ifdef __WINDOWS__
+#include <WS2tcpip.h>
+#define SHUT_WR   SD_SEND
+#else
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#define closesocket(a) close(a)
+#endif /* __WINDOWS__ */
+
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define snprintf _snprintf
+#endif
+
+#if defined(MSG_NOSIGNAL)
+#define REPLAY_SEND_FLAGS   MSG_NOSIGNAL
+#else
+#define REPLAY_SEND_FLAGS   0
+#endif
+#define REPLAY_BUFFER_SIZE  65536
+#define REPLAY_POLL_TIMEOUT 500   // ms between the checks for stop
+
+using namespace NSROOT;
+
+static OS::CMutex s_captureLock;
+static std::string s_captureDirectory;
+static std::map<std::string, unsigned> s_captureCount;
+static std::string s_replayDirectory;
+static std::map<std::string, unsigned> s_replayCount;
+static unsigned s_replaySpeed = 100;
+
+/*
+ * The path of the next file of the server and port, numbered in the order of
+ * connection, so a replay finds the capture of the same connection.
+ */
+static std::string __capturePath(const std::string& directory, std::map<std::string, unsigned>& count,
+        const char *server, unsigned port)
+{
+  char name[32];
+  snprintf(name, sizeof(name), "-%u", port);
+  std::string key(server);
+  key.append(name);
+  snprintf(name, sizeof(name), "-%04u.cap", ++count[key]);
+  return std::string(directory).append(PATH_SEPARATOR_STRING).append(key).append(name);
+}
+
+void NSROOT::DBGCapture(const char *directory)
+{
+  SocketCapture::SetDirectory(directory);
+}
+
+void NSROOT::DBGReplay(const char *directory, unsigned speed)
+{
+  SocketReplay::SetDirectory(directory, speed);
+}
+
+void SocketCapture::SetDirectory(const char *directory)
+{
+  OS::CLockGuard lock(s_captureLock);
+  std::string dir(directory ? directory : "");
+  if (dir != s_captureDirectory)
+    s_captureCount.clear();
+  s_captureDirectory.swap(dir);
+}
+
+SocketCapture* SocketCapture::Open(const char *server, unsigned port)
+{
+  std::string path;
+  {
+    OS::CLockGuard lock(s_captureLock);
+    if (s_captureDirectory.empty())
+      return NULL;
+    path = __capturePath(s_captureDirectory, s_captureCount, server, port);
+  }
+  FILE *file = fopen(path.c_str(), "wb");
+  if (!file)
+  {
+    DBG(DBG_ERROR, "%s: failed to open file (%s)\n", __FUNCTION__, path.c_str());
+    return NULL;
+  }
+  DBG(DBG_DEBUG, "%s: capture to file (%s)\n", __FUNCTION__, path.c_str());
+  return new SocketCapture(file);
+}
+
+SocketCapture::SocketCapture(FILE *file)
+: m_file(file)
+, m_start(OS::gettime_ms())
+{
+}
+
+SocketCapture::~SocketCapture()
+{
+  fclose(m_file);
+}
+
+static inline void __write32(unsigned char *p, uint32_t v)
+{
+  p[0] = (unsigned char)(v >> 24);
+  p[1] = (unsigned char)(v >> 16);
+  p[2] = (unsigned char)(v >> 8);
+  p[3] = (unsigned char)v;
+}
+
+static inline uint32_t __read32(const unsigned char *p)
+{
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+void SocketCapture::Record(char direction, const void *buf, size_t size)
+{
+  unsigned char hdr[9];
+  hdr[0] = (unsigned char)direction;
+  OS::CLockGuard lock(m_mutex);
+  __write32(hdr + 1, (uint32_t)(OS::gettime_ms() - m_start));
+  __write32(hdr + 5, (uint32_t)size);
+  if (fwrite(hdr, sizeof(hdr), 1, m_file) != 1 || (size && fwrite(buf, size, 1, m_file) != 1))
+    DBG(DBG_ERROR, "%s: failed to write the capture\n", __FUNCTION__);
+}
+
+void SocketReplay::SetDirectory(const char *directory, unsigned speed)
+{
+  OS::CLockGuard lock(s_captureLock);
+  s_replayDirectory.assign(directory ? directory : "");
+  s_replaySpeed = speed;
+  // Restart from the first captures
+  s_replayCount.clear();
+}
+
+bool SocketReplay::IsEnabled()
+{
+  OS::CLockGuard lock(s_captureLock);
+  return !s_replayDirectory.empty();
+}
+
+SocketReplay* SocketReplay::Open(const char *server, unsigned port)
+{
+#ifdef __WINDOWS__
+  (void)server;
+  (void)port;
+  DBG(DBG_ERROR, "%s: replay isn't supported on this system\n", __FUNCTION__);
+  return NULL;
+#else
+  std::string path;
+  unsigned speed;
+  {
+    OS::CLockGuard lock(s_captureLock);
+    if (s_replayDirectory.empty())
+      return NULL;
+    path = __capturePath(s_replayDirectory, s_replayCount, server, port);
+    speed = s_replaySpeed;
+  }
+  FILE *file = fopen(path.c_str(), "rb");
+  if (!file)
+  {
+    DBG(DBG_ERROR, "%s: failed to open file (%s)\n", __FUNCTION__, path.c_str());
+    return NULL;
+  }
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+  {
+    DBG(DBG_ERROR, "%s: socketpair failed (%d)\n", __FUNCTION__, errno);
+    fclose(file);
+    return NULL;
+  }
+#if defined(SO_NOSIGPIPE)
+  int on = 1;
+  setsockopt(fds[1], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+  SocketReplay *replay = new SocketReplay(file, speed, fds[0], fds[1]);
+  if (!replay->StartThread(true))
+  {
+    DBG(DBG_ERROR, "%s: failed to start the replay\n", __FUNCTION__);
+    delete replay;
+    return NULL;
+  }
+  DBG(DBG_DEBUG, "%s: replay of file (%s)\n", __FUNCTION__, path.c_str());
+  return replay;
+#endif
+}
+
+SocketReplay::SocketReplay(FILE *file, unsigned speed, net_socket_t client, net_socket_t server)
+: OS::CThread()
+, m_file(file)
+, m_speed(speed)
+, m_client(client)
+, m_server(server)
+, m_buffer(new char[REPLAY_BUFFER_SIZE])
+{
+}
+
+SocketReplay::~SocketReplay()
+{
+  StopThread(true);
+  if (m_client != INVALID_SOCKET_VALUE)
+    closesocket(m_client);
+  closesocket(m_server);
+  fclose(m_file);
+  delete[] m_buffer;
+}
+
+net_socket_t SocketReplay::TakeHandle()
+{
+  net_socket_t s = m_client;
+  m_client = INVALID_SOCKET_VALUE;
+  return s;
+}
+
+void* SocketReplay::Process()
+{
+  unsigned char hdr[9];
+  uint32_t stamp = 0;
+  int64_t last = OS::gettime_ms();
+
+  while (!IsStopped() && fread(hdr, sizeof(hdr), 1, m_file) == 1)
+  {
+    uint32_t time = __read32(hdr + 1);
+    uint32_t size = __read32(hdr + 5);
+    if (hdr[0] == CAPTURE_SENT)
+    {
+      if (!Expect(size))
+        break;
+      // The delay of the response runs from the request of the client
+      last = OS::gettime_ms();
+    }
+    else if (hdr[0] == CAPTURE_RECEIVED)
+    {
+      int64_t now = OS::gettime_ms();
+      if (m_speed > 0 && time > stamp)
+      {
+        int64_t due = last + (int64_t)(time - stamp) * 100 / m_speed;
+        if (due > now)
+        {
+          Sleep((unsigned)(due - now));
+          now = due;
+        }
+      }
+      last = now;
+      if (!Deliver(size))
+        break;
+    }
+    else
+    {
+      DBG(DBG_ERROR, "%s: invalid record\n", __FUNCTION__);
+      break;
+    }
+    stamp = time;
+  }
+  // The end of the capture closes the connection
+  shutdown(m_server, SHUT_WR);
+  return NULL;
+}
+
+/*
+ * Read the bytes sent by the client in the capture. They aren't compared, so
+ * the session must repeat the captured one.
+ */
+bool SocketReplay::Expect(size_t size)
+{
+  if (fseek(m_file, (long)size, SEEK_CUR) != 0)
+  {
+    DBG(DBG_ERROR, "%s: truncated capture\n", __FUNCTION__);
+    return false;
+  }
+  while (size > 0)
+  {
+    int r = SocketPoll::Wait(m_server, SOCKETPOLL_READ, REPLAY_POLL_TIMEOUT);
+    if (IsStopped())
+      return false;
+    if (r == 0)
+      continue;
+    if (r > 0)
+      r = recv(m_server, m_buffer, (int)(size < REPLAY_BUFFER_SIZE ? size : REPLAY_BUFFER_SIZE), 0);
+    // Closed by the client
+    if (r <= 0)
+      return false;
+    size -= (size_t)r;
+  }
+  return true;
+}
+
+/*
+ * Write the bytes received in the capture to the client.
+ */
+bool SocketReplay::Deliver(size_t size)
+{
+  while (size > 0)
+  {
+    size_t n = (size < REPLAY_BUFFER_SIZE ? size : REPLAY_BUFFER_SIZE);
+    if (fread(m_buffer, 1, n, m_file) != n)
+    {
+      DBG(DBG_ERROR, "%s: truncated capture\n", __FUNCTION__);
+      return false;
+    }
+    size -= n;
+    const char *p = m_buffer;
+    while (n > 0)
+    {
+      int r = send(m_server, p, (int)n, REPLAY_SEND_FLAGS);
+      if (r <= 0)
+        return false;
+      p += r;
+      n -= (size_t)r;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,134 @@
+/*
+ *      Copyright (C) 2014-2016 Jean-Luc Barriere
+ *
+ *  This library is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation; either version 3, or (at your option)
+ *  any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301 USA
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef CAPTURE_H
+#define	CAPTURE_H
+
+#include <cppmyth_config.h>
+#include "os/os.h"
+#include "os/threads/mutex.h"
+#include "os/threads/thread.h"
+
+#include <cstddef>  // for size_t
+#include <cstdio>
+#include <string>
+
+#define CAPTURE_SENT      '>'
+#define CAPTURE_RECEIVED  '<'
+
+namespace NSROOT
+{
+
+  /**
+   * Record of the data exchanged on a connection. The file contains one
+   * record per call: the direction, the time in milliseconds from the
+   * connection and the size, both as 32 bits big-endian, then the bytes.
+   * The files are numbered by server and port, in the order of connection.
+   */
+  class SocketCapture
+  {
+  public:
+    /**
+     * Start a capture for a new connection.
+     * @return the capture, else NULL when the capture isn't enabled
+     */
+    static SocketCapture* Open(const char *server, unsigned port);
+
+    /**
+     * Enable the capture of the connections into files of the directory.
+     * @param directory the directory path, else NULL to disable
+     */
+    static void SetDirectory(const char *directory);
+
+    ~SocketCapture();
+
+    void Record(char direction, const void *buf, size_t size);
+
+  private:
+    FILE *m_file;
+    int64_t m_start;
+    OS::CMutex m_mutex;
+
+    SocketCapture(FILE *file);
+
+    // prevent copy
+    SocketCapture(const SocketCapture&);
+    SocketCapture& operator=(const SocketCapture&);
+  };
+
+  /**
+   * Replay of a captured connection, in place of the server. The socket of
+   * the client is one end of a local pair: a thread reads what the client
+   * sends, and writes the received records into the other end. A record is
+   * delayed from the previous one by the time elapsed in the capture, scaled
+   * by the speed, so the latency of the server is kept while the time spent
+   * by the client is its own.
+   */
+  class SocketReplay : private OS::CThread
+  {
+  public:
+    /**
+     * Start the replay of the next capture of the server and port.
+     * @return the replay, else NULL when not found or failed
+     */
+    static SocketReplay* Open(const char *server, unsigned port);
+
+    /**
+     * Replace the connections by the captures of the directory.
+     * @param directory the directory path, else NULL to disable
+     * @param speed the pace in percent of the original, 0 for no delay
+     */
+    static void SetDirectory(const char *directory, unsigned speed);
+
+    /**
+     * @return true when the connections are replayed
+     */
+    static bool IsEnabled();
+
+    ~SocketReplay();
+
+    /**
+     * Hand over the end of the client, to be closed by the socket.
+     */
+    net_socket_t TakeHandle();
+
+  protected:
+    void* Process();
+
+  private:
+    FILE *m_file;
+    unsigned m_speed;
+    net_socket_t m_client;
+    net_socket_t m_server;
+    char *m_buffer;
+
+    SocketReplay(FILE *file, unsigned speed, net_socket_t client, net_socket_t server);
+    bool Expect(size_t size);
+    bool Deliver(size_t size);
+
+    // prevent copy
+    SocketReplay(const SocketReplay&);
+    SocketReplay& operator=(const SocketReplay&);
+  };
+
+}
+
+#endif	/* CAPTURE_H */
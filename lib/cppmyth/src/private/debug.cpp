@@ -20,25 +20,79 @@
  */
 
 #include "debug.h"
+#include "os/threads/thread.h"
 
 #include <cstdlib>
 #include <cstdarg>
 #include <cstdio>
 #include <cstring>
 #include <ctype.h>
+#include <string>
 
 #if defined(_MSC_VER) && _MSC_VER < 1900
 #define snprintf _snprintf
 #endif
 
+#define DBG_MSG_MAXSIZE     4096
+#define DBG_QUEUE_SIZE      512
+
+using namespace NSROOT;
+
+namespace
+{
+  /**
+   * Deliver the messages to the callback from a background thread. The ring
+   * keeps its buffers, so queuing doesn't allocate once warmed up. When the
+   * ring is full the message is dropped and counted.
+   */
+  class AsyncLogger : private OS::CThread
+  {
+  public:
+    AsyncLogger();
+    ~AsyncLogger();
+
+    void Push(int level, const char* msg);
+
+  private:
+    struct Record
+    {
+      int level;
+      std::string msg;
+    };
+
+    Record m_ring[DBG_QUEUE_SIZE];
+    unsigned m_head;
+    unsigned m_count;
+    unsigned m_dropped;
+    OS::CMutex m_mutex;
+
+    void* Process();
+    bool Deliver();
+  };
+}
+
 typedef struct
 {
   const char* name;
-  int cur_level;
+  volatile int cur_level;
   void (*msg_callback)(int level, char* msg);
+  AsyncLogger* async;
 } debug_ctx_t;
 
-static debug_ctx_t debug_ctx = {LIBTAG, DBG_NONE, NULL};
+static debug_ctx_t debug_ctx = {LIBTAG, DBG_NONE, NULL, NULL};
+static OS::CMutex debug_async_lock;
+
+static inline void __dbg_output(debug_ctx_t* ctx, int level, char* msg)
+{
+  if (ctx->msg_callback)
+  {
+    ctx->msg_callback(level, msg);
+  }
+  else
+  {
+    fwrite(msg, strlen(msg), 1, stderr);
+  }
+}
 
 /**
  * Set the debug level to be used for the subsystem
@@ -64,20 +118,95 @@ static inline void __dbg(debug_ctx_t* ctx, int level, const char* fmt, va_list a
 {
   if (ctx != NULL && level <= ctx->cur_level)
   {
-    char msg[4096];
+    char msg[DBG_MSG_MAXSIZE];
     int len = snprintf(msg, sizeof (msg), "(%s)", ctx->name);
-    vsnprintf(msg + len, sizeof (msg) - len, fmt, ap);
-    if (ctx->msg_callback)
+    int r = vsnprintf(msg + len, sizeof (msg) - len, fmt, ap);
+    // Mark a truncated payload
+    if (r < 0 || r >= (int)sizeof (msg) - len)
+      memcpy(msg + sizeof (msg) - 5, "...\n", 5);
+    OS::CLockGuard lock(debug_async_lock);
+    if (ctx->async)
     {
-      ctx->msg_callback(level, msg);
+      ctx->async->Push(level, msg);
     }
     else
     {
-      fwrite(msg, strlen(msg), 1, stderr);
+      lock.Unlock();
+      __dbg_output(ctx, level, msg);
     }
   }
 }
 
+AsyncLogger::AsyncLogger()
+: OS::CThread()
+, m_head(0)
+, m_count(0)
+, m_dropped(0)
+{
+  StartThread();
+}
+
+AsyncLogger::~AsyncLogger()
+{
+  StopThread();
+  // Flush the remaining messages
+  while (Deliver());
+}
+
+void AsyncLogger::Push(int level, const char* msg)
+{
+  {
+    OS::CLockGuard lock(m_mutex);
+    if (m_count == DBG_QUEUE_SIZE)
+    {
+      ++m_dropped;
+      return;
+    }
+    Record& rec = m_ring[(m_head + m_count++) % DBG_QUEUE_SIZE];
+    rec.level = level;
+    rec.msg.assign(msg);
+  }
+  WakeUp();
+}
+
+bool AsyncLogger::Deliver()
+{
+  char msg[DBG_MSG_MAXSIZE];
+  int level;
+  unsigned dropped;
+  {
+    OS::CLockGuard lock(m_mutex);
+    if (m_count == 0)
+      return false;
+    Record& rec = m_ring[m_head];
+    level = rec.level;
+    size_t len = rec.msg.copy(msg, sizeof (msg) - 1);
+    msg[len] = '\0';
+    m_head = (m_head + 1) % DBG_QUEUE_SIZE;
+    --m_count;
+    dropped = m_dropped;
+    m_dropped = 0;
+  }
+  if (dropped)
+  {
+    char info[64];
+    snprintf(info, sizeof (info), "(%s)%u messages dropped\n", debug_ctx.name, dropped);
+    __dbg_output(&debug_ctx, DBG_WARN, info);
+  }
+  __dbg_output(&debug_ctx, level, msg);
+  return true;
+}
+
+void* AsyncLogger::Process()
+{
+  while (!IsStopped())
+  {
+    while (Deliver());
+    Sleep(1000);
+  }
+  return NULL;
+}
+
 void NSROOT::DBGLevel(int l)
 {
   __dbg_setlevel(&debug_ctx, l);
@@ -93,7 +222,12 @@ void NSROOT::DBGNone()
   __dbg_setlevel(&debug_ctx, DBG_NONE);
 }
 
-void NSROOT::DBG(int level, const char* fmt, ...)
+bool NSROOT::DBGEnabled(int level)
+{
+  return level <= debug_ctx.cur_level;
+}
+
+void NSROOT::DBGMessage(int level, const char* fmt, ...)
 {
   va_list ap;
 
@@ -106,3 +240,21 @@ void NSROOT::SetDBGMsgCallback(void (*msgcb)(int level, char*))
 {
   debug_ctx.msg_callback = msgcb;
 }
+
+void NSROOT::DBGAsync(bool enable)
+{
+  AsyncLogger* async = NULL;
+  {
+    OS::CLockGuard lock(debug_async_lock);
+    if (enable && !debug_ctx.async)
+      debug_ctx.async = new AsyncLogger();
+    else if (!enable)
+    {
+      async = debug_ctx.async;
+      debug_ctx.async = NULL;
+    }
+  }
+  // Flush and stop outside the lock: the messages are delivered synchronously
+  // meanwhile
+  delete async;
+}
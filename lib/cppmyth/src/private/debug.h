@@ -37,9 +37,17 @@ namespace NSROOT
   void DBGLevel(int l);
   void DBGAll(void);
   void DBGNone(void);
-  void DBG(int level, const char* fmt, ...);
+  bool DBGEnabled(int level);
+  void DBGMessage(int level, const char* fmt, ...);
   void SetDBGMsgCallback(void (*msgcb)(int level, char*));
+  void DBGCapture(const char* directory);
+  void DBGReplay(const char* directory, unsigned speed);
+  void DBGAsync(bool enable);
 }
 
+/* The level is checked before the arguments are evaluated */
+#define DBG(level, ...) \
+  do { if (NSROOT::DBGEnabled(level)) NSROOT::DBGMessage(level, __VA_ARGS__); } while (0)
+
 #endif	/* DEBUG_H */
 
@@ -172,6 +172,8 @@ JSON::Node JSON::Node::GetObjectValue(const char *key) const
 JSON::Document::Document(NSROOT::WSResponse& resp)
 : m_isValid(false)
 , m_document(NULL)
+, m_bindMetric(resp.GetBindMetric())
+, m_bindStart(0)
 {
   std::string content;
   content.reserve(resp.GetContentLength());
@@ -184,7 +186,10 @@ JSON::Document::Document(NSROOT::WSResponse& resp)
   {
     DBG(DBG_PROTO, "%s: %s\n", __FUNCTION__, content.c_str());
     // Parse JSON content
+    int64_t start = Metrics::Clock();
     m_document = new sajson::document(sajson::parse(sajson::string(content.c_str(), content.length())));
+    m_bindStart = Metrics::Clock();
+    Metrics::Latency(resp.GetParseMetric(), m_bindStart - start);
     if (!m_document)
       DBG(DBG_ERROR, "%s: memory allocation failed\n", __FUNCTION__);
     else if (!m_document->is_valid())
@@ -198,6 +203,13 @@ JSON::Document::Document(NSROOT::WSResponse& resp)
   }
 }
 
+JSON::Document::~Document()
+{
+  if (m_isValid)
+    Metrics::Latency(m_bindMetric, Metrics::Clock() - m_bindStart);
+  SAFE_DELETE(m_document);
+}
+
 JSON::Node JSON::Document::GetRoot() const
 {
   if (m_document)
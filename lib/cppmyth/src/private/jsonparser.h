@@ -74,10 +74,7 @@ namespace JSON
   {
   public:
     Document(NSROOT::WSResponse& resp);
-    ~Document()
-    {
-      SAFE_DELETE(m_document);
-    }
+    ~Document();
 
     bool IsValid() const
     {
@@ -89,6 +86,8 @@ namespace JSON
   private:
     bool m_isValid;
     sajson::document *m_document;
+    Metrics::Id m_bindMetric;   ///< The content is bound until destruction
+    int64_t m_bindStart;
   };
 }
 }
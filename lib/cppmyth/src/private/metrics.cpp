@@ -0,0 +1,299 @@
+/*
+ *      Copyright (C) 2014-2016 Jean-Luc Barriere
+ *
+ *  This library is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation; either version 3, or (at your option)
+ *  any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301 USA
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "metrics.h"
+#include "os/threads/mutex.h"
+
+#include <map>
+#include <cstdio>
+
+#if __cplusplus >= 201103L
+#include <atomic>
+#define METRICS_ATOMIC
+#endif
+
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define snprintf _snprintf
+#endif
+
+#define INT64_HIGHEST   ((int64_t)(~(uint64_t)0 >> 1))
+
+using namespace NSROOT;
+
+namespace
+{
+#ifdef METRICS_ATOMIC
+  typedef std::atomic<int64_t> value_t;
+  typedef std::atomic<bool> flag_t;
+
+  inline int64_t __load(const value_t& v) { return v.load(std::memory_order_relaxed); }
+  inline void __store(value_t& v, int64_t n) { v.store(n, std::memory_order_relaxed); }
+  inline int64_t __fetch_add(value_t& v, int64_t n) { return v.fetch_add(n, std::memory_order_relaxed); }
+
+  inline void __store_min(value_t& v, int64_t n)
+  {
+    int64_t c = __load(v);
+    while (n < c && !v.compare_exchange_weak(c, n, std::memory_order_relaxed)) { }
+  }
+
+  inline void __store_max(value_t& v, int64_t n)
+  {
+    int64_t c = __load(v);
+    while (n > c && !v.compare_exchange_weak(c, n, std::memory_order_relaxed)) { }
+  }
+
+  inline bool __is_set(const flag_t& f) { return f.load(std::memory_order_acquire); }
+  inline void __set(flag_t& f) { f.store(true, std::memory_order_release); }
+#else
+  // Without atomics, each metric is guarded by its own lock and the lookup by
+  // the lock of the registry
+  typedef int64_t value_t;
+  typedef bool flag_t;
+
+  inline int64_t __load(const value_t& v) { return v; }
+  inline void __store(value_t& v, int64_t n) { v = n; }
+  inline int64_t __fetch_add(value_t& v, int64_t n) { int64_t c = v; v += n; return c; }
+  inline void __store_min(value_t& v, int64_t n) { if (n < v) v = n; }
+  inline void __store_max(value_t& v, int64_t n) { if (n > v) v = n; }
+  inline bool __is_set(const flag_t& f) { return f; }
+  inline void __set(flag_t& f) { f = true; }
+#endif
+
+  struct Metric
+  {
+    flag_t registered;
+    Metrics::METRIC_t type;
+    char name[METRICS_NAME_MAXSIZE];
+    value_t count;  // samples, or value of a counter
+    value_t value;  // last value of a gauge, or sum of latencies
+    value_t min;
+    value_t max;
+    value_t buckets[METRICS_BUCKETS];
+#ifndef METRICS_ATOMIC
+    OS::CMutex lock;
+#endif
+  };
+
+#ifdef METRICS_ATOMIC
+#define METRIC_GUARD(m)
+#else
+#define METRIC_GUARD(m) OS::CLockGuard _guard((m).lock)
+#endif
+
+  // Open addressing by the hash of the name. A slot is never released, so a
+  // lookup ends at the first free slot.
+  Metric s_metrics[METRICS_SLOTS];
+  OS::CMutex s_registryLock;
+
+  void __clear(Metric& m)
+  {
+    __store(m.count, 0);
+    __store(m.value, 0);
+    __store(m.min, INT64_HIGHEST);
+    __store(m.max, 0);
+    for (unsigned b = 0; b < METRICS_BUCKETS; ++b)
+      __store(m.buckets[b], 0);
+  }
+
+  unsigned __hash(const char *name, size_t len)
+  {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; ++i)
+      h = (h ^ (unsigned char)name[i]) * 16777619u;
+    return h & (METRICS_SLOTS - 1);
+  }
+
+  // Return the slot holding the name, or the free slot ending the lookup
+  unsigned __lookup(const char *name, size_t len, bool& found)
+  {
+    unsigned h = __hash(name, len);
+    for (unsigned i = 0; i < METRICS_SLOTS; ++i)
+    {
+      unsigned id = (h + i) & (METRICS_SLOTS - 1);
+      const Metric& m = s_metrics[id];
+      if (!__is_set(m.registered))
+      {
+        found = false;
+        return id;
+      }
+      if (strncmp(m.name, name, len) == 0 && m.name[len] == '\0')
+      {
+        found = true;
+        return id;
+      }
+    }
+    found = false;
+    return METRICS_NONE;
+  }
+
+  unsigned __bucket(int64_t usec)
+  {
+    unsigned b = 0;
+    while (usec > 1 && b < METRICS_BUCKETS - 1)
+    {
+      usec >>= 1;
+      ++b;
+    }
+    return b;
+  }
+
+  // Upper bound of the bucket holding the given rank
+  int64_t __percentile(const int64_t *buckets, int64_t count, int64_t max, unsigned pct)
+  {
+    int64_t rank = (count * pct + 99) / 100;
+    int64_t n = 0;
+    for (unsigned b = 0; b < METRICS_BUCKETS; ++b)
+    {
+      n += buckets[b];
+      if (n >= rank)
+        return ((int64_t)2 << b) < max ? ((int64_t)2 << b) : max;
+    }
+    return max;
+  }
+}
+
+Metrics::Id Metrics::Register(const char *name, size_t len, METRIC_t type)
+{
+  bool found;
+  if (len >= METRICS_NAME_MAXSIZE)
+    len = METRICS_NAME_MAXSIZE - 1;
+#ifdef METRICS_ATOMIC
+  unsigned id = __lookup(name, len, found);
+  if (found || id == METRICS_NONE)
+    return id;
+  OS::CLockGuard lock(s_registryLock);
+#else
+  OS::CLockGuard lock(s_registryLock);
+  unsigned id;
+#endif
+  // Look again as another thread could have registered it meanwhile
+  id = __lookup(name, len, found);
+  if (found || id == METRICS_NONE)
+    return id;
+  Metric& m = s_metrics[id];
+  m.type = type;
+  memcpy(m.name, name, len);
+  m.name[len] = '\0';
+  __clear(m);
+  __set(m.registered);
+  return id;
+}
+
+void Metrics::Count(Id id, int64_t n)
+{
+  if (id >= METRICS_SLOTS)
+    return;
+  Metric& m = s_metrics[id];
+  METRIC_GUARD(m);
+  __fetch_add(m.count, n);
+}
+
+void Metrics::Gauge(Id id, int64_t value)
+{
+  if (id >= METRICS_SLOTS)
+    return;
+  Metric& m = s_metrics[id];
+  METRIC_GUARD(m);
+  __store(m.value, value);
+  __store_max(m.max, value);
+  __fetch_add(m.count, 1);
+}
+
+void Metrics::Latency(Id id, int64_t usec)
+{
+  if (id >= METRICS_SLOTS)
+    return;
+  if (usec < 0)
+    usec = 0;
+  Metric& m = s_metrics[id];
+  METRIC_GUARD(m);
+  __fetch_add(m.value, usec);
+  __store_min(m.min, usec);
+  __store_max(m.max, usec);
+  __fetch_add(m.buckets[__bucket(usec)], 1);
+  __fetch_add(m.count, 1);
+}
+
+std::string Metrics::Snapshot()
+{
+  // Sorted by name
+  std::map<std::string, unsigned> index;
+  {
+    OS::CLockGuard lock(s_registryLock);
+    for (unsigned id = 0; id < METRICS_SLOTS; ++id)
+    {
+      if (__is_set(s_metrics[id].registered))
+        index.insert(std::make_pair(std::string(s_metrics[id].name), id));
+    }
+  }
+
+  std::string report;
+  char buf[256];
+  for (std::map<std::string, unsigned>::const_iterator it = index.begin(); it != index.end(); ++it)
+  {
+    Metric& m = s_metrics[it->second];
+    METRIC_GUARD(m);
+    int64_t count = __load(m.count);
+    switch (m.type)
+    {
+      case COUNTER:
+        snprintf(buf, sizeof(buf), ": %lld\n", (long long)count);
+        break;
+      case GAUGE:
+        snprintf(buf, sizeof(buf), ": %lld (max %lld)\n", (long long)__load(m.value), (long long)__load(m.max));
+        break;
+      case LATENCY:
+      {
+        if (count == 0)
+        {
+          snprintf(buf, sizeof(buf), ": n=0\n");
+          break;
+        }
+        // Samples keep coming: the figures are a close approximation
+        int64_t buckets[METRICS_BUCKETS];
+        for (unsigned b = 0; b < METRICS_BUCKETS; ++b)
+          buckets[b] = __load(m.buckets[b]);
+        int64_t max = __load(m.max);
+        snprintf(buf, sizeof(buf), ": n=%lld avg=%.3fms min=%.3fms p50<=%.3fms p90<=%.3fms p99<=%.3fms max=%.3fms\n",
+                (long long)count, (double)__load(m.value) / count / 1000.0, __load(m.min) / 1000.0,
+                __percentile(buckets, count, max, 50) / 1000.0, __percentile(buckets, count, max, 90) / 1000.0,
+                __percentile(buckets, count, max, 99) / 1000.0, max / 1000.0);
+        break;
+      }
+    }
+    report.append(it->first).append(buf);
+  }
+  return report;
+}
+
+void Metrics::Reset()
+{
+  OS::CLockGuard lock(s_registryLock);
+  for (unsigned id = 0; id < METRICS_SLOTS; ++id)
+  {
+    Metric& m = s_metrics[id];
+    if (__is_set(m.registered))
+    {
+      METRIC_GUARD(m);
+      __clear(m);
+    }
+  }
+}
@@ -0,0 +1,103 @@
+/*
+ *      Copyright (C) 2014-2016 Jean-Luc Barriere
+ *
+ *  This library is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation; either version 3, or (at your option)
+ *  any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301 USA
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef METRICS_H
+#define	METRICS_H
+
+#include <cppmyth_config.h>
+#include "os/threads/timeout.h"
+
+#include <cstring>
+#include <string>
+
+#define METRICS_BUCKETS       32
+#define METRICS_SLOTS         256   // power of 2
+#define METRICS_NAME_MAXSIZE  64
+#define METRICS_NONE          ((unsigned)-1)
+
+namespace NSROOT
+{
+
+  /**
+   * Process wide registry of counters, gauges and latency histograms. The
+   * histograms count the samples by power of 2 of microseconds.
+   *
+   * A metric is registered once by name and then fed by its id. Looking up a
+   * registered name is lock free, and the samples are accumulated with atomic
+   * operations, so callers on a hot path keep the id of a static name.
+   */
+  class Metrics
+  {
+  public:
+    typedef enum
+    {
+      COUNTER,
+      GAUGE,
+      LATENCY,
+    } METRIC_t;
+
+    typedef unsigned Id;
+
+    /**
+     * Return the id of the metric, registering it on first use. A name longer
+     * than METRICS_NAME_MAXSIZE is truncated.
+     * @return the id, or METRICS_NONE when the registry is full
+     */
+    static Id Register(const char *name, METRIC_t type) { return Register(name, strlen(name), type); }
+    static Id Register(const char *name, size_t len, METRIC_t type);
+
+    static void Count(Id id, int64_t n = 1);
+    static void Gauge(Id id, int64_t value);
+    static void Latency(Id id, int64_t usec);
+
+    /**
+     * @return a text report of all metrics, one per line
+     */
+    static std::string Snapshot();
+    /**
+     * Clear the samples. The ids remain valid.
+     */
+    static void Reset();
+
+    static int64_t Clock() { return OS::gettime_us(); }
+  };
+
+  /**
+   * Register the latency of the scope on destruction.
+   */
+  class MetricsTimer
+  {
+  public:
+    MetricsTimer(Metrics::Id id) : m_id(id), m_start(Metrics::Clock()) { }
+    ~MetricsTimer() { Metrics::Latency(m_id, Metrics::Clock() - m_start); }
+
+  private:
+    Metrics::Id m_id;
+    int64_t m_start;
+
+    // prevent copy
+    MetricsTimer(const MetricsTimer&);
+    MetricsTimer& operator=(const MetricsTimer&);
+  };
+
+}
+
+#endif	/* METRICS_H */
@@ -72,6 +72,12 @@ namespace OS
     return pthread_create(thread, &_attr, func, arg) == 0;
   }
 
+#define thread_self() __thread_self()
+  inline thread_t __thread_self() { return pthread_self(); }
+
+#define thread_equal(a, b) __thread_equal(a, b)
+  inline bool __thread_equal(thread_t a, thread_t b) { return pthread_equal(a, b) != 0; }
+
   typedef pthread_mutex_t mutex_t;
 
 #define mutex_init(a) __mutex_init(a)
@@ -59,11 +59,7 @@ CThreadPool::~CThreadPool()
   // Reject new runs
   m_stopped = true;
   // Destroy all queued workers
-  while (!m_queue.empty())
-  {
-    delete m_queue.front();
-    m_queue.pop();
-  }
+  ClearQueue();
   // Finalize all running
   if (!m_pool.empty())
   {
@@ -78,14 +74,40 @@ CThreadPool::~CThreadPool()
   }
 }
 
-bool CThreadPool::Enqueue(CWorker* worker)
+CThreadPool& CThreadPool::Shared()
+{
+  static CThreadPool _pool(THREADPOOL_SHARED_SIZE);
+  return _pool;
+}
+
+bool CThreadPool::Enqueue(CWorker* worker, PRIORITY priority, CCompletion* completion)
 {
   assert(worker->m_queued != true);
   CLockGuard lock(m_mutex);
   if (!m_stopped)
   {
     worker->m_queued = true;
-    m_queue.push(worker);
+    worker->m_completion = completion;
+    if (completion)
+      completion->Add();
+    // Work spawned by a pool thread stays on its own deque, unless it is
+    // urgent. Then any idle thread could steal it.
+    CWorkerThread* _thread = (priority != PRIORITY_HIGH ? CurrentThread() : NULL);
+    if (_thread)
+    {
+      CLockGuard tlock(_thread->m_mutex);
+      _thread->m_deque.push_back(worker);
+      tlock.Unlock();
+      if (!m_suspended)
+      {
+        if (m_waitingCount)
+          m_queueFill.Signal();
+        else if (m_poolSize < m_size)
+          StartThread(new CWorkerThread(*this));
+      }
+      return true;
+    }
+    m_queue[priority].push_back(worker);
     if (!m_suspended)
     {
       if (m_waitingCount)
@@ -129,13 +151,18 @@ unsigned CThreadPool::Size() const
 unsigned CThreadPool::QueueSize() const
 {
   CLockGuard lock(m_mutex);
-  return static_cast<unsigned>(m_queue.size());
+  unsigned size = SharedQueueSize();
+  for (std::set<CWorkerThread*>::const_iterator it = m_pool.begin(); it != m_pool.end(); ++it)
+  {
+    CLockGuard tlock((*it)->m_mutex);
+    size += static_cast<unsigned>((*it)->m_deque.size());
+  }
+  return size;
 }
 
 bool CThreadPool::IsQueueEmpty() const
 {
-  CLockGuard lock(m_mutex);
-  return m_queue.empty();
+  return QueueSize() == 0;
 }
 
 bool CThreadPool::waitEmpty(unsigned millisec)
@@ -159,6 +186,9 @@ void CThreadPool::Resume()
   CLockGuard lock(m_mutex);
   m_suspended = false;
   __resize();
+  // Wake the threads holding work on their own deque
+  if (m_waitingCount)
+    m_queueFill.Broadcast();
 }
 
 bool CThreadPool::IsSuspended() const
@@ -172,11 +202,7 @@ void CThreadPool::Reset()
   CLockGuard lock(m_mutex);
   m_stopped = true;
   // Destroy all queued workers
-  while (!m_queue.empty())
-  {
-    delete m_queue.front();
-    m_queue.pop();
-  }
+  ClearQueue();
 }
 
 void CThreadPool::Stop()
@@ -199,21 +225,96 @@ bool CThreadPool::IsStopped() const
 
 CWorker* CThreadPool::PopQueue(CWorkerThread* _thread)
 {
-  (void)_thread;
+  if (m_suspended)
+    return NULL;
+  // First the most recent work pushed on the own deque
+  {
+    CLockGuard tlock(_thread->m_mutex);
+    if (!_thread->m_deque.empty())
+    {
+      CWorker* worker = _thread->m_deque.back();
+      _thread->m_deque.pop_back();
+      return worker;
+    }
+  }
   CLockGuard lock(m_mutex);
   if (!m_suspended)
   {
     m_queueEmpty.Signal();
-    if (!m_queue.empty())
+    for (unsigned p = 0; p < PRIORITY_COUNT; ++p)
     {
-      CWorker* worker = m_queue.front();
-      m_queue.pop();
-      return worker;
+      if (!m_queue[p].empty())
+      {
+        CWorker* worker = m_queue[p].front();
+        m_queue[p].pop_front();
+        return worker;
+      }
+    }
+    return StealQueue(_thread);
+  }
+  return NULL;
+}
+
+CWorker* CThreadPool::StealQueue(CWorkerThread* _thread)
+{
+  // Take the oldest work from a busy thread. A thread holding its lock is
+  // skipped rather than waited for.
+  for (std::set<CWorkerThread*>::iterator it = m_pool.begin(); it != m_pool.end(); ++it)
+  {
+    if (*it == _thread || !(*it)->m_mutex.TryLock())
+      continue;
+    CWorker* worker = NULL;
+    if (!(*it)->m_deque.empty())
+    {
+      worker = (*it)->m_deque.front();
+      (*it)->m_deque.pop_front();
     }
+    (*it)->m_mutex.Unlock();
+    if (worker)
+      return worker;
   }
   return NULL;
 }
 
+CWorkerThread* CThreadPool::CurrentThread() const
+{
+  for (std::set<CWorkerThread*>::const_iterator it = m_pool.begin(); it != m_pool.end(); ++it)
+  {
+    if ((*it)->IsCurrent())
+      return *it;
+  }
+  return NULL;
+}
+
+unsigned CThreadPool::SharedQueueSize() const
+{
+  unsigned size = 0;
+  for (unsigned p = 0; p < PRIORITY_COUNT; ++p)
+    size += static_cast<unsigned>(m_queue[p].size());
+  return size;
+}
+
+void CThreadPool::ClearQueue()
+{
+  for (unsigned p = 0; p < PRIORITY_COUNT; ++p)
+  {
+    while (!m_queue[p].empty())
+    {
+      __release(m_queue[p].front());
+      m_queue[p].pop_front();
+    }
+  }
+  for (std::set<CWorkerThread*>::iterator it = m_pool.begin(); it != m_pool.end(); ++it)
+  {
+    CLockGuard tlock((*it)->m_mutex);
+    while (!(*it)->m_deque.empty())
+    {
+      __release((*it)->m_deque.front());
+      (*it)->m_deque.pop_front();
+    }
+  }
+}
+
 void CThreadPool::WaitQueue(CWorkerThread* _thread)
 {
   (void)_thread;
@@ -240,7 +341,25 @@ void CThreadPool::FinalizeThread(CWorkerThread* _thread)
   if (m_pool.erase(_thread))
   {
     --m_poolSize;
+    // Hand over the work left on its deque
+    CLockGuard tlock(_thread->m_mutex);
+    while (!_thread->m_deque.empty())
+    {
+      if (m_stopped)
+        __release(_thread->m_deque.front());
+      else
+        m_queue[PRIORITY_NORMAL].push_back(_thread->m_deque.front());
+      _thread->m_deque.pop_front();
+    }
+    tlock.Unlock();
     delete _thread;
+    if (!m_suspended && SharedQueueSize() > 0)
+    {
+      if (m_waitingCount)
+        m_queueFill.Signal();
+      else
+        __resize();
+    }
   }
   if (m_pool.empty())
   {
@@ -251,9 +370,9 @@ void CThreadPool::FinalizeThread(CWorkerThread* _thread)
 
 void CThreadPool::__resize()
 {
-  if (m_poolSize < m_size && !m_queue.empty())
+  if (m_poolSize < m_size && SharedQueueSize() > 0)
   {
-    for (unsigned i = m_queue.size(); i > 0; --i)
+    for (unsigned i = SharedQueueSize(); i > 0; --i)
     {
       if (m_poolSize >= m_size)
         break;
@@ -277,3 +396,11 @@ void CThreadPool::__resize()
         m_queueFill.Broadcast();
   }
 }
+
+void CThreadPool::__release(CWorker* worker)
+{
+  CCompletion* completion = worker->m_completion;
+  delete worker;
+  if (completion)
+    completion->Done();
+}
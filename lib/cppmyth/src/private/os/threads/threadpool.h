@@ -23,9 +23,11 @@
 #include "thread.h"
 #include "event.h"
 
-#include <queue>
+#include <deque>
 #include <set>
 
+#define THREADPOOL_SHARED_SIZE  8
+
 #ifdef NSROOT
 namespace NSROOT {
 #endif
@@ -36,15 +38,86 @@ namespace OS
 
   class CWorkerThread;
 
+  /**
+   * Counter of outstanding workers. Each worker enqueued with a completion
+   * holds one count until it has been processed or discarded, so a caller
+   * can fork a batch of jobs then wait for all of them.
+   */
+  class CCompletion
+  {
+  public:
+    CCompletion() : m_count(0), m_done(true) { }
+    ~CCompletion() { }
+
+    void Add()
+    {
+      CLockGuard lock(m_mutex);
+      ++m_count;
+      m_done = false;
+    }
+
+    void Done()
+    {
+      CLockGuard lock(m_mutex);
+      if (m_count > 0 && --m_count == 0)
+      {
+        m_done = true;
+        m_condition.Broadcast();
+      }
+    }
+
+    unsigned Pending() const
+    {
+      CLockGuard lock(m_mutex);
+      return m_count;
+    }
+
+    bool Wait()
+    {
+      CLockGuard lock(m_mutex);
+      return m_condition.Wait(m_mutex, m_done);
+    }
+
+    bool Wait(unsigned millisec)
+    {
+      CLockGuard lock(m_mutex);
+      return m_condition.Wait(m_mutex, m_done, millisec);
+    }
+
+  private:
+    mutable CMutex            m_mutex;
+    CCondition<volatile bool> m_condition;
+    unsigned                  m_count;
+    volatile bool             m_done;
+
+    // Prevent copy
+    CCompletion(const CCompletion& other);
+    CCompletion& operator=(const CCompletion& other);
+  };
+
   class CThreadPool
   {
     friend class CWorkerThread;
   public:
+    enum PRIORITY
+    {
+      PRIORITY_HIGH     = 0,
+      PRIORITY_NORMAL   = 1,
+      PRIORITY_LOW      = 2,
+    };
+
     CThreadPool();
     CThreadPool(unsigned size);
     ~CThreadPool();
 
-    bool Enqueue(CWorker* worker);
+    /**
+     * The executor shared by the library and its clients. It is meant for
+     * finite work: a loop blocking for the life of its owner would hold one
+     * of the threads for good, so it should run on its own CThread.
+     */
+    static CThreadPool& Shared();
+
+    bool Enqueue(CWorker* worker, PRIORITY priority = PRIORITY_NORMAL, CCompletion* completion = NULL);
 
     unsigned GetMaxSize() const { return m_size; }
 
@@ -69,6 +142,8 @@ namespace OS
     bool IsStopped() const;
 
   private:
+    enum { PRIORITY_COUNT = 3 };
+
     unsigned      m_size;
     unsigned      m_keepAlive;
     unsigned      m_poolSize;
@@ -77,7 +152,9 @@ namespace OS
     volatile bool m_suspended;
     volatile bool m_empty;
 
-    std::queue<CWorker*>      m_queue;
+    // The shared queues are fed by foreign threads. Workers enqueued from a
+    // pool thread are pushed on its own deque, and idle threads steal them.
+    std::deque<CWorker*>      m_queue[PRIORITY_COUNT];
     std::set<CWorkerThread*>  m_pool;
     mutable CMutex            m_mutex;
     CCondition<volatile bool> m_condition;
@@ -85,42 +162,58 @@ namespace OS
     CEvent                    m_queueEmpty;
 
     CWorker* PopQueue(CWorkerThread* _thread);
+    CWorker* StealQueue(CWorkerThread* _thread);
+    CWorkerThread* CurrentThread() const;
+    unsigned SharedQueueSize() const;
+    void ClearQueue();
     void WaitQueue(CWorkerThread* _thread);
     void StartThread(CWorkerThread* _thread);
     void FinalizeThread(CWorkerThread* _thread);
     void __resize();
+    static void __release(CWorker* worker);
   };
 
   class CWorker
   {
     friend class CThreadPool;
+    friend class CWorkerThread;
   public:
-    CWorker() : m_queued(false) { }
+    CWorker() : m_queued(false), m_completion(NULL) { }
     virtual ~CWorker() { }
     virtual void Process() = 0;
 
   private:
     bool m_queued;
+    CCompletion* m_completion;
   };
 
   class CWorkerThread : public CThread
   {
+    friend class CThreadPool;
   public:
     CWorkerThread(CThreadPool& pool)
     : CThread()
-    , m_threadPool(pool) { m_finalizeOnStop = true; }
+    , m_threadPool(pool)
+    , m_self()
+    , m_started(false) { m_finalizeOnStop = true; }
 
     void* Process(void)
     {
       bool waiting = false;
 
+      {
+        CLockGuard lock(m_mutex);
+        m_self = thread_self();
+        m_started = true;
+      }
+
       while (!IsStopped())
       {
         CWorker* worker = m_threadPool.PopQueue(this);
         if (worker != NULL)
         {
           worker->Process();
-          delete worker;
+          CThreadPool::__release(worker);
           waiting = false;
         }
         else if (!waiting)
@@ -141,7 +234,17 @@ namespace OS
     }
 
   private:
-    CThreadPool& m_threadPool;
+    CThreadPool&          m_threadPool;
+    CMutex                m_mutex;
+    std::deque<CWorker*>  m_deque;
+    thread_t              m_self;
+    bool                  m_started;
+
+    bool IsCurrent()
+    {
+      CLockGuard lock(m_mutex);
+      return m_started && thread_equal(m_self, thread_self());
+    }
   };
 
 }
@@ -24,6 +24,8 @@
 
 #if defined(__APPLE__)
 #include <mach/mach_time.h>
+#elif !defined(__WINDOWS__)
+#include <time.h>
 #endif
 
 #ifdef NSROOT
@@ -60,6 +62,30 @@ namespace OS
 #endif
   }
 
+#define gettime_us __gettime_us
+  inline int64_t __gettime_us()
+  {
+#if defined(__APPLE__)
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0)
+      (void)mach_timebase_info(&timebase);
+    return (int64_t)(mach_absolute_time() * timebase.numer / timebase.denom / 1000);
+#elif defined(__WINDOWS__)
+    LARGE_INTEGER tickPerSecond;
+    LARGE_INTEGER tick;
+    if (QueryPerformanceFrequency(&tickPerSecond))
+    {
+      QueryPerformanceCounter(&tick);
+      return (int64_t) (tick.QuadPart / (tickPerSecond.QuadPart / 1000000.0));
+    }
+    return -1;
+#else
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (int64_t)time.tv_sec * 1000000 + time.tv_nsec / 1000;
+#endif
+  }
+
   class CTimeout
   {
   public:
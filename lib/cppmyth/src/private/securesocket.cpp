@@ -20,10 +20,16 @@
  */
 
 #include "securesocket.h"
+#include "capture.h"
+#include "socketpoll.h"
 #include "debug.h"
 #include "cppdef.h"
+#include "os/threads/timeout.h"
 
 #include <errno.h>
+#include <cstdio>
+#include <cstring>
+#include <vector>
 
 #ifdef __WINDOWS__
 #include <WinSock2.h>
@@ -50,6 +56,75 @@ void SSLSessionFactory::Destroy()
   SAFE_DELETE(m_instance);
 }
 
+static std::string __peer(const char* server, unsigned port)
+{
+  char buf[12];
+  sprintf(buf, "%u", port);
+  return std::string(server).append(":").append(buf);
+}
+
+SecureSocket* SSLSessionFactory::TakeSocket(const std::string& server, unsigned port)
+{
+  std::string peer = __peer(server.c_str(), port);
+  std::vector<SecureSocket*> expired;
+  SecureSocket* socket = NULL;
+  {
+    OS::CLockGuard lock(m_mutex);
+    // The list is ordered by release time
+    int64_t now = OS::gettime_ms();
+    while (!m_idleSockets.empty() && m_idleSockets.front().expiry <= now)
+    {
+      expired.push_back(m_idleSockets.front().socket);
+      m_idleSockets.pop_front();
+    }
+    // Take the most recent one
+    for (IdleSocketList::iterator it = m_idleSockets.end(); it != m_idleSockets.begin();)
+    {
+      if ((--it)->peer == peer)
+      {
+        socket = it->socket;
+        m_idleSockets.erase(it);
+        break;
+      }
+    }
+  }
+  for (std::vector<SecureSocket*>::iterator it = expired.begin(); it != expired.end(); ++it)
+    delete *it;
+  // An idle connection has nothing to read, else the server closed it
+  if (socket && SocketPoll::Wait(socket->GetHandle(), SOCKETPOLL_READ, 0) != 0)
+  {
+    DBG(DBG_DEBUG, "%s: connection to %s was closed\n", __FUNCTION__, peer.c_str());
+    SAFE_DELETE(socket);
+  }
+  return socket;
+}
+
+void SSLSessionFactory::ReleaseSocket(SecureSocket* socket)
+{
+  if (socket == NULL)
+    return;
+  if (!socket->IsValid() || socket->m_peer.empty())
+  {
+    delete socket;
+    return;
+  }
+  SecureSocket* dropped = NULL;
+  {
+    OS::CLockGuard lock(m_mutex);
+    IdleSocket idle;
+    idle.peer = socket->m_peer;
+    idle.socket = socket;
+    idle.expiry = OS::gettime_ms() + SSL_POOL_IDLE_TIMEOUT * 1000;
+    m_idleSockets.push_back(idle);
+    if (m_idleSockets.size() > SSL_POOL_MAXSIZE)
+    {
+      dropped = m_idleSockets.front().socket;
+      m_idleSockets.pop_front();
+    }
+  }
+  SAFE_DELETE(dropped);
+}
+
 #if HAVE_OPENSSL
 
 #include <openssl/ssl.h>
@@ -92,6 +167,13 @@ SSLSessionFactory::SSLSessionFactory()
       const long flags = SSL_OP_ALL | SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3 | SSL_OP_NO_COMPRESSION;
       (void)SSL_CTX_set_options(static_cast<SSL_CTX*>(m_ctx), flags);
 
+      /* The client sessions are cached by peer, so a reconnect resumes with
+       * an abbreviated handshake. The internal store is for the server side,
+       * the new sessions are taken by the callback.
+       */
+      SSL_CTX_set_session_cache_mode(static_cast<SSL_CTX*>(m_ctx), SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+      SSL_CTX_sess_set_new_cb(static_cast<SSL_CTX*>(m_ctx), NewSessionCallback);
+
       /* Each cipher suite takes 2 bytes in the ClientHello, so advertising every
        * cipher suite available at the client is going to cause a big ClientHello
        * (or bigger then needed to get the job done).
@@ -112,6 +194,12 @@ SSLSessionFactory::SSLSessionFactory()
 
 SSLSessionFactory::~SSLSessionFactory()
 {
+  for (IdleSocketList::iterator it = m_idleSockets.begin(); it != m_idleSockets.end(); ++it)
+    delete it->socket;
+  m_idleSockets.clear();
+  for (SessionMap::iterator it = m_sessions.begin(); it != m_sessions.end(); ++it)
+    SSL_SESSION_free(static_cast<SSL_SESSION*>(it->second));
+  m_sessions.clear();
   if (m_ctx)
     SSL_CTX_free(static_cast<SSL_CTX*>(m_ctx));
   ERR_free_strings();
@@ -136,12 +224,54 @@ SecureSocket* SSLSessionFactory::NewSocket()
   return NULL;
 }
 
+int SSLSessionFactory::NewSessionCallback(SSL* ssl, SSL_SESSION* session)
+{
+  SecureSocket* socket = static_cast<SecureSocket*>(SSL_get_app_data(ssl));
+  if (socket == NULL || socket->m_peer.empty())
+    return 0;
+  Instance().StoreSession(socket->m_peer, session);
+  return 1; /* the reference is kept */
+}
+
+void SSLSessionFactory::StoreSession(const std::string& peer, void* session)
+{
+  OS::CLockGuard lock(m_mutex);
+  SessionMap::iterator it = m_sessions.find(peer);
+  if (it != m_sessions.end())
+  {
+    SSL_SESSION_free(static_cast<SSL_SESSION*>(it->second));
+    it->second = session;
+  }
+  else
+    m_sessions.insert(std::make_pair(peer, session));
+}
+
+void SSLSessionFactory::SetSession(void* ssl, const std::string& peer)
+{
+  OS::CLockGuard lock(m_mutex);
+  SessionMap::const_iterator it = m_sessions.find(peer);
+  if (it != m_sessions.end())
+    SSL_set_session(static_cast<SSL*>(ssl), static_cast<SSL_SESSION*>(it->second));
+}
+
+void SSLSessionFactory::ClearSession(const std::string& peer)
+{
+  OS::CLockGuard lock(m_mutex);
+  SessionMap::iterator it = m_sessions.find(peer);
+  if (it != m_sessions.end())
+  {
+    SSL_SESSION_free(static_cast<SSL_SESSION*>(it->second));
+    m_sessions.erase(it);
+  }
+}
+
 SecureSocket::SecureSocket(void* ssl)
 : TcpSocket()
 , m_ssl(ssl)
 , m_cert(NULL)
 , m_connected(false)
 , m_ssl_error(0)
+, m_peer()
 {
 }
 
@@ -161,9 +291,20 @@ bool SecureSocket::Connect(const char* server, unsigned port, int rcvbuf)
   if (!TcpSocket::Connect(server, port, rcvbuf))
     return false;
 
+  m_peer = __peer(server, port);
+  /* a replay serves the data after decryption */
+  if (m_replay)
+  {
+    m_connected = true;
+    return true;
+  }
+
   /* setup SSL */
   SSL_set_fd(static_cast<SSL*>(m_ssl), m_socket);
+  SSL_set_app_data(static_cast<SSL*>(m_ssl), this);
   SSL_set_tlsext_host_name(static_cast<SSL*>(m_ssl), server); /* fix SNI */
+  /* resume the last session with the peer */
+  SSLSessionFactory::Instance().SetSession(m_ssl, m_peer);
 
   /* do SSL handshake */
   for (;;)
@@ -182,10 +323,13 @@ bool SecureSocket::Connect(const char* server, unsigned port, int rcvbuf)
     }
     const char* errmsg = ERR_error_string(ERR_get_error(), NULL);
     DBG(DBG_ERROR, "%s: SSL connect failed: %s\n", __FUNCTION__, errmsg);
+    /* don't offer the session again */
+    SSLSessionFactory::Instance().ClearSession(m_peer);
     TcpSocket::Disconnect();
     return false;
   }
-  DBG(DBG_PROTO, "%s: SSL handshake initialized\n", __FUNCTION__);
+  DBG(DBG_PROTO, "%s: SSL handshake initialized (%s)\n", __FUNCTION__,
+          (SSL_session_reused(static_cast<SSL*>(m_ssl)) ? "resumed" : "full"));
   m_connected = true;
   /* check for a valid certificate */
   std::string str("");
@@ -200,6 +344,33 @@ bool SecureSocket::Connect(const char* server, unsigned port, int rcvbuf)
 
 size_t SecureSocket::ReceiveData(void* buf, size_t n)
 {
+  if (m_replay)
+    return TcpSocket::ReceiveData(buf, n);
+  if (m_connected && n > 0)
+  {
+    // Serve first the data left in the buffer by a peek
+    if (BufferedData() > 0)
+    {
+      const char* data;
+      size_t s = PeekData(&data);
+      if (s > n)
+        s = n;
+      memcpy(buf, data, s);
+      ConsumeData(s);
+      return s;
+    }
+    size_t r = ReceiveSome(buf, n);
+    if (m_capture && r > 0)
+      m_capture->Record(CAPTURE_RECEIVED, buf, r);
+    return r;
+  }
+  return 0;
+}
+
+size_t SecureSocket::ReceiveSome(void* buf, size_t n)
+{
+  if (m_replay)
+    return TcpSocket::ReceiveSome(buf, n);
   if (m_connected && n > 0)
   {
     m_ssl_error = SSL_ERROR_NONE;
@@ -251,6 +422,8 @@ size_t SecureSocket::ReceiveData(void* buf, size_t n)
 
 bool SecureSocket::SendData(const char* buf, size_t size)
 {
+  if (m_replay)
+    return TcpSocket::SendData(buf, size);
   if (m_connected && size > 0)
   {
     m_ssl_error = SSL_ERROR_NONE;
@@ -258,7 +431,11 @@ bool SecureSocket::SendData(const char* buf, size_t size)
     {
       int r = SSL_write(static_cast<SSL*>(m_ssl), buf, (int) size);
       if (r > 0 && size == (size_t) r)
+      {
+        if (m_capture)
+          m_capture->Record(CAPTURE_SENT, buf, size);
         return true;
+      }
       int err = SSL_get_error(static_cast<SSL*>(m_ssl), r);
       if (err == SSL_ERROR_WANT_WRITE)
       {
@@ -284,7 +461,8 @@ void SecureSocket::Disconnect()
 {
   if (m_connected)
   {
-    SSL_shutdown(static_cast<SSL*>(m_ssl));
+    if (!m_replay)
+      SSL_shutdown(static_cast<SSL*>(m_ssl));
     m_connected = false;
   }
   TcpSocket::Disconnect();
@@ -341,6 +519,7 @@ SecureSocket::SecureSocket(void* ssl)
 , m_cert(NULL)
 , m_connected(false)
 , m_ssl_error(0)
+, m_peer()
 {
 }
 
@@ -363,6 +542,13 @@ size_t SecureSocket::ReceiveData(void* buf, size_t n)
   return 0;
 }
 
+size_t SecureSocket::ReceiveSome(void* buf, size_t n)
+{
+  (void)buf;
+  (void)n;
+  return 0;
+}
+
 bool SecureSocket::SendData(const char* buf, size_t size)
 {
   (void)buf;
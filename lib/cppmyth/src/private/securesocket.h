@@ -23,8 +23,14 @@
 #define SECURESOCKET_H
 
 #include "socket.h"
+#include "os/threads/mutex.h"
 
 #include <string>
+#include <map>
+#include <list>
+
+#define SSL_POOL_MAXSIZE        4
+#define SSL_POOL_IDLE_TIMEOUT   10    // s
 
 namespace NSROOT
 {
@@ -38,7 +44,21 @@ namespace NSROOT
     bool isEnabled() const { return m_enabled; }
     SecureSocket* NewSocket();
 
+    /**
+     * Take a connection kept alive to the host.
+     * @return the connected socket, else NULL
+     */
+    SecureSocket* TakeSocket(const std::string& server, unsigned port);
+
+    /**
+     * Keep the connected socket for the next request to its host. The
+     * factory takes the ownership.
+     */
+    void ReleaseSocket(SecureSocket* socket);
+
   private:
+    friend class SecureSocket;
+
     SSLSessionFactory();
     ~SSLSessionFactory();
     SSLSessionFactory(const SSLSessionFactory&);
@@ -47,6 +67,24 @@ namespace NSROOT
     static SSLSessionFactory* m_instance;
     bool m_enabled;   ///< SSL feature status
     void* m_ctx;      ///< SSL default context for the application
+
+    struct IdleSocket
+    {
+      std::string peer;
+      SecureSocket* socket;
+      int64_t expiry;
+    };
+    typedef std::map<std::string, void*> SessionMap;
+    typedef std::list<IdleSocket> IdleSocketList;
+
+    OS::CMutex m_mutex;
+    SessionMap m_sessions;        ///< The last session by peer host:port
+    IdleSocketList m_idleSockets; ///< The connections kept alive
+
+    void SetSession(void* ssl, const std::string& peer);
+    void StoreSession(const std::string& peer, void* session);
+    void ClearSession(const std::string& peer);
+    static int NewSessionCallback(struct ssl_st* ssl, struct ssl_session_st* session);
   };
 
   class SecureSocket : public TcpSocket
@@ -64,6 +102,9 @@ namespace NSROOT
 
     bool IsCertificateValid(std::string& info);
 
+  protected:
+    size_t ReceiveSome(void* buf, size_t n);
+
   private:
     SecureSocket(void* ssl);
 
@@ -71,6 +112,7 @@ namespace NSROOT
     void* m_cert;     ///< X509 certificate
     bool m_connected; ///< SSL session state
     int m_ssl_error;  ///< SSL error code
+    std::string m_peer; ///< The peer host:port, key of the session cache
   };
 }
 
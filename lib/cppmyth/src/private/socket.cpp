@@ -20,11 +20,18 @@
  */
 
 #include "socket.h"
+#include "capture.h"
+#include "socketpoll.h"
 #include "debug.h"
+#include "cppdef.h"
+#include "os/threads/mutex.h"
+#include "os/threads/timeout.h"
 
 #include <errno.h>
 #include <cstdio>
 #include <cstring>
+#include <map>
+#include <vector>
 
 #ifdef __WINDOWS__
 #include <WS2tcpip.h>
@@ -32,6 +39,7 @@
 #define SHUT_WR   SD_SEND
 #define LASTERROR WSAGetLastError()
 #define ERRNO_INTR WSAEINTR
+#define ERRNO_INPROGRESS WSAEWOULDBLOCK
 typedef int socklen_t;
 typedef IN_ADDR in_addr_t;
 
@@ -39,13 +47,14 @@ typedef IN_ADDR in_addr_t;
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
-#include <sys/select.h>
 #include <netinet/in.h>
 #include <netdb.h>
 #include <arpa/inet.h>
+#include <fcntl.h>
 #define closesocket(a) close(a)
 #define LASTERROR errno
 #define ERRNO_INTR EINTR
+#define ERRNO_INPROGRESS EINPROGRESS
 #endif /* __WINDOWS__ */
 
 #include <signal.h>
@@ -93,14 +102,6 @@ namespace NSROOT
 ////
 
 static char my_hostname[SOCKET_HOSTNAME_MAXSIZE];
-static volatile net_socket_t my_socket;
-
-static void __sigHandler(int sig)
-{
-  closesocket(my_socket);
-  my_socket = INVALID_SOCKET_VALUE;
-  (void)sig;
-}
 
 TcpSocket::TcpSocket()
 : NetSocket()
@@ -108,6 +109,8 @@ TcpSocket::TcpSocket()
 , m_rcvbuf(SOCKET_RCVBUF_MINSIZE)
 , m_errno(0)
 , m_attempt(SOCKET_READ_ATTEMPT)
+, m_capture(NULL)
+, m_replay(NULL)
 , m_buffer(NULL)
 , m_bufptr(NULL)
 , m_buflen(SOCKET_BUFFER_SIZE)
@@ -121,25 +124,154 @@ TcpSocket::~TcpSocket()
     Disconnect();
   if (m_buffer)
     delete[] m_buffer;
+  SAFE_DELETE(m_capture);
+  SAFE_DELETE(m_replay);
 }
 
-static int __connectAddr(struct addrinfo *addr, net_socket_t *s, int rcvbuf)
+/*
+ * The addresses of a host are cached for SOCKET_RESOLVER_TTL, the one of the
+ * last successful connection first. All the sockets share the cache.
+ */
+namespace
 {
-#ifndef __WINDOWS__
-  void (*old_sighandler)(int);
-  int old_alarm;
-#endif
-  socklen_t size;
-  int err = 0, opt_rcvbuf;
+  struct ResolvedHost
+  {
+    std::vector<SocketAddress> addrs;
+    int64_t expiry;
 
-  if ((my_hostname[0] == '\0') && (gethostname(my_hostname, sizeof (my_hostname)) < 0))
+    ResolvedHost() : addrs(), expiry(0) { }
+  };
+
+  typedef std::map<std::string, ResolvedHost> resolver_cache_t;
+
+  OS::CMutex s_resolverLock;
+  resolver_cache_t s_resolverCache;
+}
+
+static int __resolve(const char *server, std::vector<SocketAddress>& addrs)
+{
+  OS::CLockGuard lock(s_resolverLock);
+  resolver_cache_t::iterator it = s_resolverCache.find(server);
+  if (it != s_resolverCache.end() && it->second.expiry > OS::gettime_ms())
   {
-    err = LASTERROR;
-    DBG(DBG_ERROR, "%s: gethostname failed (%d)\n", __FUNCTION__, err);
+    addrs = it->second.addrs;
+    return 0;
+  }
+  lock.Unlock();
+
+  struct addrinfo hints;
+  struct addrinfo *result, *addr;
+  memset(&hints, 0, sizeof (hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_protocol = IPPROTO_TCP;
+  int err = getaddrinfo(server, NULL, &hints, &result);
+  if (err)
     return err;
+  addrs.clear();
+  for (addr = result; addr; addr = addr->ai_next)
+  {
+    if ((addr->ai_family != AF_INET && addr->ai_family != AF_INET6) || addr->ai_addrlen > sizeof(sockaddr_storage))
+      continue;
+    SocketAddress sa(addr->ai_family);
+    memcpy(&sa.data, addr->ai_addr, addr->ai_addrlen);
+    sa.sa_len = (socklen_t)addr->ai_addrlen;
+    addrs.push_back(sa);
   }
+  freeaddrinfo(result);
+
+  lock.Lock();
+  ResolvedHost& host = s_resolverCache[server];
+  host.addrs = addrs;
+  host.expiry = OS::gettime_ms() + SOCKET_RESOLVER_TTL * 1000;
+  return 0;
+}
+
+static bool __sameAddress(SocketAddress& a, SocketAddress& b)
+{
+  if (a.sa_family() != b.sa_family())
+    return false;
+  if (a.sa_family() == AF_INET)
+    return memcmp(&((sockaddr_in*)a.sa())->sin_addr, &((sockaddr_in*)b.sa())->sin_addr, sizeof(in_addr)) == 0;
+  return memcmp(&((sockaddr_in6*)a.sa())->sin6_addr, &((sockaddr_in6*)b.sa())->sin6_addr, sizeof(in6_addr)) == 0;
+}
 
-  *s = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+static void __resolved(const char *server, SocketAddress *winner)
+{
+  OS::CLockGuard lock(s_resolverLock);
+  resolver_cache_t::iterator it = s_resolverCache.find(server);
+  if (it == s_resolverCache.end())
+    return;
+  if (!winner)
+  {
+    s_resolverCache.erase(it); // resolve again next time
+    return;
+  }
+  std::vector<SocketAddress>& addrs = it->second.addrs;
+  for (std::vector<SocketAddress>::iterator ita = addrs.begin(); ita != addrs.end(); ++ita)
+  {
+    if (__sameAddress(*ita, *winner))
+    {
+      SocketAddress sa = *ita;
+      addrs.erase(ita);
+      addrs.insert(addrs.begin(), sa);
+      break;
+    }
+  }
+}
+
+/*
+ * Order the addresses as RFC 8305: the families alternate, beginning with
+ * the family of the first address.
+ */
+static void __sortAddresses(std::vector<SocketAddress>& addrs, unsigned port)
+{
+  std::vector<SocketAddress> first, second;
+  int family = (addrs.empty() ? AF_UNSPEC : addrs.front().sa_family());
+  for (std::vector<SocketAddress>::iterator it = addrs.begin(); it != addrs.end(); ++it)
+  {
+    if (it->sa_family() == AF_INET)
+      ((sockaddr_in*)it->sa())->sin_port = htons(port);
+    else
+      ((sockaddr_in6*)it->sa())->sin6_port = htons(port);
+    (it->sa_family() == family ? first : second).push_back(*it);
+  }
+  addrs.clear();
+  for (size_t i = 0; i < first.size() || i < second.size(); ++i)
+  {
+    if (i < first.size())
+      addrs.push_back(first[i]);
+    if (i < second.size())
+      addrs.push_back(second[i]);
+  }
+}
+
+static int __timeoutMs(const struct timeval *tv)
+{
+  if (!tv)
+    return -1;
+  return (int)(tv->tv_sec * 1000 + tv->tv_usec / 1000);
+}
+
+static int __setNonBlocking(net_socket_t s, bool nonblocking)
+{
+#ifdef __WINDOWS__
+  u_long mode = (nonblocking ? 1 : 0);
+  return ioctlsocket(s, FIONBIO, &mode);
+#else
+  int flags = fcntl(s, F_GETFL, 0);
+  if (flags < 0)
+    return flags;
+  return fcntl(s, F_SETFL, (nonblocking ? flags | O_NONBLOCK : flags & ~O_NONBLOCK));
+#endif
+}
+
+static int __connectAddr(SocketAddress& addr, net_socket_t *s, int rcvbuf)
+{
+  socklen_t size;
+  int err = 0, opt_rcvbuf;
+
+  *s = socket(addr.sa_family(), SOCK_STREAM, IPPROTO_TCP);
   if (*s == INVALID_SOCKET_VALUE)
   {
     err = LASTERROR;
@@ -160,36 +292,118 @@ static int __connectAddr(struct addrinfo *addr, net_socket_t *s, int rcvbuf)
     DBG(DBG_WARN, "%s: could not set nosigpipe from socket (%d)\n", __FUNCTION__, LASTERROR);
 #endif
 
-#ifndef __WINDOWS__
-  old_sighandler = signal(SIGALRM, __sigHandler);
-  old_alarm = alarm(5);
-  my_socket = *s;
-#endif
-  if (connect(*s, addr->ai_addr, addr->ai_addrlen) < 0)
+  // The connection completes asynchronously
+  if (__setNonBlocking(*s, true) < 0 || (connect(*s, addr.sa(), addr.sa_len) < 0 && LASTERROR != ERRNO_INPROGRESS))
   {
     err = LASTERROR;
     DBG(DBG_ERROR, "%s: failed to connect (%d)\n", __FUNCTION__, err);
     closesocket(*s);
-#ifndef __WINDOWS__
-    signal(SIGALRM, old_sighandler);
-    alarm(old_alarm);
-#endif
+    *s = INVALID_SOCKET_VALUE;
     return err;
   }
-#ifndef __WINDOWS__
-  my_socket = INVALID_SOCKET_VALUE;
-  signal(SIGALRM, old_sighandler);
-  alarm(old_alarm);
-#endif
-  DBG(DBG_PROTO, "%s: connected to socket(%p)\n", __FUNCTION__, s);
   return err;
 }
 
+/*
+ * Race the connections to the addresses: the next attempt starts when the
+ * previous fails or after SOCKET_CONNECTION_DELAY, and the first one
+ * established wins. Returns 0 or the last error.
+ */
+static int __connectRace(std::vector<SocketAddress>& addrs, net_socket_t *s, int rcvbuf, size_t *winner)
+{
+  std::vector<net_socket_t> pending;
+  std::vector<size_t> indexes;
+  size_t next = 0;
+  int err = ETIMEDOUT;
+  OS::CTimeout timeout(SOCKET_CONNECTION_TIMEOUT);
+  OS::CTimeout delay;
+
+  *s = INVALID_SOCKET_VALUE;
+  while (*s == INVALID_SOCKET_VALUE && timeout.TimeLeft() > 0)
+  {
+    if (next < addrs.size() && (pending.empty() || delay.TimeLeft() == 0) && pending.size() < SOCKETPOLL_MAX)
+    {
+      net_socket_t ns;
+      int e = __connectAddr(addrs[next], &ns, rcvbuf);
+      if (e)
+        err = e;
+      else
+      {
+        pending.push_back(ns);
+        indexes.push_back(next);
+        delay.Set(SOCKET_CONNECTION_DELAY);
+      }
+      ++next;
+      continue;
+    }
+    if (pending.empty())
+      break;
+
+    SocketPoll sp;
+    for (std::vector<net_socket_t>::const_iterator it = pending.begin(); it != pending.end(); ++it)
+      sp.Add(*it, SOCKETPOLL_WRITE);
+    unsigned wait = timeout.TimeLeft();
+    if (next < addrs.size() && pending.size() < SOCKETPOLL_MAX && delay.TimeLeft() < wait)
+      wait = delay.TimeLeft();
+    if (sp.Wait((int)wait) < 0)
+    {
+      if (sp.GetErrNo() == ERRNO_INTR)
+        continue;
+      err = sp.GetErrNo();
+      DBG(DBG_ERROR, "%s: poll failed (%d)\n", __FUNCTION__, err);
+      break;
+    }
+    for (size_t i = 0; i < pending.size(); )
+    {
+      if (!sp.IsReady(pending[i]))
+      {
+        ++i;
+        continue;
+      }
+      int opt_error = 0;
+      socklen_t size = sizeof (opt_error);
+      if (getsockopt(pending[i], SOL_SOCKET, SO_ERROR, (char *)&opt_error, &size))
+        opt_error = LASTERROR;
+      if (opt_error == 0 && *s == INVALID_SOCKET_VALUE)
+      {
+        *s = pending[i];
+        *winner = indexes[i];
+      }
+      else
+      {
+        if (opt_error)
+        {
+          err = opt_error;
+          DBG(DBG_ERROR, "%s: failed to connect (%d)\n", __FUNCTION__, err);
+          // Don't wait to try the next address
+          delay.Set(0);
+        }
+        closesocket(pending[i]);
+      }
+      pending.erase(pending.begin() + i);
+      indexes.erase(indexes.begin() + i);
+    }
+  }
+  for (std::vector<net_socket_t>::const_iterator it = pending.begin(); it != pending.end(); ++it)
+    closesocket(*it);
+
+  if (*s == INVALID_SOCKET_VALUE)
+    return err;
+  if (__setNonBlocking(*s, false) < 0)
+  {
+    err = LASTERROR;
+    DBG(DBG_ERROR, "%s: could not set blocking mode (%d)\n", __FUNCTION__, err);
+    closesocket(*s);
+    *s = INVALID_SOCKET_VALUE;
+    return err;
+  }
+  DBG(DBG_PROTO, "%s: connected to socket(%p)\n", __FUNCTION__, s);
+  return 0;
+}
+
 bool TcpSocket::Connect(const char *server, unsigned port, int rcvbuf)
 {
-  struct addrinfo hints;
-  struct addrinfo *result, *addr;
-  char service[33];
+  std::vector<SocketAddress> addrs;
   int err;
 
   if (IsValid())
@@ -198,13 +412,28 @@ bool TcpSocket::Connect(const char *server, unsigned port, int rcvbuf)
   if (rcvbuf > SOCKET_RCVBUF_MINSIZE)
     m_rcvbuf = rcvbuf;
 
-  memset(&hints, 0, sizeof (hints));
-  hints.ai_family = AF_UNSPEC;
-  hints.ai_socktype = SOCK_STREAM;
-  hints.ai_protocol = IPPROTO_TCP;
-  snprintf(service, sizeof(service), "%u", port);
+  if ((my_hostname[0] == '\0') && (gethostname(my_hostname, sizeof (my_hostname)) < 0))
+  {
+    m_errno = LASTERROR;
+    DBG(DBG_ERROR, "%s: gethostname failed (%d)\n", __FUNCTION__, m_errno);
+    return false;
+  }
 
-  err = getaddrinfo(server, service, &hints, &result);
+  // A capture stands for the server
+  if (SocketReplay::IsEnabled())
+  {
+    SAFE_DELETE(m_replay);
+    if ((m_replay = SocketReplay::Open(server, port)) == NULL)
+    {
+      m_errno = ECONNREFUSED;
+      return false;
+    }
+    m_socket = m_replay->TakeHandle();
+    m_errno = 0;
+    return true;
+  }
+
+  err = __resolve(server, addrs);
   if (err)
   {
     switch (err)
@@ -229,15 +458,16 @@ bool TcpSocket::Connect(const char *server, unsigned port, int rcvbuf)
     return false;
   }
 
-  for (addr = result; addr; addr = addr->ai_next)
-  {
-    err = __connectAddr(addr, &m_socket, m_rcvbuf);
-    if (!err)
-      break;
-  }
-  freeaddrinfo(result);
+  __sortAddresses(addrs, port);
+  size_t winner = 0;
+  err = __connectRace(addrs, &m_socket, m_rcvbuf, &winner);
+  __resolved(server, (err ? NULL : &addrs[winner]));
   m_errno = err;
-  return (err ? false : true);
+  if (err)
+    return false;
+  SAFE_DELETE(m_capture);
+  m_capture = SocketCapture::Open(server, port);
+  return true;
 }
 
 bool TcpSocket::SendData(const char *msg, size_t size)
@@ -307,6 +537,8 @@ bool TcpSocket::SendData(const char *msg, size_t size)
     pthread_sigmask(SIG_SETMASK, &sig_restore, NULL);
 #endif
 
+    if (m_capture)
+      m_capture->Record(CAPTURE_SENT, msg, size);
     m_errno = 0;
     return true;
   }
@@ -322,117 +554,162 @@ size_t TcpSocket::ReceiveData(void *buf, size_t n)
     size_t rcvlen = 0;
     char *p = (char*)buf;
 
-    // Check for data remaining in buffer
-    if (m_buffer)
-    {
-      if (m_bufptr < m_buffer + m_rcvlen)
-      {
-        rcvlen = m_rcvlen - (m_bufptr - m_buffer);
-        if (rcvlen > n)
-          rcvlen = n;
-        memcpy(p, m_bufptr, rcvlen);
-        m_bufptr += rcvlen;
-        p += rcvlen;
-        n -= rcvlen;
-        if (n == 0)
-          return rcvlen;
-      }
-    }
-    else if ((m_buffer = new char[m_buflen]) == NULL)
-    {
-      m_errno = ENOMEM;
-      DBG(DBG_ERROR, "%s: cannot allocate %u bytes for buffer\n", __FUNCTION__, m_buflen);
-      return 0;
-    }
-    // Reset buffer
-    m_bufptr = m_buffer;
-    m_rcvlen = 0;
-
-    struct timeval tv;
-    fd_set fds;
-    int r = 0, hangcount = 0;
-
     while (n > 0)
     {
-      tv = m_timeout;
-      FD_ZERO(&fds);
-      FD_SET(m_socket, &fds);
-      r = select(m_socket + 1, &fds, NULL, NULL, &tv);
-      if (r > 0)
+      size_t s = BufferedData();
+      // Check for data remaining in buffer
+      if (s > 0)
       {
-        // Under threshold use buffering
-        if (n < m_buflen)
-        {
-          if ((r = recv(m_socket, m_buffer, m_buflen, 0)) > 0)
-          {
-            m_rcvlen = r;
-            size_t s = r;
-            if (s > n)
-              s = n;
-            memcpy(p, m_buffer, s);
-            m_bufptr = m_buffer + s;
-            p += s;
-            n -= s;
-            rcvlen += s;
-          }
-        }
-        // No buffering
-        else
-        {
-          if ((r = recv(m_socket, p, n, 0)) > 0)
-          {
-            p += r;
-            n -= r;
-            rcvlen += r;
-          }
-        }
-      }
-      if (r == 0)
-      {
-        DBG(DBG_WARN, "%s: socket(%p) timed out (%d)\n", __FUNCTION__, &m_socket, hangcount);
-        m_errno = ETIMEDOUT;
-        if (++hangcount >= m_attempt)
-          break;
+        if (s > n)
+          s = n;
+        memcpy(p, m_bufptr, s);
+        m_bufptr += s;
       }
-      if (r < 0)
+      // Under threshold use buffering
+      else if (n < SOCKET_BUFFER_SIZE)
       {
-        m_errno = LASTERROR;
-        if (m_errno != ERRNO_INTR)
+        if (FillBuffer() == 0)
           break;
+        continue;
       }
+      // No buffering
+      else if ((s = ReceiveSome(p, n)) == 0)
+        break;
+      p += s;
+      n -= s;
+      rcvlen += s;
     }
+    if (m_capture && rcvlen)
+      m_capture->Record(CAPTURE_RECEIVED, buf, rcvlen);
     return rcvlen;
   }
   m_errno = ENOTCONN;
   return 0;
 }
 
+size_t TcpSocket::ReceiveAvailable(void *buf, size_t n)
+{
+  if (IsValid())
+  {
+    m_errno = 0;
+    size_t s = BufferedData();
+    if (s > 0)
+    {
+      if (s > n)
+        s = n;
+      memcpy(buf, m_bufptr, s);
+      m_bufptr += s;
+    }
+    else
+      s = ReceiveSome(buf, n);
+    if (m_capture && s)
+      m_capture->Record(CAPTURE_RECEIVED, buf, s);
+    return s;
+  }
+  m_errno = ENOTCONN;
+  return 0;
+}
+
+size_t TcpSocket::PeekData(const char **data)
+{
+  if (IsValid())
+  {
+    m_errno = 0;
+    size_t s = BufferedData();
+    if (s == 0 && (s = FillBuffer()) == 0)
+      return 0;
+    *data = m_bufptr;
+    return s;
+  }
+  m_errno = ENOTCONN;
+  return 0;
+}
+
+void TcpSocket::ConsumeData(size_t n)
+{
+  size_t s = BufferedData();
+  if (n > s)
+    n = s;
+  if (m_capture && n)
+    m_capture->Record(CAPTURE_RECEIVED, m_bufptr, n);
+  m_bufptr += n;
+}
+
+size_t TcpSocket::ReceiveSome(void *buf, size_t n)
+{
+  int r = 0, hangcount = 0;
+
+  for (;;)
+  {
+    r = SocketPoll::Wait(m_socket, SOCKETPOLL_READ, __timeoutMs(&m_timeout));
+    if (r > 0 && (r = recv(m_socket, (char*)buf, n, 0)) > 0)
+      return (size_t)r;
+    if (r == 0)
+    {
+      DBG(DBG_WARN, "%s: socket(%p) timed out (%d)\n", __FUNCTION__, &m_socket, hangcount);
+      m_errno = ETIMEDOUT;
+      if (++hangcount >= m_attempt)
+        return 0;
+    }
+    else
+    {
+      m_errno = LASTERROR;
+      if (m_errno != ERRNO_INTR)
+        return 0;
+    }
+  }
+}
+
+/*
+ * Refill the empty buffer. Its size doubles while the reads fill it whole,
+ * up to SOCKET_BUFFER_MAXSIZE, so a bulk transfer is parsed with few calls.
+ */
+size_t TcpSocket::FillBuffer()
+{
+  bool grow = (m_rcvlen == m_buflen && m_buflen < SOCKET_BUFFER_MAXSIZE);
+  m_rcvlen = 0;
+  if (m_buffer && grow)
+  {
+    delete[] m_buffer;
+    m_buffer = NULL;
+    m_buflen = (m_buflen < SOCKET_BUFFER_MAXSIZE / 2 ? m_buflen * 2 : SOCKET_BUFFER_MAXSIZE);
+  }
+  if (!m_buffer && (m_buffer = new char[m_buflen]) == NULL)
+  {
+    m_bufptr = NULL;
+    m_errno = ENOMEM;
+    DBG(DBG_ERROR, "%s: cannot allocate %u bytes for buffer\n", __FUNCTION__, (unsigned)m_buflen);
+    return 0;
+  }
+  m_bufptr = m_buffer;
+  m_rcvlen = ReceiveSome(m_buffer, m_buflen);
+  return m_rcvlen;
+}
+
 void TcpSocket::Disconnect()
 {
   if (IsValid())
   {
     char buf[256];
-    struct timeval tv;
-    fd_set fds;
+    OS::CTimeout timeout(5000);
     int r = 0;
 
     shutdown(m_socket, SHUT_RDWR);
 
-    tv.tv_sec = 5;
-    tv.tv_usec = 0;
     do
     {
-      FD_ZERO(&fds);
-      FD_SET(m_socket, &fds);
-      r = select(m_socket + 1, &fds, NULL, NULL, &tv);
+      r = SocketPoll::Wait(m_socket, SOCKETPOLL_READ, (int)timeout.TimeLeft());
       if (r > 0)
         r = recv(m_socket, buf, sizeof(buf), 0);
     } while (r > 0);
 
     closesocket(m_socket);
     m_socket = INVALID_SOCKET_VALUE;
+    m_bufptr = m_buffer;
     m_rcvlen = 0;
   }
+  SAFE_DELETE(m_capture);
+  SAFE_DELETE(m_replay);
 }
 
 bool TcpSocket::IsValid() const
@@ -444,12 +721,7 @@ int TcpSocket::Listen(timeval *timeout)
 {
   if (IsValid())
   {
-    fd_set fds;
-    int r;
-
-    FD_ZERO(&fds);
-    FD_SET(m_socket, &fds);
-    r = select(m_socket + 1, &fds, NULL, NULL, timeout);
+    int r = SocketPoll::Wait(m_socket, SOCKETPOLL_READ, __timeoutMs(timeout));
     if (r < 0)
       m_errno = LASTERROR;
     return r;
@@ -848,14 +1120,7 @@ size_t UdpSocket::ReceiveData(void* buf, size_t n)
     m_bufptr = m_buffer;
     m_rcvlen = 0;
 
-    struct timeval tv;
-    fd_set fds;
-    int r = 0;
-
-    tv = m_timeout;
-    FD_ZERO(&fds);
-    FD_SET(m_socket, &fds);
-    r = select(m_socket + 1, &fds, NULL, NULL, &tv);
+    int r = SocketPoll::Wait(m_socket, SOCKETPOLL_READ, __timeoutMs(&m_timeout));
     if (r > 0)
     {
       if ((r = recvfrom(m_socket, m_buffer, m_buflen, 0, m_from->sa(), &m_from->sa_len)) > 0)
@@ -1130,13 +1395,7 @@ size_t UdpServerSocket::AwaitIncoming(timeval timeout)
     m_bufptr = m_buffer;
     m_rcvlen = 0;
 
-    struct timeval tv = timeout;
-    fd_set fds;
-    int r = 0;
-
-    FD_ZERO(&fds);
-    FD_SET(m_socket, &fds);
-    r = select(m_socket + 1, &fds, NULL, NULL, &tv);
+    int r = SocketPoll::Wait(m_socket, SOCKETPOLL_READ, __timeoutMs(&timeout));
     if (r > 0)
     {
       if ((r = recvfrom(m_socket, m_buffer, m_buflen, 0, m_from->sa(), &m_from->sa_len)) > 0)
@@ -34,7 +34,11 @@
 #define SOCKET_READ_TIMEOUT_USEC      0
 #define SOCKET_READ_ATTEMPT           3
 #define SOCKET_BUFFER_SIZE            1472
+#define SOCKET_BUFFER_MAXSIZE         65536
 #define SOCKET_CONNECTION_REQUESTS    5
+#define SOCKET_CONNECTION_TIMEOUT     5000  // ms
+#define SOCKET_CONNECTION_DELAY       250   // ms before racing the next address
+#define SOCKET_RESOLVER_TTL           300   // s
 
 namespace NSROOT
 {
@@ -45,6 +49,8 @@ namespace NSROOT
   } SOCKET_AF_t;
 
   struct SocketAddress;
+  class SocketCapture;
+  class SocketReplay;
 
   class NetSocket
   {
@@ -107,6 +113,29 @@ namespace NSROOT
      */
     virtual size_t ReceiveData(void* buf, size_t n);
 
+    /**
+     * Read the data ready, the pending data of the buffer first, else in one
+     * read of the socket.
+     * @param buf the pointer to write received data
+     * @param n the maximum number of byte to read
+     * @return the number of received byte, 0 on failure or timeout
+     */
+    size_t ReceiveAvailable(void* buf, size_t n);
+
+    /**
+     * Expose the pending data of the receive buffer, filling it when empty,
+     * so it can be parsed in place. The span is valid until the next receive.
+     * @param data the pointer set to the first pending byte
+     * @return the count of readable bytes, 0 on failure
+     */
+    size_t PeekData(const char** data);
+
+    /**
+     * Release the n first bytes of the span exposed by PeekData.
+     * @param n the number of byte to consume
+     */
+    void ConsumeData(size_t n);
+
     /**
      * Gracefully disconnect the socket.
      */
@@ -145,6 +174,19 @@ namespace NSROOT
     int m_rcvbuf;
     int m_errno;
     int m_attempt;
+    SocketCapture* m_capture;
+    SocketReplay* m_replay;
+
+    /**
+     * Receive the available data up to n bytes, in one read once ready.
+     * @return the number of received byte, 0 on failure or timeout
+     */
+    virtual size_t ReceiveSome(void* buf, size_t n);
+
+    /**
+     * @return the count of received byte pending in the buffer
+     */
+    size_t BufferedData() const { return m_rcvlen - (m_bufptr - m_buffer); }
 
   private:
     char* m_buffer;
@@ -152,6 +194,8 @@ namespace NSROOT
     size_t m_buflen;
     size_t m_rcvlen;
 
+    size_t FillBuffer();
+
     // prevent copy
     TcpSocket(const TcpSocket&);
     TcpSocket& operator=(const TcpSocket&);
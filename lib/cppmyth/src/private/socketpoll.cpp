@@ -0,0 +1,241 @@
+/*
+ *      Copyright (C) 2014-2016 Jean-Luc Barriere
+ *
+ *  This library is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation; either version 3, or (at your option)
+ *  any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301 USA
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "socketpoll.h"
+#include "os/threads/timeout.h"
+
+#include <errno.h>
+
+#ifdef __WINDOWS__
+#define LASTERROR WSAGetLastError()
+#define SOCKETPOLL_SLICE    100 // ms between the checks of an interruption
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#endif
+#define LASTERROR errno
+#endif /* __WINDOWS__ */
+
+using namespace NSROOT;
+
+SocketPoll::SocketPoll(bool interruptible /*= false*/)
+: m_count(0)
+, m_errno(0)
+, m_interruptible(interruptible)
+{
+#ifdef __WINDOWS__
+  m_interrupted = false;
+#else
+  m_wakeup[0] = m_wakeup[1] = -1;
+  if (interruptible)
+  {
+#if defined(__linux__)
+    m_wakeup[0] = m_wakeup[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#else
+    if (pipe(m_wakeup) == 0)
+    {
+      for (int i = 0; i < 2; ++i)
+      {
+        fcntl(m_wakeup[i], F_SETFL, fcntl(m_wakeup[i], F_GETFL, 0) | O_NONBLOCK);
+        fcntl(m_wakeup[i], F_SETFD, FD_CLOEXEC);
+      }
+    }
+    else
+      m_wakeup[0] = m_wakeup[1] = -1;
+#endif
+    if (m_wakeup[0] < 0)
+      m_interruptible = false;
+  }
+#endif
+}
+
+SocketPoll::~SocketPoll()
+{
+#ifndef __WINDOWS__
+  if (m_wakeup[0] >= 0)
+    close(m_wakeup[0]);
+  if (m_wakeup[1] >= 0 && m_wakeup[1] != m_wakeup[0])
+    close(m_wakeup[1]);
+#endif
+}
+
+void SocketPoll::Clear()
+{
+  m_count = 0;
+}
+
+bool SocketPoll::Add(net_socket_t socket, int events)
+{
+  if (m_count >= SOCKETPOLL_MAX || socket == INVALID_SOCKET_VALUE)
+    return false;
+  m_entries[m_count].socket = socket;
+  m_entries[m_count].events = events;
+  m_entries[m_count].revents = 0;
+  ++m_count;
+  return true;
+}
+
+bool SocketPoll::IsReady(net_socket_t socket) const
+{
+  for (unsigned i = 0; i < m_count; ++i)
+  {
+    if (m_entries[i].socket == socket)
+      return (m_entries[i].revents != 0);
+  }
+  return false;
+}
+
+void SocketPoll::Interrupt()
+{
+  if (!m_interruptible)
+    return;
+#ifdef __WINDOWS__
+  m_interrupted = true;
+#else
+  uint64_t one = 1;
+  // A full pipe already holds a request
+  if (write(m_wakeup[1], &one, (m_wakeup[1] == m_wakeup[0] ? sizeof(one) : 1)) < 0)
+    m_errno = LASTERROR;
+#endif
+}
+
+#ifdef __WINDOWS__
+
+int SocketPoll::Wait(int timeout)
+{
+  OS::CTimeout end(timeout < 0 ? 0 : (unsigned)timeout);
+  for (;;)
+  {
+    fd_set fds_r, fds_w, fds_e;
+    FD_ZERO(&fds_r);
+    FD_ZERO(&fds_w);
+    FD_ZERO(&fds_e);
+    for (unsigned i = 0; i < m_count; ++i)
+    {
+      m_entries[i].revents = 0;
+      if (m_entries[i].events & SOCKETPOLL_READ)
+        FD_SET(m_entries[i].socket, &fds_r);
+      if (m_entries[i].events & SOCKETPOLL_WRITE)
+        FD_SET(m_entries[i].socket, &fds_w);
+      FD_SET(m_entries[i].socket, &fds_e);
+    }
+    unsigned wait = (timeout < 0 ? SOCKETPOLL_SLICE : end.TimeLeft());
+    if (m_interruptible && wait > SOCKETPOLL_SLICE)
+      wait = SOCKETPOLL_SLICE;
+    struct timeval tv;
+    tv.tv_sec = wait / 1000;
+    tv.tv_usec = (wait % 1000) * 1000;
+    int r = select(0, &fds_r, &fds_w, &fds_e, &tv);
+    if (r < 0)
+    {
+      m_errno = LASTERROR;
+      return -1;
+    }
+    if (r > 0)
+    {
+      r = 0;
+      for (unsigned i = 0; i < m_count; ++i)
+      {
+        if (FD_ISSET(m_entries[i].socket, &fds_r))
+          m_entries[i].revents |= SOCKETPOLL_READ;
+        if (FD_ISSET(m_entries[i].socket, &fds_w))
+          m_entries[i].revents |= SOCKETPOLL_WRITE;
+        if (FD_ISSET(m_entries[i].socket, &fds_e))
+          m_entries[i].revents |= SOCKETPOLL_READ | SOCKETPOLL_WRITE;
+        if (m_entries[i].revents)
+          ++r;
+      }
+      return r;
+    }
+    if (m_interruptible && m_interrupted)
+    {
+      m_interrupted = false;
+      return 0;
+    }
+    if (timeout >= 0 && end.TimeLeft() == 0)
+      return 0;
+  }
+}
+
+#else
+
+int SocketPoll::Wait(int timeout)
+{
+  struct pollfd fds[SOCKETPOLL_MAX + 1];
+  nfds_t nfds = 0;
+  for (unsigned i = 0; i < m_count; ++i, ++nfds)
+  {
+    m_entries[i].revents = 0;
+    fds[nfds].fd = m_entries[i].socket;
+    fds[nfds].events = ((m_entries[i].events & SOCKETPOLL_READ) ? POLLIN : 0) |
+            ((m_entries[i].events & SOCKETPOLL_WRITE) ? POLLOUT : 0);
+    fds[nfds].revents = 0;
+  }
+  if (m_interruptible)
+  {
+    fds[nfds].fd = m_wakeup[0];
+    fds[nfds].events = POLLIN;
+    fds[nfds].revents = 0;
+    ++nfds;
+  }
+  int r = poll(fds, nfds, timeout);
+  if (r < 0)
+  {
+    m_errno = LASTERROR;
+    return -1;
+  }
+  if (r == 0)
+    return 0;
+  if (m_interruptible && fds[m_count].revents)
+  {
+    // Consume the requests
+    uint64_t buf;
+    while (read(m_wakeup[0], &buf, sizeof(buf)) > 0);
+    return 0;
+  }
+  r = 0;
+  for (unsigned i = 0; i < m_count; ++i)
+  {
+    short ev = fds[i].revents;
+    if (ev & POLLIN)
+      m_entries[i].revents |= SOCKETPOLL_READ;
+    if (ev & POLLOUT)
+      m_entries[i].revents |= SOCKETPOLL_WRITE;
+    // The failure is reported by the next call on the socket
+    if (ev & (POLLERR | POLLHUP | POLLNVAL))
+      m_entries[i].revents |= m_entries[i].events;
+    if (m_entries[i].revents)
+      ++r;
+  }
+  return r;
+}
+
+#endif /* __WINDOWS__ */
+
+int SocketPoll::Wait(net_socket_t socket, int events, int timeout)
+{
+  SocketPoll sp;
+  sp.Add(socket, events);
+  return sp.Wait(timeout);
+}
@@ -0,0 +1,102 @@
+/*
+ *      Copyright (C) 2014-2016 Jean-Luc Barriere
+ *
+ *  This library is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation; either version 3, or (at your option)
+ *  any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301 USA
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef SOCKETPOLL_H
+#define	SOCKETPOLL_H
+
+#include <cppmyth_config.h>
+#include "os/os.h"
+
+#define SOCKETPOLL_MAX      4
+#define SOCKETPOLL_READ     0x1
+#define SOCKETPOLL_WRITE    0x2
+
+namespace NSROOT
+{
+
+  /**
+   * Wait for the readiness of a few sockets. It is backed by poll, so the
+   * value of the descriptors isn't limited by FD_SETSIZE, else by select on
+   * Windows. When interruptible, a wait can be broken from another thread:
+   * by an eventfd on Linux, a pipe on other systems, and on Windows the wait
+   * is sliced to check the request.
+   */
+  class SocketPoll
+  {
+  public:
+    SocketPoll(bool interruptible = false);
+    ~SocketPoll();
+
+    void Clear();
+    bool Add(net_socket_t socket, int events = SOCKETPOLL_READ);
+
+    /**
+     * Wait for the events of the added sockets.
+     * @param timeout in milliseconds, else negative to wait infinitely
+     * @return the count of ready sockets, 0 on timeout or interruption, else
+     * -1 on error
+     */
+    int Wait(int timeout);
+
+    /**
+     * @return true when the socket is ready, or has failed, after the last
+     * wait
+     */
+    bool IsReady(net_socket_t socket) const;
+
+    /**
+     * Break the current or the next wait. Thread safe.
+     */
+    void Interrupt();
+
+    int GetErrNo() const { return m_errno; }
+
+    /**
+     * Wait for the events of one socket. On failure the error code is left
+     * as by the system call.
+     */
+    static int Wait(net_socket_t socket, int events, int timeout);
+
+  private:
+    struct Entry
+    {
+      net_socket_t socket;
+      int events;
+      int revents;
+    };
+    Entry m_entries[SOCKETPOLL_MAX];
+    unsigned m_count;
+    int m_errno;
+    bool m_interruptible;
+#ifdef __WINDOWS__
+    volatile bool m_interrupted;
+#else
+    int m_wakeup[2]; // read and write ends, the same for an eventfd
+#endif
+
+    // prevent copy
+    SocketPoll(const SocketPoll&);
+    SocketPoll& operator=(const SocketPoll&);
+  };
+
+}
+
+#endif	/* SOCKETPOLL_H */
@@ -189,7 +189,7 @@ void WSRequest::MakeMessageGET(std::string& msg, const char* method) const
     msg.append("User-Agent: " REQUEST_USER_AGENT "\r\n");
   else
     msg.append("User-Agent: ").append(m_userAgent).append("\r\n");
-  msg.append("Connection: " REQUEST_CONNECTION "\r\n");
+  msg.append("Connection: ").append(m_secure_uri ? REQUEST_KEEPALIVE : REQUEST_CONNECTION).append("\r\n");
   if (m_accept != CT_NONE)
     msg.append("Accept: ").append(MimeFromContentType(m_accept)).append("\r\n");
   msg.append("Accept-Charset: ").append(m_charset).append("\r\n");
@@ -212,7 +212,7 @@ void WSRequest::MakeMessagePOST(std::string& msg, const char* method) const
     msg.append("User-Agent: " REQUEST_USER_AGENT "\r\n");
   else
     msg.append("User-Agent: ").append(m_userAgent).append("\r\n");
-  msg.append("Connection: " REQUEST_CONNECTION "\r\n");
+  msg.append("Connection: ").append(m_secure_uri ? REQUEST_KEEPALIVE : REQUEST_CONNECTION).append("\r\n");
   if (m_accept != CT_NONE)
     msg.append("Accept: ").append(MimeFromContentType(m_accept)).append("\r\n");
   msg.append("Accept-Charset: ").append(m_charset).append("\r\n");
@@ -246,7 +246,7 @@ void WSRequest::MakeMessageHEAD(std::string& msg, const char* method) const
     msg.append("User-Agent: " REQUEST_USER_AGENT "\r\n");
   else
     msg.append("User-Agent: ").append(m_userAgent).append("\r\n");
-  msg.append("Connection: " REQUEST_CONNECTION "\r\n");
+  msg.append("Connection: ").append(m_secure_uri ? REQUEST_KEEPALIVE : REQUEST_CONNECTION).append("\r\n");
   if (m_accept != CT_NONE)
     msg.append("Accept: ").append(MimeFromContentType(m_accept)).append("\r\n");
   msg.append("Accept-Charset: ").append(m_charset).append("\r\n");
@@ -33,6 +33,7 @@
 #define REQUEST_PROTOCOL      "HTTP/1.1"
 #define REQUEST_USER_AGENT    "libcppmyth/2.0"
 #define REQUEST_CONNECTION    "close" // "keep-alive"
+#define REQUEST_KEEPALIVE     "keep-alive" // for secure URI, the handshake is costly
 #define REQUEST_STD_CHARSET   "utf-8"
 
 namespace NSROOT
@@ -70,6 +71,8 @@ namespace NSROOT
 
     const std::string& GetServer() const { return m_server; }
     unsigned GetPort() const { return m_port; }
+    const std::string& GetService() const { return m_service_url; }
+    HRM_t GetMethod() const { return m_service_method; }
     bool IsSecureURI() const { return m_secure_uri; }
 
   private:
@@ -24,6 +24,7 @@
 #include "debug.h"
 #include "cppdef.h"
 #include "compressor.h"
+#include "metrics.h"
 
 #include <cstdlib>  // for atol
 #include <cstdio>
@@ -31,16 +32,13 @@
 
 #define HTTP_TOKEN_MAXSIZE    20
 #define HTTP_HEADER_MAXSIZE   4000
-#define RESPONSE_BUFFER_SIZE  4000
 
 using namespace NSROOT;
 
-bool WSResponse::ReadHeaderLine(NetSocket *socket, const char *eol, std::string& line, size_t *len)
+bool WSResponse::ReadHeaderLine(TcpSocket *socket, const char *eol, std::string& line, size_t *len)
 {
-  char buf[RESPONSE_BUFFER_SIZE];
   const char *s_eol;
-  int p = 0, p_eol = 0, l_eol;
-  size_t l = 0;
+  size_t p_eol = 0, l_eol;
 
   if (eol != NULL)
     s_eol = eol;
@@ -51,40 +49,35 @@ bool WSResponse::ReadHeaderLine(NetSocket *socket, const char *eol, std::string&
   line.clear();
   do
   {
-    if (socket->ReceiveData(&buf[p], 1) > 0)
+    // Scan the received data in place for the EOL
+    const char *data;
+    size_t n = socket->PeekData(&data);
+    if (n == 0)
     {
-      if (buf[p++] == s_eol[p_eol])
-      {
-        if (++p_eol >= l_eol)
-        {
-          buf[p - l_eol] = '\0';
-          line.append(buf);
-          l += p - l_eol;
-          break;
-        }
-      }
+      /* No EOL found until end of data */
+      *len = line.size();
+      return false;
+    }
+    size_t p = 0;
+    while (p < n && p_eol < l_eol)
+    {
+      char ch = data[p++];
+      if (ch == s_eol[p_eol])
+        ++p_eol;
       else
-      {
-        p_eol = 0;
-        if (p > (RESPONSE_BUFFER_SIZE - 2 - l_eol))
-        {
-          buf[p] = '\0';
-          line.append(buf);
-          l += p;
-          p = 0;
-        }
-      }
+        p_eol = (ch == s_eol[0] ? 1 : 0);
     }
-    else
+    line.append(data, p);
+    socket->ConsumeData(p);
+    if (p_eol >= l_eol)
     {
-      /* No EOL found until end of data */
-      *len = l;
-      return false;
+      line.resize(line.size() - l_eol);
+      break;
     }
   }
-  while (l < HTTP_HEADER_MAXSIZE);
+  while (line.size() < HTTP_HEADER_MAXSIZE);
 
-  *len = l;
+  *len = line.size();
   return true;
 }
 
@@ -100,43 +93,109 @@ WSResponse::WSResponse(const WSRequest &request)
 , m_contentChunked(false)
 , m_contentLength(0)
 , m_consumed(0)
-, m_chunkBuffer(NULL)
-, m_chunkPtr(NULL)
-, m_chunkEOR(NULL)
-, m_chunkEnd(NULL)
+, m_chunkLeft(0)
+, m_chunkEnd(false)
+, m_keepAlive(false)
 , m_decoder(NULL)
+, m_bodyMetric(METRICS_NONE)
+, m_parseMetric(METRICS_NONE)
+, m_bindMetric(METRICS_NONE)
+, m_bodyTime(0)
+, m_bodyRead(false)
 {
+  int64_t start = Metrics::Clock();
   if (request.IsSecureURI())
+  {
+    // Send first on a connection kept alive to the host. The server could
+    // have closed it meanwhile: without any response a new one is made, but
+    // only for a request safe to repeat as the first could have been handled.
+    m_socket = SSLSessionFactory::Instance().TakeSocket(request.GetServer(), request.GetPort());
+    if (m_socket)
+    {
+      if (SendRequest(request) && GetResponse())
+      {
+        CheckResponse(request, start);
+        return;
+      }
+      SAFE_DELETE(m_socket);
+      if (request.GetMethod() != HRM_GET && request.GetMethod() != HRM_HEAD)
+      {
+        DBG(DBG_ERROR, "%s: invalid response\n", __FUNCTION__);
+        return;
+      }
+    }
     m_socket = SSLSessionFactory::Instance().NewSocket();
+  }
   else
     m_socket = new TcpSocket();
   if (!m_socket)
     DBG(DBG_ERROR, "%s: create socket failed\n", __FUNCTION__);
   else if (m_socket->Connect(request.GetServer().c_str(), request.GetPort(), SOCKET_RCVBUF_MINSIZE))
   {
+    static const Metrics::Id s_connectMetric = Metrics::Register("ws.connect", Metrics::LATENCY);
+    int64_t now = Metrics::Clock();
+    Metrics::Latency(s_connectMetric, now - start);
     m_socket->SetReadAttempt(6); // 60 sec to hang up
     if (SendRequest(request) && GetResponse())
-    {
-      if (m_statusCode < 200)
-        DBG(DBG_WARN, "%s: status %d\n", __FUNCTION__, m_statusCode);
-      else if (m_statusCode < 300)
-        m_successful = true;
-      else if (m_statusCode < 400)
-        m_successful = false;
-      else if (m_statusCode < 500)
-        DBG(DBG_ERROR, "%s: bad request (%d)\n", __FUNCTION__, m_statusCode);
-      else
-        DBG(DBG_ERROR, "%s: server error (%d)\n", __FUNCTION__, m_statusCode);
-    }
+      CheckResponse(request, now);
     else
       DBG(DBG_ERROR, "%s: invalid response\n", __FUNCTION__);
   }
 }
 
+static Metrics::Id EndpointMetric(const char *prefix, const std::string& url, size_t len)
+{
+  char name[METRICS_NAME_MAXSIZE];
+  size_t n = strlen(prefix);
+  if (len > sizeof(name) - n)
+    len = sizeof(name) - n;
+  memcpy(name, prefix, n);
+  memcpy(name + n, url.c_str(), len);
+  return Metrics::Register(name, n + len, Metrics::LATENCY);
+}
+
+void WSResponse::CheckResponse(const WSRequest& request, int64_t start)
+{
+  // Time to the end of the header by service: /Service/Method
+  int64_t now = Metrics::Clock();
+  const std::string& url = request.GetService();
+  size_t p = url.find('/', 1);
+  if (p != std::string::npos)
+    p = url.find('/', p + 1);
+  if (p == std::string::npos)
+    p = url.size();
+  Metrics::Latency(EndpointMetric("ws.ttfb ", url, p), now - start);
+  m_bodyMetric = EndpointMetric("ws.body ", url, p);
+  m_parseMetric = EndpointMetric("ws.parse ", url, p);
+  m_bindMetric = EndpointMetric("ws.bind ", url, p);
+  if (m_statusCode < 200)
+    DBG(DBG_WARN, "%s: status %d\n", __FUNCTION__, m_statusCode);
+  else if (m_statusCode < 300)
+    m_successful = true;
+  else if (m_statusCode < 400)
+    m_successful = false;
+  else if (m_statusCode < 500)
+    DBG(DBG_ERROR, "%s: bad request (%d)\n", __FUNCTION__, m_statusCode);
+  else
+    DBG(DBG_ERROR, "%s: server error (%d)\n", __FUNCTION__, m_statusCode);
+  // Only a secure connection is kept, and the end of content must be known
+  std::string value;
+  if (!request.IsSecureURI() || request.GetMethod() == HRM_HEAD ||
+          (!m_contentChunked && !GetHeaderValue("CONTENT-LENGTH", value)))
+    m_keepAlive = false;
+}
+
 WSResponse::~WSResponse()
 {
+  if (m_bodyRead)
+    Metrics::Latency(m_bodyMetric, m_bodyTime);
   SAFE_DELETE(m_decoder);
-  SAFE_DELETE_ARRAY(m_chunkBuffer);
+  // Keep the connection once the content has been read to the end
+  if (m_socket && m_keepAlive && (m_contentChunked ? m_chunkEnd : m_consumed == m_contentLength))
+  {
+    SSLSessionFactory::Instance().ReleaseSocket(static_cast<SecureSocket*>(m_socket));
+    m_socket = NULL;
+  }
   SAFE_DELETE(m_socket);
 }
 
@@ -181,6 +240,8 @@ bool WSResponse::GetResponse()
       {
         /* We have received a valid feedback */
         m_statusCode = status;
+        /* HTTP/1.1 keeps the connection by default */
+        m_keepAlive = (len > 8 && 0 == memcmp(line, "HTTP/1.1", 8));
         ret = true;
       }
       else
@@ -246,6 +307,15 @@ bool WSResponse::GetResponse()
           if (memcmp(token, "LOCATION", token_len) == 0)
             m_location.append(val);
           break;
+        case 10:
+          if (memcmp(token, "CONNECTION", token_len) == 0)
+          {
+            if (value_len > 4 && strnicmp(val, "close", 5) == 0)
+              m_keepAlive = false;
+            else if (value_len > 9 && strnicmp(val, "keep-alive", 10) == 0)
+              m_keepAlive = true;
+          }
+          break;
         case 12:
           if (memcmp(token, "CONTENT-TYPE", token_len) == 0)
             m_contentType = ContentTypeFromMime(val);
@@ -287,41 +357,32 @@ bool WSResponse::GetResponse()
 size_t WSResponse::ReadChunk(void *buf, size_t buflen)
 {
   size_t s = 0;
-  if (m_contentChunked)
+  if (m_contentChunked && !m_chunkEnd)
   {
-    // no more pending byte in chunk buffer
-    if (m_chunkPtr >= m_chunkEnd)
+    // no more pending byte in chunk
+    if (m_chunkLeft == 0)
     {
       // process next chunk
-      SAFE_DELETE_ARRAY(m_chunkBuffer);
-      m_chunkBuffer = m_chunkPtr = m_chunkEOR = m_chunkEnd = NULL;
       std::string strread;
       size_t len = 0;
       while (ReadHeaderLine(m_socket, "\r\n", strread, &len) && len == 0);
       DBG(DBG_PROTO, "%s: chunked data (%s)\n", __FUNCTION__, strread.c_str());
       std::string chunkStr("0x0");
       uint32_t chunkSize;
-      if (!strread.empty() && sscanf(chunkStr.append(strread).c_str(), "%x", &chunkSize) == 1 && chunkSize > 0)
+      if (strread.empty() || sscanf(chunkStr.append(strread).c_str(), "%x", &chunkSize) != 1)
+        return 0;
+      if (chunkSize == 0)
       {
-        if (!(m_chunkBuffer = new char[chunkSize]))
-          return 0;
-        m_chunkPtr = m_chunkEOR = m_chunkBuffer;
-        m_chunkEnd = m_chunkBuffer + chunkSize;
+        // that's the end of chunks: skip the trailer until the empty line
+        while (ReadHeaderLine(m_socket, "\r\n", strread, &len) && len > 0);
+        m_chunkEnd = true;
+        return 0;
       }
-      else
-        return 0; // that's the end of chunks
-    }
-    // fill chunk buffer
-    if (m_chunkPtr >= m_chunkEOR)
-    {
-      // ask for new data to fill in the chunk buffer
-      // fill at last read position and until to the end
-      m_chunkEOR += m_socket->ReceiveData(m_chunkEOR, m_chunkEnd - m_chunkEOR);
+      m_chunkLeft = chunkSize;
     }
-    if ((s = m_chunkEOR - m_chunkPtr) > buflen)
-      s = buflen;
-    memcpy(buf, m_chunkPtr, s);
-    m_chunkPtr += s;
+    // read the chunk data straight into the caller buffer
+    s = m_socket->ReceiveData(buf, m_chunkLeft > buflen ? buflen : m_chunkLeft);
+    m_chunkLeft -= s;
     m_consumed += s;
   }
   return s;
@@ -333,8 +394,8 @@ int WSResponse::SocketStreamReader(void *hdl, void *buf, int sz)
   if (resp == NULL)
     return 0;
   size_t s = 0;
-  // let read on unknown length
-  if (!resp->m_contentLength)
+  // let read on unknown length, until the server closes
+  if (!resp->m_contentLength && !resp->m_keepAlive)
     s = resp->m_socket->ReceiveData(buf, sz);
   else if (resp->m_contentLength > resp->m_consumed)
   {
@@ -353,13 +414,14 @@ int WSResponse::ChunkStreamReader(void *hdl, void *buf, int sz)
 
 size_t WSResponse::ReadContent(char* buf, size_t buflen)
 {
+  int64_t start = Metrics::Clock();
   size_t s = 0;
   if (!m_contentChunked)
   {
     if (m_contentEncoding == CE_NONE)
     {
-      // let read on unknown length
-      if (!m_contentLength)
+      // let read on unknown length, until the server closes
+      if (!m_contentLength && !m_keepAlive)
         s = m_socket->ReceiveData(buf, buflen);
       else if (m_contentLength > m_consumed)
       {
@@ -408,6 +470,8 @@ size_t WSResponse::ReadContent(char* buf, size_t buflen)
       }
     }
   }
+  m_bodyTime += Metrics::Clock() - start;
+  m_bodyRead = true;
   return s;
 }
 
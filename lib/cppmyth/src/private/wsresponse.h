@@ -25,6 +25,7 @@
 #include <cppmyth_config.h>
 #include "wscontent.h"
 #include "wsrequest.h"
+#include "metrics.h"
 
 #include <cstddef>  // for size_t
 #include <string>
@@ -33,7 +34,6 @@
 namespace NSROOT
 {
 
-  class NetSocket;
   class TcpSocket;
   class Decompressor;
 
@@ -50,10 +50,12 @@ namespace NSROOT
     size_t GetConsumed() const { return m_consumed; }
     int GetStatusCode() const { return m_statusCode; }
     const std::string& Redirection() const { return m_location; }
+    Metrics::Id GetParseMetric() const { return m_parseMetric; }
+    Metrics::Id GetBindMetric() const { return m_bindMetric; }
 
     bool GetHeaderValue(const std::string& header, std::string& value);
 
-    static bool ReadHeaderLine(NetSocket *socket, const char *eol, std::string& line, size_t *len);
+    static bool ReadHeaderLine(TcpSocket *socket, const char *eol, std::string& line, size_t *len);
 
   private:
     TcpSocket *m_socket;
@@ -67,11 +69,15 @@ namespace NSROOT
     bool m_contentChunked;
     size_t m_contentLength;
     size_t m_consumed;
-    char* m_chunkBuffer;      ///< The chunk data buffer
-    char* m_chunkPtr;         ///< The next position to read data from the chunk
-    char* m_chunkEOR;         ///< The end of received data in the chunk
-    char* m_chunkEnd;         ///< The end of the chunk buffer
+    size_t m_chunkLeft;       ///< The bytes of the chunk remaining to read
+    bool m_chunkEnd;          ///< The last chunk has been read
+    bool m_keepAlive;         ///< The connection can be kept for the next request
     Decompressor *m_decoder;
+    Metrics::Id m_bodyMetric;   ///< Metrics of the service endpoint
+    Metrics::Id m_parseMetric;
+    Metrics::Id m_bindMetric;
+    int64_t m_bodyTime;       ///< Time spent reading the content
+    bool m_bodyRead;
 
     typedef std::list<std::pair<std::string, std::string> > HeaderList;
     HeaderList m_headers;
@@ -82,6 +88,7 @@ namespace NSROOT
 
     bool SendRequest(const WSRequest& request);
     bool GetResponse();
+    void CheckResponse(const WSRequest& request, int64_t start);
     size_t ReadChunk(void *buf, size_t buflen);
     static int SocketStreamReader(void *hdl, void *buf, int sz);
     static int ChunkStreamReader(void *hdl, void *buf, int sz);
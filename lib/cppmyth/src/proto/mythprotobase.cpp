@@ -25,9 +25,11 @@
 #include "../private/os/threads/mutex.h"
 #include "../private/cppdef.h"
 #include "../private/builtin.h"
+#include "../private/metrics.h"
 
 #include <limits>
 #include <cstdio>
+#include <cstring>
 
 using namespace Myth;
 
@@ -106,10 +108,22 @@ bool ProtoBase::SendCommand(const char *cmd, bool feedback)
     sprintf(buf, "%-8u", (unsigned)l);
     msg.append(buf).append(cmd);
     DBG(DBG_PROTO, "%s: %s\n", __FUNCTION__, cmd);
+    int64_t start = Metrics::Clock();
     if (m_socket->SendData(msg.c_str(), msg.size()))
     {
       if (feedback)
-        return RcvMessageLength();
+      {
+        bool ret = RcvMessageLength();
+        // Round trip by command name
+        char name[METRICS_NAME_MAXSIZE];
+        size_t n = strcspn(cmd, " [");
+        if (n > sizeof(name) - 7)
+          n = sizeof(name) - 7;
+        memcpy(name, "proto.", 6);
+        memcpy(name + 6, cmd, n);
+        Metrics::Latency(Metrics::Register(name, n + 6, Metrics::LATENCY), Metrics::Clock() - start);
+        return ret;
+      }
       return true;
     }
     DBG(DBG_ERROR, "%s: failed (%d)\n", __FUNCTION__, m_socket->GetErrNo());
@@ -134,50 +148,40 @@ bool ProtoBase::ReadField(std::string& field)
 {
   const char *str_sep = PROTO_STR_SEPARATOR;
   size_t str_sep_len = PROTO_STR_SEPARATOR_LEN;
-  char buf[PROTO_BUFFER_SIZE];
-  size_t p = 0, p_ss = 0, l = m_msgLength, c = m_msgConsumed;
+  size_t p_ss = 0, l = m_msgLength, c = m_msgConsumed;
 
   field.clear();
   if ( c >= l)
     return false;
 
-  for (;;)
+  // Scan the received data in place until the separator or the end
+  while (l > c)
   {
-    if (l > c)
+    const char *data;
+    size_t n = m_socket->PeekData(&data);
+    if (n == 0)
     {
-      if (m_socket->ReceiveData(&buf[p], 1) < 1)
-      {
-        HangException();
-        return false;
-      }
-      ++c;
-      if (buf[p++] == str_sep[p_ss])
-      {
-        if (++p_ss >= str_sep_len)
-        {
-          // Append data until separator before exit
-          buf[p - str_sep_len] = '\0';
-          field.append(buf);
-          break;
-        }
-      }
+      HangException();
+      return false;
+    }
+    if (n > l - c)
+      n = l - c;
+    size_t p = 0;
+    while (p < n && p_ss < str_sep_len)
+    {
+      char ch = data[p++];
+      if (ch == str_sep[p_ss])
+        ++p_ss;
       else
-      {
-        p_ss = 0;
-        if (p > (PROTO_BUFFER_SIZE - 2 - str_sep_len))
-        {
-          // Append data before flushing to refill the following
-          buf[p] = '\0';
-          field.append(buf);
-          p = 0;
-        }
-      }
+        p_ss = (ch == str_sep[0] ? 1 : 0);
     }
-    else
+    field.append(data, p);
+    m_socket->ConsumeData(p);
+    c += p;
+    if (p_ss >= str_sep_len)
     {
-      // All is consumed. Append rest of data before exit
-      buf[p] = '\0';
-      field.append(buf);
+      // Strip the separator before exit
+      field.resize(field.size() - str_sep_len);
       break;
     }
   }
@@ -201,17 +205,21 @@ bool ProtoBase::IsMessageOK(const std::string& field) const
 
 size_t ProtoBase::FlushMessage()
 {
-  char buf[PROTO_BUFFER_SIZE];
-  size_t r, n = 0, f = m_msgLength - m_msgConsumed;
+  size_t n = 0, f = m_msgLength - m_msgConsumed;
 
+  // Discard the rest in place
   while (f > 0)
   {
-    r = (f > PROTO_BUFFER_SIZE ? PROTO_BUFFER_SIZE : f);
-    if (m_socket->ReceiveData(buf, r) != r)
+    const char *data;
+    size_t r = m_socket->PeekData(&data);
+    if (r == 0)
     {
       HangException();
       break;
     }
+    if (r > f)
+      r = f;
+    m_socket->ConsumeData(r);
     f -= r;
     n += r;
   }
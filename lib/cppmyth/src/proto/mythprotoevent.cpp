@@ -22,6 +22,7 @@
 #include "mythprotoevent.h"
 #include "../private/debug.h"
 #include "../private/socket.h"
+#include "../private/socketpoll.h"
 #include "../private/os/threads/mutex.h"
 #include "../private/builtin.h"
 
@@ -55,9 +56,15 @@ void __tokenize(const std::string& str, const char *delimiters, std::vector<std:
 
 ProtoEvent::ProtoEvent(const std::string& server, unsigned port)
 : ProtoBase(server, port)
+, m_poll(new SocketPoll(true))
 {
 }
 
+ProtoEvent::~ProtoEvent()
+{
+  delete m_poll;
+}
+
 bool ProtoEvent::Open()
 {
   bool ok = false;
@@ -128,13 +135,21 @@ SignalStatusPtr ProtoEvent::RcvSignalStatus()
   return signal;
 }
 
+void ProtoEvent::Interrupt()
+{
+  m_poll->Interrupt();
+}
+
 int ProtoEvent::RcvBackendMessage(unsigned timeout, EventMessage **msg)
 {
   OS::CLockGuard lock(*m_mutex);
-  struct timeval tv;
-  tv.tv_sec = timeout;
-  tv.tv_usec = 0;
-  int r = m_socket->Listen(&tv);
+  int r = -1;
+  if (m_socket->IsValid())
+  {
+    m_poll->Clear();
+    m_poll->Add(m_socket->GetHandle());
+    r = m_poll->Wait(timeout * 1000);
+  }
   if (r > 0)
   {
     std::string field;
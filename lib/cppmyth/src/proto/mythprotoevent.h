@@ -29,10 +29,13 @@
 namespace Myth
 {
 
+  class SocketPoll;
+
   class ProtoEvent : public ProtoBase
   {
   public:
     ProtoEvent(const std::string& server, unsigned port);
+    virtual ~ProtoEvent();
 
     virtual bool Open();
     virtual void Close();
@@ -46,7 +49,14 @@ namespace Myth
      */
     int RcvBackendMessage(unsigned timeout, EventMessage **msg);
 
+    /**
+     * @brief Break the wait for message. Thread safe.
+     */
+    void Interrupt();
+
   private:
+    SocketPoll *m_poll;
+
     bool Announce75();
     SignalStatusPtr RcvSignalStatus();
   };
@@ -412,12 +412,14 @@ StorageGroupFilePtr ProtoMonitor::QuerySGFile75(const std::string& hostname, con
   return sgfile;
 }
 
-MarkListPtr ProtoMonitor::GetCutList75(const Program& program)
+MarkListPtr ProtoMonitor::GetCutList75(const Program& program, bool *ok)
 {
   char buf[32];
   std::string field;
   int32_t nb;
   MarkListPtr list(new MarkList);
+  if (ok)
+    *ok = false;
 
   OS::CLockGuard lock(*m_mutex);
   if (!IsOpen())
@@ -446,7 +448,11 @@ MarkListPtr ProtoMonitor::GetCutList75(const Program& program)
       list->push_back(mark);
     }
     while (--nb > 0);
+    if (nb > 0)
+      goto out;
   }
+  if (ok)
+    *ok = true;
   DBG(DBG_DEBUG, "%s: succeeded (%s)\n", __FUNCTION__, program.fileName.c_str());
   return list;
   out:
@@ -455,12 +461,14 @@ MarkListPtr ProtoMonitor::GetCutList75(const Program& program)
   return list;
 }
 
-MarkListPtr ProtoMonitor::GetCommBreakList75(const Program& program)
+MarkListPtr ProtoMonitor::GetCommBreakList75(const Program& program, bool *ok)
 {
   char buf[32];
   std::string field;
   int32_t nb;
   MarkListPtr list(new MarkList);
+  if (ok)
+    *ok = false;
 
   OS::CLockGuard lock(*m_mutex);
   if (!IsOpen())
@@ -489,7 +497,11 @@ MarkListPtr ProtoMonitor::GetCommBreakList75(const Program& program)
       list->push_back(mark);
     }
     while (--nb > 0);
+    if (nb > 0)
+      goto out;
   }
+  if (ok)
+    *ok = true;
   DBG(DBG_DEBUG, "%s: succeeded (%s)\n", __FUNCTION__, program.fileName.c_str());
   return list;
   out:
@@ -83,13 +83,13 @@ namespace Myth
     {
       return QuerySGFile75(hostname, sgname, filename);
     }
-    MarkListPtr GetCutList(const Program& program)
+    MarkListPtr GetCutList(const Program& program, bool *ok = NULL)
     {
-      return GetCutList75(program);
+      return GetCutList75(program, ok);
     }
-    MarkListPtr GetCommBreakList(const Program& program)
+    MarkListPtr GetCommBreakList(const Program& program, bool *ok = NULL)
     {
-      return GetCommBreakList75(program);
+      return GetCommBreakList75(program, ok);
     }
     bool BlockShutdown()
     {
@@ -133,8 +133,8 @@ namespace Myth
     bool StopRecording75(const Program& program);
     bool CancelNextRecording75(int rnum, bool cancel);
     StorageGroupFilePtr QuerySGFile75(const std::string& hostname, const std::string& sgname, const std::string& filename);
-    MarkListPtr GetCutList75(const Program& program);
-    MarkListPtr GetCommBreakList75(const Program& program);
+    MarkListPtr GetCutList75(const Program& program, bool *ok);
+    MarkListPtr GetCommBreakList75(const Program& program, bool *ok);
     bool BlockShutdown75();
     bool AllowShutdown75();
     std::vector<int> GetFreeCardIdList75();
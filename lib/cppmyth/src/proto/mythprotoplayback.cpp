@@ -22,19 +22,14 @@
 #include "mythprotoplayback.h"
 #include "../private/debug.h"
 #include "../private/socket.h"
+#include "../private/socketpoll.h"
 #include "../private/os/threads/mutex.h"
 #include "../private/builtin.h"
+#include "../private/metrics.h"
 
 #include <limits>
 #include <cstdio>
 
-#ifdef __WINDOWS__
-#include <Ws2tcpip.h>
-#else
-#include <sys/socket.h> // for recv
-#include <sys/select.h> // for select
-#endif /* __WINDOWS__ */
-
 using namespace Myth;
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -144,11 +139,13 @@ bool ProtoPlayback::TransferIsOpen75(ProtoTransfer& transfer)
 
 int ProtoPlayback::TransferRequestBlock(ProtoTransfer& transfer, void *buffer, unsigned n)
 {
+  static const Metrics::Id s_blockMetric = Metrics::Register("transfer.block", Metrics::LATENCY);
+  static const Metrics::Id s_bytesMetric = Metrics::Register("transfer.bytes", Metrics::COUNTER);
   bool request = false, data = false;
-  int r = 0, nfds = 0, fdc, fdd;
+  int r = 0;
+  net_socket_t fdc, fdd;
   char *p = (char*)buffer;
-  struct timeval tv;
-  fd_set fds;
+  SocketPoll sp;
   unsigned s = 0;
 
   int64_t filePosition = transfer.GetPosition();
@@ -157,11 +154,12 @@ int ProtoPlayback::TransferRequestBlock(ProtoTransfer& transfer, void *buffer, u
   if (n == 0)
     return n;
 
-  fdc = GetSocket();
-  if (INVALID_SOCKET_VALUE == (net_socket_t)fdc)
+  int64_t start = Metrics::Clock();
+  fdc = (net_socket_t)GetSocket();
+  if (INVALID_SOCKET_VALUE == fdc)
     return -1;
-  fdd = transfer.GetSocket();
-  if (INVALID_SOCKET_VALUE == (net_socket_t)fdd)
+  fdd = (net_socket_t)transfer.GetSocket();
+  if (INVALID_SOCKET_VALUE == fdd)
     return -1;
   // Max size is RCVBUF size
   if (n > PROTO_TRANSFER_RCVBUF)
@@ -181,49 +179,30 @@ int ProtoPlayback::TransferRequestBlock(ProtoTransfer& transfer, void *buffer, u
 
   do
   {
-    FD_ZERO(&fds);
+    sp.Clear();
     if (request)
-    {
-      FD_SET((net_socket_t)fdc, &fds);
-      if (nfds < fdc)
-        nfds = fdc;
-    }
-    FD_SET((net_socket_t)fdd, &fds);
-    if (nfds < fdd)
-      nfds = fdd;
-
-    if (data)
-    {
-      // Read directly to get all queued packets
-      tv.tv_sec = 0;
-      tv.tv_usec = 0;
-    }
-    else
-    {
-      // Wait and read for new packet
-      tv.tv_sec = 10;
-      tv.tv_usec = 0;
-    }
-
-    r = select (nfds + 1, &fds, NULL, NULL, &tv);
+      sp.Add(fdc);
+    sp.Add(fdd);
+    // Read directly to get all queued packets, else wait for new packet
+    r = sp.Wait(data ? 0 : 10000);
     if (r < 0)
     {
-      DBG(DBG_ERROR, "%s: select error (%d)\n", __FUNCTION__, r);
+      DBG(DBG_ERROR, "%s: poll error (%d)\n", __FUNCTION__, sp.GetErrNo());
       goto err;
     }
     if (r == 0 && !data)
     {
-      DBG(DBG_ERROR, "%s: select timeout\n", __FUNCTION__);
+      DBG(DBG_ERROR, "%s: poll timeout\n", __FUNCTION__);
       goto err;
     }
     // Check for data
     data = false;
-    if (FD_ISSET((net_socket_t)fdd, &fds))
+    if (sp.IsReady(fdd))
     {
-      r = recv((net_socket_t)fdd, p, (size_t)(n - s), 0);
+      r = transfer.ReadData(p, (size_t)(n - s));
       if (r < 0)
       {
-        DBG(DBG_ERROR, "%s: recv data error (%d)\n", __FUNCTION__, r);
+        DBG(DBG_ERROR, "%s: read data error (%d)\n", __FUNCTION__, transfer.GetSocketErrNo());
         goto err;
       }
       if (r > 0)
@@ -236,7 +215,7 @@ int ProtoPlayback::TransferRequestBlock(ProtoTransfer& transfer, void *buffer, u
       }
     }
     // Check for response of request
-    if (request && FD_ISSET((net_socket_t)fdc, &fds))
+    if (request && sp.IsReady(fdc))
     {
       int32_t rlen = TransferRequestBlockFeedback75();
       request = false; // request is completed
@@ -251,6 +230,8 @@ int ProtoPlayback::TransferRequestBlock(ProtoTransfer& transfer, void *buffer, u
     }
   } while (request || data || !s);
   DBG(DBG_DEBUG, "%s: data read (%u)\n", __FUNCTION__, s);
+  Metrics::Latency(s_blockMetric, Metrics::Clock() - start);
+  Metrics::Count(s_bytesMetric, s);
   return (int)s;
 err:
   if (request)
@@ -25,6 +25,7 @@
 #include "../private/os/threads/mutex.h"
 #include "../private/builtin.h"
 
+#include <errno.h>
 #include <limits>
 #include <cstdio>
 
@@ -99,13 +100,16 @@ void ProtoTransfer::Flush()
   int64_t unread = m_fileRequest - m_filePosition;
   if (unread > 0)
   {
-    char buf[PROTO_BUFFER_SIZE];
     size_t n = (size_t)unread;
     while (n > 0)
     {
-      size_t s = (n > PROTO_BUFFER_SIZE ? PROTO_BUFFER_SIZE : n);
-      if(m_socket->ReceiveData(buf, s) != s)
+      const char *data;
+      size_t s = m_socket->PeekData(&data);
+      if (s == 0)
         break;
+      if (s > n)
+        s = n;
+      m_socket->ConsumeData(s);
       n -= s;
     }
     DBG(DBG_DEBUG, "%s: unreaded bytes (%u)\n", __FUNCTION__, (unsigned)n);
@@ -114,6 +118,15 @@ void ProtoTransfer::Flush()
   }
 }
 
+int ProtoTransfer::ReadData(void *buf, size_t n)
+{
+  size_t r = m_socket->ReceiveAvailable(buf, n);
+  // A closed connection reads nothing like a timeout
+  if (r == 0 && m_socket->GetErrNo() != 0 && m_socket->GetErrNo() != ETIMEDOUT)
+    return -1;
+  return (int)r;
+}
+
 bool ProtoTransfer::Announce75()
 {
   OS::CLockGuard lock(*m_mutex);
@@ -48,6 +48,11 @@ namespace Myth
      * @return void
      */
     void Flush();
+    /**
+     * @brief Read the data ready on the connection, without waiting for more
+     * @return the count of byte read, else -1 on error
+     */
+    int ReadData(void *buf, size_t n);
 
     uint32_t GetFileId() const;
     std::string GetPathName() const;
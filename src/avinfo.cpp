@@ -69,6 +69,8 @@ AVInfo::AVInfo(Myth::Stream* file)
 , m_DTS(PTS_UNSET)
 , m_PTS(PTS_UNSET)
 , m_AVStatus(0)
+, m_analyzed(false)
+, m_throughput(0)
 {
   m_av_buf = (unsigned char*)malloc(sizeof(*m_av_buf) * (m_av_buf_size + 1));
   if (m_av_buf)
@@ -170,48 +172,29 @@ void AVInfo::Process()
   }
 
   int ret = 0;
-  bool analyzed = false; // become true once all channel streams are parsed
-  size_t throughput = 0; // to limit size of analyzed data
+  m_analyzed = false;
+  m_throughput = 0;
 
-  while (!analyzed && throughput < ES_MAX_BUFFER_SIZE)
+  while (!m_analyzed && m_throughput < ES_MAX_BUFFER_SIZE)
   {
-    {
-      ret = m_AVContext->TSResync();
-    }
+    ret = m_AVContext->TSResync();
     if (ret != TSDemux::AVCONTEXT_CONTINUE)
       break;
 
-    ret = m_AVContext->ProcessTSPacket();
-
-    if (m_AVContext->HasPIDStreamData())
-    {
-      TSDemux::STREAM_PKT pkt;
-      while (get_stream_data(&pkt))
-      {
-        throughput += pkt.size;
-        if (pkt.streamChange)
-        {
-          // Update stream properties. Analyzing will be closed once setup is completed for all streams.
-          if (update_pvr_stream(pkt.pid) && m_nosetup.empty())
-              analyzed = true;
-        }
-      }
-    }
-    if (m_AVContext->HasPIDPayload())
-    {
-      ret = m_AVContext->ProcessTSPayload();
-      if (ret == TSDemux::AVCONTEXT_PROGRAM_CHANGE)
-      {
-        populate_pvr_streams();
-      }
-    }
+    // Process in place all the packets buffered from the current position
+    const unsigned char* data = ReadAV(m_AVContext->GetPosition(), FLUTS_NORMAL_TS_PACKETSIZE);
+    if (!data)
+      break;
+    ret = m_AVContext->ProcessTSBatch(data, m_av_rbe - data, *this);
+    if (ret == TSDemux::AVCONTEXT_TS_NOSYNC)
+      continue;
 
     if (ret < 0)
       XBMC->Log(LOG_NOTICE, LOGTAG "%s: error %d", __FUNCTION__, ret);
 
     if (ret == TSDemux::AVCONTEXT_TS_ERROR)
-      throughput = static_cast<size_t>(m_AVContext->Shift());
-    else
+      m_throughput = static_cast<size_t>(m_AVContext->Shift());
+    else if (ret < 0)
       m_AVContext->GoNext();
   }
 
@@ -252,12 +235,30 @@ std::vector<AVInfo::STREAM_AVINFO> AVInfo::GetStreams() const
   return ret;
 }
 
-bool AVInfo::get_stream_data(TSDemux::STREAM_PKT* pkt)
+bool AVInfo::HandleStreamData(TSDemux::ElementaryStream* es)
 {
-  TSDemux::ElementaryStream* es = m_AVContext->GetPIDStream();
-  if (!es)
-    return false;
+  TSDemux::STREAM_PKT pkt;
+  while (get_stream_data(es, &pkt))
+  {
+    m_throughput += pkt.size;
+    if (pkt.streamChange)
+    {
+      // Update stream properties. Analyzing will be closed once setup is completed for all streams.
+      if (update_pvr_stream(pkt.pid) && m_nosetup.empty())
+        m_analyzed = true;
+    }
+  }
+  return !m_analyzed && m_throughput < ES_MAX_BUFFER_SIZE;
+}
+
+bool AVInfo::HandleProgramChange()
+{
+  populate_pvr_streams();
+  return true;
+}
 
+bool AVInfo::get_stream_data(TSDemux::ElementaryStream* es, TSDemux::STREAM_PKT* pkt)
+{
   if (!es->GetStreamPacket(pkt))
     return false;
 
@@ -31,13 +31,15 @@
 
 #define AV_BUFFER_SIZE          131072
 
-class AVInfo : public TSDemux::TSDemuxer
+class AVInfo : public TSDemux::TSDemuxer, public TSDemux::TSBatchHandler
 {
 public:
   AVInfo(Myth::Stream *file);
   ~AVInfo();
 
   const unsigned char* ReadAV(uint64_t pos, size_t n);
+  bool HandleStreamData(TSDemux::ElementaryStream* es);
+  bool HandleProgramChange();
 
   typedef struct
   {
@@ -55,7 +57,7 @@ private:
 
   void Process();
 
-  bool get_stream_data(TSDemux::STREAM_PKT* pkt);
+  bool get_stream_data(TSDemux::ElementaryStream* es, TSDemux::STREAM_PKT* pkt);
   void populate_pvr_streams();
   bool update_pvr_stream(uint16_t pid);
 
@@ -74,4 +76,6 @@ private:
 
   std::set<uint16_t> m_nosetup;
   int m_AVStatus;
+  bool m_analyzed;              ///< true once all channel streams are parsed
+  size_t m_throughput;          ///< to limit size of analyzed data
 };
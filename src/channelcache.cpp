@@ -0,0 +1,228 @@
+/*
+ *      Copyright (C) 2005-2013 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301 USA
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "channelcache.h"
+#include "client.h"
+#include "tools.h"
+
+#include <cstring>
+
+#define CHANNEL_CACHE_MAGIC       "MCC1"
+#define CHANNEL_CACHE_MAXSIZE     0x1000000
+
+using namespace ADDON;
+
+namespace
+{
+  void PutString(std::string& buf, const std::string& str)
+  {
+    PutVarint(buf, str.size());
+    buf.append(str);
+  }
+
+  bool GetString(const unsigned char*& p, const unsigned char* end, std::string& str)
+  {
+    uint64_t len;
+    if (!GetVarint(p, end, len) || len > static_cast<uint64_t>(end - p))
+      return false;
+    str.assign(reinterpret_cast<const char*>(p), static_cast<size_t>(len));
+    p += len;
+    return true;
+  }
+
+  bool GetUint32(const unsigned char*& p, const unsigned char* end, uint32_t& v)
+  {
+    uint64_t u;
+    if (!GetVarint(p, end, u) || u > 0xffffffff)
+      return false;
+    v = static_cast<uint32_t>(u);
+    return true;
+  }
+
+  bool SameChannel(const Myth::Channel& a, const Myth::Channel& b)
+  {
+    return a.chanId == b.chanId &&
+            a.chanNum == b.chanNum &&
+            a.callSign == b.callSign &&
+            a.iconURL == b.iconURL &&
+            a.channelName == b.channelName &&
+            a.mplexId == b.mplexId &&
+            a.commFree == b.commFree &&
+            a.chanFilters == b.chanFilters &&
+            a.sourceId == b.sourceId &&
+            a.inputId == b.inputId &&
+            a.visible == b.visible;
+  }
+}
+
+ChannelCache::ChannelCache()
+: sources(new Myth::VideoSourceList)
+, channels()
+{
+}
+
+bool ChannelCache::Equals(const ChannelCache& other) const
+{
+  if (sources->size() != other.sources->size() || channels.size() != other.channels.size())
+    return false;
+  for (size_t i = 0; i < sources->size(); ++i)
+  {
+    const Myth::VideoSource& sa = *(*sources)[i];
+    const Myth::VideoSource& sb = *(*other.sources)[i];
+    if (sa.sourceId != sb.sourceId || sa.sourceName != sb.sourceName)
+      return false;
+  }
+  for (size_t i = 0; i < channels.size(); ++i)
+  {
+    const Myth::ChannelList& ca = *channels[i];
+    const Myth::ChannelList& cb = *other.channels[i];
+    if (ca.size() != cb.size())
+      return false;
+    for (size_t j = 0; j < ca.size(); ++j)
+    {
+      if (!SameChannel(*ca[j], *cb[j]))
+        return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * File layout: the magic and the backend key, then varints for the count of
+ * sources and for each source its id, name and channels. Strings are stored
+ * as their length followed by the bytes.
+ */
+bool ChannelCache::Load(const std::string& filePath, const std::string& backend)
+{
+  if (!XBMC->FileExists(filePath.c_str(), false))
+    return false;
+  void* file = XBMC->OpenFile(filePath.c_str(), 0);
+  if (!file)
+    return false;
+  std::vector<unsigned char> buf;
+  int64_t len = XBMC->GetFileLength(file);
+  if (len > 0 && len <= CHANNEL_CACHE_MAXSIZE)
+  {
+    buf.resize(static_cast<size_t>(len));
+    if (XBMC->ReadFile(file, &buf[0], buf.size()) != len)
+      buf.clear();
+  }
+  XBMC->CloseFile(file);
+
+  size_t ml = strlen(CHANNEL_CACHE_MAGIC);
+  if (buf.size() < ml || memcmp(&buf[0], CHANNEL_CACHE_MAGIC, ml) != 0)
+  {
+    XBMC->Log(LOG_NOTICE, "%s: Invalid file '%s'", __FUNCTION__, filePath.c_str());
+    return false;
+  }
+  const unsigned char* p = &buf[ml];
+  const unsigned char* end = &buf[0] + buf.size();
+  std::string key;
+  uint64_t sourceCount;
+  if (!GetString(p, end, key) || key != backend)
+  {
+    XBMC->Log(LOG_INFO, "%s: Cache of another backend in '%s'", __FUNCTION__, filePath.c_str());
+    return false;
+  }
+  if (!GetVarint(p, end, sourceCount) || sourceCount > buf.size())
+    return false;
+
+  Myth::VideoSourceListPtr newSources(new Myth::VideoSourceList);
+  std::vector<Myth::ChannelListPtr> newChannels;
+  unsigned total = 0;
+  for (uint64_t i = 0; i < sourceCount; ++i)
+  {
+    Myth::VideoSourcePtr source(new Myth::VideoSource);
+    uint64_t count;
+    if (!GetUint32(p, end, source->sourceId) || !GetString(p, end, source->sourceName) ||
+            !GetVarint(p, end, count) || count > buf.size())
+      return false;
+    Myth::ChannelListPtr list(new Myth::ChannelList);
+    list->reserve(static_cast<size_t>(count));
+    for (uint64_t j = 0; j < count; ++j)
+    {
+      Myth::ChannelPtr channel(new Myth::Channel);
+      uint32_t visible;
+      if (!GetUint32(p, end, channel->chanId) ||
+              !GetString(p, end, channel->chanNum) ||
+              !GetString(p, end, channel->callSign) ||
+              !GetString(p, end, channel->iconURL) ||
+              !GetString(p, end, channel->channelName) ||
+              !GetUint32(p, end, channel->mplexId) ||
+              !GetString(p, end, channel->commFree) ||
+              !GetString(p, end, channel->chanFilters) ||
+              !GetUint32(p, end, channel->sourceId) ||
+              !GetUint32(p, end, channel->inputId) ||
+              !GetUint32(p, end, visible))
+        return false;
+      channel->visible = (visible != 0);
+      list->push_back(channel);
+    }
+    total += list->size();
+    newSources->push_back(source);
+    newChannels.push_back(list);
+  }
+  sources.swap(newSources);
+  channels.swap(newChannels);
+  XBMC->Log(LOG_DEBUG, "%s: Loaded %u channel(s) of %u source(s) from '%s'", __FUNCTION__,
+          total, (unsigned)sources->size(), filePath.c_str());
+  return true;
+}
+
+bool ChannelCache::Save(const std::string& filePath, const std::string& backend) const
+{
+  std::string buf(CHANNEL_CACHE_MAGIC);
+  PutString(buf, backend);
+  PutVarint(buf, sources->size());
+  for (size_t i = 0; i < sources->size(); ++i)
+  {
+    const Myth::VideoSource& source = *(*sources)[i];
+    PutVarint(buf, source.sourceId);
+    PutString(buf, source.sourceName);
+    const Myth::ChannelList& list = *channels[i];
+    PutVarint(buf, list.size());
+    for (Myth::ChannelList::const_iterator it = list.begin(); it != list.end(); ++it)
+    {
+      const Myth::Channel& channel = **it;
+      PutVarint(buf, channel.chanId);
+      PutString(buf, channel.chanNum);
+      PutString(buf, channel.callSign);
+      PutString(buf, channel.iconURL);
+      PutString(buf, channel.channelName);
+      PutVarint(buf, channel.mplexId);
+      PutString(buf, channel.commFree);
+      PutString(buf, channel.chanFilters);
+      PutVarint(buf, channel.sourceId);
+      PutVarint(buf, channel.inputId);
+      PutVarint(buf, channel.visible ? 1 : 0);
+    }
+  }
+  void* file = XBMC->OpenFileForWrite(filePath.c_str(), true);
+  if (!file)
+  {
+    XBMC->Log(LOG_ERROR, "%s: Failed to open file '%s'", __FUNCTION__, filePath.c_str());
+    return false;
+  }
+  bool ret = (XBMC->WriteFile(file, buf.data(), buf.size()) == static_cast<ssize_t>(buf.size()));
+  XBMC->CloseFile(file);
+  return ret;
+}
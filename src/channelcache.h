@@ -0,0 +1,52 @@
+#pragma once
+/*
+ *      Copyright (C) 2005-2013 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301 USA
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <mythtypes.h>
+
+#include <string>
+#include <vector>
+
+#define CHANNEL_CACHE_FILENAME    "channels.cache"
+
+/**
+ * The video sources and their channels as fetched from the backend. They are
+ * saved in the user profile, so the next start can serve the channels before
+ * the backend has answered. The backend key tells the cache of a backend from
+ * another one.
+ */
+class ChannelCache
+{
+public:
+  ChannelCache();
+
+  Myth::VideoSourceListPtr sources;
+  std::vector<Myth::ChannelListPtr> channels; ///< channels by index of source
+
+  bool Empty() const { return sources->empty(); }
+
+  /// Returns true when both hold the same sources and channels
+  bool Equals(const ChannelCache& other) const;
+
+  bool Load(const std::string& filePath, const std::string& backend);
+  bool Save(const std::string& filePath, const std::string& backend) const;
+};
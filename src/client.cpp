@@ -41,6 +41,7 @@ int           g_iProtoPort              = DEFAULT_PROTO_PORT;               ///<
 int           g_iWSApiPort              = DEFAULT_WSAPI_PORT;               ///< The mythtv sevice API port (default is 6544)
 std::string   g_szWSSecurityPin         = DEFAULT_WSAPI_SECURITY_PIN;       ///< The default security pin for the mythtv wsapi
 bool          g_bExtraDebug             = DEFAULT_EXTRA_DEBUG;              ///< Output extensive debug information to the log
+std::string   g_szCaptureDir            = "";                               ///< The directory capturing the connections to the backend
 bool          g_bLiveTV                 = DEFAULT_LIVETV;                   ///< LiveTV support (or recordings only)
 bool          g_bLiveTVPriority         = DEFAULT_LIVETV_PRIORITY;          ///< MythTV Backend setting to allow live TV to move scheduled shows
 int           g_iLiveTVConflictStrategy = DEFAULT_LIVETV_CONFLICT_STRATEGY; ///< Conflict resolving strategy (0=
@@ -67,6 +68,7 @@ bool          g_bShowNotRecording       = DEFAULT_SHOW_NOT_RECORDING;
 bool          g_bPromptDeleteAtEnd      = DEFAULT_PROMPT_DELETE;
 bool          g_bUseBackendBookmarks    = DEFAULT_BACKEND_BOOKMARKS;
 bool          g_bRootDefaultGroup       = DEFAULT_ROOT_DEFAULT_GROUP;
+bool          g_bDemuxing               = DEFAULT_HANDLE_DEMUXING;
 std::string   g_szDamagedColor          = DEFAULT_DAMAGED_COLOR;
 
 ///* Client member variables */
@@ -252,6 +254,16 @@ ADDON_STATUS ADDON_Create(void *hdl, void *props)
   }
   buffer[0] = 0;
 
+  /* Read setting "capture_dir" from settings.xml */
+  if (XBMC->GetSetting("capture_dir", buffer))
+    g_szCaptureDir = buffer;
+  else
+  {
+    /* If setting is unknown fallback to defaults */
+    g_szCaptureDir = "";
+  }
+  buffer[0] = 0;
+
   /* Read settings "group_recordings" from settings.xml */
   if (!XBMC->GetSetting("group_recordings", &g_iGroupRecordings))
   {
@@ -348,6 +360,14 @@ ADDON_STATUS ADDON_Create(void *hdl, void *props)
     g_bRootDefaultGroup = DEFAULT_ROOT_DEFAULT_GROUP;
   }
 
+  /* Read setting "demuxing" from settings.xml */
+  if (!XBMC->GetSetting("demuxing", &g_bDemuxing))
+  {
+    /* If setting is unknown fallback to defaults */
+    XBMC->Log(LOG_ERROR, "Couldn't get 'demuxing' setting, falling back to '%u' as default", DEFAULT_HANDLE_DEMUXING);
+    g_bDemuxing = DEFAULT_HANDLE_DEMUXING;
+  }
+
   /* Read setting "damaged_color" from settings.xml */
   if (XBMC->GetSetting("damaged_color", buffer))
   {
@@ -415,6 +435,12 @@ ADDON_STATUS ADDON_Create(void *hdl, void *props)
   menuHook.iLocalizedStringId = 30426;
   PVR->AddMenuHook(&menuHook);
 
+  memset(&menuHook, 0, sizeof(PVR_MENUHOOK));
+  menuHook.category = PVR_MENUHOOK_SETTING;
+  menuHook.iHookId = MENUHOOK_SHOW_METRICS;
+  menuHook.iLocalizedStringId = 30427;
+  PVR->AddMenuHook(&menuHook);
+
   XBMC->Log(LOG_DEBUG, "Creating menu hooks...done");
 
   // Create our addon
@@ -517,6 +543,12 @@ ADDON_STATUS ADDON_SetSetting(const char *settingName, const void *settingValue)
     if (g_bUseBackendBookmarks != *(bool*)settingValue)
       return ADDON_STATUS_NEED_RESTART;
   }
+  else if (str == "demuxing")
+  {
+    XBMC->Log(LOG_INFO, "Changed Setting 'demuxing' from %u to %u", g_bDemuxing, *(bool*)settingValue);
+    if (g_bDemuxing != *(bool*)settingValue)
+      return ADDON_STATUS_NEED_RESTART;
+  }
   else if (str == "host_ether")
   {
     XBMC->Log(LOG_INFO, "Changed Setting 'host_ether' from %s to %s", g_szMythHostEther.c_str(), (const char*)settingValue);
@@ -532,6 +564,16 @@ ADDON_STATUS ADDON_SetSetting(const char *settingName, const void *settingValue)
         g_client->SetDebug();
     }
   }
+  else if (str == "capture_dir")
+  {
+    XBMC->Log(LOG_INFO, "Changed Setting 'capture_dir' from %s to %s", g_szCaptureDir.c_str(), (const char*)settingValue);
+    if (g_szCaptureDir != (const char*)settingValue)
+    {
+      g_szCaptureDir = (const char*)settingValue;
+      if (g_client)
+        g_client->SetDebug();
+    }
+  }
   else if (str == "livetv")
   {
     XBMC->Log(LOG_INFO, "Changed Setting 'livetv' from %u to %u", g_bLiveTV, *(bool*)settingValue);
@@ -727,7 +769,7 @@ PVR_ERROR GetAddonCapabilities(PVR_ADDON_CAPABILITIES *pCapabilities)
     pCapabilities->bSupportsTimers                = true;
 
     pCapabilities->bHandlesInputStream            = true;
-    pCapabilities->bHandlesDemuxing               = false;
+    pCapabilities->bHandlesDemuxing               = g_bDemuxing;
 
     pCapabilities->bSupportsRecordings            = true;
     pCapabilities->bSupportsRecordingsUndelete    = true;
@@ -1148,6 +1190,52 @@ long long LengthRecordedStream(void)
   return g_client->LengthRecordedStream();
 }
 
+/*
+ * PVR Demux Functions
+ */
+
+PVR_ERROR GetStreamProperties(PVR_STREAM_PROPERTIES* pProperties)
+{
+  if (g_client == NULL)
+    return PVR_ERROR_SERVER_ERROR;
+
+  return g_client->GetStreamProperties(pProperties);
+}
+
+void DemuxAbort(void)
+{
+  if (g_client != NULL)
+    g_client->DemuxAbort();
+}
+
+DemuxPacket* DemuxRead(void)
+{
+  if (g_client == NULL)
+    return NULL;
+
+  return g_client->DemuxRead();
+}
+
+void DemuxFlush(void)
+{
+  if (g_client != NULL)
+    g_client->DemuxFlush();
+}
+
+void DemuxReset()
+{
+  if (g_client != NULL)
+    g_client->DemuxReset();
+}
+
+bool SeekTime(double time, bool backwards, double *startpts)
+{
+  if (g_client == NULL)
+    return false;
+
+  return g_client->SeekTime(time, backwards, startpts);
+}
+
 /*
  * Unused API Functions
  */
@@ -1160,12 +1248,6 @@ PVR_ERROR GetStreamTimes(PVR_STREAM_TIMES *pStreamTimes)
   return g_client->GetStreamTimes(pStreamTimes);
 }
 
-PVR_ERROR GetStreamProperties(PVR_STREAM_PROPERTIES *) { return PVR_ERROR_NOT_IMPLEMENTED; }
-void DemuxAbort(void) {}
-DemuxPacket* DemuxRead(void) { return NULL; }
-void DemuxFlush(void) {}
-bool SeekTime(double, bool, double *) { return false; }
-void DemuxReset() {}
 void FillBuffer(bool mode) {}
 void SetSpeed(int) {};
 PVR_ERROR SetEPGTimeFrame(int) { return PVR_ERROR_NOT_IMPLEMENTED; }
@@ -52,6 +52,7 @@
 #define MENUHOOK_TRIGGER_CHANNEL_UPDATE     6
 #define MENUHOOK_INFO_RECORDING             7
 #define MENUHOOK_INFO_EPG                   8
+#define MENUHOOK_SHOW_METRICS               9
 
 #define DEFAULT_TUNE_DELAY                  5
 #define GROUP_RECORDINGS_ALWAYS             0
@@ -69,6 +70,7 @@
 #define DEFAULT_LIVETV_RECORDINGS           true
 #define DEFAULT_BACKEND_BOOKMARKS           true
 #define DEFAULT_ROOT_DEFAULT_GROUP          false
+#define DEFAULT_HANDLE_DEMUXING             false
 #define DEFAULT_DAMAGED_COLOR               "yellow"
 /*!
  * @brief PVR macros for string exchange
@@ -92,6 +94,7 @@ extern int          g_iProtoPort;               ///< The mythtv protocol port (d
 extern int          g_iWSApiPort;               ///< The mythtv service API port (default is 6544)
 extern std::string  g_szWSSecurityPin;          ///< The default security pin for the mythtv wsapi
 extern bool         g_bExtraDebug;              ///< Debug logging
+extern std::string  g_szCaptureDir;             ///< Capture of the connections to the backend
 extern bool         g_bLiveTV;                  ///< LiveTV support (or recordings only)
 extern bool         g_bLiveTVPriority;          ///< MythTV Backend setting to allow live TV to move scheduled shows
 extern int          g_iLiveTVConflictStrategy;  ///< Live TV conflict resolving strategy (0=Has later, 1=Stop TV, 2=Cancel recording)
@@ -121,6 +124,7 @@ extern bool         g_bShowNotRecording;
 extern bool         g_bPromptDeleteAtEnd;
 extern bool         g_bUseBackendBookmarks;
 extern bool         g_bRootDefaultGroup;
+extern bool         g_bDemuxing;                ///< Demux the streams in the add-on
 extern std::string  g_szDamagedColor;
 
 extern ADDON::CHelper_libXBMC_addon *XBMC;
@@ -9,6 +9,7 @@ class CMutex;
 class CThread;
 class CTimeout;
 class CEvent;
+class CCompletion;
 }
 }
 
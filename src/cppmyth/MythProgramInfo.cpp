@@ -263,6 +263,16 @@ bool MythProgramInfo::HasBookmark() const
   return ((m_proginfo && (m_proginfo->programFlags & 0x00000010)) ? true : false);
 }
 
+bool MythProgramInfo::IsCommFlagged() const
+{
+  return ((m_proginfo && (m_proginfo->programFlags & 0x00000001)) ? true : false);
+}
+
+bool MythProgramInfo::HasCutList() const
+{
+  return ((m_proginfo && (m_proginfo->programFlags & 0x00000002)) ? true : false);
+}
+
 uint32_t MythProgramInfo::ChannelID() const
 {
   return (m_proginfo ? m_proginfo->channel.chanId : 0);
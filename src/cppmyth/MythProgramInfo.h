@@ -69,6 +69,8 @@ public:
   bool IsWatched() const;
   bool IsDeletePending() const;
   bool HasBookmark() const;
+  bool IsCommFlagged() const;
+  bool HasCutList() const;
   uint32_t ChannelID() const;
   std::string ChannelName() const;
   std::string Callsign() const;
@@ -126,6 +126,7 @@ bool MythRecordingRuleNode::IsRecording() const
 
 MythScheduleManager::MythScheduleManager(const std::string& server, unsigned protoPort, unsigned wsapiPort, const std::string& wsapiSecurityPin)
 : m_lock(new Myth::OS::CMutex)
+, m_updateLock(new Myth::OS::CMutex)
 , m_control(NULL)
 , m_protoVersion(0)
 , m_versionHelper(NULL)
@@ -137,7 +138,14 @@ MythScheduleManager::MythScheduleManager(const std::string& server, unsigned pro
 , m_templates(NULL)
 {
   m_control = new Myth::Control(server, protoPort, wsapiPort, wsapiSecurityPin);
-  this->Update();
+  // The lists are loaded by Update, meanwhile they are empty
+  this->Setup();
+  m_rules = new NodeList;
+  m_rulesById = new NodeById;
+  m_rulesByIndex = new NodeByIndex;
+  m_templates = new MythRecordingRuleList;
+  m_recordings = new RecordingList;
+  m_recordingIndexByRuleId = new RecordingIndexByRuleId;
 }
 
 MythScheduleManager::~MythScheduleManager()
@@ -151,6 +159,7 @@ MythScheduleManager::~MythScheduleManager()
   SAFE_DELETE(m_rules);
   SAFE_DELETE(m_versionHelper);
   SAFE_DELETE(m_control);
+  delete m_updateLock;
   delete m_lock;
 }
 
@@ -839,6 +848,9 @@ void MythScheduleManager::CloseControl()
 
 void MythScheduleManager::Update()
 {
+  // The updates come from the loads and the events: run one at a time so
+  // the last one publishes the latest lists, and keep the helper in use
+  Myth::OS::CLockGuard updating(*m_updateLock);
   // Setup VersionHelper for the new set
   this->Setup();
   // Allocate containers
@@ -216,6 +216,7 @@ public:
 
 private:
   mutable Myth::OS::CMutex *m_lock;
+  Myth::OS::CMutex *m_updateLock; ///< serializes Update and the helper setup
   Myth::Control *m_control;
 
   int m_protoVersion;
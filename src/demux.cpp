@@ -0,0 +1,659 @@
+/*
+ *      Copyright (C) 2005-2013 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301 USA
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <kodi/xbmc_pvr_types.h>
+
+#include "demux.h"
+#include "demuxer/debug.h"
+
+#define LOGTAG                  "[DEMUX] "
+#define RATE_INTERVAL           1000000 // us between the samples of the rates
+
+using namespace ADDON;
+
+void DemuxLog(int level, char *msg)
+{
+  if (msg && level != DEMUX_DBG_NONE)
+  {
+    bool doLog = g_bExtraDebug;
+    addon_log_t loglevel = LOG_DEBUG;
+    switch (level)
+    {
+    case DEMUX_DBG_ERROR:
+      loglevel = LOG_ERROR;
+      doLog = true;
+      break;
+    case DEMUX_DBG_WARN:
+    case DEMUX_DBG_INFO:
+      loglevel = LOG_INFO;
+      break;
+    case DEMUX_DBG_DEBUG:
+    case DEMUX_DBG_PARSE:
+    case DEMUX_DBG_ALL:
+      loglevel = LOG_DEBUG;
+      break;
+    }
+    if (XBMC && doLog)
+      XBMC->Log(loglevel, LOGTAG "%s", msg);
+  }
+}
+
+Demux::Demux(Myth::Stream* file, bool realtime, const std::string& indexFile)
+: CThread()
+, m_file(file)
+, m_realtime(realtime)
+, m_endOfStream(false)
+, m_channel(1)
+, m_av_buf_size(DEMUX_BUFFER_SIZE)
+, m_av_pos(0)
+, m_av_buf(NULL)
+, m_av_rbs(NULL)
+, m_av_rbe(NULL)
+, m_AVContext(NULL)
+, m_mainStreamPID(0xffff)
+, m_mainStreamVideo(false)
+, m_DTS(PTS_UNSET)
+, m_PTS(PTS_UNSET)
+, m_indexFile(indexFile)
+, m_seeked(false)
+, m_started(false)
+, m_pesCount(0)
+, m_finished(false)
+, m_ratePackets(0)
+, m_rateBytes(0)
+, m_rateTime(Myth::Metrics::Clock())
+{
+  memset(&m_streams, 0, sizeof(PVR_STREAM_PROPERTIES));
+  memset(m_pesPos, 0, sizeof(m_pesPos));
+  if (!m_realtime && !m_indexFile.empty())
+    m_index.Load(m_indexFile);
+  m_av_buf = (unsigned char*)malloc(sizeof(*m_av_buf) * (m_av_buf_size + 1));
+  if (m_av_buf)
+  {
+    m_av_rbs = m_av_buf;
+    m_av_rbe = m_av_buf;
+
+    if (g_bExtraDebug)
+      TSDemux::DBGLevel(DEMUX_DBG_DEBUG);
+    else
+      TSDemux::DBGLevel(DEMUX_DBG_ERROR);
+    TSDemux::SetDBGMsgCallback(DemuxLog);
+
+    m_AVContext = new TSDemux::AVContext(this, m_av_pos, m_channel);
+
+    StartThread();
+  }
+  else
+  {
+    XBMC->Log(LOG_ERROR, LOGTAG "alloc AV buffer failed");
+  }
+}
+
+Demux::~Demux()
+{
+  Abort();
+
+  // Keep the keyframes for the next playback
+  if (!m_indexFile.empty() && m_index.IsDirty())
+    m_index.Save(m_indexFile);
+
+  // Free AV context
+  if (m_AVContext)
+    SAFE_DELETE(m_AVContext);
+  // Free AV buffer
+  if (m_av_buf)
+  {
+    if (g_bExtraDebug)
+      XBMC->Log(LOG_DEBUG, LOGTAG "free AV buffer: allocated size was %zu", m_av_buf_size);
+    free(m_av_buf);
+    m_av_buf = NULL;
+  }
+}
+
+/*
+ * Implement our AV reader
+ */
+const unsigned char* Demux::ReadAV(uint64_t pos, size_t n)
+{
+  // out of range
+  if (n > m_av_buf_size)
+    return NULL;
+
+  // Already read ?
+  size_t sz = m_av_rbe - m_av_buf;
+  if (pos < m_av_pos || pos > (m_av_pos + sz))
+  {
+    // seek and reset buffer
+    int64_t newpos = m_file->Seek((int64_t)pos, Myth::WHENCE_SET);
+    if (newpos < 0)
+      return NULL;
+    m_av_pos = pos = (uint64_t)newpos;
+    m_av_rbs = m_av_rbe = m_av_buf;
+  }
+  else
+  {
+    // move to the desired pos in buffer
+    m_av_rbs = m_av_buf + (size_t)(pos - m_av_pos);
+  }
+
+  size_t dataread = m_av_rbe - m_av_rbs;
+  if (dataread >= n)
+    return m_av_rbs;
+  // flush old data to free up space at the end
+  memmove(m_av_buf, m_av_rbs, dataread);
+  m_av_rbs = m_av_buf;
+  m_av_rbe = m_av_rbs + dataread;
+  m_av_pos = pos;
+  // fill new data
+  unsigned int len = (unsigned int)(m_av_buf_size - dataread);
+  while (!IsStopped())
+  {
+    int ret = m_file->Read(m_av_rbe, len);
+    if (ret > 0)
+    {
+      m_av_rbe += ret;
+      dataread += ret;
+      len -= ret;
+    }
+    m_endOfStream = (ret == 0);
+    if (dataread >= n || ret <= 0)
+      break;
+  }
+  return dataread >= n ? m_av_rbs : NULL;
+}
+
+void* Demux::Process()
+{
+  if (!m_AVContext)
+  {
+    XBMC->Log(LOG_ERROR, LOGTAG "%s: no AVContext", __FUNCTION__);
+    return NULL;
+  }
+
+  int ret = 0;
+
+  while (!IsStopped())
+  {
+    // Wait for room in the queue
+    {
+      Myth::OS::CLockGuard lock(m_queueLock);
+      while (m_queue.size() >= DEMUX_QUEUE_SIZE && !IsStopped())
+      {
+        Myth::OS::CTimeout timeout(100);
+        m_queueCondition.Wait(m_queueLock, timeout);
+      }
+    }
+
+    // Once finished, the thread only waits for a seek
+    if (m_finished)
+    {
+      Sleep(100);
+      continue;
+    }
+
+    uint64_t pos = m_AVContext->GetPosition();
+    ret = m_AVContext->TSResync();
+    if (ret != TSDemux::AVCONTEXT_CONTINUE)
+    {
+      // The end of a recording, or a stream that can't be synced, terminates
+      // the demux once the queue is drained. Else the stream could be
+      // growing: retry later
+      bool nosync = (ret == TSDemux::AVCONTEXT_TS_NOSYNC && m_AVContext->GetPosition() == pos);
+      if (nosync || (ret == TSDemux::AVCONTEXT_IO_ERROR && m_endOfStream && !m_realtime))
+      {
+        if (nosync)
+          XBMC->Log(LOG_ERROR, LOGTAG "%s: no sync found", __FUNCTION__);
+        Myth::OS::CLockGuard lock(m_queueLock);
+        m_finished = true;
+        m_queueCondition.Broadcast();
+      }
+      else if (ret == TSDemux::AVCONTEXT_IO_ERROR)
+        Sleep(100);
+      continue;
+    }
+
+    // Process in place all the packets buffered from the current position
+    const unsigned char* data = ReadAV(m_AVContext->GetPosition(), FLUTS_NORMAL_TS_PACKETSIZE);
+    if (!data)
+      continue;
+    uint64_t start = m_AVContext->GetPosition();
+    ret = m_AVContext->ProcessTSBatch(data, m_av_rbe - data, *this);
+    if (m_AVContext->GetPosition() > start)
+      m_rateBytes += m_AVContext->GetPosition() - start;
+    sample_rates();
+    if (ret == TSDemux::AVCONTEXT_TS_NOSYNC)
+      continue;
+
+    if (ret < 0)
+      XBMC->Log(LOG_NOTICE, LOGTAG "%s: error %d", __FUNCTION__, ret);
+
+    if (ret == TSDemux::AVCONTEXT_TS_ERROR)
+      m_AVContext->Shift();
+    else if (ret < 0)
+      m_AVContext->GoNext();
+  }
+
+  XBMC->Log(LOG_DEBUG, LOGTAG "%s: stopped with status %d", __FUNCTION__, ret);
+  return NULL;
+}
+
+void Demux::stop_process()
+{
+  StopThread(false);
+  // Wake up the wait for room in the queue
+  {
+    Myth::OS::CLockGuard lock(m_queueLock);
+    m_queueCondition.Broadcast();
+  }
+  StopThread();
+}
+
+bool Demux::HandleStreamData(TSDemux::ElementaryStream* es)
+{
+  // A new PES of the main stream begins here
+  if (es->pid == m_mainStreamPID)
+    m_pesPos[m_pesCount++ % DEMUX_PES_HISTORY] = m_AVContext->GetPosition();
+
+  unsigned packets = 0;
+  size_t bytes = 0;
+  TSDemux::STREAM_PKT pkt;
+  while (es->GetStreamPacket(&pkt))
+  {
+    if (pkt.duration > 180000)
+    {
+      pkt.duration = 0;
+    }
+    else if (pkt.pid == m_mainStreamPID)
+    {
+      // Sync main DTS & PTS
+      m_DTS = pkt.dts;
+      m_PTS = pkt.pts;
+      if (!m_realtime && pkt.pts != PTS_UNSET && (pkt.keyframe || !m_mainStreamVideo))
+        index_keyframe(pkt.pts);
+    }
+
+    if (pkt.streamChange)
+    {
+      // Update stream properties. Once setup is completed for all streams the player is notified.
+      if (update_pvr_stream(pkt.pid) && m_nosetup.empty())
+        push_stream_change();
+    }
+    // Stream properties are needed before sending data
+    if (m_nosetup.find(pkt.pid) != m_nosetup.end())
+      continue;
+
+    DemuxPacket* dxp = PVR->AllocateDemuxPacket(static_cast<int>(pkt.size));
+    if (!dxp)
+      break;
+    memcpy(dxp->pData, pkt.data, pkt.size);
+    dxp->iSize = static_cast<int>(pkt.size);
+    dxp->iStreamId = static_cast<int>(pkt.pid);
+    dxp->duration = (double)pkt.duration * DVD_TIME_BASE / PTS_TIME_BASE;
+    dxp->dts = (pkt.dts == PTS_UNSET ? DVD_NOPTS_VALUE : (double)pkt.dts * DVD_TIME_BASE / PTS_TIME_BASE);
+    dxp->pts = (pkt.pts == PTS_UNSET ? DVD_NOPTS_VALUE : (double)pkt.pts * DVD_TIME_BASE / PTS_TIME_BASE);
+    push_packet(dxp);
+    ++packets;
+    bytes += pkt.size;
+  }
+  if (packets)
+  {
+    std::map<uint16_t, StreamMetrics>::const_iterator it = m_streamMetrics.find(es->pid);
+    if (it != m_streamMetrics.end())
+    {
+      Myth::Metrics::Count(it->second.packets, packets);
+      Myth::Metrics::Count(it->second.bytes, (int64_t)bytes);
+    }
+    m_ratePackets += packets;
+  }
+  // Stop the batch when the queue is full
+  Myth::OS::CLockGuard lock(m_queueLock);
+  return m_queue.size() < DEMUX_QUEUE_SIZE;
+}
+
+bool Demux::HandleProgramChange()
+{
+  populate_pvr_streams();
+  if (m_nosetup.empty())
+    push_stream_change();
+  return true;
+}
+
+bool Demux::GetStreamProperties(PVR_STREAM_PROPERTIES* props)
+{
+  Myth::OS::CLockGuard lock(m_mutex);
+  if (!m_nosetup.empty())
+    XBMC->Log(LOG_NOTICE, LOGTAG "%s: incomplete setup", __FUNCTION__);
+
+  props->iStreamCount = m_streams.iStreamCount;
+  for (unsigned i = 0; i < m_streams.iStreamCount; i++)
+    props->stream[i] = m_streams.stream[i];
+  return true;
+}
+
+void Demux::Flush()
+{
+  Myth::OS::CLockGuard lock(m_queueLock);
+  while (!m_queue.empty())
+  {
+    PVR->FreeDemuxPacket(m_queue.front());
+    m_queue.pop_front();
+  }
+  m_queueCondition.Broadcast();
+}
+
+void Demux::Abort()
+{
+  stop_process();
+  Flush();
+  Myth::OS::CLockGuard lock(m_mutex);
+  m_streams.iStreamCount = 0;
+}
+
+void Demux::Reset()
+{
+  Flush();
+  // Parsing restarts on the next unit start of each stream
+  if (m_AVContext)
+    m_AVContext->ResetPackets();
+}
+
+DemuxPacket* Demux::Read()
+{
+  Myth::OS::CLockGuard lock(m_queueLock);
+  Myth::OS::CTimeout timeout(100);
+  while (m_queue.empty() && !m_finished && !IsStopped() && m_queueCondition.Wait(m_queueLock, timeout));
+  if (m_queue.empty())
+  {
+    // The queue is drained once stopped or at the end of the recording
+    if (m_finished || IsStopped())
+      return NULL;
+    // Nothing yet: hand an empty packet to keep the player waiting
+    lock.Unlock();
+    return PVR->AllocateDemuxPacket(0);
+  }
+  DemuxPacket* dxp = m_queue.front();
+  m_queue.pop_front();
+  m_queueCondition.Broadcast();
+  return dxp;
+}
+
+/*
+ * Time is in msec on the same origin as the packet PTS. The seek lands on the
+ * indexed keyframe. Out of the indexed range the position is extrapolated from
+ * the mean bit rate, and the index is completed from there while playing.
+ */
+bool Demux::SeekTime(double time, bool backwards, double* startpts)
+{
+  // Only the recordings are indexed
+  if (m_realtime || !m_AVContext)
+    return false;
+
+  stop_process();
+
+  KeyframeIndex::Entry first, last, entry;
+  uint64_t start;
+  bool found = false;
+  {
+    Myth::OS::CLockGuard lock(m_mutex);
+    start = m_index.GetStartPTS();
+    if (start != PTS_UNSET && m_index.First(first) && m_index.Last(last))
+    {
+      uint64_t target = (uint64_t)(time > 0 ? time * PTS_TIME_BASE / 1000 + 0.5 : 0) & PTS_MASK;
+      uint64_t delta = (target - start) & PTS_MASK;
+      if (delta > PTS_MASK / 2)
+        delta = 0; // before the start
+      if (delta <= last.time + DEMUX_INDEX_GAP)
+      {
+        if (!(found = m_index.Find(delta, backwards, entry)))
+          found = m_index.First(entry);
+      }
+      else if (last.time > first.time && last.pos > first.pos)
+      {
+        double rate = (double)(last.pos - first.pos) / (double)(last.time - first.time);
+        entry.time = delta;
+        entry.pos = last.pos + (uint64_t)(rate * (double)(delta - last.time));
+        int64_t size = m_file->GetSize();
+        if (size > 0 && entry.pos > (uint64_t)size)
+          entry.pos = (uint64_t)size > DEMUX_BUFFER_SIZE ? (uint64_t)size - DEMUX_BUFFER_SIZE : last.pos;
+        found = true;
+      }
+    }
+    if (found)
+      m_seeked = true;
+  }
+
+  if (found)
+  {
+    m_AVContext->GoPosition(entry.pos);
+    m_AVContext->ResetPackets();
+    m_DTS = m_PTS = PTS_UNSET;
+    for (unsigned i = 0; i < DEMUX_PES_HISTORY; ++i)
+      m_pesPos[i] = entry.pos;
+    m_pesCount = 0;
+    m_endOfStream = false;
+    {
+      Myth::OS::CLockGuard lock(m_queueLock);
+      m_finished = false;
+    }
+    Flush();
+    *startpts = (double)((start + entry.time) & PTS_MASK) * DVD_TIME_BASE / PTS_TIME_BASE;
+    XBMC->Log(LOG_DEBUG, LOGTAG "%s: seek to %.0f ms at position %lld", __FUNCTION__, time, (long long)entry.pos);
+  }
+  else
+    XBMC->Log(LOG_DEBUG, LOGTAG "%s: no keyframe known for %.0f ms", __FUNCTION__, time);
+
+  StartThread();
+  return found;
+}
+
+double Demux::GetStartTime()
+{
+  Myth::OS::CLockGuard lock(m_mutex);
+  uint64_t start = m_index.GetStartPTS();
+  return (start == PTS_UNSET ? 0 : (double)start * DVD_TIME_BASE / PTS_TIME_BASE);
+}
+
+void Demux::push_stream_change()
+{
+  DemuxPacket* dxp = PVR->AllocateDemuxPacket(0);
+  if (!dxp)
+    return;
+  dxp->iStreamId = DMX_SPECIALID_STREAMCHANGE;
+  push_packet(dxp);
+  XBMC->Log(LOG_DEBUG, LOGTAG "%s: streams change", __FUNCTION__);
+}
+
+void Demux::push_packet(DemuxPacket* dxp)
+{
+  Myth::OS::CLockGuard lock(m_queueLock);
+  m_queue.push_back(dxp);
+  m_queueCondition.Broadcast();
+}
+
+void Demux::register_stream_metrics(const TSDemux::ElementaryStream* es)
+{
+  if (m_streamMetrics.find(es->pid) != m_streamMetrics.end())
+    return;
+  char name[METRICS_NAME_MAXSIZE];
+  StreamMetrics ids;
+  snprintf(name, sizeof(name), "demux.%s.packets", es->GetStreamCodecName());
+  ids.packets = Myth::Metrics::Register(name, Myth::Metrics::COUNTER);
+  snprintf(name, sizeof(name), "demux.%s.bytes", es->GetStreamCodecName());
+  ids.bytes = Myth::Metrics::Register(name, Myth::Metrics::COUNTER);
+  m_streamMetrics.insert(std::make_pair(es->pid, ids));
+}
+
+void Demux::sample_rates()
+{
+  int64_t now = Myth::Metrics::Clock();
+  int64_t elapsed = now - m_rateTime;
+  if (elapsed < RATE_INTERVAL)
+    return;
+  static const Myth::Metrics::Id s_packetRate = Myth::Metrics::Register("demux.packets_per_s", Myth::Metrics::GAUGE);
+  static const Myth::Metrics::Id s_byteRate = Myth::Metrics::Register("demux.bytes_per_s", Myth::Metrics::GAUGE);
+  Myth::Metrics::Gauge(s_packetRate, (int64_t)(m_ratePackets * 1000000 / elapsed));
+  Myth::Metrics::Gauge(s_byteRate, (int64_t)(m_rateBytes * 1000000 / elapsed));
+  m_ratePackets = 0;
+  m_rateBytes = 0;
+  m_rateTime = now;
+}
+
+void Demux::index_keyframe(uint64_t pts)
+{
+  // Restarting from the oldest of the last PES finds the keyframe again,
+  // even when it spans several of them
+  uint64_t pos = m_pesPos[m_pesCount % DEMUX_PES_HISTORY];
+
+  Myth::OS::CLockGuard lock(m_mutex);
+  if (!m_started)
+  {
+    m_started = true;
+    // The first keyframe of the stream gives the time origin
+    if (!m_seeked && m_index.GetStartPTS() != pts)
+    {
+      if (m_index.GetStartPTS() != PTS_UNSET)
+        XBMC->Log(LOG_INFO, LOGTAG "%s: the index doesn't match the stream", __FUNCTION__);
+      m_index.Clear();
+      m_index.SetStartPTS(pts);
+    }
+  }
+  uint64_t start = m_index.GetStartPTS();
+  if (start == PTS_UNSET)
+    return;
+  uint64_t time = (pts - start) & PTS_MASK;
+  // Positions are only repeatable from the start of the stream
+  if (!m_index.Add(time, pos) && !m_seeked)
+  {
+    XBMC->Log(LOG_INFO, LOGTAG "%s: the index doesn't match the stream", __FUNCTION__);
+    m_index.Clear();
+    m_index.SetStartPTS(start);
+    m_index.Add(time, pos);
+  }
+}
+
+void Demux::populate_pvr_streams()
+{
+  Myth::OS::CLockGuard lock(m_mutex);
+  m_nosetup.clear();
+
+  uint16_t mainPid = 0xffff;
+  int mainType = XBMC_CODEC_TYPE_UNKNOWN;
+  unsigned count = 0;
+  const std::vector<TSDemux::ElementaryStream*> es_streams = m_AVContext->GetStreams();
+  for (std::vector<TSDemux::ElementaryStream*>::const_iterator it = es_streams.begin(); it != es_streams.end() && count < PVR_STREAM_MAX_STREAMS; it++)
+  {
+    const char* codec_name = (*it)->GetStreamCodecName();
+    xbmc_codec_t codec = PVR->GetCodecByName(codec_name);
+    if (codec.codec_type != XBMC_CODEC_TYPE_UNKNOWN)
+    {
+      // Find the main stream:
+      // The best candidate would be the first video. Else the first audio
+      switch (mainType)
+      {
+      case XBMC_CODEC_TYPE_VIDEO:
+        break;
+      case XBMC_CODEC_TYPE_AUDIO:
+        if (codec.codec_type != XBMC_CODEC_TYPE_VIDEO)
+          break;
+      default:
+        mainPid = (*it)->pid;
+        mainType = codec.codec_type;
+      }
+
+      PVR_STREAM_PROPERTIES_STREAM& stream = m_streams.stream[count++];
+      memset(&stream, 0, sizeof(PVR_STREAM_PROPERTIES_STREAM));
+      stream.iPID = (*it)->pid;
+      stream.iCodecType = codec.codec_type;
+      stream.iCodecId = codec.codec_id;
+      memcpy(stream.strLanguage, (*it)->stream_info.language, sizeof(stream.strLanguage));
+      stream.iSubtitleInfo = (*it)->stream_info.composition_id | ((*it)->stream_info.ancillary_id << 16);
+      stream.iFPSScale = (*it)->stream_info.fps_scale;
+      stream.iFPSRate = (*it)->stream_info.fps_rate;
+      stream.iHeight = (*it)->stream_info.height;
+      stream.iWidth = (*it)->stream_info.width;
+      stream.fAspect = (*it)->stream_info.aspect;
+      stream.iChannels = (*it)->stream_info.channels;
+      stream.iSampleRate = (*it)->stream_info.sample_rate;
+      stream.iBlockAlign = (*it)->stream_info.block_align;
+      stream.iBitRate = (*it)->stream_info.bit_rate;
+      stream.iBitsPerSample = (*it)->stream_info.bits_per_sample;
+
+      // Allow streaming for the PID
+      m_AVContext->StartStreaming((*it)->pid);
+      register_stream_metrics(*it);
+      // Add stream to no setup set
+      if (!(*it)->has_stream_info)
+        m_nosetup.insert((*it)->pid);
+
+      if (g_bExtraDebug)
+        XBMC->Log(LOG_DEBUG, LOGTAG "%s: register PES %.4x %s", __FUNCTION__, (*it)->pid, codec_name);
+    }
+  }
+  m_streams.iStreamCount = count;
+  // Renew main stream
+  m_mainStreamPID = mainPid;
+  m_mainStreamVideo = (mainType == XBMC_CODEC_TYPE_VIDEO);
+}
+
+bool Demux::update_pvr_stream(uint16_t pid)
+{
+  TSDemux::ElementaryStream* es = m_AVContext->GetStream(pid);
+  if (!es)
+    return false;
+
+  if (g_bExtraDebug)
+    XBMC->Log(LOG_DEBUG, LOGTAG "%s: update info PES %.4x %s", __FUNCTION__, es->pid, es->GetStreamCodecName());
+
+  Myth::OS::CLockGuard lock(m_mutex);
+  for (unsigned i = 0; i < m_streams.iStreamCount; i++)
+  {
+    PVR_STREAM_PROPERTIES_STREAM& stream = m_streams.stream[i];
+    if (stream.iPID != es->pid)
+      continue;
+    memcpy(stream.strLanguage, es->stream_info.language, sizeof(stream.strLanguage));
+    stream.iSubtitleInfo = es->stream_info.composition_id | (es->stream_info.ancillary_id << 16);
+    stream.iFPSScale = es->stream_info.fps_scale;
+    stream.iFPSRate = es->stream_info.fps_rate;
+    stream.iHeight = es->stream_info.height;
+    stream.iWidth = es->stream_info.width;
+    stream.fAspect = es->stream_info.aspect;
+    stream.iChannels = es->stream_info.channels;
+    stream.iSampleRate = es->stream_info.sample_rate;
+    stream.iBlockAlign = es->stream_info.block_align;
+    stream.iBitRate = es->stream_info.bit_rate;
+    stream.iBitsPerSample = es->stream_info.bits_per_sample;
+    break;
+  }
+
+  if (es->has_stream_info)
+  {
+    // Now stream is setup. Remove it from no setup set
+    std::set<uint16_t>::iterator it = m_nosetup.find(es->pid);
+    if (it != m_nosetup.end())
+    {
+      m_nosetup.erase(it);
+      if (m_nosetup.empty())
+        XBMC->Log(LOG_DEBUG, LOGTAG "%s: setup is completed", __FUNCTION__);
+    }
+  }
+  return true;
+}
@@ -0,0 +1,121 @@
+#pragma once
+/*
+ *      Copyright (C) 2005-2013 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301 USA
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "demuxer/tsDemuxer.h"
+#include "client.h"
+#include "keyframeindex.h"
+
+#include <mythstream.h>
+#include "private/os/threads/thread.h"
+#include "private/os/threads/mutex.h"
+#include "private/os/threads/condition.h"
+#include "private/metrics.h"
+
+#include <set>
+#include <deque>
+#include <map>
+
+#define DEMUX_BUFFER_SIZE       131072
+#define DEMUX_QUEUE_SIZE        100
+#define DEMUX_PES_HISTORY       4
+#define DEMUX_INDEX_GAP         (2 * PTS_TIME_BASE)
+
+class Demux : public TSDemux::TSDemuxer, public TSDemux::TSBatchHandler, private Myth::OS::CThread
+{
+public:
+  Demux(Myth::Stream *file, bool realtime, const std::string& indexFile = "");
+  ~Demux();
+
+  const unsigned char* ReadAV(uint64_t pos, size_t n);
+  bool HandleStreamData(TSDemux::ElementaryStream* es);
+  bool HandleProgramChange();
+
+  bool GetStreamProperties(PVR_STREAM_PROPERTIES* props);
+  void Flush();
+  void Abort();
+  void Reset();
+  DemuxPacket* Read();
+  bool SeekTime(double time, bool backwards, double* startpts);
+  double GetStartTime();
+
+private:
+  Myth::Stream *m_file;
+  bool m_realtime;              ///< true if the stream is played at real time (live)
+  bool m_endOfStream;           ///< true if the last read of file hit the end
+  uint16_t m_channel;
+
+  void* Process();
+  void stop_process();
+
+  void populate_pvr_streams();
+  bool update_pvr_stream(uint16_t pid);
+  void push_stream_change();
+  void push_packet(DemuxPacket* dxp);
+  void index_keyframe(uint64_t pts);
+  void register_stream_metrics(const TSDemux::ElementaryStream* es);
+  void sample_rates();
+
+  // AV raw buffer
+  size_t m_av_buf_size;         ///< size of av buffer
+  uint64_t m_av_pos;            ///< absolute position in av
+  unsigned char* m_av_buf;      ///< buffer
+  unsigned char* m_av_rbs;      ///< raw data start in buffer
+  unsigned char* m_av_rbe;      ///< raw data end in buffer
+
+  // Playback context
+  TSDemux::AVContext* m_AVContext;
+  uint16_t m_mainStreamPID;     ///< PID of main stream
+  bool m_mainStreamVideo;       ///< true if the main stream is a video
+  uint64_t m_DTS;               ///< absolute decode time of main stream
+  uint64_t m_PTS;               ///< absolute presentation time of main stream
+
+  Myth::OS::CMutex m_mutex;
+  PVR_STREAM_PROPERTIES m_streams;
+  std::set<uint16_t> m_nosetup;
+
+  // Keyframe index of a recording
+  KeyframeIndex m_index;
+  std::string m_indexFile;
+  bool m_seeked;                ///< true once the stream left its start
+  bool m_started;               ///< true once the time origin is checked
+  uint64_t m_pesPos[DEMUX_PES_HISTORY]; ///< positions of the last PES of main stream
+  unsigned m_pesCount;
+
+  // Packets ready for the player
+  Myth::OS::CMutex m_queueLock;
+  Myth::OS::CCondition<volatile bool> m_queueCondition;
+  std::deque<DemuxPacket*> m_queue;
+  bool m_finished;              ///< true once the end of a recording is demuxed
+
+  // Counters of the demuxed streams, fed to the metrics of the library. They
+  // are kept by codec, which bounds the number of metrics.
+  struct StreamMetrics
+  {
+    Myth::Metrics::Id packets;
+    Myth::Metrics::Id bytes;
+  };
+  std::map<uint16_t, StreamMetrics> m_streamMetrics;
+  uint64_t m_ratePackets;       ///< packets demuxed since the last rate sample
+  uint64_t m_rateBytes;         ///< bytes of stream processed since the last rate sample
+  int64_t m_rateTime;           ///< time of the last rate sample (us)
+};
@@ -20,6 +20,7 @@
 
 #include "ES_MPEGVideo.h"
 #include "bitstream.h"
+#include "startcode.h"
 #include "debug.h"
 
 using namespace TSDemux;
@@ -80,6 +81,7 @@ void ES_MPEG2Video::Parse(STREAM_PKT *pkt)
 {
   int frame_ptr = es_consumed;
   int p = es_parsed;
+  int scan = p + 3; // from here the scanner state mirrors the buffer
   uint32_t startcode = m_StartCode;
   bool frameComplete = false;
   int l;
@@ -92,6 +94,15 @@ void ES_MPEG2Video::Parse(STREAM_PKT *pkt)
         break;
       }
     }
+    else if (p >= scan)
+    {
+      // jump to the byte following the next start code prefix
+      size_t next = FindStartCode(es_buf, p - 3, es_len - 5);
+      next = (next < es_len - 5 ? next + 4 : es_len - 3);
+      startcode = ShiftStartCode(startcode, es_buf, p, next);
+      p = static_cast<int>(next);
+      continue;
+    }
     startcode = startcode << 8 | es_buf[p++];
   }
   es_parsed = p;
@@ -121,6 +132,7 @@ void ES_MPEG2Video::Parse(STREAM_PKT *pkt)
       pkt->pts          = m_PTS;
       pkt->duration     = m_FrameDuration;
       pkt->streamChange = streamChange;
+      pkt->keyframe     = m_KeyFrame;
     }
     m_StartCode = 0xffffffff;
     es_parsed = es_consumed;
@@ -134,6 +146,7 @@ void ES_MPEG2Video::Reset()
   ElementaryStream::Reset();
   m_StartCode = 0xffffffff;
   m_NeedIFrame = true;
+  m_KeyFrame = false;
   m_NeedSPS = true;
 }
 
@@ -277,7 +290,8 @@ bool ES_MPEG2Video::Parse_MPEG2Video_PicStart(uint8_t *buf)
   if (pct < PKT_I_FRAME || pct > PKT_B_FRAME)
     return true; /* Illegal picture_coding_type */
 
-  if (pct == PKT_I_FRAME)
+  m_KeyFrame = (pct == PKT_I_FRAME);
+  if (m_KeyFrame)
     m_NeedIFrame = false;
 
   int vbvDelay = bs.readBits(16); /* vbv_delay */
@@ -30,6 +30,7 @@ namespace TSDemux
   private:
     uint32_t        m_StartCode;
     bool            m_NeedIFrame;
+    bool            m_KeyFrame;
     bool            m_NeedSPS;
     int             m_FrameDuration;
     int             m_vbvDelay;       /* -1 if CBR */
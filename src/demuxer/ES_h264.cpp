@@ -20,6 +20,7 @@
 
 #include "ES_h264.h"
 #include "bitstream.h"
+#include "startcode.h"
 #include "debug.h"
 
 #include <cstring>      // for memset memcpy
@@ -73,6 +74,7 @@ void ES_h264::Parse(STREAM_PKT* pkt)
 {
   size_t frame_ptr = es_consumed;
   size_t p = es_parsed;
+  size_t scan = p + 3; // from here the scanner state mirrors the buffer
   uint32_t startcode = m_StartCode;
   bool frameComplete = false;
 
@@ -85,6 +87,15 @@ void ES_h264::Parse(STREAM_PKT* pkt)
         break;
       }
     }
+    else if (p >= scan)
+    {
+      // jump to the byte following the next start code prefix
+      size_t next = FindStartCode(es_buf, p - 3, es_len - 5);
+      next = (next < es_len - 5 ? next + 4 : es_len - 3);
+      startcode = ShiftStartCode(startcode, es_buf, p, next);
+      p = next;
+      continue;
+    }
     startcode = startcode << 8 | es_buf[p++];
   }
   es_parsed = p;
@@ -120,6 +131,7 @@ void ES_h264::Parse(STREAM_PKT* pkt)
       pkt->pts            = m_PTS;
       pkt->duration       = duration;
       pkt->streamChange   = streamChange;
+      pkt->keyframe       = m_KeyFrame;
     }
     m_StartCode = 0xffffffff;
     es_parsed = es_consumed;
@@ -133,6 +145,7 @@ void ES_h264::Reset()
   ElementaryStream::Reset();
   m_StartCode = 0xffffffff;
   m_NeedIFrame = true;
+  m_KeyFrame = false;
   m_NeedSPS = true;
   m_NeedPPS = true;
   memset(&m_streamData, 0, sizeof(m_streamData));
@@ -176,6 +189,7 @@ int ES_h264::Parse_H264(uint32_t startcode, int buf_ptr, bool &complete)
 
     if (!es_found_frame)
     {
+      m_KeyFrame = (vcl.nal_unit_type == NAL_IDR || vcl.slice_type == 2);
       if (buf_ptr - 4 >= (int)es_pts_pointer)
       {
         m_DTS = c_dts;
@@ -297,6 +311,7 @@ bool ES_h264::Parse_SLH(uint8_t *buf, int len, h264_private::VCL_NAL &vcl)
 
   if (slice_type > 4)
     slice_type -= 5;  /* Fixed slice type per frame */
+  vcl.slice_type = slice_type;
 
   switch (slice_type)
   {
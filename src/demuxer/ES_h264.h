@@ -58,6 +58,7 @@ namespace TSDemux
         int delta_pic_order_cnt_1; // slice
         int pic_order_cnt_lsb; // slice
         int idr_pic_id; // slice
+        int slice_type; // slice
         int nal_unit_type;
         int nal_ref_idc; // start code
         int pic_order_cnt_type; // sps
@@ -73,6 +74,7 @@ namespace TSDemux
     enum
     {
       NAL_SLH     = 0x01, // Slice Header
+      NAL_IDR     = 0x05, // Slice of an IDR picture
       NAL_SEI     = 0x06, // Supplemental Enhancement Information
       NAL_SPS     = 0x07, // Sequence Parameter Set
       NAL_PPS     = 0x08, // Picture Parameter Set
@@ -82,6 +84,7 @@ namespace TSDemux
 
     uint32_t        m_StartCode;
     bool            m_NeedIFrame;
+    bool            m_KeyFrame;
     bool            m_NeedSPS;
     bool            m_NeedPPS;
     int             m_Width;
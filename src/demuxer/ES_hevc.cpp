@@ -22,6 +22,7 @@
 
 #include "ES_hevc.h"
 #include "bitstream.h"
+#include "startcode.h"
 #include "debug.h"
 
 #include <cstring>      // for memset memcpy
@@ -54,12 +55,22 @@ void ES_hevc::Parse(STREAM_PKT* pkt)
 
   size_t frame_ptr = es_consumed;
   size_t p = es_parsed;
+  size_t scan = p + 2; // from here the scanner state mirrors the buffer
   uint32_t startcode = m_StartCode;
   bool frameComplete = false;
 
   while (p < es_len)
   {
-    startcode = startcode << 8 | es_buf[p++];
+    if (p >= scan)
+    {
+      // jump to the byte following the next start code prefix
+      size_t next = FindStartCode(es_buf, p - 2, es_len);
+      next = (next < es_len ? next + 3 : es_len);
+      startcode = ShiftStartCode(startcode, es_buf, p, next);
+      p = next;
+    }
+    else
+      startcode = startcode << 8 | es_buf[p++];
     if ((startcode & 0x00ffffff) == 0x00000001)
     {
       if (m_LastStartPos != -1)
@@ -102,6 +113,7 @@ void ES_hevc::Parse(STREAM_PKT* pkt)
       pkt->pts      = m_PTS;
       pkt->duration = duration;
       pkt->streamChange = streamChange;
+      pkt->keyframe = m_KeyFrame;
     }
     m_StartCode = 0xffffffff;
     m_LastStartPos = -1;
@@ -118,6 +130,7 @@ void ES_hevc::Reset()
   m_LastStartPos = -1;
   m_NeedSPS = true;
   m_NeedPPS = true;
+  m_KeyFrame = false;
   memset(&m_streamData, 0, sizeof(m_streamData));
 }
 
@@ -157,6 +170,7 @@ void ES_hevc::Parse_HEVC(int buf_ptr, unsigned int NumBytesInNalUnit, bool &comp
 
     if (!es_found_frame)
     {
+      m_KeyFrame = (hdr.nal_unit_type >= NAL_BLA_W_LP);
       if (buf_ptr - 3 >= (int)es_pts_pointer)
       {
         m_DTS = c_dts;
@@ -93,6 +93,7 @@ namespace TSDemux
     int             m_LastStartPos;
     bool            m_NeedSPS;
     bool            m_NeedPPS;
+    bool            m_KeyFrame;
     int             m_Width;
     int             m_Height;
     int             m_FpsScale;
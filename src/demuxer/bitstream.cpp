@@ -20,113 +20,202 @@
 
 #include "bitstream.h"
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 using namespace TSDemux;
 
-void CBitstream::skipBits(unsigned int num)
+namespace
 {
-  if (m_doEP3)
+  // Big-endian load of 8 bytes at any alignment: compilers fold it into one
+  // unaligned load (and a byte swap on little-endian targets)
+  inline uint64_t load64BE(const uint8_t *p)
   {
+    return ((uint64_t)p[0] << 56) | ((uint64_t)p[1] << 48) |
+           ((uint64_t)p[2] << 40) | ((uint64_t)p[3] << 32) |
+           ((uint64_t)p[4] << 24) | ((uint64_t)p[5] << 16) |
+           ((uint64_t)p[6] << 8)  |  (uint64_t)p[7];
+  }
 
-    while (num)
+  // Count of leading zero bits, v must not be zero
+  inline unsigned int clz64(uint64_t v)
+  {
+#if defined(__GNUC__)
+    return (unsigned int)__builtin_clzll(v);
+#elif defined(_MSC_VER) && defined(_WIN64)
+    unsigned long idx;
+    _BitScanReverse64(&idx, v);
+    return 63 - (unsigned int)idx;
+#else
+    unsigned int n = 0;
+    while (!(v & 0x8000000000000000ULL))
     {
-      unsigned int tmp = m_offset >> 3;
-      if (!(m_offset & 7) && (m_data[tmp--] == 3) && (m_data[tmp--] == 0) && (m_data[tmp] == 0))
-        m_offset += 8;   // skip EP3 byte
+      v <<= 1;
+      ++n;
+    }
+    return n;
+#endif
+  }
 
-      if (!(m_offset & 7) && (num >= 8)) // byte boundary, speed up things a little bit
-      {
-        m_offset += 8;
-        num -= 8;
-      }
-      else if ((tmp = 8-(m_offset & 7)) <= num) // jump to byte boundary
-      {
-        m_offset += tmp;
-        num -= tmp;
-      }
-      else
+  // True when one of the 8 bytes is 0x03, the only value an EP3 byte can take
+  inline bool hasByte3(uint64_t v)
+  {
+    uint64_t x = v ^ 0x0303030303030303ULL;
+    return ((x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL) != 0;
+  }
+}
+
+/*
+ * Top up the cache to at least 57 bits while data remains. Whole words are
+ * loaded at once; in EP3 mode a word containing a 0x03 byte falls back to
+ * the byte loop, which strips the emulation prevention bytes.
+ */
+void CBitstream::fillCache()
+{
+  const size_t end = m_len >> 3;
+
+  while (m_cacheBits <= 56)
+  {
+    if (m_pos + 8 <= end)
+    {
+      uint64_t v = load64BE(m_data + m_pos);
+      if (!m_doEP3 || !hasByte3(v))
       {
-        m_offset += num;
-         num = 0;
+        unsigned int n = (64 - m_cacheBits) >> 3;
+        m_cache |= v >> m_cacheBits;
+        m_cacheBits += n << 3;
+        if (m_cacheBits < 64)
+          m_cache &= ~0ULL << (64 - m_cacheBits);
+        m_pos += n;
+        return;
       }
-
-      if (m_offset >= m_len)
+    }
+    else if (m_pos >= end)
+    {
+      // trailing bits of an incomplete byte
+      unsigned int tail = (unsigned int)(m_len & 7);
+      if (m_pos == end && tail)
       {
-        m_error = true;
-        break;
+        m_cache |= (uint64_t)(m_data[m_pos] >> (8 - tail)) << (64 - m_cacheBits - tail);
+        m_cacheBits += tail;
+        ++m_pos;
       }
+      return;
     }
 
-    return;
+    uint8_t b = m_data[m_pos];
+    if (m_doEP3 && b == 3 && m_data[m_pos - 1] == 0 && m_data[m_pos - 2] == 0)
+    {
+      ++m_pos;   // skip EP3 byte
+      continue;
+    }
+    m_cache |= (uint64_t)b << (56 - m_cacheBits);
+    m_cacheBits += 8;
+    ++m_pos;
   }
-
-  m_offset += num;
 }
 
-unsigned int CBitstream::readBits(int num)
+// Reached the end of data: the remaining bits are lost
+void CBitstream::dropCache()
 {
-  unsigned int r = 0;
+  m_cache = 0;
+  m_cacheBits = 0;
+  m_pos = (m_len >> 3) + 1;
+}
 
-  while(num > 0)
+void CBitstream::skipBits(unsigned int num)
+{
+  while (num > m_cacheBits)
   {
-    if (m_doEP3)
+    num -= m_cacheBits;
+    m_cache = 0;
+    m_cacheBits = 0;
+    if (!m_doEP3 && num >= 64)
     {
-      size_t tmp = m_offset >> 3;
-      if (!(m_offset & 7) && (m_data[tmp--] == 3) && (m_data[tmp--] == 0) && (m_data[tmp] == 0))
-        m_offset += 8;   // skip EP3 byte
+      // no byte to strip: jump over whole bytes
+      m_pos += num >> 3;
+      num &= 7;
     }
+    fillCache();
+    if (!m_cacheBits)
+    {
+      if (m_doEP3)
+        m_error = true;
+      return;
+    }
+  }
+  consume(num);
+}
 
-    if(m_offset >= m_len)
+unsigned int CBitstream::readBits(int num)
+{
+  if (num <= 0)
+    return 0;
+
+  if (m_cacheBits < (unsigned int)num)
+  {
+    fillCache();
+    if (m_cacheBits < (unsigned int)num)
     {
       m_error = true;
+      dropCache();
       return 0;
     }
-
-    num--;
-
-    if(m_data[m_offset / 8] & (1 << (7 - (m_offset & 7))))
-      r |= 1 << num;
-
-    m_offset++;
   }
+
+  unsigned int r = (unsigned int)(m_cache >> (64 - num));
+  consume(num);
   return r;
 }
 
 unsigned int CBitstream::showBits(int num)
 {
-  unsigned int r = 0;
-  size_t offs = m_offset;
+  if (num <= 0)
+    return 0;
 
-  while(num > 0)
+  if (m_cacheBits < (unsigned int)num)
   {
-    if(offs >= m_len)
+    fillCache();
+    if (m_cacheBits < (unsigned int)num)
     {
       m_error = true;
       return 0;
     }
-
-    num--;
-
-    if(m_data[offs / 8] & (1 << (7 - (offs & 7))))
-      r |= 1 << num;
-
-    offs++;
   }
-  return r;
+
+  return (unsigned int)(m_cache >> (64 - num));
 }
 
 unsigned int CBitstream::readGolombUE(int maxbits)
 {
-  int lzb = -1;
-  int bits = 0;
+  if (m_cacheBits <= 32)
+    fillCache();
+
+  // the unused bits of the cache are zero
+  unsigned int lzb = m_cache ? clz64(m_cache) : 64;
 
-  for(int b = 0; !b; lzb++, bits++)
+  if (lzb > (unsigned int)maxbits)
   {
-    if (bits > maxbits)
-      return 0;
-    b = readBits1();
+    if (m_cacheBits > (unsigned int)maxbits)
+      consume(maxbits + 1);
+    else
+    {
+      m_error = true;
+      dropCache();
+    }
+    return 0;
+  }
+
+  if (lzb >= m_cacheBits)
+  {
+    m_error = true;
+    dropCache();
+    return 0;
   }
 
-  return (1 << lzb) - 1 + readBits(lzb);
+  consume(lzb + 1);
+  return (unsigned int)(((uint64_t)1 << lzb) - 1 + readBits(lzb));
 }
 
 signed int CBitstream::readGolombSE()
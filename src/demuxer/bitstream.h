@@ -30,18 +30,26 @@ namespace TSDemux
   {
   private:
     uint8_t       *m_data;
-    size_t         m_offset;
+    size_t         m_pos;       // next byte to load in the cache
     const size_t   m_len;
     bool           m_error;
     const bool     m_doEP3;
+    uint64_t       m_cache;     // next bits to read, MSB first
+    unsigned int   m_cacheBits; // count of valid bits in the cache
+
+    void fillCache();
+    void dropCache();
+    void consume(unsigned int num) { m_cache = (num < 64) ? (m_cache << num) : 0; m_cacheBits -= num; }
 
   public:
     CBitstream(uint8_t *data, size_t bits)
     : m_data(data)
-    , m_offset(0)
+    , m_pos(0)
     , m_len(bits)
     , m_error(false)
     , m_doEP3(false)
+    , m_cache(0)
+    , m_cacheBits(0)
     {}
 
     // this is a bitstream that has embedded emulation_prevention_three_byte
@@ -49,10 +57,12 @@ namespace TSDemux
     // Data must start at byte 2
     CBitstream(uint8_t *data, size_t bits, bool doEP3)
     : m_data(data)
-    , m_offset(16) // skip header and use as sentinel for EP3 detection
+    , m_pos(2) // skip header and use as sentinel for EP3 detection
     , m_len(bits)
     , m_error(false)
     , m_doEP3(true)
+    , m_cache(0)
+    , m_cacheBits(0)
     {}
 
     void         skipBits(unsigned int num);
@@ -21,14 +21,71 @@
 
 #include "elementaryStream.h"
 #include "debug.h"
+#include "private/os/threads/mutex.h"
 
 #include <cstdlib>    // for malloc free size_t
 #include <cstring>    // memset memcpy memmove
 #include <climits>    // for INT_MAX
 #include <cerrno>
+#include <vector>
 
 using namespace TSDemux;
 
+namespace
+{
+  /**
+   * Buffers released by streams, kept for the next stream of the same type
+   */
+  class BufferPool
+  {
+  public:
+    static BufferPool& Instance()
+    {
+      static BufferPool pool;
+      return pool;
+    }
+
+    ~BufferPool()
+    {
+      for (int t = 0; t <= STREAM_TYPE_PRIVATE_DATA; ++t)
+        for (std::vector<Buffer>::iterator it = m_free[t].begin(); it != m_free[t].end(); ++it)
+          free(it->data);
+    }
+
+    unsigned char* Take(STREAM_TYPE type, size_t* size)
+    {
+      Myth::OS::CLockGuard lock(m_mutex);
+      std::vector<Buffer>& list = m_free[type];
+      if (list.empty())
+        return NULL;
+      Buffer buf = list.back();
+      list.pop_back();
+      *size = buf.size;
+      return buf.data;
+    }
+
+    bool Give(STREAM_TYPE type, unsigned char* data, size_t size)
+    {
+      Myth::OS::CLockGuard lock(m_mutex);
+      std::vector<Buffer>& list = m_free[type];
+      if (list.size() >= ES_BUFFER_POOL_SIZE)
+        return false;
+      Buffer buf = { data, size };
+      list.push_back(buf);
+      return true;
+    }
+
+  private:
+    struct Buffer
+    {
+      unsigned char* data;
+      size_t size;
+    };
+    Myth::OS::CMutex m_mutex;
+    std::vector<Buffer> m_free[STREAM_TYPE_PRIVATE_DATA + 1];
+  };
+}
+
 ElementaryStream::ElementaryStream(uint16_t pes_pid)
   : pid(pes_pid)
   , stream_type(STREAM_TYPE_UNKNOWN)
@@ -38,6 +95,7 @@ ElementaryStream::ElementaryStream(uint16_t pes_pid)
   , p_pts(PTS_UNSET)
   , has_stream_info(false)
   , es_alloc_init(ES_INIT_BUFFER_SIZE)
+  , es_mem(NULL)
   , es_buf(NULL)
   , es_alloc(0)
   , es_len(0)
@@ -52,11 +110,12 @@ ElementaryStream::ElementaryStream(uint16_t pes_pid)
 
 ElementaryStream::~ElementaryStream(void)
 {
-  if (es_buf)
+  if (es_mem)
   {
     DBG(DEMUX_DBG_DEBUG, "free stream buffer %.4x: allocated size was %zu\n", pid, es_alloc);
-    free(es_buf);
-    es_buf = NULL;
+    if (!BufferPool::Instance().Give(stream_type, es_mem, es_alloc))
+      free(es_mem);
+    es_mem = es_buf = NULL;
   }
 }
 
@@ -70,6 +129,7 @@ void ElementaryStream::Reset(void)
 void ElementaryStream::ClearBuffer()
 {
   es_len = es_consumed = es_pts_pointer = es_parsed = 0;
+  es_buf = es_mem;
 }
 
 int ElementaryStream::Append(const unsigned char* buf, size_t len, bool new_pts)
@@ -82,7 +142,9 @@ int ElementaryStream::Append(const unsigned char* buf, size_t len, bool new_pts)
   {
     if (es_consumed < es_len)
     {
-      memmove(es_buf, es_buf + es_consumed, es_len - es_consumed);
+      // Drop the consumed data by moving the window forward. The remaining
+      // data is moved only when the window reaches the end of memory.
+      es_buf += es_consumed;
       es_len -= es_consumed;
       es_parsed -= es_consumed;
       if (es_pts_pointer > es_consumed)
@@ -95,6 +157,18 @@ int ElementaryStream::Append(const unsigned char* buf, size_t len, bool new_pts)
     else
       ClearBuffer();
   }
+  if (!es_mem)
+  {
+    es_mem = es_buf = BufferPool::Instance().Take(stream_type, &es_alloc);
+    if (es_mem)
+      DBG(DEMUX_DBG_DEBUG, "reuse buffer size %zu for stream %.4x\n", es_alloc, pid);
+  }
+  size_t offset = es_buf - es_mem;
+  if (offset && offset + es_len + len > es_alloc)
+  {
+    memmove(es_mem, es_buf, es_len);
+    es_buf = es_mem;
+  }
   if (es_len + len > es_alloc)
   {
     if (es_alloc >= ES_MAX_BUFFER_SIZE)
@@ -105,9 +179,9 @@ int ElementaryStream::Append(const unsigned char* buf, size_t len, bool new_pts)
       n = ES_MAX_BUFFER_SIZE;
 
     DBG(DEMUX_DBG_DEBUG, "realloc buffer size to %zu for stream %.4x\n", n, pid);
-    unsigned char* p = es_buf;
-    es_buf = (unsigned char*)realloc(es_buf, n * sizeof(*es_buf));
-    if (es_buf)
+    unsigned char* p = es_mem;
+    es_mem = es_buf = (unsigned char*)realloc(es_mem, n * sizeof(*es_mem));
+    if (es_mem)
     {
       es_alloc = n;
     }
@@ -215,6 +289,7 @@ void ElementaryStream::ResetStreamPacket(STREAM_PKT* pkt)
   pkt->pts                = PTS_UNSET;
   pkt->duration           = 0;
   pkt->streamChange       = false;
+  pkt->keyframe           = false;
 }
 
 uint64_t ElementaryStream::Rescale(uint64_t a, uint64_t b, uint64_t c)
@@ -27,6 +27,7 @@
 
 #define ES_INIT_BUFFER_SIZE     64000
 #define ES_MAX_BUFFER_SIZE      1048576
+#define ES_BUFFER_POOL_SIZE     4
 #define PTS_MASK                0x1ffffffffLL
 #define PTS_UNSET               0x1ffffffffLL
 #define PTS_TIME_BASE           90000LL
@@ -84,6 +85,7 @@ namespace TSDemux
     uint64_t              pts;
     uint64_t              duration;
     bool                  streamChange;
+    bool                  keyframe;     ///< Video: the decoding can start from this frame
   };
 
   class ElementaryStream
@@ -118,7 +120,8 @@ namespace TSDemux
     bool SetAudioInformation(int Channels, int SampleRate, int BitRate, int BitsPerSample, int BlockAlign);
 
     size_t es_alloc_init;         ///< Initial allocation of memory for buffer
-    unsigned char* es_buf;        ///< The Pointer to buffer
+    unsigned char* es_mem;        ///< Allocated memory for buffer
+    unsigned char* es_buf;        ///< The Pointer to buffer: window in allocated memory
     size_t es_alloc;              ///< Allocated size of memory for buffer
     size_t es_len;                ///< Size of data in buffer
     size_t es_consumed;           ///< Consumed payload. Will be erased on next append
@@ -0,0 +1,115 @@
+/*
+ *      Copyright (C) 2013 Jean-Luc Barriere
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301 USA
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "startcode.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define STARTCODE_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+using namespace TSDemux;
+
+#if defined(__AVX2__) || defined(STARTCODE_SSE2)
+static inline size_t first_set_bit(unsigned mask)
+{
+  size_t n = 0;
+  while (!(mask & 1))
+  {
+    mask >>= 1;
+    ++n;
+  }
+  return n;
+}
+#endif
+
+size_t TSDemux::FindStartCode(const uint8_t* buf, size_t pos, size_t end)
+{
+  if (end < 3 || pos > end - 3)
+    return end;
+  // offsets up to last are candidates
+  const size_t last = end - 3;
+  size_t i = pos;
+
+  // Test a block of candidates at once: byte i is 0, i+1 is 0 and i+2 is 1.
+  // The vector loops stop so that the load at i + 2 stays inside the range.
+#if defined(__AVX2__)
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i one = _mm256_set1_epi8(1);
+  while (i + 31 <= last)
+  {
+    __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buf + i));
+    __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buf + i + 1));
+    __m256i b2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buf + i + 2));
+    __m256i m = _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(b0, zero), _mm256_cmpeq_epi8(b1, zero)),
+                                 _mm256_cmpeq_epi8(b2, one));
+    unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(m));
+    if (mask)
+      return i + first_set_bit(mask);
+    i += 32;
+  }
+#elif defined(STARTCODE_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi8(1);
+  while (i + 15 <= last)
+  {
+    __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + i));
+    __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + i + 1));
+    __m128i b2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + i + 2));
+    __m128i m = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(b0, zero), _mm_cmpeq_epi8(b1, zero)),
+                              _mm_cmpeq_epi8(b2, one));
+    unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(m));
+    if (mask)
+      return i + first_set_bit(mask);
+    i += 16;
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  const uint8x16_t one = vdupq_n_u8(1);
+  while (i + 15 <= last)
+  {
+    uint8x16_t b0 = vld1q_u8(buf + i);
+    uint8x16_t b1 = vld1q_u8(buf + i + 1);
+    uint8x16_t b2 = vld1q_u8(buf + i + 2);
+    uint8x16_t m = vandq_u8(vandq_u8(vceqzq_u8(b0), vceqzq_u8(b1)), vceqq_u8(b2, one));
+    if (vmaxvq_u8(m))
+      break; // the scalar loop below locates the match inside this block
+    i += 16;
+  }
+#endif
+
+  // Scalar scan: a byte above 1 at i + 2 rules out candidates i, i+1 and i+2.
+  while (i <= last)
+  {
+    if (buf[i + 2] > 1)
+      i += 3;
+    else if (buf[i + 1])
+      i += 2;
+    else if (buf[i] || buf[i + 2] != 1)
+      ++i;
+    else
+      return i;
+  }
+  return end;
+}
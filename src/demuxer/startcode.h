@@ -0,0 +1,50 @@
+/*
+ *      Copyright (C) 2013 Jean-Luc Barriere
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301 USA
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef STARTCODE_H
+#define STARTCODE_H
+
+#include <cstdint>
+#include <cstddef>    // for size_t
+
+namespace TSDemux
+{
+  /**
+   * Find the first 00 00 01 sequence lying entirely in buf[pos, end).
+   * Returns its offset, or end when there is none.
+   */
+  size_t FindStartCode(const uint8_t* buf, size_t pos, size_t end);
+
+  /**
+   * Returns the state of a byte-wise start code scanner after it has shifted
+   * in buf[from, to). Only the last four bytes are significant.
+   */
+  inline uint32_t ShiftStartCode(uint32_t startcode, const uint8_t* buf, size_t from, size_t to)
+  {
+    if (to - from > 4)
+      from = to - 4;
+    while (from < to)
+      startcode = startcode << 8 | buf[from++];
+    return startcode;
+  }
+}
+
+#endif /* STARTCODE_H */
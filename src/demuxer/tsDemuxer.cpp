@@ -31,8 +31,11 @@
 #include "debug.h"
 
 #include <cassert>
+#include <cstring>
 
 #define MAX_RESYNC_SIZE         65536
+#define RESYNC_WINDOW_SIZE      16384
+#define RESYNC_PROBE_SIZE       ((TS_CHECK_MAX_SCORE + 1) * AV_CONTEXT_PACKETSIZE)
 
 using namespace TSDemux;
 
@@ -40,6 +43,7 @@ AVContext::AVContext(TSDemuxer* const demux, uint64_t pos, uint16_t channel)
   : av_pos(pos)
   , av_data_len(FLUTS_NORMAL_TS_PACKETSIZE)
   , av_pkt_size(0)
+  , av_data(av_buf)
   , is_configured(false)
   , channel(channel)
   , pid(0xffff)
@@ -53,8 +57,17 @@ AVContext::AVContext(TSDemuxer* const demux, uint64_t pos, uint16_t channel)
 {
   m_demux = demux;
   memset(av_buf, 0, sizeof(av_buf));
+  memset(packets, 0, sizeof(packets));
 };
 
+AVContext::~AVContext()
+{
+  for (unsigned i = 0; i < AV_CONTEXT_PID_COUNT; ++i)
+    delete packets[i];
+  for (std::vector<Packet*>::iterator it = packet_pool.begin(); it != packet_pool.end(); ++it)
+    delete *it;
+}
+
 void AVContext::Reset(void)
 {
   Myth::OS::CLockGuard lock(mutex);
@@ -122,9 +135,9 @@ std::vector<ElementaryStream*> AVContext::GetStreams()
   Myth::OS::CLockGuard lock(mutex);
 
   std::vector<ElementaryStream*> v;
-  for (std::map<uint16_t, Packet>::iterator it = packets.begin(); it != packets.end(); ++it)
-    if (it->second.packet_type == PACKET_TYPE_PES && it->second.stream)
-      v.push_back(it->second.stream);
+  for (unsigned i = 0; i < AV_CONTEXT_PID_COUNT; ++i)
+    if (packets[i] && packets[i]->packet_type == PACKET_TYPE_PES && packets[i]->stream)
+      v.push_back(packets[i]->stream);
   return v;
 }
 
@@ -132,27 +145,27 @@ void AVContext::StartStreaming(uint16_t pid)
 {
   Myth::OS::CLockGuard lock(mutex);
 
-  std::map<uint16_t, Packet>::iterator it = packets.find(pid);
-  if (it != packets.end())
-    it->second.streaming = true;
+  Packet* p = packets[pid & 0x1fff];
+  if (p)
+    p->streaming = true;
 }
 
 void AVContext::StopStreaming(uint16_t pid)
 {
   Myth::OS::CLockGuard lock(mutex);
 
-  std::map<uint16_t, Packet>::iterator it = packets.find(pid);
-  if (it != packets.end())
-    it->second.streaming = false;
+  Packet* p = packets[pid & 0x1fff];
+  if (p)
+    p->streaming = false;
 }
 
 ElementaryStream* AVContext::GetStream(uint16_t pid) const
 {
   Myth::OS::CLockGuard lock(mutex);
 
-  std::map<uint16_t, Packet>::const_iterator it = packets.find(pid);
-  if (it != packets.end())
-    return it->second.stream;
+  const Packet* p = packets[pid & 0x1fff];
+  if (p)
+    return p->stream;
   return NULL;
 }
 
@@ -160,9 +173,9 @@ uint16_t AVContext::GetChannel(uint16_t pid) const
 {
   Myth::OS::CLockGuard lock(mutex);
 
-  std::map<uint16_t, Packet>::const_iterator it = packets.find(pid);
-  if (it != packets.end())
-    return it->second.channel;
+  const Packet* p = packets[pid & 0x1fff];
+  if (p)
+    return p->channel;
   return 0xffff;
 }
 
@@ -170,9 +183,10 @@ void AVContext::ResetPackets()
 {
   Myth::OS::CLockGuard lock(mutex);
 
-  for (std::map<uint16_t, Packet>::iterator it = packets.begin(); it != packets.end(); ++it)
+  for (unsigned i = 0; i < AV_CONTEXT_PID_COUNT; ++i)
   {
-    it->second.Reset();
+    if (packets[i])
+      packets[i]->Reset();
   }
 }
 
@@ -260,14 +274,55 @@ int AVContext::configure_ts()
   int nb = sizeof (fluts) / (2 * sizeof (int));
   int score = TS_CHECK_MIN_SCORE;
 
+  // Window of data probed in memory. Positions from win_pos to win_end have
+  // room for the longest probe. Once the data runs short, read per probe.
+  const unsigned char* win = NULL;
+  uint64_t win_pos = 0, win_end = 0;
+  bool windowed = true;
+
   for (int i = 0; i < MAX_RESYNC_SIZE; i++)
   {
-    const unsigned char* data = m_demux->ReadAV(pos, data_size);
-    if (!data)
-      return AVCONTEXT_IO_ERROR;
-    if (data[0] == 0x47)
+    if (windowed && (pos < win_pos || pos >= win_end))
     {
-      int count, found;
+      win_pos = win_end = pos;
+      if ((win = m_demux->ReadAV(pos, RESYNC_WINDOW_SIZE)))
+        win_end += RESYNC_WINDOW_SIZE - RESYNC_PROBE_SIZE;
+      else
+        windowed = false;
+    }
+    if (pos < win_end)
+    {
+      const unsigned char* data = win + (size_t)(pos - win_pos);
+      if (data[0] != 0x47)
+      {
+        // Skip to the next candidate, accounting each skipped byte as a try
+        size_t len = (size_t)(win_end - pos);
+        if (len > (size_t)(MAX_RESYNC_SIZE - i))
+          len = MAX_RESYNC_SIZE - i;
+        const unsigned char* next = static_cast<const unsigned char*>(memchr(data, 0x47, len));
+        size_t skip = next ? next - data : len;
+        pos += skip;
+        i += static_cast<int>(skip) - 1;
+        continue;
+      }
+      // Score all sizes on the window
+      for (int t = 0; t < nb; t++)
+      {
+        const unsigned char* ndata = data;
+        while (fluts[t][1] < score && (ndata += fluts[t][0])[0] == 0x47)
+          ++fluts[t][1];
+      }
+    }
+    else
+    {
+      const unsigned char* data = m_demux->ReadAV(pos, data_size);
+      if (!data)
+        return AVCONTEXT_IO_ERROR;
+      if (data[0] != 0x47)
+      {
+        pos++;
+        continue;
+      }
       for (int t = 0; t < nb; t++) // for all fluts
       {
         const unsigned char* ndata;
@@ -282,6 +337,9 @@ int AVContext::configure_ts()
         }
         while (ndata[0] == 0x47 && (++fluts[t][1]) && do_retry);
       }
+    }
+    {
+      int count, found;
       // Is score reached ?
       count = found = 0;
       for (int t = 0; t < nb; t++)
@@ -310,8 +368,6 @@ int AVContext::configure_ts()
       else
         pos++;
     }
-    else
-      pos++;
   }
 
   DBG(DEMUX_DBG_ERROR, "%s: invalid stream\n", __FUNCTION__);
@@ -327,14 +383,47 @@ int AVContext::TSResync()
       return ret;
     is_configured = true;
   }
-  for (int i = 0; i < MAX_RESYNC_SIZE; i++)
+  const unsigned char* data = m_demux->ReadAV(av_pos, av_pkt_size);
+  if (!data)
+    return AVCONTEXT_IO_ERROR;
+  if (data[0] == 0x47)
+  {
+    memcpy(av_buf, data, av_pkt_size);
+    av_data = av_buf;
+    Reset();
+    return AVCONTEXT_CONTINUE;
+  }
+
+  // Out of sync: look for the sync byte through a window at once, as long
+  // as the data is available
+  int i = 0;
+  while (i < MAX_RESYNC_SIZE && (data = m_demux->ReadAV(av_pos, RESYNC_WINDOW_SIZE)))
+  {
+    size_t len = RESYNC_WINDOW_SIZE - av_pkt_size + 1;
+    if (len > (size_t)(MAX_RESYNC_SIZE - i))
+      len = MAX_RESYNC_SIZE - i;
+    const unsigned char* sync = static_cast<const unsigned char*>(memchr(data, 0x47, len));
+    if (sync)
+    {
+      av_pos += sync - data;
+      memcpy(av_buf, sync, av_pkt_size);
+      av_data = av_buf;
+      Reset();
+      return AVCONTEXT_CONTINUE;
+    }
+    av_pos += len;
+    i += static_cast<int>(len);
+  }
+
+  for (; i < MAX_RESYNC_SIZE; i++)
   {
-    const unsigned char* data = m_demux->ReadAV(av_pos, av_pkt_size);
+    data = m_demux->ReadAV(av_pos, av_pkt_size);
     if (!data)
       return AVCONTEXT_IO_ERROR;
     if (data[0] == 0x47)
     {
       memcpy(av_buf, data, av_pkt_size);
+      av_data = av_buf;
       Reset();
       return AVCONTEXT_CONTINUE;
     }
@@ -394,14 +483,90 @@ uint64_t AVContext::GetPosition() const
 int AVContext::ProcessTSPacket()
 {
   Myth::OS::CLockGuard lock(mutex);
+  return process_ts_packet();
+}
+
+/*
+ * Process payload of packet depending of its type
+ *
+ * PACKET_TYPE_PSI -> parse_ts_psi()
+ * PACKET_TYPE_PES -> parse_ts_pes()
+ */
+int AVContext::ProcessTSPayload()
+{
+  Myth::OS::CLockGuard lock(mutex);
+  return process_ts_payload();
+}
+
+/*
+ * Process a run of packets laid out at the current position, with no copy.
+ * The data must start on a packet boundary and only whole packets are
+ * processed. The lock is held for the whole run and handler is called in
+ * place of the caller loop to pick stream data and follow program changes.
+ *
+ * returns:
+ *
+ * AVCONTEXT_CONTINUE
+ *   All whole packets were processed, or the handler asked to stop. The
+ *   position is on the next packet to process.
+ *
+ * AVCONTEXT_TS_NOSYNC
+ *   Bad sync byte at the current position. Should run TSResync().
+ *
+ * Any other negative status is returned as is for the packet at the current
+ * position, as ProcessTSPacket() or ProcessTSPayload() would do. On
+ * AVCONTEXT_TS_ERROR the caller should Shift(), else GoNext().
+ */
+int AVContext::ProcessTSBatch(const unsigned char* data, size_t len, TSBatchHandler& handler)
+{
+  Myth::OS::CLockGuard lock(mutex);
+
+  if (!is_configured)
+    return AVCONTEXT_TS_NOSYNC;
+
+  int ret = AVCONTEXT_CONTINUE;
+  bool more = true;
+  size_t offset = 0;
+  while (more && offset + av_pkt_size <= len)
+  {
+    av_data = data + offset;
+    if (av_data[0] != 0x47)
+    {
+      ret = AVCONTEXT_TS_NOSYNC;
+      break;
+    }
+    ret = process_ts_packet();
+    if (this->packet && this->packet->has_stream_data && this->packet->packet_type == PACKET_TYPE_PES &&
+        this->packet->stream)
+      more = handler.HandleStreamData(this->packet->stream);
+    if (this->has_payload)
+    {
+      ret = process_ts_payload();
+      if (ret == AVCONTEXT_PROGRAM_CHANGE)
+        more = handler.HandleProgramChange() && more;
+    }
+    if (ret < 0)
+      break;
+    offset += av_pkt_size;
+    av_pos += av_pkt_size;
+    Reset();
+  }
+  // The data belongs to the caller
+  av_data = av_buf;
+  if (ret < 0)
+    return ret;
+  return AVCONTEXT_CONTINUE;
+}
 
+int AVContext::process_ts_packet()
+{
   int ret = AVCONTEXT_CONTINUE;
-  std::map<uint16_t, Packet>::iterator it;
+  Packet* pkt;
 
-  if (av_rb8(this->av_buf) != 0x47) // ts sync byte
+  if (av_rb8(this->av_data) != 0x47) // ts sync byte
     return AVCONTEXT_TS_NOSYNC;
 
-  uint16_t header = av_rb16(this->av_buf + 1);
+  uint16_t header = av_rb16(this->av_data + 1);
   this->pid = header & 0x1fff;
   this->transport_error = (header & 0x8000) != 0;
   this->payload_unit_start = (header & 0x4000) != 0;
@@ -417,7 +582,7 @@ int AVContext::ProcessTSPacket()
   if (this->pid == 0x1fff)
     return AVCONTEXT_CONTINUE;
 
-  uint8_t flags = av_rb8(this->av_buf + 3);
+  uint8_t flags = av_rb8(this->av_data + 3);
   bool has_payload = (flags & 0x10) != 0;
   bool is_discontinuity = false;
   uint8_t continuity_counter = flags & 0x0f;
@@ -425,7 +590,7 @@ int AVContext::ProcessTSPacket()
   size_t n = 0;
   if (has_adaptation)
   {
-    size_t len = (size_t)av_rb8(this->av_buf + 4);
+    size_t len = (size_t)av_rb8(this->av_data + 4);
     if (len > (this->av_data_len - 5))
     {
 #if defined(TSDEMUX_DEBUG)
@@ -437,29 +602,27 @@ int AVContext::ProcessTSPacket()
     n = len + 1;
     if (len > 0)
     {
-      is_discontinuity = (av_rb8(this->av_buf + 5) & 0x80) != 0;
+      is_discontinuity = (av_rb8(this->av_data + 5) & 0x80) != 0;
     }
   }
   if (has_payload)
   {
     // Payload start after adaptation fields
-    this->payload = this->av_buf + n + 4;
+    this->payload = this->av_data + n + 4;
     this->payload_len = this->av_data_len - n - 4;
   }
 
-  it = this->packets.find(this->pid);
-  if (it == this->packets.end())
+  pkt = this->packets[this->pid];
+  if (!pkt)
   {
     // Not registred PID
     // We are waiting for unit start of PID 0 else next packet is required
     if (this->pid == 0 && this->payload_unit_start)
     {
       // Registering PID 0
-      Packet pid0;
-      pid0.pid = this->pid;
-      pid0.packet_type = PACKET_TYPE_PSI;
-      pid0.continuity = continuity_counter;
-      it = this->packets.insert(it, std::make_pair(this->pid, pid0));
+      pkt = register_packet(this->pid);
+      pkt->packet_type = PACKET_TYPE_PSI;
+      pkt->continuity = continuity_counter;
     }
     else
       return AVCONTEXT_CONTINUE;
@@ -468,35 +631,35 @@ int AVContext::ProcessTSPacket()
   {
     // PID is registred
     // Checking unit start is required
-    if (it->second.wait_unit_start && !this->payload_unit_start)
+    if (pkt->wait_unit_start && !this->payload_unit_start)
     {
       // Not unit start. Save packet flow continuity...
-      it->second.continuity = continuity_counter;
+      pkt->continuity = continuity_counter;
       this->discontinuity = true;
       return AVCONTEXT_DISCONTINUITY;
     }
     // Checking continuity where possible
-    if (it->second.continuity != 0xff)
+    if (pkt->continuity != 0xff)
     {
-      uint8_t expected_cc = has_payload ? (it->second.continuity + 1) & 0x0f : it->second.continuity;
+      uint8_t expected_cc = has_payload ? (pkt->continuity + 1) & 0x0f : pkt->continuity;
       if (!is_discontinuity && expected_cc != continuity_counter)
       {
         this->discontinuity = true;
         // If unit is not start then reset PID and wait the next unit start
         if (!this->payload_unit_start)
         {
-          it->second.Reset();
+          pkt->Reset();
           DBG(DEMUX_DBG_WARN, "PID %.4x discontinuity detected: found %u, expected %u\n", this->pid, continuity_counter, expected_cc);
           return AVCONTEXT_DISCONTINUITY;
         }
       }
     }
-    it->second.continuity = continuity_counter;
+    pkt->continuity = continuity_counter;
   }
 
   this->discontinuity |= is_discontinuity;
   this->has_payload = has_payload;
-  this->packet = &(it->second);
+  this->packet = pkt;
 
   // It is time to stream data for PES
   if (this->payload_unit_start &&
@@ -510,16 +673,8 @@ int AVContext::ProcessTSPacket()
   return ret;
 }
 
-/*
- * Process payload of packet depending of its type
- *
- * PACKET_TYPE_PSI -> parse_ts_psi()
- * PACKET_TYPE_PES -> parse_ts_pes()
- */
-int AVContext::ProcessTSPayload()
+int AVContext::process_ts_payload()
 {
-  Myth::OS::CLockGuard lock(mutex);
-
   if (!this->packet)
     return AVCONTEXT_CONTINUE;
 
@@ -539,33 +694,60 @@ int AVContext::ProcessTSPayload()
   return ret;
 }
 
+Packet* AVContext::register_packet(uint16_t pid)
+{
+  Packet* pkt = this->packets[pid];
+  if (!pkt)
+  {
+    if (this->packet_pool.empty())
+      pkt = new Packet();
+    else
+    {
+      pkt = this->packet_pool.back();
+      this->packet_pool.pop_back();
+    }
+    pkt->pid = pid;
+    this->packets[pid] = pkt;
+  }
+  return pkt;
+}
+
+void AVContext::release_packet(uint16_t pid)
+{
+  Packet* pkt = this->packets[pid];
+  if (pkt)
+  {
+    this->packets[pid] = NULL;
+    if (this->packet == pkt)
+      this->packet = NULL;
+    pkt->Clear();
+    this->packet_pool.push_back(pkt);
+  }
+}
+
 void AVContext::clear_pmt()
 {
   DBG(DEMUX_DBG_DEBUG, "%s\n", __FUNCTION__);
-  std::vector<uint16_t> pid_list;
-  for (std::map<uint16_t, Packet>::iterator it = this->packets.begin(); it != this->packets.end(); ++it)
+  for (unsigned i = 0; i < AV_CONTEXT_PID_COUNT; ++i)
   {
-    if (it->second.packet_type == PACKET_TYPE_PSI && it->second.packet_table.table_id == 0x02)
+    Packet* pkt = this->packets[i];
+    if (pkt && pkt->packet_type == PACKET_TYPE_PSI && pkt->packet_table.table_id == 0x02)
     {
-      pid_list.push_back(it->first);
-      clear_pes(it->second.channel);
+      clear_pes(pkt->channel);
+      release_packet(i);
     }
   }
-  for (std::vector<uint16_t>::iterator it = pid_list.begin(); it != pid_list.end(); ++it)
-    this->packets.erase(*it);
 }
 
 void AVContext::clear_pes(uint16_t channel)
 {
   DBG(DEMUX_DBG_DEBUG, "%s(%u)\n", __FUNCTION__, channel);
-  std::vector<uint16_t> pid_list;
-  for (std::map<uint16_t, Packet>::iterator it = this->packets.begin(); it != this->packets.end(); ++it)
+  for (unsigned i = 0; i < AV_CONTEXT_PID_COUNT; ++i)
   {
-    if (it->second.packet_type == PACKET_TYPE_PES && it->second.channel == channel)
-      pid_list.push_back(it->first);
+    Packet* pkt = this->packets[i];
+    if (pkt && pkt->packet_type == PACKET_TYPE_PES && pkt->channel == channel)
+      release_packet(i);
   }
-  for (std::vector<uint16_t>::iterator it = pid_list.begin(); it != pid_list.end(); ++it)
-    this->packets.erase(*it);
 }
 
 /*
@@ -722,10 +904,9 @@ int AVContext::parse_ts_psi()
         DBG(DEMUX_DBG_DEBUG, "%s: PAT version %u: new PMT %.4x channel %u\n", __FUNCTION__, version, pmt_pid, channel);
         if (this->channel == 0 || this->channel == channel)
         {
-          Packet& pmt = this->packets[pmt_pid];
-          pmt.pid = pmt_pid;
-          pmt.packet_type = PACKET_TYPE_PSI;
-          pmt.channel = channel;
+          Packet* pmt = register_packet(pmt_pid);
+          pmt->packet_type = PACKET_TYPE_PSI;
+          pmt->channel = channel;
           DBG(DEMUX_DBG_DEBUG, "%s: PAT version %u: register PMT %.4x channel %u\n", __FUNCTION__, version, pmt_pid, channel);
         }
       }
@@ -796,12 +977,11 @@ int AVContext::parse_ts_psi()
                   this->packet->pid, version, pes_pid, ElementaryStream::GetStreamCodecName(stream_type));
         if (stream_type != STREAM_TYPE_UNKNOWN)
         {
-          Packet& pes = this->packets[pes_pid];
-          pes.pid = pes_pid;
-          pes.packet_type = PACKET_TYPE_PES;
-          pes.channel = this->packet->channel;
+          Packet* pes = register_packet(pes_pid);
+          pes->packet_type = PACKET_TYPE_PES;
+          pes->channel = this->packet->channel;
           // Disable streaming by default
-          pes.streaming = false;
+          pes->streaming = false;
           // Get basic stream infos from PMT table
           STREAM_INFO stream_info;
           stream_info = parse_pes_descriptor(psi, len, &stream_type);
@@ -847,7 +1027,7 @@ int AVContext::parse_ts_psi()
 
           es->stream_type = stream_type;
           es->stream_info = stream_info;
-          pes.stream = es;
+          pes->stream = es;
           DBG(DEMUX_DBG_DEBUG, "%s: PMT(%.4x) version %u: register PES %.4x %s\n", __FUNCTION__,
                   this->packet->pid, version, pes_pid, es->GetStreamCodecName());
         }
@@ -35,6 +35,7 @@
 #define FLUTS_ATSC_TS_PACKETSIZE    208
 
 #define AV_CONTEXT_PACKETSIZE       208
+#define AV_CONTEXT_PID_COUNT        0x2000
 #define TS_CHECK_MIN_SCORE          2
 #define TS_CHECK_MAX_SCORE          10
 
@@ -46,6 +47,20 @@ namespace TSDemux
     virtual const unsigned char* ReadAV(uint64_t pos, size_t len) = 0;
   };
 
+  /**
+   * Callbacks of AVContext::ProcessTSBatch(). Returning false stops the batch
+   * once the current packet is processed.
+   */
+  class TSBatchHandler
+  {
+  public:
+    virtual ~TSBatchHandler() {}
+    /** A new unit starts: the pending packets of the stream must be picked */
+    virtual bool HandleStreamData(ElementaryStream* es) = 0;
+    /** The program map has changed */
+    virtual bool HandleProgramChange() = 0;
+  };
+
   enum {
     AVCONTEXT_TS_ERROR            = -3,
     AVCONTEXT_IO_ERROR            = -2,
@@ -60,6 +75,7 @@ namespace TSDemux
   {
   public:
     AVContext(TSDemuxer* const demux, uint64_t pos, uint16_t channel);
+    ~AVContext();
     void Reset(void);
 
     uint16_t GetPID() const;
@@ -84,6 +100,7 @@ namespace TSDemux
     uint64_t GetPosition() const;
     int ProcessTSPacket();
     int ProcessTSPayload();
+    int ProcessTSBatch(const unsigned char* data, size_t len, TSBatchHandler& handler);
 
   private:
     AVContext(const AVContext&);
@@ -95,6 +112,10 @@ namespace TSDemux
     static uint16_t av_rb16(const unsigned char* p);
     static uint32_t av_rb32(const unsigned char* p);
     static uint64_t decode_pts(const unsigned char* p);
+    int process_ts_packet();
+    int process_ts_payload();
+    Packet* register_packet(uint16_t pid);
+    void release_packet(uint16_t pid);
     void clear_pmt();
     void clear_pes(uint16_t channel);
     int parse_ts_psi();
@@ -112,11 +133,15 @@ namespace TSDemux
     size_t av_data_len;
     size_t av_pkt_size;
     unsigned char av_buf[AV_CONTEXT_PACKETSIZE];
+    // Current packet: av_buf or in place of the batch data
+    const unsigned char* av_data;
 
     // TS Streams context
     bool is_configured;
     uint16_t channel;
-    std::map<uint16_t, Packet> packets;
+    // Packets indexed by PID. The released ones are kept for reuse
+    Packet* packets[AV_CONTEXT_PID_COUNT];
+    std::vector<Packet*> packet_pool;
 
     // Packet context
     uint16_t pid;
@@ -65,6 +65,25 @@ namespace TSDemux
         stream->Reset();
     }
 
+    // Restore the initial state, so the packet can be reused for another PID
+    void Clear(void)
+    {
+      if (stream)
+        delete stream;
+      pid = 0xffff;
+      continuity = 0xff;
+      packet_type = PACKET_TYPE_UNKNOWN;
+      channel = 0;
+      wait_unit_start = true;
+      has_stream_data = false;
+      streaming = false;
+      stream = NULL;
+      packet_table.table_id = 0xff;
+      packet_table.version = 0xff;
+      packet_table.id = 0xffff;
+      packet_table.Reset();
+    }
+
     uint16_t pid;
     uint8_t continuity;
     PACKET_TYPE packet_type;
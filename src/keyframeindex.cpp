@@ -0,0 +1,206 @@
+/*
+ *      Copyright (C) 2005-2013 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301 USA
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "keyframeindex.h"
+#include "client.h"
+#include "tools.h"
+#include "demuxer/elementaryStream.h"
+
+#include <algorithm>
+#include <cstring>
+
+#define KEYFRAME_INDEX_MAGIC      "MKI1"
+#define KEYFRAME_INDEX_MAXSIZE    0x1000000
+
+using namespace ADDON;
+
+namespace
+{
+  bool LessTime(const KeyframeIndex::Entry& a, const KeyframeIndex::Entry& b)
+  {
+    return a.time < b.time;
+  }
+
+  bool LessPos(const KeyframeIndex::Entry& a, const KeyframeIndex::Entry& b)
+  {
+    return a.pos < b.pos;
+  }
+}
+
+KeyframeIndex::KeyframeIndex()
+: m_entries()
+, m_startPTS(PTS_UNSET)
+, m_dirty(false)
+{
+}
+
+void KeyframeIndex::Clear()
+{
+  m_entries.clear();
+  m_startPTS = PTS_UNSET;
+  m_dirty = true;
+}
+
+void KeyframeIndex::SetStartPTS(uint64_t pts)
+{
+  if (pts != m_startPTS)
+  {
+    m_startPTS = pts;
+    m_dirty = true;
+  }
+}
+
+bool KeyframeIndex::Add(uint64_t time, uint64_t pos)
+{
+  Entry entry = { time, pos };
+  std::vector<Entry>::iterator it = std::lower_bound(m_entries.begin(), m_entries.end(), entry, LessPos);
+  if (it != m_entries.end() && it->pos == pos)
+    return it->time == time;
+  // Keep the times ordered as the positions. Else the PTS jumped (cut,
+  // wrap): the entry is dropped
+  if ((it != m_entries.end() && it->time <= time) || (it != m_entries.begin() && (it - 1)->time >= time))
+    return true;
+  m_entries.insert(it, entry);
+  m_dirty = true;
+  return true;
+}
+
+bool KeyframeIndex::Find(uint64_t time, bool backwards, Entry& entry) const
+{
+  Entry key = { time, 0 };
+  if (!backwards)
+  {
+    std::vector<Entry>::const_iterator it = std::lower_bound(m_entries.begin(), m_entries.end(), key, LessTime);
+    if (it != m_entries.end())
+    {
+      entry = *it;
+      return true;
+    }
+  }
+  std::vector<Entry>::const_iterator it = std::upper_bound(m_entries.begin(), m_entries.end(), key, LessTime);
+  if (it == m_entries.begin())
+    return false;
+  entry = *(--it);
+  return true;
+}
+
+bool KeyframeIndex::First(Entry& entry) const
+{
+  if (m_entries.empty())
+    return false;
+  entry = m_entries.front();
+  return true;
+}
+
+bool KeyframeIndex::Last(Entry& entry) const
+{
+  if (m_entries.empty())
+    return false;
+  entry = m_entries.back();
+  return true;
+}
+
+/*
+ * File layout: the magic, then varints for the start PTS, the count of
+ * entries and for each entry the deltas of time and position from the
+ * previous one.
+ */
+bool KeyframeIndex::Load(const std::string& filePath)
+{
+  if (!XBMC->FileExists(filePath.c_str(), false))
+    return false;
+  void* file = XBMC->OpenFile(filePath.c_str(), 0);
+  if (!file)
+    return false;
+  std::vector<unsigned char> buf;
+  int64_t len = XBMC->GetFileLength(file);
+  if (len > 0 && len <= KEYFRAME_INDEX_MAXSIZE)
+  {
+    buf.resize(static_cast<size_t>(len));
+    if (XBMC->ReadFile(file, &buf[0], buf.size()) != len)
+      buf.clear();
+  }
+  XBMC->CloseFile(file);
+
+  size_t ml = strlen(KEYFRAME_INDEX_MAGIC);
+  if (buf.size() < ml || memcmp(&buf[0], KEYFRAME_INDEX_MAGIC, ml) != 0)
+  {
+    XBMC->Log(LOG_NOTICE, "%s: Invalid file '%s'", __FUNCTION__, filePath.c_str());
+    return false;
+  }
+  const unsigned char* p = &buf[ml];
+  const unsigned char* end = &buf[0] + buf.size();
+  uint64_t startPTS, count;
+  if (!GetVarint(p, end, startPTS) || !GetVarint(p, end, count) || count > buf.size())
+    return false;
+  std::vector<Entry> entries;
+  entries.reserve(static_cast<size_t>(count));
+  Entry entry = { 0, 0 };
+  for (uint64_t i = 0; i < count; ++i)
+  {
+    uint64_t dt, dp;
+    if (!GetVarint(p, end, dt) || !GetVarint(p, end, dp))
+      return false;
+    entry.time += dt;
+    entry.pos += dp;
+    entries.push_back(entry);
+  }
+  m_entries.swap(entries);
+  m_startPTS = startPTS;
+  m_dirty = false;
+  if (g_bExtraDebug)
+    XBMC->Log(LOG_DEBUG, "%s: Loaded %u keyframes from '%s'", __FUNCTION__, (unsigned)m_entries.size(), filePath.c_str());
+  return true;
+}
+
+bool KeyframeIndex::Save(const std::string& filePath)
+{
+  if (m_entries.empty() || m_startPTS == PTS_UNSET)
+  {
+    if (XBMC->FileExists(filePath.c_str(), false))
+      XBMC->DeleteFile(filePath.c_str());
+    m_dirty = false;
+    return true;
+  }
+  std::string buf(KEYFRAME_INDEX_MAGIC);
+  buf.reserve(buf.size() + 20 + m_entries.size() * 6);
+  PutVarint(buf, m_startPTS);
+  PutVarint(buf, m_entries.size());
+  Entry prev = { 0, 0 };
+  for (std::vector<Entry>::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+  {
+    PutVarint(buf, it->time - prev.time);
+    PutVarint(buf, it->pos - prev.pos);
+    prev = *it;
+  }
+  void* file = XBMC->OpenFileForWrite(filePath.c_str(), true);
+  if (!file)
+  {
+    XBMC->Log(LOG_ERROR, "%s: Failed to open file '%s'", __FUNCTION__, filePath.c_str());
+    return false;
+  }
+  bool ret = (XBMC->WriteFile(file, buf.data(), buf.size()) == static_cast<ssize_t>(buf.size()));
+  XBMC->CloseFile(file);
+  if (ret)
+    m_dirty = false;
+  return ret;
+}
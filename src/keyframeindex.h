@@ -0,0 +1,74 @@
+#pragma once
+/*
+ *      Copyright (C) 2005-2013 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301 USA
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#define KEYFRAME_INDEX_DIRECTORY  "keyframes"
+
+/**
+ * Map of the keyframes of a recording: time from the start of the stream
+ * (PTS ticks) to the position in the file where the demuxing can restart.
+ * Entries are kept sorted by time and by position.
+ */
+class KeyframeIndex
+{
+public:
+  struct Entry
+  {
+    uint64_t time;
+    uint64_t pos;
+  };
+
+  KeyframeIndex();
+
+  void Clear();
+  bool Empty() const { return m_entries.empty(); }
+  bool IsDirty() const { return m_dirty; }
+
+  uint64_t GetStartPTS() const { return m_startPTS; }
+  void SetStartPTS(uint64_t pts);
+
+  /**
+   * Register a keyframe. Returns false when it conflicts with a known entry
+   * at the same position: the index doesn't match the stream.
+   */
+  bool Add(uint64_t time, uint64_t pos);
+
+  /**
+   * Find the keyframe before the given time, or the first one after if not
+   * backwards. Returns false when no entry matches.
+   */
+  bool Find(uint64_t time, bool backwards, Entry& entry) const;
+  bool First(Entry& entry) const;
+  bool Last(Entry& entry) const;
+
+  bool Load(const std::string& filePath);
+  bool Save(const std::string& filePath);
+
+private:
+  std::vector<Entry> m_entries;
+  uint64_t m_startPTS;
+  bool m_dirty;
+};
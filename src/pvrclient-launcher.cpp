@@ -27,6 +27,8 @@
 
 using namespace ADDON;
 
+// The launcher retries until connected, possibly for the life of the client,
+// so it runs on its own thread rather than holding a worker of the shared pool
 class PVRClientLauncherPrivate : private Myth::OS::CThread
 {
 public:
@@ -24,16 +24,88 @@
 #include "client.h"
 #include "tools.h"
 #include "avinfo.h"
+#include "demux.h"
 #include "filestreaming.h"
 #include "taskhandler.h"
 #include "private/os/threads/mutex.h"
+#include "private/os/threads/threadpool.h"
+#include "private/os/os.h"
 
 #include <time.h>
 #include <set>
 #include <cassert>
 
+#define BOOKMARK_PREFETCH_DELAY   2000  // ms after the recordings are loaded
+#define BOOKMARK_PREFETCH_BATCH   20    // bookmarks read by each prefetch task
+#define BOOKMARK_FLUSH_DELAY      2000  // ms to coalesce the updates of a position
+#define BOOKMARK_FLUSH_RETRIES    5     // failed flushes retried, the delay doubling each time
+#define EDL_PREFETCH_DELAY        5000  // ms after the recordings are loaded
+#define EDL_PREFETCH_BATCH        10    // recordings read by each prefetch task
+#define SLAVE_STREAM_IDLE_TIMEOUT 300   // s to keep the connection to a slave
+#define KEYFRAME_PRUNE_INTERVAL   86400 // s between the cleanups of the keyframe indexes
+
+// Keys of the coalesced tasks
+enum
+{
+  TASK_PREFETCH_BOOKMARKS = 1,
+  TASK_FLUSH_BOOKMARKS,
+  TASK_PREFETCH_EDLS,
+};
+
 using namespace ADDON;
 
+/**
+ * Load of a dataset. Its count is held by the job on the shared pool. A
+ * refresh requested while a load is pending marks it dirty instead of being
+ * dropped, and the job loads once more before it completes: the data read
+ * before the request could be stale.
+ */
+class DataLoad : public Myth::OS::CCompletion
+{
+public:
+  DataLoad() : m_running(false), m_dirty(false) { }
+
+  /// Reserve a count for a new load, or mark the pending one dirty
+  bool Begin()
+  {
+    Myth::OS::CLockGuard lock(m_mutex);
+    if (m_running)
+    {
+      m_dirty = true;
+      return false;
+    }
+    m_running = true;
+    m_dirty = false;
+    Add();
+    return true;
+  }
+
+  /// Clear the dirty mark, else end the load
+  bool Again()
+  {
+    Myth::OS::CLockGuard lock(m_mutex);
+    if (m_dirty)
+    {
+      m_dirty = false;
+      return true;
+    }
+    m_running = false;
+    return false;
+  }
+
+  void End()
+  {
+    Myth::OS::CLockGuard lock(m_mutex);
+    m_running = false;
+    m_dirty = false;
+  }
+
+private:
+  Myth::OS::CMutex m_mutex;
+  bool m_running;
+  bool m_dirty;
+};
+
 PVRClientMythTV::PVRClientMythTV()
 : m_connectionError(CONN_ERROR_NOT_CONNECTED)
 , m_eventHandler(NULL)
@@ -41,6 +113,7 @@ PVRClientMythTV::PVRClientMythTV()
 , m_liveStream(NULL)
 , m_recordingStream(NULL)
 , m_dummyStream(NULL)
+, m_demux(NULL)
 , m_hang(false)
 , m_powerSaving(false)
 , m_stopTV(false)
@@ -48,28 +121,62 @@ PVRClientMythTV::PVRClientMythTV()
 , m_scheduleManager(NULL)
 , m_lock(new Myth::OS::CMutex)
 , m_todo(NULL)
+, m_channelsLoading(new DataLoad)
+, m_recordingsLoading(new DataLoad)
+, m_timersLoading(new DataLoad)
+, m_channels(new ChannelData())
 , m_channelsLock(new Myth::OS::CMutex)
+, m_channelCache()
+, m_channelsCached(false)
+, m_recordings(new ProgramInfoMap())
 , m_recordingsLock(new Myth::OS::CMutex)
 , m_recordingChangePinCount(0)
 , m_recordingsAmountChange(false)
 , m_recordingsAmount(0)
 , m_deletedRecAmountChange(false)
 , m_deletedRecAmount(0)
+, m_bookmarksGeneration(0)
+, m_bookmarksFlushRetries(0)
+, m_bookmarksLock(new Myth::OS::CMutex)
+, m_edlsGeneration(0)
+, m_edlsLock(new Myth::OS::CMutex)
+, m_masterBackendOverride(-1)
+, m_backendsLock(new Myth::OS::CMutex)
+, m_idleSlaveStream(NULL)
+, m_idleSlaveTime(0)
+, m_keyframePruneTime(0)
 {
 }
 
 PVRClientMythTV::~PVRClientMythTV()
 {
+  // Wait for the loads in progress
+  m_channelsLoading->Wait();
+  m_recordingsLoading->Wait();
+  m_timersLoading->Wait();
+  // Write the pending bookmarks
+  if (m_control)
+    FlushBookmarks();
   SAFE_DELETE(m_todo);
+  SAFE_DELETE(m_demux);
   SAFE_DELETE(m_dummyStream);
   SAFE_DELETE(m_liveStream);
   SAFE_DELETE(m_recordingStream);
+  SAFE_DELETE(m_idleSlaveStream);
   SAFE_DELETE(m_artworksManager);
   SAFE_DELETE(m_scheduleManager);
   SAFE_DELETE(m_eventHandler);
   SAFE_DELETE(m_control);
+  // Flush the library messages
+  Myth::DBGAsync(false);
+  delete m_backendsLock;
+  delete m_edlsLock;
+  delete m_bookmarksLock;
   delete m_recordingsLock;
   delete m_channelsLock;
+  delete m_timersLoading;
+  delete m_recordingsLoading;
+  delete m_channelsLoading;
   delete m_lock;
 }
 
@@ -114,6 +221,10 @@ void PVRClientMythTV::SetDebug(bool silent /*= false*/)
   else
     Myth::DBGLevel(MYTH_DBG_ERROR);
   Myth::SetDBGMsgCallback(Log);
+  // Keep the heavy tracing out of the streaming threads
+  Myth::DBGAsync(g_bExtraDebug);
+  // The new connections record their traffic
+  Myth::DBGCapture(g_szCaptureDir.empty() ? NULL : g_szCaptureDir.c_str());
 }
 
 bool PVRClientMythTV::Connect()
@@ -158,6 +269,7 @@ bool PVRClientMythTV::Connect()
   m_eventHandler->SubscribeForEvent(subid, Myth::EVENT_HANDLER_TIMER);
   m_eventHandler->SubscribeForEvent(subid, Myth::EVENT_ASK_RECORDING);
   m_eventHandler->SubscribeForEvent(subid, Myth::EVENT_RECORDING_LIST_CHANGE);
+  m_eventHandler->SubscribeForEvent(subid, Myth::EVENT_CLEAR_SETTINGS_CACHE);
 
   // Create schedule manager and new subscription handled by dedicated thread
   m_scheduleManager = new MythScheduleManager(g_szMythHostname, g_iProtoPort, g_iWSApiPort, g_szWSSecurityPin);
@@ -170,6 +282,12 @@ bool PVRClientMythTV::Connect()
   // Create the task handler to process various task
   m_todo = new TaskHandler();
 
+  // Serve the channels of the last session until the backend ones are loaded
+  LoadChannelCache();
+
+  // Load the data in the background: Kodi requests them once connected
+  RefreshBackendData();
+
   // Now all is ready: Start event handler
   m_eventHandler->Start();
   return true;
@@ -282,6 +400,9 @@ void PVRClientMythTV::HandleBackendMessage(Myth::EventMessagePtr msg)
     case Myth::EVENT_RECORDING_LIST_CHANGE:
       HandleRecordingListChange(*msg);
       break;
+    case Myth::EVENT_CLEAR_SETTINGS_CACHE:
+      ClearBackendAddresses();
+      break;
     case Myth::EVENT_HANDLER_TIMER:
       RunHouseKeeping();
       break;
@@ -303,13 +424,12 @@ void PVRClientMythTV::HandleBackendMessage(Myth::EventMessagePtr msg)
             m_control->Open();
           if (m_scheduleManager)
             m_scheduleManager->OpenControl();
+          ClearBackendAddresses();
           m_hang = false;
           XBMC->QueueNotification(QUEUE_INFO, XBMC->GetLocalizedString(30303)); // Connection to MythTV restored
         }
         // Refreshing all
-        HandleChannelChange();
-        HandleScheduleChange();
-        HandleRecordingListChange(Myth::EventMessage());
+        RefreshBackendData();
       }
       else if (msg->subject[0] == EVENTHANDLER_NOTCONNECTED)
       {
@@ -323,11 +443,110 @@ void PVRClientMythTV::HandleBackendMessage(Myth::EventMessagePtr msg)
   }
 }
 
+class LoadJob : public Myth::OS::CWorker
+{
+public:
+  LoadJob(PVRClientMythTV* pvr, DataLoad* loading)
+  : Myth::OS::CWorker()
+  , m_pvr(pvr)
+  , m_loading(loading)
+  , m_ended(false) { }
+
+  virtual ~LoadJob()
+  {
+    // Discarded by the pool without running
+    if (!m_ended)
+      m_loading->End();
+  }
+
+  virtual void Process()
+  {
+    do
+      Load();
+    while (m_loading->Again());
+    m_ended = true;
+  }
+
+protected:
+  virtual void Load() = 0;
+
+  PVRClientMythTV *m_pvr;
+
+private:
+  DataLoad *m_loading;
+  bool m_ended;
+};
+
+class LoadChannelsJob : public LoadJob
+{
+public:
+  LoadChannelsJob(PVRClientMythTV* pvr, DataLoad* loading)
+  : LoadJob(pvr, loading) { }
+
+  virtual void Load()
+  {
+    m_pvr->HandleChannelChange();
+  }
+};
+
+class LoadRecordingsJob : public LoadJob
+{
+public:
+  LoadRecordingsJob(PVRClientMythTV* pvr, DataLoad* loading)
+  : LoadJob(pvr, loading) { }
+
+  virtual void Load()
+  {
+    m_pvr->HandleRecordingListChange(Myth::EventMessage());
+  }
+};
+
+class LoadTimersJob : public LoadJob
+{
+public:
+  LoadTimersJob(PVRClientMythTV* pvr, DataLoad* loading)
+  : LoadJob(pvr, loading) { }
+
+  virtual void Load()
+  {
+    m_pvr->HandleScheduleChange();
+  }
+};
+
+static void EnqueueLoad(LoadJob *job, Myth::OS::CThreadPool::PRIORITY priority, DataLoad *loading)
+{
+  // A pending load will run again instead. Otherwise the count is reserved,
+  // then released once the job holds its own.
+  if (!loading->Begin())
+  {
+    delete job;
+    return;
+  }
+  // The pool is stopped: run it in place
+  if (!Myth::OS::CThreadPool::Shared().Enqueue(job, priority, loading))
+  {
+    job->Process();
+    delete job;
+  }
+  loading->Done();
+}
+
+void PVRClientMythTV::RefreshBackendData()
+{
+  // The loads depend only on the connection, so they run concurrently, and
+  // each one publishes its data when done
+  EnqueueLoad(new LoadChannelsJob(this, m_channelsLoading), Myth::OS::CThreadPool::PRIORITY_HIGH, m_channelsLoading);
+  EnqueueLoad(new LoadTimersJob(this, m_timersLoading), Myth::OS::CThreadPool::PRIORITY_NORMAL, m_timersLoading);
+  EnqueueLoad(new LoadRecordingsJob(this, m_recordingsLoading), Myth::OS::CThreadPool::PRIORITY_NORMAL, m_recordingsLoading);
+}
+
 void PVRClientMythTV::HandleChannelChange()
 {
-  FillChannelsAndChannelGroups();
-  PVR->TriggerChannelUpdate();
-  PVR->TriggerChannelGroupsUpdate();
+  if (FillChannelsAndChannelGroups())
+  {
+    PVR->TriggerChannelUpdate();
+    PVR->TriggerChannelGroupsUpdate();
+  }
 }
 
 void PVRClientMythTV::HandleScheduleChange()
@@ -392,6 +611,9 @@ void PVRClientMythTV::HandleRecordingListChange(const Myth::EventMessage& msg)
       XBMC->Log(LOG_DEBUG, "%s: Reload all recordings", __FUNCTION__);
     Myth::OS::CLockGuard lock(*m_recordingsLock);
     FillRecordings();
+    // Invalidate once published, so a read can't cache from the old list
+    InvalidateBookmarks();
+    InvalidateEdls();
     ++m_recordingChangePinCount;
   }
   else if (cs == 4 && msg.subject[1] == "ADD")
@@ -402,13 +624,15 @@ void PVRClientMythTV::HandleRecordingListChange(const Myth::EventMessage& msg)
     if (!prog.IsNull())
     {
       Myth::OS::CLockGuard lock(*m_recordingsLock);
-      ProgramInfoMap::iterator it = m_recordings.find(prog.UID());
-      if (it == m_recordings.end())
+      ProgramInfoMapPtr recordings = GetRecordingsData();
+      if (recordings->find(prog.UID()) == recordings->end())
       {
         if (g_bExtraDebug)
           XBMC->Log(LOG_DEBUG, "%s: Add recording: %s", __FUNCTION__, prog.UID().c_str());
         // Add recording
-        m_recordings.insert(std::pair<std::string, MythProgramInfo>(prog.UID().c_str(), prog));
+        ProgramInfoMap *update = new ProgramInfoMap(*recordings);
+        update->insert(std::pair<std::string, MythProgramInfo>(prog.UID().c_str(), prog));
+        PublishRecordings(update);
         ++m_recordingChangePinCount;
       }
     }
@@ -422,13 +646,15 @@ void PVRClientMythTV::HandleRecordingListChange(const Myth::EventMessage& msg)
     if (!prog.IsNull())
     {
       Myth::OS::CLockGuard lock(*m_recordingsLock);
-      ProgramInfoMap::iterator it = m_recordings.find(prog.UID());
-      if (it == m_recordings.end())
+      ProgramInfoMapPtr recordings = GetRecordingsData();
+      if (recordings->find(prog.UID()) == recordings->end())
       {
         if (g_bExtraDebug)
           XBMC->Log(LOG_DEBUG, "%s: Add recording: %s", __FUNCTION__, prog.UID().c_str());
         // Add recording
-        m_recordings.insert(std::pair<std::string, MythProgramInfo>(prog.UID().c_str(), prog));
+        ProgramInfoMap *update = new ProgramInfoMap(*recordings);
+        update->insert(std::pair<std::string, MythProgramInfo>(prog.UID().c_str(), prog));
+        PublishRecordings(update);
         ++m_recordingChangePinCount;
       }
     }
@@ -439,8 +665,9 @@ void PVRClientMythTV::HandleRecordingListChange(const Myth::EventMessage& msg)
   {
     Myth::OS::CLockGuard lock(*m_recordingsLock);
     MythProgramInfo prog(msg.program);
-    ProgramInfoMap::iterator it = m_recordings.find(prog.UID());
-    if (it != m_recordings.end())
+    ProgramInfoMapPtr recordings = GetRecordingsData();
+    ProgramInfoMap::const_iterator it = recordings->find(prog.UID());
+    if (it != recordings->end())
     {
       if (g_bExtraDebug)
         XBMC->Log(LOG_DEBUG, "%s: Update recording: %s", __FUNCTION__, prog.UID().c_str());
@@ -453,7 +680,13 @@ void PVRClientMythTV::HandleRecordingListChange(const Myth::EventMessage& msg)
       // Keep original air date
       prog.GetPtr()->airdate = it->second.Airdate();
       // Update recording
-      it->second = prog;
+      ProgramInfoMap *update = new ProgramInfoMap(*recordings);
+      (*update)[it->first] = prog;
+      PublishRecordings(update);
+      // The bookmark could be changed by another frontend
+      InvalidateBookmark(prog.UID());
+      // The marks are updated by the commercial flagging or the editor
+      InvalidateEdl(prog.UID());
       ++m_recordingChangePinCount;
     }
   }
@@ -467,14 +700,20 @@ void PVRClientMythTV::HandleRecordingListChange(const Myth::EventMessage& msg)
     if (!prog.IsNull())
     {
       Myth::OS::CLockGuard lock(*m_recordingsLock);
-      ProgramInfoMap::iterator it = m_recordings.find(prog.UID());
-      if (it != m_recordings.end())
+      ProgramInfoMapPtr recordings = GetRecordingsData();
+      if (recordings->find(prog.UID()) != recordings->end())
       {
         if (g_bExtraDebug)
           XBMC->Log(LOG_DEBUG, "%s: Delete recording: %s", __FUNCTION__, prog.UID().c_str());
         // Remove recording
-        m_recordings.erase(it);
+        ProgramInfoMap *update = new ProgramInfoMap(*recordings);
+        update->erase(prog.UID());
+        PublishRecordings(update);
+        InvalidateBookmark(prog.UID());
+        InvalidateEdl(prog.UID());
         ++m_recordingChangePinCount;
+        lock.Unlock();
+        DeleteKeyframeIndex(prog.UID());
       }
     }
   }
@@ -487,14 +726,20 @@ void PVRClientMythTV::HandleRecordingListChange(const Myth::EventMessage& msg)
     if (!prog.IsNull())
     {
       Myth::OS::CLockGuard lock(*m_recordingsLock);
-      ProgramInfoMap::iterator it = m_recordings.find(prog.UID());
-      if (it != m_recordings.end())
+      ProgramInfoMapPtr recordings = GetRecordingsData();
+      if (recordings->find(prog.UID()) != recordings->end())
       {
         if (g_bExtraDebug)
           XBMC->Log(LOG_DEBUG, "%s: Delete recording: %s", __FUNCTION__, prog.UID().c_str());
         // Remove recording
-        m_recordings.erase(it);
+        ProgramInfoMap *update = new ProgramInfoMap(*recordings);
+        update->erase(prog.UID());
+        PublishRecordings(update);
+        InvalidateBookmark(prog.UID());
+        InvalidateEdl(prog.UID());
         ++m_recordingChangePinCount;
+        lock.Unlock();
+        DeleteKeyframeIndex(prog.UID());
       }
     }
   }
@@ -541,6 +786,23 @@ void PVRClientMythTV::RunHouseKeeping()
     lock.Lock();
     m_recordingChangePinCount = 0;
   }
+  // Close the connection to the slave when unused for a while. Don't wait
+  // for a stream being opened.
+  if (m_lock->TryLock())
+  {
+    if (m_idleSlaveStream && difftime(time(NULL), m_idleSlaveTime) > SLAVE_STREAM_IDLE_TIMEOUT)
+    {
+      XBMC->Log(LOG_DEBUG, "%s: Close idle connection to remote backend %s", __FUNCTION__, m_idleSlaveHost.c_str());
+      SAFE_DELETE(m_idleSlaveStream);
+    }
+    m_lock->Unlock();
+  }
+  // Clean up the indexes of the recordings deleted meanwhile, once loaded
+  if (difftime(time(NULL), m_keyframePruneTime) > KEYFRAME_PRUNE_INTERVAL && !m_recordingsLoading->Pending())
+  {
+    m_keyframePruneTime = time(NULL);
+    PruneKeyframeIndexes();
+  }
 }
 
 PVR_ERROR PVRClientMythTV::GetEPGForChannel(ADDON_HANDLE handle, int iChannelUid, time_t iStart, time_t iEnd)
@@ -608,8 +870,8 @@ int PVRClientMythTV::GetNumChannels()
   if (g_bExtraDebug)
     XBMC->Log(LOG_DEBUG, "%s", __FUNCTION__);
 
-  Myth::OS::CLockGuard lock(*m_channelsLock);
-  return m_PVRChannels.size();
+  WaitChannels();
+  return GetChannelData()->PVRChannels.size();
 }
 
 PVR_ERROR PVRClientMythTV::GetChannels(ADDON_HANDLE handle, bool bRadio)
@@ -619,18 +881,23 @@ PVR_ERROR PVRClientMythTV::GetChannels(ADDON_HANDLE handle, bool bRadio)
   if (g_bExtraDebug)
     XBMC->Log(LOG_DEBUG, "%s: radio: %s", __FUNCTION__, (bRadio ? "true" : "false"));
 
-  Myth::OS::CLockGuard lock(*m_channelsLock);
+  // Wait for the channels being loaded
+  WaitChannels();
+  ChannelDataPtr channels = GetChannelData();
 
   // Load channels list
-  if (m_PVRChannels.empty())
+  if (channels->PVRChannels.empty())
+  {
     FillChannelsAndChannelGroups();
+    channels = GetChannelData();
+  }
   // Transfer channels of the requested type (radio / tv)
-  for (PVRChannelList::const_iterator it = m_PVRChannels.begin(); it != m_PVRChannels.end(); ++it)
+  for (PVRChannelList::const_iterator it = channels->PVRChannels.begin(); it != channels->PVRChannels.end(); ++it)
   {
     if (it->bIsRadio == bRadio)
     {
-      ChannelIdMap::const_iterator itm = m_channelsById.find(it->iUniqueId);
-      if (itm != m_channelsById.end() && !itm->second.IsNull())
+      ChannelIdMap::const_iterator itm = channels->channelsById.find(it->iUniqueId);
+      if (itm != channels->channelsById.end() && !itm->second.IsNull())
       {
         PVR_CHANNEL tag;
         memset(&tag, 0, sizeof(PVR_CHANNEL));
@@ -667,8 +934,8 @@ int PVRClientMythTV::GetChannelGroupsAmount()
   if (g_bExtraDebug)
     XBMC->Log(LOG_DEBUG, "%s", __FUNCTION__);
 
-  Myth::OS::CLockGuard lock(*m_channelsLock);
-  return m_PVRChannelGroups.size();
+  WaitChannels();
+  return GetChannelData()->PVRChannelGroups.size();
 }
 
 PVR_ERROR PVRClientMythTV::GetChannelGroups(ADDON_HANDLE handle, bool bRadio)
@@ -678,10 +945,11 @@ PVR_ERROR PVRClientMythTV::GetChannelGroups(ADDON_HANDLE handle, bool bRadio)
   if (g_bExtraDebug)
     XBMC->Log(LOG_DEBUG, "%s: radio: %s", __FUNCTION__, (bRadio ? "true" : "false"));
 
-  Myth::OS::CLockGuard lock(*m_channelsLock);
+  WaitChannels();
+  ChannelDataPtr channels = GetChannelData();
 
   // Transfer channel groups of the given type (radio / tv)
-  for (PVRChannelGroupMap::iterator itg = m_PVRChannelGroups.begin(); itg != m_PVRChannelGroups.end(); ++itg)
+  for (PVRChannelGroupMap::const_iterator itg = channels->PVRChannelGroups.begin(); itg != channels->PVRChannelGroups.end(); ++itg)
   {
     PVR_CHANNEL_GROUP tag;
     memset(&tag, 0, sizeof(PVR_CHANNEL_GROUP));
@@ -714,10 +982,11 @@ PVR_ERROR PVRClientMythTV::GetChannelGroupMembers(ADDON_HANDLE handle, const PVR
   if (g_bExtraDebug)
     XBMC->Log(LOG_DEBUG, "%s: group: %s", __FUNCTION__, group.strGroupName);
 
-  Myth::OS::CLockGuard lock(*m_channelsLock);
+  WaitChannels();
+  ChannelDataPtr channels = GetChannelData();
 
-  PVRChannelGroupMap::iterator itg = m_PVRChannelGroups.find(group.strGroupName);
-  if (itg == m_PVRChannelGroups.end())
+  PVRChannelGroupMap::const_iterator itg = channels->PVRChannelGroups.find(group.strGroupName);
+  if (itg == channels->PVRChannelGroups.end())
   {
     XBMC->Log(LOG_ERROR,"%s: Channel group not found", __FUNCTION__);
     return PVR_ERROR_INVALID_PARAMETERS;
@@ -752,18 +1021,63 @@ bool PVRClientMythTV::IsPlaying() const
   return false;
 }
 
-int PVRClientMythTV::FillChannelsAndChannelGroups()
+static std::string ChannelCacheKey()
+{
+  return g_szMythHostname + ":" + Myth::IntToString(g_iWSApiPort);
+}
+
+void PVRClientMythTV::LoadChannelCache()
+{
+  Myth::OS::CLockGuard lock(*m_channelsLock);
+  std::string filePath = g_szUserPath + CHANNEL_CACHE_FILENAME;
+  if (m_channelCache.Load(filePath, ChannelCacheKey()) && !m_channelCache.Empty())
+  {
+    PublishChannels(m_channelCache);
+    m_channelsCached = true;
+  }
+}
+
+void PVRClientMythTV::WaitChannels() const
+{
+  // The cached channels are valid until the loaded ones replace them
+  if (!m_channelsCached)
+    m_channelsLoading->Wait();
+}
+
+bool PVRClientMythTV::FillChannelsAndChannelGroups()
 {
   if (!m_control)
-    return 0;
-  int count = 0;
+    return false;
   XBMC->Log(LOG_DEBUG, "%s", __FUNCTION__);
 
   Myth::OS::CLockGuard lock(*m_channelsLock);
-  m_PVRChannels.clear();
-  m_PVRChannelGroups.clear();
-  m_PVRChannelUidById.clear();
-  m_channelsById.clear();
+  ChannelCache cache;
+
+  // Fetch the channels of the sources. It runs on a pool thread, so it must
+  // not wait for other jobs of the pool
+  cache.sources = m_control->GetVideoSourceList();
+  for (Myth::VideoSourceList::const_iterator its = cache.sources->begin(); its != cache.sources->end(); ++its)
+    cache.channels.push_back(m_control->GetChannelList((*its)->sourceId));
+
+  // Nothing to publish when the backend returns the data already served
+  if (cache.Equals(m_channelCache))
+  {
+    XBMC->Log(LOG_DEBUG, "%s: Channels unchanged", __FUNCTION__);
+    return false;
+  }
+  PublishChannels(cache);
+  m_channelCache = cache;
+  // Keep the last good cache when the backend returned nothing
+  if (!cache.Empty())
+    m_channelCache.Save(g_szUserPath + CHANNEL_CACHE_FILENAME, ChannelCacheKey());
+  return true;
+}
+
+void PVRClientMythTV::PublishChannels(const ChannelCache& cache)
+{
+  int count = 0;
+  // Build the new snapshot aside
+  ChannelData *data = new ChannelData();
 
   // Create a channels map to merge channels with same channum and callsign within
   typedef std::pair<std::string, std::string> chanuid_t;
@@ -771,10 +1085,9 @@ int PVRClientMythTV::FillChannelsAndChannelGroups()
   mapuid_t channelIdentifiers;
 
   // For each source create a channels group
-  Myth::VideoSourceListPtr sources = m_control->GetVideoSourceList();
-  for (Myth::VideoSourceList::iterator its = sources->begin(); its != sources->end(); ++its)
+  for (size_t i = 0; i < cache.sources->size(); ++i)
   {
-    Myth::ChannelListPtr channels = m_control->GetChannelList((*its)->sourceId);
+    Myth::ChannelListPtr channels = cache.channels[i];
     std::set<PVRChannelItem> channelIDs;
     //channelIdentifiers.clear();
     for (Myth::ChannelList::iterator itc = channels->begin(); itc != channels->end(); ++itc)
@@ -787,7 +1100,7 @@ int PVRClientMythTV::FillChannelsAndChannelGroups()
       item.iSubChannelNumber = channel.NumberMinor();
       item.bIsRadio = channel.IsRadio();
       // Store the new Myth channel in the map
-      m_channelsById.insert(std::make_pair(item.iUniqueId, channel));
+      data->channelsById.insert(std::make_pair(item.iUniqueId, channel));
 
       // Looking for PVR channel with same channum and callsign
       chanuid_t channelIdentifier = std::make_pair(channel.Number(), channel.Callsign());
@@ -797,42 +1110,43 @@ int PVRClientMythTV::FillChannelsAndChannelGroups()
         if (g_bExtraDebug)
           XBMC->Log(LOG_DEBUG, "%s: skipping channel: %d", __FUNCTION__, chanid);
         // Link channel to PVR item
-        m_PVRChannelUidById.insert(std::make_pair(chanid, itm->second.iUniqueId));
+        data->PVRChannelUidById.insert(std::make_pair(chanid, itm->second.iUniqueId));
         // Add found PVR item to the grouping set
         channelIDs.insert(itm->second);
       }
       else
       {
         ++count;
-        m_PVRChannels.push_back(item);
+        data->PVRChannels.push_back(item);
         channelIdentifiers.insert(std::make_pair(channelIdentifier, item));
         // Link channel to PVR item
-        m_PVRChannelUidById.insert(std::make_pair(chanid, item.iUniqueId));
+        data->PVRChannelUidById.insert(std::make_pair(chanid, item.iUniqueId));
         // Add the new PVR item to the grouping set
         channelIDs.insert(item);
       }
     }
-    m_PVRChannelGroups.insert(std::make_pair((*its)->sourceName, PVRChannelList(channelIDs.begin(), channelIDs.end())));
+    data->PVRChannelGroups.insert(std::make_pair((*cache.sources)[i]->sourceName, PVRChannelList(channelIDs.begin(), channelIDs.end())));
   }
 
-  XBMC->Log(LOG_DEBUG, "%s: Loaded %d channel(s) %d group(s)", __FUNCTION__, count, (unsigned)m_PVRChannelGroups.size());
-  return count;
+  XBMC->Log(LOG_DEBUG, "%s: Loaded %d channel(s) %d group(s)", __FUNCTION__, count, (unsigned)data->PVRChannelGroups.size());
+  // Publish the new snapshot
+  std::atomic_store(&m_channels, ChannelDataPtr(data));
 }
 
 MythChannel PVRClientMythTV::FindChannel(uint32_t channelId) const
 {
-  Myth::OS::CLockGuard lock(*m_channelsLock);
-  ChannelIdMap::const_iterator it = m_channelsById.find(channelId);
-  if (it != m_channelsById.end())
+  ChannelDataPtr channels = GetChannelData();
+  ChannelIdMap::const_iterator it = channels->channelsById.find(channelId);
+  if (it != channels->channelsById.end())
     return it->second;
   return MythChannel();
 }
 
 int PVRClientMythTV::FindPVRChannelUid(uint32_t channelId) const
 {
-  Myth::OS::CLockGuard lock(*m_channelsLock);
-  PVRChannelMap::const_iterator it = m_PVRChannelUidById.find(channelId);
-  if (it != m_PVRChannelUidById.end())
+  ChannelDataPtr channels = GetChannelData();
+  PVRChannelMap::const_iterator it = channels->PVRChannelUidById.find(channelId);
+  if (it != channels->PVRChannelUidById.end())
     return it->second;
   return PVR_CHANNEL_INVALID_UID;
 }
@@ -842,11 +1156,12 @@ int PVRClientMythTV::GetRecordingsAmount()
   if (g_bExtraDebug)
     XBMC->Log(LOG_DEBUG, "%s", __FUNCTION__);
 
+  m_recordingsLoading->Wait();
   if (m_recordingsAmountChange)
   {
     int res = 0;
-    Myth::OS::CLockGuard lock(*m_recordingsLock);
-    for (ProgramInfoMap::iterator it = m_recordings.begin(); it != m_recordings.end(); ++it)
+    ProgramInfoMapPtr recordings = GetRecordingsData();
+    for (ProgramInfoMap::const_iterator it = recordings->begin(); it != recordings->end(); ++it)
     {
       if (!it->second.IsNull() && it->second.IsVisible() && (g_bLiveTVRecordings || !it->second.IsLiveTV()))
         res++;
@@ -865,36 +1180,30 @@ PVR_ERROR PVRClientMythTV::GetRecordings(ADDON_HANDLE handle)
   if (g_bExtraDebug)
     XBMC->Log(LOG_DEBUG, "%s", __FUNCTION__);
 
-  Myth::OS::CLockGuard lock(*m_recordingsLock);
+  // The channels are needed to link the recordings
+  m_recordingsLoading->Wait();
+  WaitChannels();
+  ProgramInfoMapPtr recordings = GetRecordingsData();
 
-  // Setup series
+  // Setup series: the titles found more than once in a group
+  typedef std::set<std::pair<std::string, std::string> > TitleSet;
+  TitleSet series;
   if (g_iGroupRecordings == GROUP_RECORDINGS_ONLY_FOR_SERIES)
   {
-    typedef std::map<std::pair<std::string, std::string>, ProgramInfoMap::iterator::pointer> TitlesMap;
-    TitlesMap titles;
-    for (ProgramInfoMap::iterator it = m_recordings.begin(); it != m_recordings.end(); ++it)
+    TitleSet titles;
+    for (ProgramInfoMap::const_iterator it = recordings->begin(); it != recordings->end(); ++it)
     {
       if (!it->second.IsNull() && it->second.IsVisible() && (g_bLiveTVRecordings || !it->second.IsLiveTV()))
       {
         std::pair<std::string, std::string> title = std::make_pair(it->second.RecordingGroup(), it->second.GroupingTitle());
-        TitlesMap::iterator found = titles.find(title);
-        if (found != titles.end())
-        {
-          if (found->second)
-          {
-            found->second->second.SetPropsSerie(true);
-            found->second = NULL;
-          }
-          it->second.SetPropsSerie(true);
-        }
-        else
-          titles.insert(std::make_pair(title, &(*it)));
+        if (!titles.insert(title).second)
+          series.insert(title);
       }
     }
   }
   time_t now = time(NULL);
   // Transfer to PVR
-  for (ProgramInfoMap::iterator it = m_recordings.begin(); it != m_recordings.end(); ++it)
+  for (ProgramInfoMap::const_iterator it = recordings->begin(); it != recordings->end(); ++it)
   {
     if (!it->second.IsNull() && it->second.IsVisible() && (g_bLiveTVRecordings || !it->second.IsLiveTV()))
     {
@@ -942,7 +1251,8 @@ PVR_ERROR PVRClientMythTV::GetRecordings(ADDON_HANDLE handle)
       std::string strDirectory;
       if (!g_bRootDefaultGroup || it->second.RecordingGroup().compare("Default") != 0)
         strDirectory.append(it->second.RecordingGroup());
-      if (g_iGroupRecordings == GROUP_RECORDINGS_ALWAYS || (g_iGroupRecordings == GROUP_RECORDINGS_ONLY_FOR_SERIES && it->second.GetPropsSerie()))
+      if (g_iGroupRecordings == GROUP_RECORDINGS_ALWAYS || (g_iGroupRecordings == GROUP_RECORDINGS_ONLY_FOR_SERIES &&
+          series.find(std::make_pair(it->second.RecordingGroup(), it->second.GroupingTitle())) != series.end()))
         strDirectory.append("/").append(it->second.GroupingTitle());
       PVR_STRCPY(tag.strDirectory, strDirectory.c_str());
 
@@ -997,11 +1307,12 @@ int PVRClientMythTV::GetDeletedRecordingsAmount()
   if (g_bExtraDebug)
     XBMC->Log(LOG_DEBUG, "%s", __FUNCTION__);
 
+  m_recordingsLoading->Wait();
   if (m_deletedRecAmountChange)
   {
     int res = 0;
-    Myth::OS::CLockGuard lock(*m_recordingsLock);
-    for (ProgramInfoMap::iterator it = m_recordings.begin(); it != m_recordings.end(); ++it)
+    ProgramInfoMapPtr recordings = GetRecordingsData();
+    for (ProgramInfoMap::const_iterator it = recordings->begin(); it != recordings->end(); ++it)
     {
       if (!it->second.IsNull() && it->second.IsDeleted() && (g_bLiveTVRecordings || !it->second.IsLiveTV()))
         res++;
@@ -1020,10 +1331,12 @@ PVR_ERROR PVRClientMythTV::GetDeletedRecordings(ADDON_HANDLE handle)
   if (g_bExtraDebug)
     XBMC->Log(LOG_DEBUG, "%s", __FUNCTION__);
 
-  Myth::OS::CLockGuard lock(*m_recordingsLock);
+  m_recordingsLoading->Wait();
+  WaitChannels();
+  ProgramInfoMapPtr recordings = GetRecordingsData();
 
   // Transfer to PVR
-  for (ProgramInfoMap::iterator it = m_recordings.begin(); it != m_recordings.end(); ++it)
+  for (ProgramInfoMap::const_iterator it = recordings->begin(); it != recordings->end(); ++it)
   {
     if (!it->second.IsNull() && it->second.IsDeleted() && (g_bLiveTVRecordings || !it->second.IsLiveTV()))
     {
@@ -1109,14 +1422,38 @@ PVR_ERROR PVRClientMythTV::GetDeletedRecordings(ADDON_HANDLE handle)
   return PVR_ERROR_NO_ERROR;
 }
 
-void PVRClientMythTV::ForceUpdateRecording(ProgramInfoMap::iterator it)
+void PVRClientMythTV::PublishRecordings(ProgramInfoMap *recordings)
+{
+  // Setup the lazy fields now, as readers will share the items
+  for (ProgramInfoMap::const_iterator it = recordings->begin(); it != recordings->end(); ++it)
+  {
+    it->second.IsVisible();
+    it->second.GroupingTitle();
+  }
+  std::atomic_store(&m_recordings, ProgramInfoMapPtr(recordings));
+}
+
+bool PVRClientMythTV::FindRecording(const std::string& uid, MythProgramInfo& programInfo) const
+{
+  ProgramInfoMapPtr recordings = GetRecordingsData();
+  ProgramInfoMap::const_iterator it = recordings->find(uid);
+  if (it == recordings->end())
+    return false;
+  programInfo = it->second;
+  return true;
+}
+
+void PVRClientMythTV::ForceUpdateRecording(const std::string& uid)
 {
   if (!m_control)
     return;
   if (g_bExtraDebug)
     XBMC->Log(LOG_DEBUG, "%s", __FUNCTION__);
 
-  if (!it->second.IsNull())
+  Myth::OS::CLockGuard lock(*m_recordingsLock);
+  ProgramInfoMapPtr recordings = GetRecordingsData();
+  ProgramInfoMap::const_iterator it = recordings->find(uid);
+  if (it != recordings->end() && !it->second.IsNull())
   {
     MythProgramInfo prog(m_control->GetRecorded(it->second.ChannelID(), it->second.RecordingStartTime()));
     if (!prog.IsNull())
@@ -1124,7 +1461,9 @@ void PVRClientMythTV::ForceUpdateRecording(ProgramInfoMap::iterator it)
       // Copy props
       prog.CopyProps(it->second);
       // Update recording
-      it->second = prog;
+      ProgramInfoMap *update = new ProgramInfoMap(*recordings);
+      (*update)[uid] = prog;
+      PublishRecordings(update);
       ++m_recordingChangePinCount;
 
       if (g_bExtraDebug)
@@ -1133,6 +1472,36 @@ void PVRClientMythTV::ForceUpdateRecording(ProgramInfoMap::iterator it)
   }
 }
 
+class PrefetchBookmarksTask : public Task
+{
+public:
+  PrefetchBookmarksTask(PVRClientMythTV* pvr)
+  : Task()
+  , m_pvr(pvr) { }
+
+  virtual void Execute()
+  {
+    m_pvr->PrefetchBookmarks();
+  }
+
+  PVRClientMythTV *m_pvr;
+};
+
+class PrefetchEdlsTask : public Task
+{
+public:
+  PrefetchEdlsTask(PVRClientMythTV* pvr)
+  : Task()
+  , m_pvr(pvr) { }
+
+  virtual void Execute()
+  {
+    m_pvr->PrefetchEdls();
+  }
+
+  PVRClientMythTV *m_pvr;
+};
+
 int PVRClientMythTV::FillRecordings()
 {
   int count = 0;
@@ -1145,18 +1514,25 @@ int PVRClientMythTV::FillRecordings()
     return count;
 
   // Load recordings map
-  m_recordings.clear();
+  Myth::OS::CLockGuard lock(*m_recordingsLock);
+  ProgramInfoMap *recordings = new ProgramInfoMap();
   m_recordingsAmount = 0;
   m_deletedRecAmount = 0;
   Myth::ProgramListPtr programs = m_control->GetRecordedList();
   for (Myth::ProgramList::iterator it = programs->begin(); it != programs->end(); ++it)
   {
     MythProgramInfo prog = MythProgramInfo(*it);
-    m_recordings.insert(std::make_pair(prog.UID(), prog));
+    recordings->insert(std::make_pair(prog.UID(), prog));
     ++count;
   }
+  PublishRecordings(recordings);
   if (count > 0)
     m_recordingsAmountChange = m_deletedRecAmountChange = true; // Need count amounts
+  if (m_todo)
+  {
+    m_todo->ScheduleTask(TASK_PREFETCH_BOOKMARKS, new PrefetchBookmarksTask(this), BOOKMARK_PREFETCH_DELAY);
+    m_todo->ScheduleTask(TASK_PREFETCH_EDLS, new PrefetchEdlsTask(this), EDL_PREFETCH_DELAY);
+  }
   XBMC->Log(LOG_DEBUG, "%s: count %d", __FUNCTION__, count);
   return count;
 }
@@ -1167,15 +1543,13 @@ PVR_ERROR PVRClientMythTV::DeleteRecording(const PVR_RECORDING &recording)
     return PVR_ERROR_SERVER_ERROR;
   XBMC->Log(LOG_DEBUG, "%s", __FUNCTION__);
 
-  Myth::OS::CLockGuard lock(*m_recordingsLock);
-
-  ProgramInfoMap::iterator it = m_recordings.find(recording.strRecordingId);
-  if (it != m_recordings.end())
+  MythProgramInfo prog;
+  if (FindRecording(recording.strRecordingId, prog))
   {
     // Deleting Live recording is prohibited. Otherwise continue
-    if (this->IsMyLiveRecording(it->second))
+    if (this->IsMyLiveRecording(prog))
     {
-      if (it->second.IsLiveTV())
+      if (prog.IsLiveTV())
         return PVR_ERROR_RECORDING_RUNNING;
       // it is kept then ignore it now.
       if (m_liveStream && m_liveStream->KeepLiveRecording(false))
@@ -1183,7 +1557,7 @@ PVR_ERROR PVRClientMythTV::DeleteRecording(const PVR_RECORDING &recording)
       else
         return PVR_ERROR_FAILED;
     }
-    bool ret = m_control->DeleteRecording(*(it->second.GetPtr()));
+    bool ret = m_control->DeleteRecording(*(prog.GetPtr()));
     if (ret)
     {
       XBMC->Log(LOG_DEBUG, "%s: Deleted recording %s", __FUNCTION__, recording.strRecordingId);
@@ -1207,15 +1581,13 @@ PVR_ERROR PVRClientMythTV::DeleteAndForgetRecording(const PVR_RECORDING &recordi
     return PVR_ERROR_SERVER_ERROR;
   XBMC->Log(LOG_DEBUG, "%s", __FUNCTION__);
 
-  Myth::OS::CLockGuard lock(*m_recordingsLock);
-
-  ProgramInfoMap::iterator it = m_recordings.find(recording.strRecordingId);
-  if (it != m_recordings.end())
+  MythProgramInfo prog;
+  if (FindRecording(recording.strRecordingId, prog))
   {
     // Deleting Live recording is prohibited. Otherwise continue
-    if (this->IsMyLiveRecording(it->second))
+    if (this->IsMyLiveRecording(prog))
     {
-      if (it->second.IsLiveTV())
+      if (prog.IsLiveTV())
         return PVR_ERROR_RECORDING_RUNNING;
       // it is kept then ignore it now.
       if (m_liveStream && m_liveStream->KeepLiveRecording(false))
@@ -1223,7 +1595,7 @@ PVR_ERROR PVRClientMythTV::DeleteAndForgetRecording(const PVR_RECORDING &recordi
       else
         return PVR_ERROR_FAILED;
     }
-    bool ret = m_control->DeleteRecording(*(it->second.GetPtr()), false, true);
+    bool ret = m_control->DeleteRecording(*(prog.GetPtr()), false, true);
     if (ret)
     {
       XBMC->Log(LOG_DEBUG, "%s: Deleted and forget recording %s", __FUNCTION__, recording.strRecordingId);
@@ -1264,15 +1636,14 @@ PVR_ERROR PVRClientMythTV::SetRecordingPlayCount(const PVR_RECORDING &recording,
     return PVR_ERROR_SERVER_ERROR;
   XBMC->Log(LOG_DEBUG, "%s", __FUNCTION__);
 
-  Myth::OS::CLockGuard lock(*m_recordingsLock);
-  ProgramInfoMap::iterator it = m_recordings.find(recording.strRecordingId);
-  if (it != m_recordings.end())
+  MythProgramInfo prog;
+  if (FindRecording(recording.strRecordingId, prog))
   {
-    if (m_control->UpdateRecordedWatchedStatus(*(it->second.GetPtr()), (count > 0 ? true : false)))
+    if (m_control->UpdateRecordedWatchedStatus(*(prog.GetPtr()), (count > 0 ? true : false)))
     {
       if (g_bExtraDebug)
         XBMC->Log(LOG_DEBUG, "%s: Set watched state for %s", __FUNCTION__, recording.strRecordingId);
-      ForceUpdateRecording(it);
+      ForceUpdateRecording(recording.strRecordingId);
     }
     else
     {
@@ -1280,7 +1651,7 @@ PVR_ERROR PVRClientMythTV::SetRecordingPlayCount(const PVR_RECORDING &recording,
     }
     if (g_bPromptDeleteAtEnd)
     {
-      m_todo->ScheduleTask(new PromptDeleteRecordingTask(this, it->second), 1000);
+      m_todo->ScheduleTask(new PromptDeleteRecordingTask(this, prog), 1000);
     }
     return PVR_ERROR_NO_ERROR;
   }
@@ -1291,32 +1662,39 @@ PVR_ERROR PVRClientMythTV::SetRecordingPlayCount(const PVR_RECORDING &recording,
   }
 }
 
-PVRClientMythTV::cachedBookmark_t PVRClientMythTV::_cachedBookmark = { 0, 0, 0 };
+class FlushBookmarksTask : public Task
+{
+public:
+  FlushBookmarksTask(PVRClientMythTV* pvr)
+  : Task()
+  , m_pvr(pvr) { }
+
+  virtual void Execute()
+  {
+    m_pvr->FlushBookmarks();
+  }
+
+  PVRClientMythTV *m_pvr;
+};
 
 PVR_ERROR PVRClientMythTV::SetRecordingLastPlayedPosition(const PVR_RECORDING &recording, int lastplayedposition)
 {
   if (g_bExtraDebug)
     XBMC->Log(LOG_DEBUG, "%s: Setting Bookmark for: %s to %d", __FUNCTION__, recording.strTitle, lastplayedposition);
 
-  Myth::OS::CLockGuard lock(*m_recordingsLock);
-  ProgramInfoMap::iterator it = m_recordings.find(recording.strRecordingId);
-  if (it != m_recordings.end())
+  MythProgramInfo programInfo;
+  if (FindRecording(recording.strRecordingId, programInfo))
   {
-    Myth::ProgramPtr prog(it->second.GetPtr());
-    lock.Unlock();
-    if (prog)
     {
-      long long duration = (long long)lastplayedposition * 1000;
-      // Write the bookmark
-      if (m_control->SetSavedBookmark(*prog, 2, duration))
-      {
-        _cachedBookmark = { recording.iChannelUid, recording.recordingTime, lastplayedposition };
-        if (g_bExtraDebug)
-          XBMC->Log(LOG_DEBUG, "%s: Setting Bookmark successful", __FUNCTION__);
-        return PVR_ERROR_NO_ERROR;
-      }
+      Myth::OS::CLockGuard lock(*m_bookmarksLock);
+      m_bookmarks[programInfo.UID()] = lastplayedposition;
+      m_bookmarksToWrite[programInfo.UID()] = lastplayedposition;
     }
-    XBMC->Log(LOG_NOTICE, "%s: Setting Bookmark failed", __FUNCTION__);
+    // Write behind: successive updates are coalesced
+    if (m_todo)
+      m_todo->ScheduleTask(TASK_FLUSH_BOOKMARKS, new FlushBookmarksTask(this), BOOKMARK_FLUSH_DELAY);
+    else
+      FlushBookmarks();
     return PVR_ERROR_NO_ERROR;
   }
   XBMC->Log(LOG_ERROR, "%s: Recording %s does not exist", __FUNCTION__, recording.strRecordingId);
@@ -1325,43 +1703,184 @@ PVR_ERROR PVRClientMythTV::SetRecordingLastPlayedPosition(const PVR_RECORDING &r
 
 int PVRClientMythTV::GetRecordingLastPlayedPosition(const PVR_RECORDING &recording)
 {
-  if (recording.iChannelUid == _cachedBookmark.channelUid && recording.recordingTime == _cachedBookmark.recordingTime)
   {
-    XBMC->Log(LOG_DEBUG, "%s: Returning cached Bookmark for: %s", __FUNCTION__, recording.strTitle);
-    return _cachedBookmark.position;
+    Myth::OS::CLockGuard lock(*m_bookmarksLock);
+    BookmarkMap::const_iterator it = m_bookmarks.find(recording.strRecordingId);
+    if (it != m_bookmarks.end())
+    {
+      if (g_bExtraDebug)
+        XBMC->Log(LOG_DEBUG, "%s: Returning cached Bookmark for: %s", __FUNCTION__, recording.strTitle);
+      return it->second;
+    }
   }
 
   if (g_bExtraDebug)
     XBMC->Log(LOG_DEBUG, "%s: Reading Bookmark for: %s", __FUNCTION__, recording.strTitle);
 
-  Myth::OS::CLockGuard lock(*m_recordingsLock);
-  ProgramInfoMap::iterator it = m_recordings.find(recording.strRecordingId);
-  if (it != m_recordings.end())
+  MythProgramInfo programInfo;
+  if (FindRecording(recording.strRecordingId, programInfo))
   {
-    if (it->second.HasBookmark())
+    int position = ReadBookmark(programInfo.UID());
+    if (g_bExtraDebug)
     {
-      Myth::ProgramPtr prog(it->second.GetPtr());
-      lock.Unlock();
-      if (prog)
+      if (position > 0)
+        XBMC->Log(LOG_DEBUG, "%s: %d", __FUNCTION__, position);
+      else
+        XBMC->Log(LOG_DEBUG, "%s: Recording %s has no bookmark", __FUNCTION__, recording.strTitle);
+    }
+    return position;
+  }
+  XBMC->Log(LOG_ERROR, "%s: Recording %s does not exist", __FUNCTION__, recording.strRecordingId);
+  return 0;
+}
+
+int PVRClientMythTV::ReadBookmark(const std::string& uid)
+{
+  // The generation is taken before the recording, so a recording updated
+  // meanwhile is seen by the invalidation
+  unsigned generation;
+  {
+    Myth::OS::CLockGuard lock(*m_bookmarksLock);
+    BookmarkMap::const_iterator it = m_bookmarks.find(uid);
+    if (it != m_bookmarks.end())
+      return it->second;
+    generation = m_bookmarksGeneration;
+  }
+  int position = 0;
+  MythProgramInfo programInfo;
+  if (FindRecording(uid, programInfo) && programInfo.HasBookmark())
+  {
+    Myth::ProgramPtr prog(programInfo.GetPtr());
+    if (prog)
+    {
+      int64_t duration = m_control->GetSavedBookmark(*prog, 2); // returns 0 if no bookmark was found
+      if (duration > 0)
+        position = (int)(duration / 1000);
+    }
+  }
+  Myth::OS::CLockGuard lock(*m_bookmarksLock);
+  // A position set meanwhile wins over the one read
+  BookmarkMap::const_iterator it = m_bookmarks.find(uid);
+  if (it != m_bookmarks.end())
+    return it->second;
+  // Invalidated meanwhile: the value read could be stale
+  if (generation == m_bookmarksGeneration)
+    m_bookmarks.insert(std::make_pair(uid, position));
+  return position;
+}
+
+void PVRClientMythTV::InvalidateBookmark(const std::string& uid)
+{
+  Myth::OS::CLockGuard lock(*m_bookmarksLock);
+  ++m_bookmarksGeneration;
+  if (m_bookmarksToWrite.find(uid) == m_bookmarksToWrite.end())
+    m_bookmarks.erase(uid);
+}
+
+void PVRClientMythTV::InvalidateBookmarks()
+{
+  Myth::OS::CLockGuard lock(*m_bookmarksLock);
+  ++m_bookmarksGeneration;
+  // Keep the positions still to write
+  m_bookmarks = m_bookmarksToWrite;
+}
+
+bool PVRClientMythTV::PrefetchBookmarks()
+{
+  if (!m_control)
+    return false;
+  // The backend has no bulk request for bookmarks: the list tells which
+  // recordings have one, and those are read by small batches.
+  std::vector<std::string> batch;
+  bool more = false;
+  {
+    Myth::OS::CLockGuard lock(*m_bookmarksLock);
+    // Under the lock no invalidation can follow the list taken
+    ProgramInfoMapPtr recordings = GetRecordingsData();
+    for (ProgramInfoMap::const_iterator it = recordings->begin(); it != recordings->end(); ++it)
+    {
+      if (it->second.IsNull() || m_bookmarks.find(it->first) != m_bookmarks.end())
+        continue;
+      if (!it->second.HasBookmark())
+        m_bookmarks.insert(std::make_pair(it->first, 0));
+      else if (batch.size() < BOOKMARK_PREFETCH_BATCH)
+        batch.push_back(it->first);
+      else
+        more = true;
+    }
+  }
+  for (std::vector<std::string>::const_iterator it = batch.begin(); it != batch.end(); ++it)
+    ReadBookmark(*it);
+  if (g_bExtraDebug && !batch.empty())
+    XBMC->Log(LOG_DEBUG, "%s: Prefetched %u bookmarks", __FUNCTION__, (unsigned)batch.size());
+  // Let the other tasks run before the next batch
+  if (more && m_todo)
+    m_todo->ScheduleTask(TASK_PREFETCH_BOOKMARKS, new PrefetchBookmarksTask(this), 0);
+  return more;
+}
+
+void PVRClientMythTV::FlushBookmarks()
+{
+  if (!m_control)
+    return;
+  BookmarkMap pending;
+  {
+    Myth::OS::CLockGuard lock(*m_bookmarksLock);
+    pending.swap(m_bookmarksToWrite);
+  }
+  BookmarkMap failed;
+  for (BookmarkMap::const_iterator it = pending.begin(); it != pending.end(); ++it)
+  {
+    MythProgramInfo programInfo;
+    if (!FindRecording(it->first, programInfo) || !programInfo.GetPtr())
+    {
+      XBMC->Log(LOG_NOTICE, "%s: Recording %s does not exist", __FUNCTION__, it->first.c_str());
+      continue;
+    }
+    if (m_control->SetSavedBookmark(*(programInfo.GetPtr()), 2, (int64_t)it->second * 1000))
+    {
+      if (g_bExtraDebug)
+        XBMC->Log(LOG_DEBUG, "%s: Setting Bookmark successful for %s", __FUNCTION__, it->first.c_str());
+      continue;
+    }
+    failed.insert(*it);
+  }
+
+  unsigned delay;
+  {
+    Myth::OS::CLockGuard lock(*m_bookmarksLock);
+    if (failed.empty())
+    {
+      m_bookmarksFlushRetries = 0;
+      return;
+    }
+    bool retry = (m_bookmarksFlushRetries < BOOKMARK_FLUSH_RETRIES);
+    for (BookmarkMap::const_iterator it = failed.begin(); it != failed.end(); ++it)
+    {
+      // A position queued meanwhile supersedes the one that failed
+      if (m_bookmarksToWrite.find(it->first) != m_bookmarksToWrite.end())
+        continue;
+      if (retry)
       {
-        int64_t duration = m_control->GetSavedBookmark(*prog, 2); // returns 0 if no bookmark was found
-        if (duration > 0)
-        {
-          int position = (int)(duration / 1000);
-          _cachedBookmark = { recording.iChannelUid, recording.recordingTime, position };
-          if (g_bExtraDebug)
-            XBMC->Log(LOG_DEBUG, "%s: %d", __FUNCTION__, position);
-          return position;
-        }
+        m_bookmarksToWrite.insert(*it);
+        continue;
       }
+      XBMC->Log(LOG_ERROR, "%s: Setting Bookmark failed for %s", __FUNCTION__, it->first.c_str());
+      // The backend didn't store it, so stop serving it
+      BookmarkMap::iterator bm = m_bookmarks.find(it->first);
+      if (bm != m_bookmarks.end() && bm->second == it->second)
+        m_bookmarks.erase(bm);
     }
-    if (g_bExtraDebug)
-      XBMC->Log(LOG_DEBUG, "%s: Recording %s has no bookmark", __FUNCTION__, recording.strTitle);
+    if (!retry)
+    {
+      m_bookmarksFlushRetries = 0;
+      return;
+    }
+    delay = BOOKMARK_FLUSH_DELAY << m_bookmarksFlushRetries++;
   }
-  else
-    XBMC->Log(LOG_ERROR, "%s: Recording %s does not exist", __FUNCTION__, recording.strRecordingId);
-  _cachedBookmark = { recording.iChannelUid, recording.recordingTime, 0 };
-  return 0;
+  XBMC->Log(LOG_NOTICE, "%s: Setting %u Bookmarks failed, retrying in %u ms", __FUNCTION__, (unsigned)failed.size(), delay);
+  if (m_todo)
+    m_todo->ScheduleTask(TASK_FLUSH_BOOKMARKS, new FlushBookmarksTask(this), delay);
 }
 
 PVR_ERROR PVRClientMythTV::GetRecordingEdl(const PVR_RECORDING &recording, PVR_EDL_ENTRY entries[], int *size)
@@ -1371,21 +1890,104 @@ PVR_ERROR PVRClientMythTV::GetRecordingEdl(const PVR_RECORDING &recording, PVR_E
   *size = 0;
   if (g_iEnableEDL == ENABLE_EDL_NEVER)
     return PVR_ERROR_NO_ERROR;
+
   if (g_bExtraDebug)
     XBMC->Log(LOG_DEBUG, "%s: Reading edl for: %s", __FUNCTION__, recording.strTitle);
   // Check recording
   MythProgramInfo prog;
+  if (!FindRecording(recording.strRecordingId, prog))
   {
-    Myth::OS::CLockGuard lock(*m_recordingsLock);
-    ProgramInfoMap::iterator it = m_recordings.find(recording.strRecordingId);
-    if (it == m_recordings.end())
+    XBMC->Log(LOG_ERROR, "%s: Recording %s does not exist", __FUNCTION__, recording.strRecordingId);
+    return PVR_ERROR_INVALID_PARAMETERS;
+  }
+  // From the cache, else joining the prefetch started at the stream opening
+  EdlList edl;
+  if (!ReadEdl(prog.UID(), edl))
+    return PVR_ERROR_NO_ERROR;
+
+  // Open dialog
+  if (g_iEnableEDL == ENABLE_EDL_DIALOG && !edl.empty())
+  {
+    bool canceled = false;
+    if (!GUI->Dialog_YesNo_ShowAndGetInput(XBMC->GetLocalizedString(30110), XBMC->GetLocalizedString(30111), canceled) && !canceled)
+      return PVR_ERROR_NO_ERROR;
+  }
+
+  int index = 0;
+  for (EdlList::const_iterator it = edl.begin(); it != edl.end() && index < PVR_ADDON_EDL_LENGTH; ++it)
+  {
+    PVR_EDL_ENTRY entry = *it;
+    // Use scene marker instead commercial break
+    if (g_iEnableEDL == ENABLE_EDL_SCENE && entry.type == PVR_EDL_TYPE_COMBREAK)
     {
-      XBMC->Log(LOG_ERROR, "%s: Recording %s does not exist", __FUNCTION__, recording.strRecordingId);
-      return PVR_ERROR_INVALID_PARAMETERS;
+      entry.start = entry.end;
+      entry.type = PVR_EDL_TYPE_SCENE;
     }
-    prog = it->second;
+    entries[index++] = entry;
   }
+  *size = index;
+  return PVR_ERROR_NO_ERROR;
+}
 
+bool PVRClientMythTV::ReadEdl(const std::string& uid, EdlList& edl)
+{
+  std::shared_ptr<Myth::OS::CCompletion> reading;
+  {
+    Myth::OS::CLockGuard lock(*m_edlsLock);
+    EdlMap::const_iterator it = m_edls.find(uid);
+    if (it != m_edls.end())
+    {
+      edl = it->second;
+      return true;
+    }
+    EdlReadingMap::const_iterator itr = m_edlsReading.find(uid);
+    if (itr != m_edlsReading.end())
+      reading = itr->second;
+  }
+  // Join the read in progress
+  if (reading)
+  {
+    reading->Wait();
+    reading.reset();
+  }
+  // The generation is taken before the recording, so a recording updated
+  // meanwhile is seen by the invalidation
+  unsigned generation;
+  {
+    Myth::OS::CLockGuard lock(*m_edlsLock);
+    EdlMap::const_iterator it = m_edls.find(uid);
+    if (it != m_edls.end())
+    {
+      edl = it->second;
+      return true;
+    }
+    generation = m_edlsGeneration;
+    if (m_edlsReading.find(uid) == m_edlsReading.end())
+    {
+      reading.reset(new Myth::OS::CCompletion);
+      reading->Add();
+      m_edlsReading.insert(std::make_pair(uid, reading));
+    }
+  }
+  MythProgramInfo prog;
+  bool complete = false;
+  bool ret = FindRecording(uid, prog) && FetchEdl(prog, edl, complete);
+  {
+    Myth::OS::CLockGuard lock(*m_edlsLock);
+    if (reading)
+      m_edlsReading.erase(uid);
+    // Keep a read that has failed, or was invalidated meanwhile, out of
+    // the cache
+    if (ret && complete && generation == m_edlsGeneration)
+      m_edls[uid] = edl;
+  }
+  if (reading)
+    reading->Done();
+  return ret;
+}
+
+bool PVRClientMythTV::FetchEdl(const MythProgramInfo& prog, EdlList& edl, bool& complete)
+{
   // Checking backend capabilities
   int unit = 2; // default unit is duration (ms)
   float rate = 1000.0f;
@@ -1396,14 +1998,15 @@ PVR_ERROR PVRClientMythTV::GetRecordingEdl(const PVR_RECORDING &recording, PVR_E
     rate = prog.GetPropsVideoFrameRate();
     XBMC->Log(LOG_DEBUG, "%s: AV props: Frame Rate = %.3f", __FUNCTION__, rate);
     if (rate <= 0)
-      return PVR_ERROR_NO_ERROR;
+      return false;
   }
 
   Myth::MarkList skpList;
 
   // Search for commbreak list with defined unit
-  Myth::MarkListPtr comList = m_control->GetCommBreakList(*(prog.GetPtr()), unit);
-  XBMC->Log(LOG_DEBUG, "%s: Found %d commercial breaks for: %s", __FUNCTION__, comList->size(), recording.strTitle);
+  bool comRead = false;
+  Myth::MarkListPtr comList = m_control->GetCommBreakList(*(prog.GetPtr()), unit, &comRead);
+  XBMC->Log(LOG_DEBUG, "%s: Found %d commercial breaks for: %s", __FUNCTION__, comList->size(), prog.UID().c_str());
   if (!comList->empty())
   {
     if (comList->front()->markType == Myth::MARK_COMM_END)
@@ -1424,8 +2027,12 @@ PVR_ERROR PVRClientMythTV::GetRecordingEdl(const PVR_RECORDING &recording, PVR_E
   }
 
   // Search for cutting list with defined unit
-  Myth::MarkListPtr cutList = m_control->GetCutList(*(prog.GetPtr()), unit);
-  XBMC->Log(LOG_DEBUG, "%s: Found %d cut list entries for: %s", __FUNCTION__, cutList->size(), recording.strTitle);
+  bool cutRead = false;
+  Myth::MarkListPtr cutList = m_control->GetCutList(*(prog.GetPtr()), unit, &cutRead);
+  XBMC->Log(LOG_DEBUG, "%s: Found %d cut list entries for: %s", __FUNCTION__, cutList->size(), prog.UID().c_str());
+  // An empty list is a valid answer: only a failed request leaves the read
+  // incomplete
+  complete = comRead && cutRead;
   if (!cutList->empty())
   {
     if (cutList->front()->markType == Myth::MARK_CUT_END)
@@ -1445,21 +2052,13 @@ PVR_ERROR PVRClientMythTV::GetRecordingEdl(const PVR_RECORDING &recording, PVR_E
     }
   }
 
-  // Open dialog
-  if (g_iEnableEDL == ENABLE_EDL_DIALOG && !skpList.empty())
-  {
-    bool canceled = false;
-    if (!GUI->Dialog_YesNo_ShowAndGetInput(XBMC->GetLocalizedString(30110), XBMC->GetLocalizedString(30111), canceled) && !canceled)
-      return PVR_ERROR_NO_ERROR;
-  }
-
   // Processing marks
-  int index = 0;
+  edl.clear();
   Myth::MarkList::const_iterator it;
   Myth::MarkPtr startPtr;
   for (it = skpList.begin(); it != skpList.end(); ++it)
   {
-    if (index >= PVR_ADDON_EDL_LENGTH)
+    if (edl.size() >= PVR_ADDON_EDL_LENGTH)
       break;
     switch ((*it)->markType)
     {
@@ -1473,22 +2072,12 @@ PVR_ERROR PVRClientMythTV::GetRecordingEdl(const PVR_RECORDING &recording, PVR_E
           PVR_EDL_ENTRY entry;
           double s = (double)(startPtr->markValue) / rate;
           double e = (double)((*it)->markValue) / rate;
-          // Use scene marker instead commercial break
-          if (g_iEnableEDL == ENABLE_EDL_SCENE)
-          {
-            entry.start = entry.end = (int64_t)(e * 1000.0);
-            entry.type = PVR_EDL_TYPE_SCENE;
-            XBMC->Log(LOG_DEBUG, "%s: SCENE %9.3f", __FUNCTION__, e);
-          }
-          else
-          {
-            entry.start = (int64_t)(s * 1000.0);
-            entry.end = (int64_t)(e * 1000.0);
-            entry.type = PVR_EDL_TYPE_COMBREAK;
+          entry.start = (int64_t)(s * 1000.0);
+          entry.end = (int64_t)(e * 1000.0);
+          entry.type = PVR_EDL_TYPE_COMBREAK;
+          edl.push_back(entry);
+          if (g_bExtraDebug)
             XBMC->Log(LOG_DEBUG, "%s: COMBREAK %9.3f - %9.3f", __FUNCTION__, s, e);
-          }
-          entries[index] = entry;
-          index++;
         }
         startPtr.reset();
         break;
@@ -1501,8 +2090,7 @@ PVR_ERROR PVRClientMythTV::GetRecordingEdl(const PVR_RECORDING &recording, PVR_E
           entry.start = (int64_t)(s * 1000.0);
           entry.end = (int64_t)(e * 1000.0);
           entry.type = PVR_EDL_TYPE_CUT;
-          entries[index] = entry;
-          index++;
+          edl.push_back(entry);
           if (g_bExtraDebug)
             XBMC->Log(LOG_DEBUG, "%s: CUT %9.3f - %9.3f", __FUNCTION__, s, e);
         }
@@ -1513,8 +2101,94 @@ PVR_ERROR PVRClientMythTV::GetRecordingEdl(const PVR_RECORDING &recording, PVR_E
     }
   }
 
-  *size = index;
-  return PVR_ERROR_NO_ERROR;
+  return true;
+}
+
+void PVRClientMythTV::InvalidateEdl(const std::string& uid)
+{
+  Myth::OS::CLockGuard lock(*m_edlsLock);
+  ++m_edlsGeneration;
+  m_edls.erase(uid);
+}
+
+void PVRClientMythTV::InvalidateEdls()
+{
+  Myth::OS::CLockGuard lock(*m_edlsLock);
+  ++m_edlsGeneration;
+  m_edls.clear();
+}
+
+class PrefetchEdlTask : public Task
+{
+public:
+  PrefetchEdlTask(PVRClientMythTV* pvr, const std::string& uid)
+  : Task()
+  , m_pvr(pvr)
+  , m_uid(uid) { }
+
+  virtual void Execute()
+  {
+    m_pvr->PrefetchEdl(m_uid);
+  }
+
+  PVRClientMythTV *m_pvr;
+  std::string m_uid;
+};
+
+void PVRClientMythTV::PrefetchEdl(const std::string& uid)
+{
+  if (!m_control)
+    return;
+  EdlList edl;
+  ReadEdl(uid, edl);
+}
+
+bool PVRClientMythTV::PrefetchEdls()
+{
+  // Without a frame rate the old backends can't give marks in time units:
+  // the rate is known only once the recording is played.
+  if (!m_control || g_iEnableEDL == ENABLE_EDL_NEVER || m_control->CheckService() < 85)
+    return false;
+  // Only the recordings that are commercial flagged or have a cut list are
+  // read; the others are read on demand.
+  std::vector<std::string> batch;
+  bool more = false;
+  {
+    Myth::OS::CLockGuard lock(*m_edlsLock);
+    ProgramInfoMapPtr recordings = GetRecordingsData();
+    for (ProgramInfoMap::const_iterator it = recordings->begin(); it != recordings->end(); ++it)
+    {
+      if (it->second.IsNull() || !(it->second.IsCommFlagged() || it->second.HasCutList()) ||
+              m_edls.find(it->first) != m_edls.end())
+        continue;
+      if (batch.size() < EDL_PREFETCH_BATCH)
+        batch.push_back(it->first);
+      else
+      {
+        more = true;
+        break;
+      }
+    }
+  }
+  EdlList edl;
+  for (std::vector<std::string>::const_iterator it = batch.begin(); it != batch.end(); ++it)
+    ReadEdl(*it, edl);
+  unsigned done = 0;
+  {
+    Myth::OS::CLockGuard lock(*m_edlsLock);
+    for (std::vector<std::string>::const_iterator it = batch.begin(); it != batch.end(); ++it)
+      done += m_edls.count(*it);
+  }
+  if (g_bExtraDebug && !batch.empty())
+    XBMC->Log(LOG_DEBUG, "%s: Prefetched %u edls", __FUNCTION__, done);
+  // The failed reads aren't cached, so they would make the next batch: stop
+  // when nothing could be read
+  if (done == 0)
+    more = false;
+  // Let the other tasks run before the next batch
+  if (more && m_todo)
+    m_todo->ScheduleTask(TASK_PREFETCH_EDLS, new PrefetchEdlsTask(this), 0);
+  return more;
 }
 
 PVR_ERROR PVRClientMythTV::UndeleteRecording(const PVR_RECORDING &recording)
@@ -1523,12 +2197,10 @@ PVR_ERROR PVRClientMythTV::UndeleteRecording(const PVR_RECORDING &recording)
     return PVR_ERROR_SERVER_ERROR;
   XBMC->Log(LOG_DEBUG, "%s", __FUNCTION__);
 
-  Myth::OS::CLockGuard lock(*m_recordingsLock);
-
-  ProgramInfoMap::iterator it = m_recordings.find(recording.strRecordingId);
-  if (it != m_recordings.end())
+  MythProgramInfo prog;
+  if (FindRecording(recording.strRecordingId, prog))
   {
-    bool ret = m_control->UndeleteRecording(*(it->second.GetPtr()));
+    bool ret = m_control->UndeleteRecording(*(prog.GetPtr()));
     if (ret)
     {
       XBMC->Log(LOG_DEBUG, "%s: Undeleted recording %s", __FUNCTION__, recording.strRecordingId);
@@ -1554,9 +2226,9 @@ PVR_ERROR PVRClientMythTV::PurgeDeletedRecordings()
   if (g_bExtraDebug)
     XBMC->Log(LOG_DEBUG, "%s", __FUNCTION__);
 
-  Myth::OS::CLockGuard lock(*m_recordingsLock);
+  ProgramInfoMapPtr recordings = GetRecordingsData();
 
-  for (ProgramInfoMap::iterator it = m_recordings.begin(); it != m_recordings.end(); ++it)
+  for (ProgramInfoMap::const_iterator it = recordings->begin(); it != recordings->end(); ++it)
   {
     if (!it->second.IsNull() && it->second.IsDeleted())
     {
@@ -1600,6 +2272,7 @@ int PVRClientMythTV::GetTimersAmount(void)
   if (g_bExtraDebug)
     XBMC->Log(LOG_DEBUG, "%s", __FUNCTION__);
 
+  m_timersLoading->Wait();
   if (m_scheduleManager)
     return m_scheduleManager->GetUpcomingCount();
   return 0;
@@ -1612,6 +2285,9 @@ PVR_ERROR PVRClientMythTV::GetTimers(ADDON_HANDLE handle)
   if (g_bExtraDebug)
     XBMC->Log(LOG_DEBUG, "%s", __FUNCTION__);
 
+  // The channels are needed to link the timers
+  m_timersLoading->Wait();
+  WaitChannels();
   MythTimerEntryList entries;
   {
     Myth::OS::CLockGuard lock(*m_lock);
@@ -2085,10 +2761,14 @@ bool PVRClientMythTV::OpenLiveStream(const PVR_CHANNEL &channel)
   Myth::OS::CLockGuard lock(*m_lock);
   // First we have to get merged channels for the selected channel
   Myth::ChannelList chanset;
-  for (PVRChannelMap::const_iterator it = m_PVRChannelUidById.begin(); it != m_PVRChannelUidById.end(); ++it)
+  ChannelDataPtr channels = GetChannelData();
+  for (PVRChannelMap::const_iterator it = channels->PVRChannelUidById.begin(); it != channels->PVRChannelUidById.end(); ++it)
   {
     if (it->second == channel.iUniqueId)
-      chanset.push_back(FindChannel(it->first).GetPtr());
+    {
+      ChannelIdMap::const_iterator itm = channels->channelsById.find(it->first);
+      chanset.push_back(itm != channels->channelsById.end() ? itm->second.GetPtr() : Myth::ChannelPtr());
+    }
   }
 
   if (chanset.empty())
@@ -2107,6 +2787,8 @@ bool PVRClientMythTV::OpenLiveStream(const PVR_CHANNEL &channel)
   // Try to open
   if (m_liveStream->SpawnLiveTV(chanset[0]->chanNum, chanset))
   {
+    if (g_bDemuxing)
+      m_demux = new Demux(m_liveStream, true);
     XBMC->Log(LOG_DEBUG, "%s: Done", __FUNCTION__);
     return true;
   }
@@ -2118,6 +2800,8 @@ bool PVRClientMythTV::OpenLiveStream(const PVR_CHANNEL &channel)
     m_dummyStream = new FileStreaming(g_szClientPath + PATH_SEPARATOR_STRING + "resources" + PATH_SEPARATOR_STRING + "channel_unavailable.ts");
   if (m_dummyStream && m_dummyStream->IsValid())
   {
+    if (g_bDemuxing)
+      m_demux = new Demux(m_dummyStream, false);
     return true;
   }
   SAFE_DELETE(m_dummyStream);
@@ -2133,6 +2817,7 @@ void PVRClientMythTV::CloseLiveStream()
   // Begin critical section
   Myth::OS::CLockGuard lock(*m_lock);
   // Destroy my stream
+  SAFE_DELETE(m_demux);
   SAFE_DELETE(m_liveStream);
   SAFE_DELETE(m_dummyStream);
 
@@ -2248,6 +2933,7 @@ PVR_ERROR PVRClientMythTV::SignalStatus(PVR_SIGNAL_STATUS &signalStatus)
 PVR_ERROR PVRClientMythTV::GetStreamTimes(PVR_STREAM_TIMES* pStreamTimes)
 {
   time_t begTs, endTs;
+  double ptsStart = 0;
   {
     Myth::OS::CLockGuard lock(*m_lock);
     if (m_liveStream)
@@ -2266,6 +2952,9 @@ PVR_ERROR PVRClientMythTV::GetStreamTimes(PVR_STREAM_TIMES* pStreamTimes)
       begTs = m_recordingStreamInfo.RecordingStartTime();
       endTs = m_recordingStreamInfo.RecordingEndTime();
       pStreamTimes->startTime = 0; // for recordings, this must be zero
+      // The demuxer of the add-on keeps the PTS of the stream
+      if (m_demux)
+        ptsStart = m_demux->GetStartTime();
     }
     else
     {
@@ -2275,9 +2964,9 @@ PVR_ERROR PVRClientMythTV::GetStreamTimes(PVR_STREAM_TIMES* pStreamTimes)
   time_t now = time(NULL);
   if (now < endTs)
     endTs = now;
-  pStreamTimes->ptsStart = 0; // it is started from 0 by the ffmpeg demuxer
-  pStreamTimes->ptsBegin = 0; // earliest pts player can seek back
-  pStreamTimes->ptsEnd = static_cast<int64_t>(difftime(endTs, begTs)) * DVD_TIME_BASE;
+  pStreamTimes->ptsStart = static_cast<int64_t>(ptsStart); // else it is started from 0 by the ffmpeg demuxer
+  pStreamTimes->ptsBegin = pStreamTimes->ptsStart; // earliest pts player can seek back
+  pStreamTimes->ptsEnd = pStreamTimes->ptsStart + static_cast<int64_t>(difftime(endTs, begTs)) * DVD_TIME_BASE;
   return PVR_ERROR_NO_ERROR;
 }
 
@@ -2297,17 +2986,16 @@ bool PVRClientMythTV::OpenRecordedStream(const PVR_RECORDING &recording)
   }
 
   MythProgramInfo prog;
+  if (!FindRecording(recording.strRecordingId, prog))
   {
-    Myth::OS::CLockGuard lock(*m_recordingsLock);
-    ProgramInfoMap::iterator it = m_recordings.find(recording.strRecordingId);
-    if (it == m_recordings.end())
-    {
-      XBMC->Log(LOG_ERROR, "%s: Recording %s does not exist", __FUNCTION__, recording.strRecordingId);
-      return false;
-    }
-    prog = it->second;
+    XBMC->Log(LOG_ERROR, "%s: Recording %s does not exist", __FUNCTION__, recording.strRecordingId);
+    return false;
   }
 
+  // Read the skip entries while the stream is opening
+  if (m_todo && g_iEnableEDL != ENABLE_EDL_NEVER)
+    m_todo->ScheduleTask(new PrefetchEdlTask(this, prog.UID()));
+
   if (prog.HostName() == m_control->GetServerHostName())
   {
     // Request the stream from our master using the opened event handler.
@@ -2321,6 +3009,8 @@ bool PVRClientMythTV::OpenRecordedStream(const PVR_RECORDING &recording)
         XBMC->Log(LOG_DEBUG, "%s: Done", __FUNCTION__);
       // Fill AV info for later use
       FillRecordingAVInfo(prog, m_recordingStream);
+      if (g_bDemuxing)
+        m_demux = new Demux(m_recordingStream, false, KeyframeIndexPath(prog));
       return true;
     }
   }
@@ -2328,8 +3018,7 @@ bool PVRClientMythTV::OpenRecordedStream(const PVR_RECORDING &recording)
   {
     // MasterBackendOverride setting will guide us to choose best method
     // If checked we will try to connect master failover slave
-    Myth::SettingPtr mbo = m_control->GetSetting("MasterBackendOverride", false);
-    if (mbo && mbo->value == "1")
+    if (MasterBackendOverride())
     {
       XBMC->Log(LOG_INFO, "%s: Option 'MasterBackendOverride' is enabled", __FUNCTION__);
       m_recordingStream = new Myth::RecordingPlayback(*m_eventHandler);
@@ -2340,34 +3029,51 @@ bool PVRClientMythTV::OpenRecordedStream(const PVR_RECORDING &recording)
           XBMC->Log(LOG_DEBUG, "%s: Done", __FUNCTION__);
         // Fill AV info for later use
         FillRecordingAVInfo(prog, m_recordingStream);
+        if (g_bDemuxing)
+          m_demux = new Demux(m_recordingStream, false, KeyframeIndexPath(prog));
         return true;
       }
       SAFE_DELETE(m_recordingStream);
       XBMC->Log(LOG_NOTICE, "%s: Failed to open recorded stream from master backend", __FUNCTION__);
       XBMC->Log(LOG_NOTICE, "%s: You should uncheck option 'MasterBackendOverride' from MythTV setup", __FUNCTION__);
     }
-    // Query backend server IP
-    std::string backend_addr(m_control->GetBackendServerIP6(prog.HostName()));
-    if (backend_addr.empty())
-      backend_addr = m_control->GetBackendServerIP(prog.HostName());
-    if (backend_addr.empty())
-      backend_addr = prog.HostName();
-    // Query backend server port
-    unsigned backend_port(m_control->GetBackendServerPort(prog.HostName()));
-    if (!backend_port)
-      backend_port = (unsigned)g_iProtoPort;
-    // Request the stream from slave host. A dedicated event handler will be opened.
-    XBMC->Log(LOG_INFO, "%s: Connect to remote backend %s:%u", __FUNCTION__, backend_addr.c_str(), backend_port);
-    m_recordingStream = new Myth::RecordingPlayback(backend_addr, backend_port);
-    if (!m_recordingStream->IsOpen())
-      XBMC->QueueNotification(QUEUE_ERROR, XBMC->GetLocalizedString(30302)); // MythTV backend unavailable
-    else if (m_recordingStream->OpenTransfer(prog.GetPtr()))
+    bool opened = false;
+    // Reuse the connection kept from the previous stream on this host
+    if (m_idleSlaveStream && m_idleSlaveHost == prog.HostName())
+    {
+      m_recordingStream = m_idleSlaveStream;
+      m_idleSlaveStream = NULL;
+      opened = m_recordingStream->IsOpen() && m_recordingStream->OpenTransfer(prog.GetPtr());
+      if (opened)
+      {
+        if (g_bExtraDebug)
+          XBMC->Log(LOG_DEBUG, "%s: Reuse connection to remote backend %s", __FUNCTION__, prog.HostName().c_str());
+      }
+      else
+        SAFE_DELETE(m_recordingStream);
+    }
+    if (!opened)
+    {
+      SAFE_DELETE(m_idleSlaveStream);
+      BackendAddress backend = ResolveBackend(prog.HostName());
+      // Request the stream from slave host. A dedicated event handler will be opened.
+      XBMC->Log(LOG_INFO, "%s: Connect to remote backend %s:%u", __FUNCTION__, backend.addr.c_str(), backend.port);
+      m_recordingStream = new Myth::RecordingPlayback(backend.addr, backend.port);
+      if (!m_recordingStream->IsOpen())
+        XBMC->QueueNotification(QUEUE_ERROR, XBMC->GetLocalizedString(30302)); // MythTV backend unavailable
+      else
+        opened = m_recordingStream->OpenTransfer(prog.GetPtr());
+    }
+    if (opened)
     {
       m_recordingStreamInfo = prog;
+      m_recordingStreamHost = prog.HostName();
       if (g_bExtraDebug)
         XBMC->Log(LOG_DEBUG, "%s: Done", __FUNCTION__);
       // Fill AV info for later use
       FillRecordingAVInfo(prog, m_recordingStream);
+      if (g_bDemuxing)
+        m_demux = new Demux(m_recordingStream, false, KeyframeIndexPath(prog));
       return true;
     }
   }
@@ -2377,6 +3083,59 @@ bool PVRClientMythTV::OpenRecordedStream(const PVR_RECORDING &recording)
   return false;
 }
 
+PVRClientMythTV::BackendAddress PVRClientMythTV::ResolveBackend(const std::string& hostname)
+{
+  Myth::OS::CLockGuard lock(*m_backendsLock);
+  BackendAddressMap::const_iterator it = m_backendAddresses.find(hostname);
+  if (it != m_backendAddresses.end())
+    return it->second;
+  lock.Unlock();
+
+  BackendAddress backend;
+  // Query backend server IP
+  backend.addr = m_control->GetBackendServerIP6(hostname);
+  if (backend.addr.empty())
+    backend.addr = m_control->GetBackendServerIP(hostname);
+  // Keep the fallback uncached: the queries could have failed
+  bool found = !backend.addr.empty();
+  if (!found)
+    backend.addr = hostname;
+  // Query backend server port
+  backend.port = m_control->GetBackendServerPort(hostname);
+  if (!backend.port)
+    backend.port = (unsigned)g_iProtoPort;
+  if (found)
+  {
+    lock.Lock();
+    m_backendAddresses[hostname] = backend;
+  }
+  return backend;
+}
+
+bool PVRClientMythTV::MasterBackendOverride()
+{
+  Myth::OS::CLockGuard lock(*m_backendsLock);
+  if (m_masterBackendOverride < 0)
+  {
+    lock.Unlock();
+    Myth::SettingPtr mbo = m_control->GetSetting("MasterBackendOverride", false);
+    if (!mbo)
+      return false;
+    lock.Lock();
+    m_masterBackendOverride = (mbo->value == "1" ? 1 : 0);
+  }
+  return m_masterBackendOverride > 0;
+}
+
+void PVRClientMythTV::ClearBackendAddresses()
+{
+  if (g_bExtraDebug)
+    XBMC->Log(LOG_DEBUG, "%s", __FUNCTION__);
+  Myth::OS::CLockGuard lock(*m_backendsLock);
+  m_backendAddresses.clear();
+  m_masterBackendOverride = -1;
+}
+
 void PVRClientMythTV::CloseRecordedStream()
 {
   if (g_bExtraDebug)
@@ -2386,9 +3145,21 @@ void PVRClientMythTV::CloseRecordedStream()
   Myth::OS::CLockGuard lock(*m_lock);
 
   // Destroy my stream
+  SAFE_DELETE(m_demux);
+  if (m_recordingStream && !m_recordingStreamHost.empty() && m_recordingStream->IsOpen())
+  {
+    // Keep the connection to the slave for the next stream
+    m_recordingStream->CloseTransfer();
+    SAFE_DELETE(m_idleSlaveStream);
+    m_idleSlaveStream = m_recordingStream;
+    m_idleSlaveHost = m_recordingStreamHost;
+    m_idleSlaveTime = time(NULL);
+    m_recordingStream = NULL;
+  }
   SAFE_DELETE(m_recordingStream);
   // Reset my info
   m_recordingStreamInfo = MythProgramInfo();
+  m_recordingStreamHost.clear();
 
   if (g_bExtraDebug)
     XBMC->Log(LOG_DEBUG, "%s: Done", __FUNCTION__);
@@ -2451,6 +3222,49 @@ long long PVRClientMythTV::LengthRecordedStream()
   return retval;
 }
 
+PVR_ERROR PVRClientMythTV::GetStreamProperties(PVR_STREAM_PROPERTIES* pProperties)
+{
+  // Keep unlocked
+  if (!m_demux)
+    return PVR_ERROR_SERVER_ERROR;
+  return (m_demux->GetStreamProperties(pProperties) ? PVR_ERROR_NO_ERROR : PVR_ERROR_SERVER_ERROR);
+}
+
+void PVRClientMythTV::DemuxAbort()
+{
+  if (m_demux)
+    m_demux->Abort();
+}
+
+void PVRClientMythTV::DemuxFlush()
+{
+  if (m_demux)
+    m_demux->Flush();
+}
+
+void PVRClientMythTV::DemuxReset()
+{
+  if (m_demux)
+    m_demux->Reset();
+}
+
+DemuxPacket* PVRClientMythTV::DemuxRead()
+{
+  // Keep unlocked
+  if (m_stopTV)
+  {
+    CloseLiveStream();
+    return NULL;
+  }
+  return (m_demux ? m_demux->Read() : NULL);
+}
+
+bool PVRClientMythTV::SeekTime(double time, bool backwards, double *startpts)
+{
+  // Keep unlocked
+  return (m_demux ? m_demux->SeekTime(time, backwards, startpts) : false);
+}
+
 PVR_ERROR PVRClientMythTV::CallMenuHook(const PVR_MENUHOOK &menuhook, const PVR_MENUHOOK_DATA &item)
 {
   if (!m_control)
@@ -2462,16 +3276,15 @@ PVR_ERROR PVRClientMythTV::CallMenuHook(const PVR_MENUHOOK &menuhook, const PVR_
 
   if (menuhook.iHookId == MENUHOOK_KEEP_RECORDING && item.cat == PVR_MENUHOOK_RECORDING)
   {
-    Myth::OS::CLockGuard lock(*m_recordingsLock);
-    ProgramInfoMap::iterator it = m_recordings.find(item.data.recording.strRecordingId);
-    if (it == m_recordings.end())
+    MythProgramInfo prog;
+    if (!FindRecording(item.data.recording.strRecordingId, prog))
     {
       XBMC->Log(LOG_ERROR,"%s: Recording not found", __FUNCTION__);
       return PVR_ERROR_INVALID_PARAMETERS;
     }
 
     // If recording is current live show then keep it and set live recorder
-    if (IsMyLiveRecording(it->second))
+    if (IsMyLiveRecording(prog))
     {
       Myth::OS::CLockGuard lock(*m_lock);
       if (m_liveStream && m_liveStream->KeepLiveRecording(true))
@@ -2481,10 +3294,10 @@ PVR_ERROR PVRClientMythTV::CallMenuHook(const PVR_MENUHOOK &menuhook, const PVR_
     // Else keep recording
     else
     {
-      if (m_control->UndeleteRecording(*(it->second.GetPtr())))
+      if (m_control->UndeleteRecording(*(prog.GetPtr())))
       {
         std::string info = XBMC->GetLocalizedString(menuhook.iLocalizedStringId);
-        info.append(": ").append(it->second.Title());
+        info.append(": ").append(prog.Title());
         XBMC->QueueNotification(QUEUE_INFO, info.c_str());
         return PVR_ERROR_NO_ERROR;
       }
@@ -2495,15 +3308,10 @@ PVR_ERROR PVRClientMythTV::CallMenuHook(const PVR_MENUHOOK &menuhook, const PVR_
   if (menuhook.iHookId == MENUHOOK_INFO_RECORDING && item.cat == PVR_MENUHOOK_RECORDING)
   {
     MythProgramInfo pinfo;
+    if (!FindRecording(item.data.recording.strRecordingId, pinfo))
     {
-      Myth::OS::CLockGuard lock(*m_recordingsLock);
-      ProgramInfoMap::iterator it = m_recordings.find(item.data.recording.strRecordingId);
-      if (it == m_recordings.end())
-      {
-        XBMC->Log(LOG_ERROR,"%s: Recording not found", __FUNCTION__);
-        return PVR_ERROR_INVALID_PARAMETERS;
-      }
-      pinfo = it->second;
+      XBMC->Log(LOG_ERROR,"%s: Recording not found", __FUNCTION__);
+      return PVR_ERROR_INVALID_PARAMETERS;
     }
     if (pinfo.IsNull())
       return PVR_ERROR_REJECTED;
@@ -2634,6 +3442,14 @@ PVR_ERROR PVRClientMythTV::CallMenuHook(const PVR_MENUHOOK &menuhook, const PVR_
     }
   }
 
+  if (menuhook.category == PVR_MENUHOOK_SETTING && menuhook.iHookId == MENUHOOK_SHOW_METRICS)
+  {
+    std::string report = Myth::Control::GetMetrics();
+    XBMC->Log(LOG_NOTICE, "%s: metrics\n%s", __FUNCTION__, report.c_str());
+    GUI->Dialog_TextViewer(XBMC->GetLocalizedString(menuhook.iLocalizedStringId), report.c_str());
+    return PVR_ERROR_NO_ERROR;
+  }
+
   if (menuhook.category == PVR_MENUHOOK_EPG && item.cat == PVR_MENUHOOK_EPG)
   {
     time_t attime;
@@ -2749,6 +3565,63 @@ void PVRClientMythTV::FillRecordingAVInfo(MythProgramInfo& programInfo, Myth::St
   }
 }
 
+std::string PVRClientMythTV::KeyframeIndexPath(const MythProgramInfo& programInfo)
+{
+  std::string dirPath = g_szUserPath + KEYFRAME_INDEX_DIRECTORY;
+  if (!XBMC->DirectoryExists(dirPath.c_str()) && !XBMC->CreateDirectory(dirPath.c_str()))
+  {
+    XBMC->Log(LOG_ERROR, "%s: Failed to create directory '%s'", __FUNCTION__, dirPath.c_str());
+    return "";
+  }
+  return dirPath + PATH_SEPARATOR_STRING + programInfo.UID() + ".idx";
+}
+
+void PVRClientMythTV::DeleteKeyframeIndex(const std::string& uid)
+{
+  std::string filePath = g_szUserPath + KEYFRAME_INDEX_DIRECTORY + PATH_SEPARATOR_STRING + uid + ".idx";
+  if (!XBMC->FileExists(filePath.c_str(), false))
+    return;
+  if (XBMC->DeleteFile(filePath.c_str()))
+    XBMC->Log(LOG_DEBUG, "%s: Deleted '%s'", __FUNCTION__, filePath.c_str());
+  else
+    XBMC->Log(LOG_ERROR, "%s: Failed to delete '%s'", __FUNCTION__, filePath.c_str());
+}
+
+void PVRClientMythTV::PruneKeyframeIndexes()
+{
+  ProgramInfoMapPtr recordings = GetRecordingsData();
+  // An empty list could be a failed load: keep everything
+  if (recordings->empty())
+    return;
+  std::string dirPath = g_szUserPath + KEYFRAME_INDEX_DIRECTORY;
+  VFSDirEntry *items = NULL;
+  unsigned int count = 0;
+  if (!XBMC->DirectoryExists(dirPath.c_str()) || !XBMC->GetDirectory(dirPath.c_str(), ".idx", &items, &count))
+    return;
+  unsigned pruned = 0;
+  for (unsigned int i = 0; i < count; ++i)
+  {
+    if (items[i].folder || !items[i].path)
+      continue;
+    // The file name is the UID of the recording
+    std::string fileName(items[i].path);
+    size_t p = fileName.find_last_of("/\\");
+    if (p != std::string::npos)
+      fileName.erase(0, p + 1);
+    if (fileName.size() <= 4 || fileName.compare(fileName.size() - 4, 4, ".idx") != 0)
+      continue;
+    if (recordings->find(fileName.substr(0, fileName.size() - 4)) != recordings->end())
+      continue;
+    if (XBMC->DeleteFile(items[i].path))
+      ++pruned;
+    else
+      XBMC->Log(LOG_ERROR, "%s: Failed to delete '%s'", __FUNCTION__, items[i].path);
+  }
+  XBMC->FreeDirectory(items, count);
+  if (pruned)
+    XBMC->Log(LOG_DEBUG, "%s: Deleted %u stale indexes", __FUNCTION__, pruned);
+}
+
 time_t PVRClientMythTV::GetRecordingTime(time_t airtt, time_t recordingtt)
 {
   if (!g_bUseAirdate || airtt == 0)
@@ -24,6 +24,7 @@
 #include "cppmyth.h"
 #include "artworksmanager.h"
 #include "categories.h"
+#include "channelcache.h"
 
 #include <kodi/xbmc_pvr_types.h>
 #include <mythsharedptr.h>
@@ -36,9 +37,12 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
 
 class FileStreaming;
 class TaskHandler;
+class Demux;
+class DataLoad;
 
 class PVRClientMythTV : public Myth::EventSubscriber
 {
@@ -71,12 +75,17 @@ public:
 
   // Implements EventSubscriber
   void HandleBackendMessage(Myth::EventMessagePtr msg);
+  void RefreshBackendData();
   void HandleChannelChange();
   void HandleScheduleChange();
   void HandleAskRecording(const Myth::EventMessage& msg);
   void HandleRecordingListChange(const Myth::EventMessage& msg);
   void PromptDeleteRecording(const MythProgramInfo &prog);
   void RunHouseKeeping();
+  bool PrefetchBookmarks();
+  void FlushBookmarks();
+  bool PrefetchEdls();
+  void PrefetchEdl(const std::string& uid);
 
   // EPG
   PVR_ERROR GetEPGForChannel(ADDON_HANDLE handle, int iChannelUid, time_t iStart, time_t iEnd);
@@ -129,6 +138,14 @@ public:
   long long SeekRecordedStream(long long iPosition, int iWhence);
   long long LengthRecordedStream();
 
+  // Demuxing
+  PVR_ERROR GetStreamProperties(PVR_STREAM_PROPERTIES* pProperties);
+  void DemuxAbort();
+  void DemuxFlush();
+  void DemuxReset();
+  DemuxPacket* DemuxRead();
+  bool SeekTime(double time, bool backwards, double *startpts);
+
   // Menu hook
   PVR_ERROR CallMenuHook(const PVR_MENUHOOK &menuhook, const PVR_MENUHOOK_DATA &item);
 
@@ -145,7 +162,9 @@ private:
   Myth::LiveTVPlayback *m_liveStream;
   Myth::RecordingPlayback *m_recordingStream;
   MythProgramInfo m_recordingStreamInfo;
+  std::string m_recordingStreamHost;  ///< slave host of the stream, or empty
   FileStreaming *m_dummyStream;
+  Demux *m_demux;
   bool m_hang;
   bool m_powerSaving;
   bool m_stopTV;
@@ -161,12 +180,20 @@ private:
   // Frontend
   TaskHandler *m_todo;
 
+  /**
+   * The channels, the recordings and the timers are loaded concurrently on
+   * the shared pool. A request waits only for the loads it depends on, and
+   * a refresh requested during a load makes it run again.
+   */
+  DataLoad *m_channelsLoading;
+  DataLoad *m_recordingsLoading;
+  DataLoad *m_timersLoading;
+
   // Categories
   Categories m_categories;
 
   // Channels
   typedef std::map<unsigned int, MythChannel> ChannelIdMap;
-  ChannelIdMap m_channelsById;
   struct PVRChannelItem
   {
     unsigned int iUniqueId;
@@ -177,24 +204,52 @@ private:
   };
   typedef std::vector<PVRChannelItem> PVRChannelList;
   typedef std::map<std::string, PVRChannelList> PVRChannelGroupMap;
-  PVRChannelList m_PVRChannels;
-  PVRChannelGroupMap m_PVRChannelGroups;
   typedef std::map<unsigned int, unsigned int> PVRChannelMap;
-  PVRChannelMap m_PVRChannelUidById;
+  struct ChannelData
+  {
+    ChannelIdMap channelsById;
+    PVRChannelList PVRChannels;
+    PVRChannelGroupMap PVRChannelGroups;
+    PVRChannelMap PVRChannelUidById;
+  };
+  /**
+   * Channel data are published as an immutable snapshot. Readers take the
+   * current one without locking, and a refresh builds a new one aside then
+   * swaps it. The lock only serializes the refreshes.
+   */
+  typedef std::shared_ptr<const ChannelData> ChannelDataPtr;
+  ChannelDataPtr m_channels;
   mutable Myth::OS::CMutex *m_channelsLock;
-  int FillChannelsAndChannelGroups();
+  ChannelDataPtr GetChannelData() const { return std::atomic_load(&m_channels); }
+  /**
+   * The channels saved by the last session are served at startup while the
+   * backend ones are loading. The cache holds the backend data the current
+   * snapshot was built from, under m_channelsLock.
+   */
+  ChannelCache m_channelCache;
+  bool m_channelsCached;
+  void LoadChannelCache();
+  void WaitChannels() const;
+  void PublishChannels(const ChannelCache& cache);
+  /// Returns true when the channels have changed
+  bool FillChannelsAndChannelGroups();
   MythChannel FindChannel(uint32_t channelId) const;
   int FindPVRChannelUid(uint32_t channelId) const;
 
   // Recordings
-  ProgramInfoMap m_recordings;
+  /// Snapshot of recordings, replaced on change under m_recordingsLock
+  typedef std::shared_ptr<const ProgramInfoMap> ProgramInfoMapPtr;
+  ProgramInfoMapPtr m_recordings;
   mutable Myth::OS::CMutex *m_recordingsLock;
+  ProgramInfoMapPtr GetRecordingsData() const { return std::atomic_load(&m_recordings); }
+  void PublishRecordings(ProgramInfoMap *recordings);
+  bool FindRecording(const std::string& uid, MythProgramInfo& programInfo) const;
   unsigned m_recordingChangePinCount;
   bool m_recordingsAmountChange;
   int m_recordingsAmount;
   bool m_deletedRecAmountChange;
   int m_deletedRecAmount;
-  void ForceUpdateRecording(ProgramInfoMap::iterator it);
+  void ForceUpdateRecording(const std::string& uid);
   int FillRecordings();
   MythChannel FindRecordingChannel(const MythProgramInfo& programInfo) const;
   bool IsMyLiveRecording(const MythProgramInfo& programInfo);
@@ -217,19 +272,72 @@ private:
    */
   static void FillRecordingAVInfo(MythProgramInfo& programInfo, Myth::Stream *stream);
 
+  /// Get the path of the keyframe index file for a recorded program
+  static std::string KeyframeIndexPath(const MythProgramInfo& programInfo);
+  static void DeleteKeyframeIndex(const std::string& uid);
+  /// Delete the keyframe indexes of the recordings no longer listed
+  void PruneKeyframeIndexes();
+
   /// Get the time that should be reported for this recording
   static time_t GetRecordingTime(time_t airdate, time_t startDate);
 
   /**
-   * @FIXME In some circumstances PVR calls GetRecordingLastPlayedPosition() in loop.
-   * To prevent backend stressing, the previous value is cached and will be returned
-   * next time for the same recording.
+   * Last played positions (s) by recording UID. PVR reads them for many
+   * recordings in a row, so they are cached and prefetched after the list is
+   * loaded. The writes are queued and flushed later by a task, keeping only
+   * the latest position of each recording. A failed write is queued again
+   * and retried with a growing delay; once the retries are exhausted the
+   * position is dropped from the cache too. An invalidation bumps the
+   * generation, so a read started before it isn't cached.
+   */
+  typedef std::map<std::string, int> BookmarkMap;
+  BookmarkMap m_bookmarks;
+  BookmarkMap m_bookmarksToWrite;
+  unsigned m_bookmarksGeneration;
+  unsigned m_bookmarksFlushRetries;
+  mutable Myth::OS::CMutex *m_bookmarksLock;
+  int ReadBookmark(const std::string& uid);
+  void InvalidateBookmark(const std::string& uid);
+  void InvalidateBookmarks();
+
+  /**
+   * Skip entries by recording UID, as read from the comm break and cut lists.
+   * Commercial breaks are kept as PVR_EDL_TYPE_COMBREAK; the scene mode is
+   * applied when returning them. A read in progress is joined by the
+   * others of the same recording, and as for the bookmarks a read started
+   * before an invalidation isn't cached.
    */
-  typedef struct
+  typedef std::vector<PVR_EDL_ENTRY> EdlList;
+  typedef std::map<std::string, EdlList> EdlMap;
+  typedef std::map<std::string, std::shared_ptr<Myth::OS::CCompletion> > EdlReadingMap;
+  EdlMap m_edls;
+  EdlReadingMap m_edlsReading;
+  unsigned m_edlsGeneration;
+  mutable Myth::OS::CMutex *m_edlsLock;
+  bool ReadEdl(const std::string& uid, EdlList& edl);
+  bool FetchEdl(const MythProgramInfo& prog, EdlList& edl, bool& complete);
+  void InvalidateEdl(const std::string& uid);
+  void InvalidateEdls();
+
+  /**
+   * Slave backends: the address of each host is resolved once until the
+   * backend clears its settings cache, and the connection of the last slave
+   * stream is kept open a while to be reused by the next one.
+   */
+  struct BackendAddress
   {
-    int channelUid;
-    time_t recordingTime;
-    int position;
-  } cachedBookmark_t;
-  static cachedBookmark_t _cachedBookmark;
+    std::string addr;
+    unsigned port;
+  };
+  typedef std::map<std::string, BackendAddress> BackendAddressMap;
+  BackendAddressMap m_backendAddresses;
+  int m_masterBackendOverride;
+  mutable Myth::OS::CMutex *m_backendsLock;
+  Myth::RecordingPlayback *m_idleSlaveStream;
+  std::string m_idleSlaveHost;
+  time_t m_idleSlaveTime;
+  time_t m_keyframePruneTime;
+  BackendAddress ResolveBackend(const std::string& hostname);
+  bool MasterBackendOverride();
+  void ClearBackendAddresses();
 };
@@ -26,26 +26,80 @@
 #include "private/os/threads/event.h"
 #include "private/os/threads/thread.h"
 
+#include <vector>
+#include <cassert>
+
+// A handle is the index of the node plus one in the low bits, and the
+// generation of the node above, so a stale handle matches no reused node.
+#define NODE_INDEX_BITS 16
+#define NODE_INDEX_MASK ((1UL << NODE_INDEX_BITS) - 1)
+#define NODE_NONE       ((size_t)-1)
+
+// The scheduling loop blocks for the life of the handler, so it runs on its
+// own thread rather than holding a worker of the shared pool
 class TaskHandlerPrivate : private Myth::OS::CThread
 {
 public:
   TaskHandlerPrivate();
   virtual ~TaskHandlerPrivate();
 
-  void ScheduleTask(Task *task, unsigned delayMs = 0);
+  TaskHandle ScheduleTask(TaskKey key, Task *task, unsigned delayMs = 0);
+  bool CancelTask(TaskHandle handle);
+  bool CancelKeyedTask(TaskKey key);
   void Clear();
   void Suspend();
   bool Resume();
 
 protected:
-    void *Process();
+  void *Process();
 
 private:
-  typedef std::pair<Task*, Myth::OS::CTimeout*> Scheduled;
-  std::queue<Scheduled> m_queue;
-  std::vector<Scheduled> m_delayed;
+  // Pending tasks are kept in a binary min-heap of node indexes, ordered by
+  // due time, then by submission order to keep FIFO for equal deadlines.
+  // The nodes are stored by value and recycled through a free list, so no
+  // allocation is made once the vectors have grown. Each node knows its
+  // place in the heap, so a cancelled one is removed in O(log n).
+  struct Node
+  {
+    Myth::OS::CTimeout due;
+    Task *task;           // NULL while the node is free
+    TaskKey key;
+    unsigned long seq;
+    unsigned long gen;
+    size_t pos;           // place in the heap, else next free node
+  };
+
+  std::vector<Node> m_nodes;
+  std::vector<size_t> m_heap;
+  size_t m_free;
+  size_t m_keys[TASK_KEY_MAX];
+  unsigned long m_seq;
   Myth::OS::CMutex m_mutex;
   Myth::OS::CEvent m_queueContent;
+
+  TaskHandle Handle(size_t index) const
+  {
+    return (m_nodes[index].gen << NODE_INDEX_BITS) | (TaskHandle)(index + 1);
+  }
+  bool Before(size_t a, size_t b) const
+  {
+    const Node& na = m_nodes[a];
+    const Node& nb = m_nodes[b];
+    if (na.due != nb.due)
+      return na.due < nb.due;
+    return na.seq < nb.seq;
+  }
+  void Place(size_t pos, size_t index)
+  {
+    m_heap[pos] = index;
+    m_nodes[index].pos = pos;
+  }
+  size_t Acquire();
+  void Release(size_t index);
+  void Remove(size_t index);
+  void SiftUp(size_t pos);
+  void SiftDown(size_t pos);
+  void Unlink(size_t index);
 };
 
 TaskHandler::TaskHandler()
@@ -58,9 +112,24 @@ TaskHandler::~TaskHandler()
   delete m_p;
 }
 
-void TaskHandler::ScheduleTask(Task* task, unsigned delayMs)
+TaskHandle TaskHandler::ScheduleTask(Task* task, unsigned delayMs)
+{
+  return m_p->ScheduleTask(TASK_KEY_NONE, task, delayMs);
+}
+
+TaskHandle TaskHandler::ScheduleTask(TaskKey key, Task* task, unsigned delayMs)
+{
+  return m_p->ScheduleTask(key, task, delayMs);
+}
+
+bool TaskHandler::CancelTask(TaskHandle handle)
 {
-  m_p->ScheduleTask(task, delayMs);
+  return m_p->CancelTask(handle);
+}
+
+bool TaskHandler::CancelKeyedTask(TaskKey key)
+{
+  return m_p->CancelKeyedTask(key);
 }
 
 void TaskHandler::Clear()
@@ -81,41 +150,173 @@ bool TaskHandler::Resume()
 
 TaskHandlerPrivate::TaskHandlerPrivate()
 : Myth::OS::CThread()
+, m_free(NODE_NONE)
+, m_seq(0)
 {
-  StartThread(false);
+  for (unsigned k = 0; k < TASK_KEY_MAX; ++k)
+    m_keys[k] = NODE_NONE;
+  // wait until running, else a suspend would miss the thread to come
+  StartThread(true);
 }
 
 TaskHandlerPrivate::~TaskHandlerPrivate()
 {
   Clear();
   Suspend();
-  // last chance
-  WaitThread(1000);
+  // the loop must be stopped before destruction
+  StopThread(true);
 }
 
-void TaskHandlerPrivate::ScheduleTask(Task *task, unsigned delayMs)
+TaskHandle TaskHandlerPrivate::ScheduleTask(TaskKey key, Task *task, unsigned delayMs)
 {
+  assert(key < TASK_KEY_MAX);
   Myth::OS::CLockGuard lock(m_mutex);
-  m_queue.push(std::make_pair(task, new Myth::OS::CTimeout(delayMs)));
-  m_queueContent.Signal();
+  if (key != TASK_KEY_NONE && key < TASK_KEY_MAX && m_keys[key] != NODE_NONE)
+  {
+    // coalesce: the pending task with the same key is superseded
+    Remove(m_keys[key]);
+  }
+  size_t index = Acquire();
+  if (index == NODE_NONE)
+  {
+    lock.Unlock();
+    delete task;
+    return TASK_HANDLE_NONE;
+  }
+  Node& node = m_nodes[index];
+  node.due.Set(delayMs);
+  node.task = task;
+  node.key = (key < TASK_KEY_MAX ? key : TASK_KEY_NONE);
+  node.seq = ++m_seq;
+  m_heap.push_back(index);
+  SiftUp(m_heap.size() - 1);
+  if (node.key != TASK_KEY_NONE)
+    m_keys[node.key] = index;
+  // wake up only when the earliest deadline changed
+  if (m_heap.front() == index)
+    m_queueContent.Signal();
+  return Handle(index);
 }
 
-void TaskHandlerPrivate::Clear()
+bool TaskHandlerPrivate::CancelTask(TaskHandle handle)
+{
+  size_t index = (size_t)(handle & NODE_INDEX_MASK) - 1;
+  Myth::OS::CLockGuard lock(m_mutex);
+  if (handle == TASK_HANDLE_NONE || index >= m_nodes.size() ||
+          m_nodes[index].task == NULL || Handle(index) != handle)
+    return false;
+  Remove(index);
+  return true;
+}
+
+bool TaskHandlerPrivate::CancelKeyedTask(TaskKey key)
 {
   Myth::OS::CLockGuard lock(m_mutex);
-  for (std::vector<Scheduled>::const_iterator it = m_delayed.begin(); it != m_delayed.end(); ++it)
+  if (key == TASK_KEY_NONE || key >= TASK_KEY_MAX || m_keys[key] == NODE_NONE)
+    return false;
+  Remove(m_keys[key]);
+  return true;
+}
+
+size_t TaskHandlerPrivate::Acquire()
+{
+  if (m_free != NODE_NONE)
   {
-    delete it->second;
-    delete it->first;
+    size_t index = m_free;
+    m_free = m_nodes[index].pos;
+    return index;
   }
-  m_delayed.clear();
-  while (!m_queue.empty())
+  // the index must fit in the handle
+  if (m_nodes.size() >= NODE_INDEX_MASK)
+    return NODE_NONE;
+  Node node;
+  node.task = NULL;
+  node.key = TASK_KEY_NONE;
+  node.seq = 0;
+  node.gen = 0;
+  node.pos = NODE_NONE;
+  m_nodes.push_back(node);
+  return m_nodes.size() - 1;
+}
+
+void TaskHandlerPrivate::Release(size_t index)
+{
+  Node& node = m_nodes[index];
+  if (node.key != TASK_KEY_NONE)
+    m_keys[node.key] = NODE_NONE;
+  node.task = NULL;
+  node.key = TASK_KEY_NONE;
+  ++node.gen;
+  node.pos = m_free;
+  m_free = index;
+}
+
+void TaskHandlerPrivate::Remove(size_t index)
+{
+  Task *task = m_nodes[index].task;
+  Unlink(index);
+  Release(index);
+  delete task;
+}
+
+void TaskHandlerPrivate::SiftUp(size_t pos)
+{
+  size_t index = m_heap[pos];
+  while (pos > 0)
   {
-    Scheduled& item = m_queue.front();
-    delete item.second;
-    delete item.first;
-    m_queue.pop();
+    size_t parent = (pos - 1) / 2;
+    if (!Before(index, m_heap[parent]))
+      break;
+    Place(pos, m_heap[parent]);
+    pos = parent;
   }
+  Place(pos, index);
+}
+
+void TaskHandlerPrivate::SiftDown(size_t pos)
+{
+  size_t index = m_heap[pos];
+  size_t size = m_heap.size();
+  for (;;)
+  {
+    size_t child = 2 * pos + 1;
+    if (child >= size)
+      break;
+    if (child + 1 < size && Before(m_heap[child + 1], m_heap[child]))
+      ++child;
+    if (!Before(m_heap[child], index))
+      break;
+    Place(pos, m_heap[child]);
+    pos = child;
+  }
+  Place(pos, index);
+}
+
+void TaskHandlerPrivate::Unlink(size_t index)
+{
+  // move the last node into the hole then restore the heap property
+  size_t pos = m_nodes[index].pos;
+  size_t last = m_heap.back();
+  m_heap.pop_back();
+  if (last != index)
+  {
+    Place(pos, last);
+    if (pos > 0 && Before(last, m_heap[(pos - 1) / 2]))
+      SiftUp(pos);
+    else
+      SiftDown(pos);
+  }
+}
+
+void TaskHandlerPrivate::Clear()
+{
+  Myth::OS::CLockGuard lock(m_mutex);
+  for (std::vector<size_t>::const_iterator it = m_heap.begin(); it != m_heap.end(); ++it)
+  {
+    delete m_nodes[*it].task;
+    Release(*it);
+  }
+  m_heap.clear();
 }
 
 void TaskHandlerPrivate::Suspend()
@@ -143,45 +344,30 @@ void *TaskHandlerPrivate::Process()
   Myth::OS::CLockGuard lock(m_mutex);
   while (!IsStopped())
   {
-    Myth::OS::CTimeout later;
     unsigned left = 0;
 
-    // refill all delayed in queue
-    for (std::vector<Scheduled>::const_iterator it = m_delayed.begin(); it != m_delayed.end(); ++it)
-      m_queue.push(*it);
-    m_delayed.clear();
-
-    while (!m_queue.empty() && !IsStopped())
+    // run all due jobs, the earliest first
+    while (!m_heap.empty() && !IsStopped() && (left = m_nodes[m_heap.front()].due.TimeLeft()) == 0)
     {
-      Scheduled& item = m_queue.front();
-      m_queue.pop();
-      // delay the job else process it
-      if ((left = item.second->TimeLeft()) > 0)
-      {
-        m_delayed.push_back(item);
-        lock.Unlock();
-        if (!later.IsSet() || later.TimeLeft() > left)
-          later.Set(left);
-      }
-      else
-      {
-        lock.Unlock();
-        item.first->Execute();
-        delete item.second;
-        delete item.first;
-      }
-
+      size_t index = m_heap.front();
+      Task *task = m_nodes[index].task;
+      Unlink(index);
+      Release(index);
+      lock.Unlock();
+      task->Execute();
+      delete task;
       lock.Lock();
     }
 
     if (IsStopped())
       break;
 
+    bool idle = m_heap.empty();
     lock.Unlock();
 
-    if (!later.IsSet())
+    if (idle)
       m_queueContent.Wait();
-    else if ((left = later.TimeLeft()) > 0)
+    else if (left > 0)
       m_queueContent.Wait(left);
 
     lock.Lock();
@@ -21,9 +21,6 @@
  *
  */
 
-#include <queue>
-#include <vector>
-
 class Task
 {
 public:
@@ -31,6 +28,14 @@ public:
   virtual void Execute() = 0;
 };
 
+typedef unsigned long TaskHandle;
+#define TASK_HANDLE_NONE 0
+
+/// Key of a coalesced task, defined by the caller below TASK_KEY_MAX
+typedef unsigned TaskKey;
+#define TASK_KEY_NONE 0
+#define TASK_KEY_MAX  16
+
 class TaskHandlerPrivate;
 
 class TaskHandler
@@ -39,7 +44,18 @@ public:
   TaskHandler();
   ~TaskHandler();
 
-  void ScheduleTask(Task *task, unsigned delayMs = 0);
+  /**
+   * Schedule the task to run after delayMs. The handler takes ownership of
+   * the task. Returns a handle usable to cancel it while it is pending.
+   */
+  TaskHandle ScheduleTask(Task *task, unsigned delayMs = 0);
+  /**
+   * Schedule a keyed task. Any pending task with the same key is discarded
+   * and replaced, so the key is executed once per burst of calls.
+   */
+  TaskHandle ScheduleTask(TaskKey key, Task *task, unsigned delayMs = 0);
+  bool CancelTask(TaskHandle handle);
+  bool CancelKeyedTask(TaskKey key);
   void Clear();
   void Suspend();
   bool Resume();
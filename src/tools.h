@@ -24,6 +24,8 @@
 #include "private/os/os.h"
 
 #include <math.h>
+#include <string>
+#include <stdint.h>
 
 #ifdef __WINDOWS__
 #include <time.h>
@@ -71,3 +73,27 @@ static inline void timeadd(time_t *time, double diffsec)
   newtm.tm_sec += (int)(diffsec - dh * INTERVAL_HOUR);
   *time = mktime(&newtm);
 }
+
+// Unsigned LEB128: 7 bits per byte, the high bit flags a following byte
+static inline void PutVarint(std::string& buf, uint64_t v)
+{
+  while (v >= 0x80)
+  {
+    buf.push_back(static_cast<char>((v & 0x7f) | 0x80));
+    v >>= 7;
+  }
+  buf.push_back(static_cast<char>(v));
+}
+
+static inline bool GetVarint(const unsigned char*& p, const unsigned char* end, uint64_t& v)
+{
+  v = 0;
+  for (unsigned shift = 0; p < end && shift < 64; shift += 7)
+  {
+    unsigned char c = *p++;
+    v |= static_cast<uint64_t>(c & 0x7f) << shift;
+    if (!(c & 0x80))
+      return true;
+  }
+  return false;
+}
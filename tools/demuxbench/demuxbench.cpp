@@ -0,0 +1,542 @@
+/*
+ *      Copyright (C) 2005-2013 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301 USA
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+/*
+ * Throughput of the demuxer on synthetic streams or on a capture. Each
+ * scenario generates a transport stream in memory, or loads the capture,
+ * then runs the AVContext over it with all its programs the way the demux of
+ * the add-on does, and reports the rates and the heap allocations per packet
+ * of stream.
+ */
+
+#include "tsgenerator.h"
+
+#include <tsDemuxer.h>
+#include <debug.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#define BENCH_DEFAULT_DURATION  60
+#define BENCH_DEFAULT_RUNS      5
+
+static unsigned long long g_allocations = 0;
+
+#if defined(__GLIBC__)
+// Count every allocation of the heap, including the buffers of the streams
+extern "C"
+{
+  void* __libc_malloc(size_t size);
+  void* __libc_calloc(size_t count, size_t size);
+  void* __libc_realloc(void* ptr, size_t size);
+
+  void* malloc(size_t size)
+  {
+    ++g_allocations;
+    return __libc_malloc(size);
+  }
+
+  void* calloc(size_t count, size_t size)
+  {
+    ++g_allocations;
+    return __libc_calloc(count, size);
+  }
+
+  void* realloc(void* ptr, size_t size)
+  {
+    ++g_allocations;
+    return __libc_realloc(ptr, size);
+  }
+}
+#else
+// Only the allocations of objects are counted
+void* operator new(size_t size)
+{
+  ++g_allocations;
+  void* p = malloc(size ? size : 1);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void* operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+  free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+  free(p);
+}
+#endif
+
+namespace
+{
+  struct StreamCounter
+  {
+    bool enabled;
+    const char* codecName;
+    uint16_t channel;
+    uint64_t packets;
+    uint64_t bytes;
+    uint64_t keyframes;
+  };
+
+  /**
+   * Runs an AVContext over the stream in memory as Demux::Process() does
+   */
+  class BenchDemux : public TSDemux::TSDemuxer, public TSDemux::TSBatchHandler
+  {
+  public:
+    // The channel 0 registers all the programs of the PAT
+    explicit BenchDemux(const std::vector<unsigned char>& stream)
+    : m_data(&stream[0])
+    , m_size(stream.size())
+    , m_AVContext(NULL)
+    , m_resyncs(0)
+    , m_errors(0)
+    , m_programChanges(0)
+    {
+      memset(m_counters, 0, sizeof(m_counters));
+      m_AVContext = new TSDemux::AVContext(this, 0, 0);
+    }
+
+    ~BenchDemux()
+    {
+      delete m_AVContext;
+    }
+
+    const unsigned char* ReadAV(uint64_t pos, size_t len)
+    {
+      if (pos > m_size || len > m_size - pos)
+        return NULL;
+      return m_data + pos;
+    }
+
+    bool HandleStreamData(TSDemux::ElementaryStream* es)
+    {
+      TSDemux::STREAM_PKT pkt;
+      while (es->GetStreamPacket(&pkt))
+      {
+        StreamCounter& counter = m_counters[pkt.pid & 0x1fff];
+        ++counter.packets;
+        counter.bytes += pkt.size;
+        if (pkt.keyframe)
+          ++counter.keyframes;
+        // Touch the data as the copy for the player would do
+        memcpy(m_sink, pkt.data, pkt.size < sizeof(m_sink) ? pkt.size : sizeof(m_sink));
+      }
+      return true;
+    }
+
+    bool HandleProgramChange()
+    {
+      ++m_programChanges;
+      const std::vector<TSDemux::ElementaryStream*> streams = m_AVContext->GetStreams();
+      for (std::vector<TSDemux::ElementaryStream*>::const_iterator it = streams.begin(); it != streams.end(); ++it)
+      {
+        StreamCounter& counter = m_counters[(*it)->pid & 0x1fff];
+        counter.enabled = true;
+        counter.codecName = (*it)->GetStreamCodecName();
+        counter.channel = m_AVContext->GetChannel((*it)->pid);
+        m_AVContext->StartStreaming((*it)->pid);
+      }
+      return true;
+    }
+
+    void Run()
+    {
+      for (;;)
+      {
+        uint64_t pos = m_AVContext->GetPosition();
+        int ret = m_AVContext->TSResync();
+        if (ret != TSDemux::AVCONTEXT_CONTINUE)
+        {
+          // End of stream, or no sync found
+          break;
+        }
+        if (m_AVContext->GetPosition() != pos)
+          ++m_resyncs;
+
+        const unsigned char* data = ReadAV(m_AVContext->GetPosition(), FLUTS_NORMAL_TS_PACKETSIZE);
+        if (!data)
+          break;
+        ret = m_AVContext->ProcessTSBatch(data, m_data + m_size - data, *this);
+        if (ret == TSDemux::AVCONTEXT_TS_NOSYNC)
+          continue;
+        if (ret < 0)
+          ++m_errors;
+        if (ret == TSDemux::AVCONTEXT_TS_ERROR)
+          m_AVContext->Shift();
+        else if (ret < 0)
+          m_AVContext->GoNext();
+      }
+    }
+
+    const StreamCounter& Counter(uint16_t pid) const { return m_counters[pid & 0x1fff]; }
+    unsigned Resyncs() const { return m_resyncs; }
+    unsigned Errors() const { return m_errors; }
+    unsigned ProgramChanges() const { return m_programChanges; }
+
+  private:
+    const unsigned char* m_data;
+    size_t m_size;
+    TSDemux::AVContext* m_AVContext;
+    StreamCounter m_counters[0x2000];
+    unsigned char m_sink[4096];
+    unsigned m_resyncs;
+    unsigned m_errors;
+    unsigned m_programChanges;
+  };
+
+  struct Scenario
+  {
+    std::string name;
+    GeneratorConfig config;
+  };
+
+  uint16_t StreamPid(BENCH_CODEC codec, unsigned index)
+  {
+    return static_cast<uint16_t>(0x0200 + (codec << 4) + index);
+  }
+
+  void AddStream(GeneratorConfig& config, BENCH_CODEC codec)
+  {
+    GeneratorStream stream;
+    stream.codec = codec;
+    stream.pid = StreamPid(codec, static_cast<unsigned>(config.streams.size()));
+    config.streams.push_back(stream);
+  }
+
+  /**
+   * Totals of the timed runs over a stream, by PID
+   */
+  struct Measure
+  {
+    double seconds;
+    unsigned long long allocations;
+    std::vector<StreamCounter> totals;
+    uint64_t packets;
+    unsigned resyncs;
+    unsigned errors;
+    unsigned changes;
+
+    Measure() : seconds(0.0), allocations(0), totals(0x2000), packets(0), resyncs(0), errors(0), changes(0) { }
+
+    void Run(const std::vector<unsigned char>& stream, unsigned runs)
+    {
+      // Warm up the buffers kept by the demuxer
+      {
+        BenchDemux demux(stream);
+        demux.Run();
+      }
+      for (unsigned r = 0; r < runs; ++r)
+      {
+        BenchDemux* demux = new BenchDemux(stream);
+        unsigned long long a0 = g_allocations;
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        demux->Run();
+        std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+        allocations += g_allocations - a0;
+        seconds += std::chrono::duration<double>(t1 - t0).count();
+        for (unsigned pid = 0; pid < 0x2000; ++pid)
+        {
+          const StreamCounter& c = demux->Counter(static_cast<uint16_t>(pid));
+          if (!c.enabled)
+            continue;
+          StreamCounter& t = totals[pid];
+          t.enabled = true;
+          t.codecName = c.codecName;
+          t.channel = c.channel;
+          t.packets += c.packets;
+          t.bytes += c.bytes;
+          t.keyframes += c.keyframes;
+          packets += c.packets;
+        }
+        resyncs = demux->Resyncs();
+        errors = demux->Errors();
+        changes = demux->ProgramChanges();
+        delete demux;
+      }
+      if (seconds <= 0.0)
+        seconds = 1e-9;
+    }
+
+    void PrintSummary(const char* name, unsigned packetSize, size_t size, unsigned runs) const
+    {
+      double mb = (double)size * runs / (1024.0 * 1024.0);
+      char size_[12] = "-";
+      if (packetSize)
+        snprintf(size_, sizeof(size_), "%u", packetSize);
+      printf("%-24s %4s %9.1f MB/s %11.0f pkt/s %8.3f alloc/pkt  (resync %u, error %u, pmt %u)\n",
+              name, size_, mb / seconds, packets / seconds,
+              packets ? (double)allocations / packets : 0.0, resyncs, errors, changes);
+    }
+
+    void PrintStream(uint16_t pid, const char* codecName, unsigned runs) const
+    {
+      const StreamCounter& t = totals[pid];
+      printf("  %.4x %-19s %9.1f MB/s %11.0f pkt/s %10llu pkt %6llu key\n", pid, codecName,
+              t.bytes / (1024.0 * 1024.0) / seconds, t.packets / seconds,
+              (unsigned long long)(t.packets / runs), (unsigned long long)(t.keyframes / runs));
+    }
+  };
+
+  bool RunScenario(const Scenario& scenario, unsigned runs, const char* output)
+  {
+    std::vector<unsigned char> stream;
+    TSGenerator generator(scenario.config);
+    generator.Generate(stream);
+    if (stream.empty())
+      return false;
+
+    if (output)
+    {
+      FILE* file = fopen(output, "wb");
+      if (!file || fwrite(&stream[0], 1, stream.size(), file) != stream.size())
+      {
+        fprintf(stderr, "failed to write '%s'\n", output);
+        if (file)
+          fclose(file);
+        return false;
+      }
+      fclose(file);
+    }
+
+    Measure measure;
+    measure.Run(stream, runs);
+    measure.PrintSummary(scenario.name.c_str(), scenario.config.packetSize, stream.size(), runs);
+    for (std::vector<GeneratorStream>::const_iterator it = scenario.config.streams.begin(); it != scenario.config.streams.end(); ++it)
+      measure.PrintStream(it->pid, TSGenerator::CodecName(it->codec), runs);
+    return true;
+  }
+
+  /**
+   * Demux a capture with all its programs. The file is loaded in memory, so
+   * the disk isn't measured.
+   */
+  bool RunFile(const char* path, unsigned runs)
+  {
+    std::vector<unsigned char> stream;
+    FILE* file = fopen(path, "rb");
+    if (!file)
+    {
+      fprintf(stderr, "failed to open '%s'\n", path);
+      return false;
+    }
+    unsigned char buf[0x10000];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), file)) > 0)
+      stream.insert(stream.end(), buf, buf + n);
+    bool failed = (ferror(file) != 0);
+    fclose(file);
+    if (failed || stream.empty())
+    {
+      fprintf(stderr, "failed to read '%s'\n", path);
+      return false;
+    }
+
+    Measure measure;
+    measure.Run(stream, runs);
+    // The packet size of a capture is found by the demuxer only
+    measure.PrintSummary(path, 0, stream.size(), runs);
+    // The streams found, by program
+    std::vector<uint16_t> channels;
+    for (unsigned pid = 0; pid < 0x2000; ++pid)
+    {
+      const StreamCounter& t = measure.totals[pid];
+      if (t.enabled && std::find(channels.begin(), channels.end(), t.channel) == channels.end())
+        channels.push_back(t.channel);
+    }
+    std::sort(channels.begin(), channels.end());
+    for (std::vector<uint16_t>::const_iterator ch = channels.begin(); ch != channels.end(); ++ch)
+    {
+      printf(" program %u\n", *ch);
+      for (unsigned pid = 0; pid < 0x2000; ++pid)
+      {
+        const StreamCounter& t = measure.totals[pid];
+        if (t.enabled && t.channel == *ch)
+          measure.PrintStream(static_cast<uint16_t>(pid), t.codecName, runs);
+      }
+    }
+    return true;
+  }
+
+  void Usage(const char* name)
+  {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -c codec[,codec...]  streams of a custom scenario: mpeg2video, h264, hevc,\n"
+            "                       aac, ac3, mp2, teletext\n"
+            "  -s size              packet size: 188, 192, 204 or 208\n"
+            "  -t seconds           length of the streams (%u)\n"
+            "  -r runs              timed runs per scenario (%u)\n"
+            "  -p pid               PID of the PMT\n"
+            "  -n number            program number\n"
+            "  -i packets           interval of the PAT and PMT\n"
+            "  -j packets           interval of the junk bytes\n"
+            "  -l packets           interval of the lost packets\n"
+            "  -o file              write the stream of the custom scenario\n"
+            "  -f file              demux a capture with all its programs instead\n"
+            "  -v                   debug messages of the demuxer\n"
+            "Without -c or -f, the default suite is run.\n",
+            name, BENCH_DEFAULT_DURATION, BENCH_DEFAULT_RUNS);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  GeneratorConfig config;
+  config.duration = BENCH_DEFAULT_DURATION;
+  unsigned runs = BENCH_DEFAULT_RUNS;
+  const char* output = NULL;
+  const char* input = NULL;
+  std::string codecs;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string opt(argv[i]);
+    if (opt == "-v")
+    {
+      TSDemux::DBGAll();
+      continue;
+    }
+    if (opt.size() != 2 || opt[0] != '-' || i + 1 >= argc)
+    {
+      Usage(argv[0]);
+      return 1;
+    }
+    const char* arg = argv[++i];
+    unsigned value = static_cast<unsigned>(strtoul(arg, NULL, 0));
+    switch (opt[1])
+    {
+    case 'c': codecs = arg; break;
+    case 's': config.packetSize = value; break;
+    case 't': config.duration = value; break;
+    case 'r': runs = value; break;
+    case 'p': config.pmtPid = static_cast<uint16_t>(value & 0x1fff); break;
+    case 'n': config.programNumber = static_cast<uint16_t>(value); break;
+    case 'i': config.psiInterval = value; break;
+    case 'j': config.junkInterval = value; break;
+    case 'l': config.lossInterval = value; break;
+    case 'o': output = arg; break;
+    case 'f': input = arg; break;
+    default:
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  if (config.packetSize != FLUTS_NORMAL_TS_PACKETSIZE && config.packetSize != FLUTS_M2TS_TS_PACKETSIZE &&
+          config.packetSize != FLUTS_DVB_ASI_TS_PACKETSIZE && config.packetSize != FLUTS_ATSC_TS_PACKETSIZE)
+  {
+    fprintf(stderr, "invalid packet size %u\n", config.packetSize);
+    return 1;
+  }
+  if (runs == 0)
+    runs = 1;
+
+  if (input)
+    return RunFile(input, runs) ? 0 : 1;
+
+  std::vector<Scenario> scenarios;
+  if (!codecs.empty())
+  {
+    Scenario s;
+    s.name = codecs;
+    s.config = config;
+    size_t pos = 0;
+    while (pos <= codecs.size())
+    {
+      size_t end = codecs.find(',', pos);
+      if (end == std::string::npos)
+        end = codecs.size();
+      BENCH_CODEC codec;
+      if (!TSGenerator::ParseCodec(codecs.substr(pos, end - pos), codec))
+      {
+        fprintf(stderr, "unknown codec '%s'\n", codecs.substr(pos, end - pos).c_str());
+        return 1;
+      }
+      AddStream(s.config, codec);
+      pos = end + 1;
+    }
+    scenarios.push_back(s);
+  }
+  else
+  {
+    // Each parser alone
+    for (int c = 0; c < BENCH_CODEC_COUNT; ++c)
+    {
+      Scenario s;
+      s.name = TSGenerator::CodecName(static_cast<BENCH_CODEC>(c));
+      s.config = config;
+      AddStream(s.config, static_cast<BENCH_CODEC>(c));
+      scenarios.push_back(s);
+    }
+    // A broadcast program for each packet size
+    static const unsigned sizes[] =
+    {
+      FLUTS_NORMAL_TS_PACKETSIZE, FLUTS_M2TS_TS_PACKETSIZE, FLUTS_DVB_ASI_TS_PACKETSIZE, FLUTS_ATSC_TS_PACKETSIZE
+    };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    {
+      Scenario s;
+      s.name = "h264+aac+ac3+teletext";
+      s.config = config;
+      s.config.packetSize = sizes[i];
+      AddStream(s.config, BENCH_CODEC_H264);
+      AddStream(s.config, BENCH_CODEC_AAC);
+      AddStream(s.config, BENCH_CODEC_AC3);
+      AddStream(s.config, BENCH_CODEC_TELETEXT);
+      scenarios.push_back(s);
+    }
+    // Damaged stream: resync on junk and recover from lost packets
+    Scenario s;
+    s.name = "mpeg2+mp2 damaged";
+    s.config = config;
+    if (!s.config.junkInterval)
+      s.config.junkInterval = 2000;
+    if (!s.config.lossInterval)
+      s.config.lossInterval = 1000;
+    AddStream(s.config, BENCH_CODEC_MPEG2VIDEO);
+    AddStream(s.config, BENCH_CODEC_MPEGAUDIO);
+    scenarios.push_back(s);
+    output = NULL;
+  }
+
+  for (std::vector<Scenario>::const_iterator it = scenarios.begin(); it != scenarios.end(); ++it)
+  {
+    if (!RunScenario(*it, runs, output))
+      return 1;
+  }
+  return 0;
+}
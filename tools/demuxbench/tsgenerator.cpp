@@ -0,0 +1,724 @@
+/*
+ *      Copyright (C) 2005-2013 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301 USA
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "tsgenerator.h"
+
+#include <cstring>
+
+#define TS_PACKET_SIZE        188
+#define TS_PAYLOAD_SIZE       184
+#define FILLER_SIZE           0x10000
+#define PTS_START             90000
+#define VIDEO_GOP_SIZE        12
+
+namespace
+{
+  const char* const g_codecNames[BENCH_CODEC_COUNT] =
+  {
+    "mpeg2video", "h264", "hevc", "aac", "ac3", "mp2", "teletext"
+  };
+
+  /**
+   * Writer of the bit fields of headers, msb first
+   */
+  class BitWriter
+  {
+  public:
+    BitWriter() : m_cache(0), m_bits(0) { }
+
+    void Put(unsigned bits, uint32_t value)
+    {
+      while (bits > 0)
+      {
+        --bits;
+        m_cache = (m_cache << 1) | ((value >> bits) & 1);
+        if (++m_bits == 8)
+        {
+          m_buf.push_back(static_cast<unsigned char>(m_cache));
+          m_cache = m_bits = 0;
+        }
+      }
+    }
+
+    void PutGolombUE(uint32_t value)
+    {
+      unsigned len = 0;
+      for (uint32_t v = value + 1; v > 1; v >>= 1)
+        ++len;
+      Put(len, 0);
+      Put(len + 1, value + 1);
+    }
+
+    /** Put the stop bit then align on byte */
+    void PutTrailingBits()
+    {
+      Put(1, 1);
+      while (m_bits)
+        Put(1, 0);
+    }
+
+    const std::vector<unsigned char>& Data() const { return m_buf; }
+
+  private:
+    std::vector<unsigned char> m_buf;
+    uint32_t m_cache;
+    unsigned m_bits;
+  };
+
+  uint32_t CRC32(const unsigned char* data, size_t len)
+  {
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < len; ++i)
+    {
+      crc ^= static_cast<uint32_t>(data[i]) << 24;
+      for (int b = 0; b < 8; ++b)
+        crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+    }
+    return crc;
+  }
+
+  void PutStartCode(std::vector<unsigned char>& buf, uint8_t code)
+  {
+    static const unsigned char prefix[] = { 0x00, 0x00, 0x01 };
+    buf.insert(buf.end(), prefix, prefix + sizeof(prefix));
+    buf.push_back(code);
+  }
+
+  /** Append a NAL unit, escaping the sequences of the start code prefix */
+  void PutNal(std::vector<unsigned char>& buf, const std::vector<unsigned char>& rbsp, bool longPrefix)
+  {
+    if (longPrefix)
+      buf.push_back(0x00);
+    buf.push_back(0x00);
+    buf.push_back(0x00);
+    buf.push_back(0x01);
+    unsigned zeros = 0;
+    for (std::vector<unsigned char>::const_iterator it = rbsp.begin(); it != rbsp.end(); ++it)
+    {
+      if (zeros >= 2 && *it <= 0x03)
+      {
+        buf.push_back(0x03);
+        zeros = 0;
+      }
+      buf.push_back(*it);
+      zeros = (*it == 0x00 ? zeros + 1 : 0);
+    }
+  }
+
+  void PutTimestamp(std::vector<unsigned char>& buf, uint8_t prefix, uint64_t ts)
+  {
+    buf.push_back(static_cast<unsigned char>((prefix << 4) | ((ts >> 29) & 0x0e) | 0x01));
+    buf.push_back(static_cast<unsigned char>(ts >> 22));
+    buf.push_back(static_cast<unsigned char>(((ts >> 14) & 0xfe) | 0x01));
+    buf.push_back(static_cast<unsigned char>(ts >> 7));
+    buf.push_back(static_cast<unsigned char>(((ts << 1) & 0xfe) | 0x01));
+  }
+
+  void PutLanguage(std::vector<unsigned char>& buf)
+  {
+    static const unsigned char desc[] = { 0x0a, 0x04, 'e', 'n', 'g', 0x00 };
+    buf.insert(buf.end(), desc, desc + sizeof(desc));
+  }
+}
+
+GeneratorConfig::GeneratorConfig()
+: packetSize(TS_PACKET_SIZE)
+, programNumber(1)
+, pmtPid(0x0100)
+, psiInterval(400)
+, junkInterval(0)
+, lossInterval(0)
+, duration(60)
+, seed(1)
+, streams()
+{
+}
+
+TSGenerator::TSGenerator(const GeneratorConfig& config)
+: m_config(config)
+, m_random(config.seed)
+, m_packets(0)
+, m_streamPackets(0)
+, m_lastPsi(0)
+{
+  memset(m_continuity, 0, sizeof(m_continuity));
+  // Bytes of payload: neither null, 0x0b nor 0xff, so the filler can't
+  // emulate a start code prefix or an audio sync word
+  m_filler.reserve(FILLER_SIZE);
+  for (unsigned i = 0; i < FILLER_SIZE; ++i)
+  {
+    unsigned char c = static_cast<unsigned char>(1 + Random() % 254);
+    m_filler.push_back(c == 0x0b ? 0x0c : c);
+  }
+}
+
+const char* TSGenerator::CodecName(BENCH_CODEC codec)
+{
+  return (codec < BENCH_CODEC_COUNT ? g_codecNames[codec] : "unknown");
+}
+
+bool TSGenerator::ParseCodec(const std::string& name, BENCH_CODEC& codec)
+{
+  for (int i = 0; i < BENCH_CODEC_COUNT; ++i)
+  {
+    if (name == g_codecNames[i])
+    {
+      codec = static_cast<BENCH_CODEC>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t TSGenerator::Random()
+{
+  m_random = m_random * 1103515245 + 12345;
+  return m_random >> 8;
+}
+
+void TSGenerator::PutFiller(std::vector<unsigned char>& buf, size_t len)
+{
+  while (len > 0)
+  {
+    size_t pos = Random() % FILLER_SIZE;
+    size_t n = FILLER_SIZE - pos;
+    if (n > len)
+      n = len;
+    buf.insert(buf.end(), m_filler.begin() + pos, m_filler.begin() + pos + n);
+    len -= n;
+  }
+}
+
+void TSGenerator::Generate(std::vector<unsigned char>& out)
+{
+  std::vector<Track> tracks;
+  for (std::vector<GeneratorStream>::const_iterator it = m_config.streams.begin(); it != m_config.streams.end(); ++it)
+  {
+    Track track;
+    track.stream = *it;
+    track.dts = PTS_START;
+    track.frame = 0;
+    tracks.push_back(track);
+  }
+  if (tracks.empty())
+    return;
+
+  const uint64_t end = PTS_START + static_cast<uint64_t>(m_config.duration) * 90000;
+  PutPSI(out);
+  for (;;)
+  {
+    // Mux the access units in decoding order
+    Track* next = &tracks[0];
+    for (std::vector<Track>::iterator it = tracks.begin(); it != tracks.end(); ++it)
+    {
+      if (it->dts < next->dts)
+        next = &(*it);
+    }
+    if (next->dts >= end)
+      break;
+    if (m_packets - m_lastPsi >= m_config.psiInterval)
+      PutPSI(out);
+    BuildAccessUnit(*next);
+    PutPES(out, *next);
+    next->dts += FrameDuration(next->stream.codec);
+    ++next->frame;
+  }
+}
+
+uint64_t TSGenerator::FrameDuration(BENCH_CODEC codec) const
+{
+  switch (codec)
+  {
+  case BENCH_CODEC_AAC:
+    return 90000 * 1024 / 48000;
+  case BENCH_CODEC_AC3:
+    return 90000 * 1536 / 48000;
+  case BENCH_CODEC_MPEGAUDIO:
+    return 90000 * 1152 / 48000;
+  case BENCH_CODEC_TELETEXT:
+    return 7200;
+  default:
+    return 3600; // 25 fps
+  }
+}
+
+void TSGenerator::BuildAccessUnit(Track& track)
+{
+  m_au.clear();
+  switch (track.stream.codec)
+  {
+  case BENCH_CODEC_MPEG2VIDEO:
+    BuildMPEG2Video(track);
+    break;
+  case BENCH_CODEC_H264:
+    BuildH264(track);
+    break;
+  case BENCH_CODEC_HEVC:
+    BuildHEVC(track);
+    break;
+  case BENCH_CODEC_AAC:
+    BuildAAC(track);
+    break;
+  case BENCH_CODEC_AC3:
+    BuildAC3(track);
+    break;
+  case BENCH_CODEC_MPEGAUDIO:
+    BuildMPEGAudio(track);
+    break;
+  case BENCH_CODEC_TELETEXT:
+    BuildTeletext(track);
+    break;
+  default:
+    break;
+  }
+}
+
+void TSGenerator::BuildMPEG2Video(Track& track)
+{
+  unsigned picture = track.frame % VIDEO_GOP_SIZE;
+  bool intra = (picture == 0);
+  if (intra)
+  {
+    // Sequence header: 720x576, 4:3, 25 fps
+    BitWriter seq;
+    seq.Put(12, 720);
+    seq.Put(12, 576);
+    seq.Put(4, 2);
+    seq.Put(4, 3);
+    seq.Put(18, 15000);   // bit rate in 400 bits/s
+    seq.Put(1, 1);
+    seq.Put(10, 112);     // vbv buffer size
+    seq.Put(3, 0);
+    PutStartCode(m_au, 0xb3);
+    m_au.insert(m_au.end(), seq.Data().begin(), seq.Data().end());
+    // GOP header
+    static const unsigned char gop[] = { 0x00, 0x08, 0x00, 0x40 };
+    PutStartCode(m_au, 0xb8);
+    m_au.insert(m_au.end(), gop, gop + sizeof(gop));
+  }
+  BitWriter pic;
+  pic.Put(10, picture);
+  pic.Put(3, intra ? 1 : 2);
+  pic.Put(16, 0xffff);
+  if (!intra)
+    pic.Put(4, 0x7);      // full_pel_forward_vector, forward_f_code
+  pic.PutTrailingBits();
+  PutStartCode(m_au, 0x00);
+  m_au.insert(m_au.end(), pic.Data().begin(), pic.Data().end());
+  // One slice per row of macroblocks
+  size_t size = (intra ? 60000 : 15000);
+  for (unsigned row = 1; row <= 36; ++row)
+  {
+    PutStartCode(m_au, static_cast<uint8_t>(row));
+    PutFiller(m_au, size / 36);
+  }
+}
+
+void TSGenerator::BuildH264(Track& track)
+{
+  unsigned picture = track.frame % VIDEO_GOP_SIZE;
+  bool idr = (picture == 0);
+  // Access unit delimiter
+  std::vector<unsigned char> aud(1, 0x09);
+  aud.push_back(0xf0);
+  PutNal(m_au, aud, true);
+  if (idr)
+  {
+    // SPS: main profile, level 4.0, 1920x1088 progressive
+    BitWriter sps;
+    sps.Put(8, 0x67);
+    sps.Put(8, 77);
+    sps.Put(8, 0x40);
+    sps.Put(8, 40);
+    sps.PutGolombUE(0);   // seq_parameter_set_id
+    sps.PutGolombUE(0);   // log2_max_frame_num - 4
+    sps.PutGolombUE(2);   // pic_order_cnt_type
+    sps.PutGolombUE(1);   // num_ref_frames
+    sps.Put(1, 0);
+    sps.PutGolombUE(119); // width in mbs - 1
+    sps.PutGolombUE(67);  // height in mbs - 1
+    sps.Put(1, 1);        // frame_mbs_only
+    sps.Put(1, 1);        // direct_8x8_inference
+    sps.Put(1, 0);        // frame_cropping
+    sps.Put(1, 0);        // vui_parameters_present
+    sps.PutTrailingBits();
+    PutNal(m_au, sps.Data(), false);
+    BitWriter pps;
+    pps.Put(8, 0x68);
+    pps.PutGolombUE(0);   // pic_parameter_set_id
+    pps.PutGolombUE(0);   // seq_parameter_set_id
+    pps.Put(1, 0);        // entropy_coding_mode
+    pps.Put(1, 0);        // pic_order_present
+    pps.PutGolombUE(0);   // num_slice_groups - 1
+    pps.PutTrailingBits();
+    PutNal(m_au, pps.Data(), false);
+  }
+  BitWriter slice;
+  slice.Put(8, idr ? 0x65 : 0x41);
+  slice.PutGolombUE(0);   // first_mb_in_slice
+  slice.PutGolombUE(idr ? 7 : 5);
+  slice.PutGolombUE(0);   // pic_parameter_set_id
+  slice.Put(4, picture);  // frame_num
+  if (idr)
+    slice.PutGolombUE((track.frame / VIDEO_GOP_SIZE) & 0xff);
+  slice.PutTrailingBits();
+  std::vector<unsigned char> nal(slice.Data());
+  PutFiller(nal, idr ? 80000 : 20000);
+  PutNal(m_au, nal, false);
+}
+
+void TSGenerator::BuildHEVC(Track& track)
+{
+  unsigned picture = track.frame % VIDEO_GOP_SIZE;
+  bool idr = (picture == 0);
+  // Access unit delimiter
+  std::vector<unsigned char> aud;
+  aud.push_back(35 << 1);
+  aud.push_back(0x01);
+  aud.push_back(0x50);
+  PutNal(m_au, aud, true);
+  if (idr)
+  {
+    BitWriter vps;
+    vps.Put(16, (32 << 9) | 1);
+    vps.Put(16, 0x0c01);
+    vps.Put(16, 0xffff);
+    vps.PutTrailingBits();
+    PutNal(m_au, vps.Data(), false);
+    // SPS: main profile, level 4.1, 1920x1080
+    BitWriter sps;
+    sps.Put(16, (33 << 9) | 1);
+    sps.Put(4, 0);        // sps_video_parameter_set_id
+    sps.Put(3, 0);        // sps_max_sub_layers - 1
+    sps.Put(1, 1);        // sps_temporal_id_nesting
+    sps.Put(8, 0x01);     // general_profile_idc
+    sps.Put(32, 0x60000000);
+    sps.Put(4, 0x9);
+    sps.Put(32, 0);
+    sps.Put(11, 0);
+    sps.Put(1, 0);
+    sps.Put(8, 123);      // general_level_idc
+    sps.PutGolombUE(0);   // sps_seq_parameter_set_id
+    sps.PutGolombUE(1);   // chroma_format_idc
+    sps.PutGolombUE(1920);
+    sps.PutGolombUE(1080);
+    sps.Put(1, 0);        // conformance_window
+    sps.PutGolombUE(0);   // bit_depth_luma - 8
+    sps.PutGolombUE(0);   // bit_depth_chroma - 8
+    sps.PutGolombUE(4);   // log2_max_pic_order_cnt_lsb - 4
+    sps.PutTrailingBits();
+    PutNal(m_au, sps.Data(), false);
+    BitWriter pps;
+    pps.Put(16, (34 << 9) | 1);
+    pps.PutGolombUE(0);   // pps_pic_parameter_set_id
+    pps.PutGolombUE(0);   // pps_seq_parameter_set_id
+    pps.Put(1, 0);        // dependent_slice_segments_enabled
+    pps.PutTrailingBits();
+    PutNal(m_au, pps.Data(), false);
+  }
+  BitWriter slice;
+  slice.Put(16, ((idr ? 19 : 1) << 9) | 1);
+  slice.Put(1, 1);        // first_slice_segment_in_pic
+  if (idr)
+    slice.Put(1, 0);      // no_output_of_prior_pics
+  slice.PutGolombUE(0);   // slice_pic_parameter_set_id
+  slice.PutTrailingBits();
+  std::vector<unsigned char> nal(slice.Data());
+  PutFiller(nal, idr ? 60000 : 15000);
+  PutNal(m_au, nal, false);
+}
+
+void TSGenerator::BuildAAC(Track& track)
+{
+  // ADTS, MPEG-4 LC, 48 kHz, stereo, no CRC
+  const unsigned size = 384;
+  m_au.push_back(0xff);
+  m_au.push_back(0xf1);
+  m_au.push_back(0x4c);
+  m_au.push_back(static_cast<unsigned char>(0x80 | (size >> 11)));
+  m_au.push_back(static_cast<unsigned char>(size >> 3));
+  m_au.push_back(static_cast<unsigned char>(((size & 0x07) << 5) | 0x1f));
+  m_au.push_back(0xfc);
+  PutFiller(m_au, size - 7);
+}
+
+void TSGenerator::BuildAC3(Track& track)
+{
+  // 48 kHz, 384 kbps, stereo: 768 words per frame
+  m_au.push_back(0x0b);
+  m_au.push_back(0x77);
+  m_au.push_back(0x5a);   // crc1
+  m_au.push_back(0xa5);
+  m_au.push_back(0x1c);   // fscod, frmsizecod
+  m_au.push_back(0x40);   // bsid 8, bsmod 0
+  m_au.push_back(0x40);   // acmod 2, dsurmod, lfeon
+  PutFiller(m_au, 1536 - 7);
+}
+
+void TSGenerator::BuildMPEGAudio(Track& track)
+{
+  // MPEG-1 layer II, 192 kbps, 48 kHz, stereo: 576 bytes per frame
+  m_au.push_back(0xff);
+  m_au.push_back(0xfd);
+  m_au.push_back(0xa4);
+  m_au.push_back(0x04);
+  PutFiller(m_au, 576 - 4);
+}
+
+void TSGenerator::BuildTeletext(Track& track)
+{
+  // EBU data identifier then data units of 46 bytes
+  m_au.push_back(0x10);
+  for (int i = 0; i < 4; ++i)
+  {
+    m_au.push_back(0x02);
+    m_au.push_back(0x2c);
+    PutFiller(m_au, 44);
+  }
+}
+
+void TSGenerator::PutPSI(std::vector<unsigned char>& out)
+{
+  std::vector<unsigned char> section;
+  // PAT
+  section.push_back(0x00);
+  section.push_back(0xb0);
+  section.push_back(0x00);
+  section.push_back(0x00);  // transport_stream_id
+  section.push_back(0x01);
+  section.push_back(0xc1);  // version 0, current
+  section.push_back(0x00);
+  section.push_back(0x00);
+  section.push_back(static_cast<unsigned char>(m_config.programNumber >> 8));
+  section.push_back(static_cast<unsigned char>(m_config.programNumber));
+  section.push_back(static_cast<unsigned char>(0xe0 | (m_config.pmtPid >> 8)));
+  section.push_back(static_cast<unsigned char>(m_config.pmtPid));
+  PutSection(out, 0x0000, section);
+
+  // PMT
+  section.clear();
+  section.push_back(0x02);
+  section.push_back(0xb0);
+  section.push_back(0x00);
+  section.push_back(static_cast<unsigned char>(m_config.programNumber >> 8));
+  section.push_back(static_cast<unsigned char>(m_config.programNumber));
+  section.push_back(0xc1);
+  section.push_back(0x00);
+  section.push_back(0x00);
+  uint16_t pcrPid = m_config.streams.empty() ? 0x1fff : m_config.streams[0].pid;
+  section.push_back(static_cast<unsigned char>(0xe0 | (pcrPid >> 8)));
+  section.push_back(static_cast<unsigned char>(pcrPid));
+  section.push_back(0xf0);  // program_info_length
+  section.push_back(0x00);
+  for (std::vector<GeneratorStream>::const_iterator it = m_config.streams.begin(); it != m_config.streams.end(); ++it)
+  {
+    std::vector<unsigned char> desc;
+    uint8_t type = 0;
+    switch (it->codec)
+    {
+    case BENCH_CODEC_MPEG2VIDEO:
+      type = 0x02;
+      break;
+    case BENCH_CODEC_H264:
+      type = 0x1b;
+      break;
+    case BENCH_CODEC_HEVC:
+      type = 0x24;
+      break;
+    case BENCH_CODEC_AAC:
+      type = 0x0f;
+      PutLanguage(desc);
+      break;
+    case BENCH_CODEC_AC3:
+      type = 0x06;
+      desc.push_back(0x6a);
+      desc.push_back(0x01);
+      desc.push_back(0x00);
+      PutLanguage(desc);
+      break;
+    case BENCH_CODEC_MPEGAUDIO:
+      type = 0x03;
+      PutLanguage(desc);
+      break;
+    case BENCH_CODEC_TELETEXT:
+    {
+      type = 0x06;
+      static const unsigned char ttx[] = { 0x56, 0x05, 'e', 'n', 'g', 0x09, 0x00 };
+      desc.insert(desc.end(), ttx, ttx + sizeof(ttx));
+      break;
+    }
+    default:
+      continue;
+    }
+    section.push_back(type);
+    section.push_back(static_cast<unsigned char>(0xe0 | (it->pid >> 8)));
+    section.push_back(static_cast<unsigned char>(it->pid));
+    section.push_back(static_cast<unsigned char>(0xf0 | (desc.size() >> 8)));
+    section.push_back(static_cast<unsigned char>(desc.size()));
+    section.insert(section.end(), desc.begin(), desc.end());
+  }
+  PutSection(out, m_config.pmtPid, section);
+  m_lastPsi = m_packets;
+}
+
+void TSGenerator::PutSection(std::vector<unsigned char>& out, uint16_t pid, const std::vector<unsigned char>& section)
+{
+  // Fill the section length then seal with the CRC
+  size_t len = section.size() - 3 + 4;
+  std::vector<unsigned char> buf(1, 0x00); // pointer field
+  buf.push_back(section[0]);
+  buf.push_back(static_cast<unsigned char>(0xb0 | (len >> 8)));
+  buf.push_back(static_cast<unsigned char>(len));
+  buf.insert(buf.end(), section.begin() + 3, section.end());
+  uint32_t crc = CRC32(&buf[1], buf.size() - 1);
+  buf.push_back(static_cast<unsigned char>(crc >> 24));
+  buf.push_back(static_cast<unsigned char>(crc >> 16));
+  buf.push_back(static_cast<unsigned char>(crc >> 8));
+  buf.push_back(static_cast<unsigned char>(crc));
+
+  size_t pos = 0;
+  while (pos < buf.size())
+  {
+    size_t n = buf.size() - pos;
+    if (n > TS_PAYLOAD_SIZE)
+      n = TS_PAYLOAD_SIZE;
+    PutPacket(out, pid, pos == 0, &buf[pos], n, false);
+    pos += n;
+  }
+}
+
+void TSGenerator::PutPES(std::vector<unsigned char>& out, const Track& track)
+{
+  uint8_t streamId;
+  bool video = false;
+  switch (track.stream.codec)
+  {
+  case BENCH_CODEC_MPEG2VIDEO:
+  case BENCH_CODEC_H264:
+  case BENCH_CODEC_HEVC:
+    streamId = 0xe0;
+    video = true;
+    break;
+  case BENCH_CODEC_AAC:
+  case BENCH_CODEC_MPEGAUDIO:
+    streamId = 0xc0;
+    break;
+  default:
+    streamId = 0xbd;
+  }
+
+  m_pes.clear();
+  PutStartCode(m_pes, streamId);
+  m_pes.push_back(0x00); // packet length, set below
+  m_pes.push_back(0x00);
+  m_pes.push_back(0x80);
+  if (video)
+  {
+    // Presented one frame after decoding
+    m_pes.push_back(0xc0);
+    m_pes.push_back(10);
+    PutTimestamp(m_pes, 0x3, track.dts + 3600);
+    PutTimestamp(m_pes, 0x1, track.dts);
+  }
+  else if (track.stream.codec == BENCH_CODEC_TELETEXT)
+  {
+    // The header of teletext is stuffed to 45 bytes
+    m_pes.push_back(0x80);
+    m_pes.push_back(0x24);
+    PutTimestamp(m_pes, 0x2, track.dts);
+    m_pes.insert(m_pes.end(), 0x24 - 5, 0xff);
+  }
+  else
+  {
+    m_pes.push_back(0x80);
+    m_pes.push_back(5);
+    PutTimestamp(m_pes, 0x2, track.dts);
+  }
+  m_pes.insert(m_pes.end(), m_au.begin(), m_au.end());
+  // Unbounded length for large video units
+  size_t len = m_pes.size() - 6;
+  if (!video || len <= 0xffff)
+  {
+    m_pes[4] = static_cast<unsigned char>(len >> 8);
+    m_pes[5] = static_cast<unsigned char>(len);
+  }
+
+  size_t pos = 0;
+  while (pos < m_pes.size())
+  {
+    size_t n = m_pes.size() - pos;
+    if (n > TS_PAYLOAD_SIZE)
+      n = TS_PAYLOAD_SIZE;
+    // Lose some packets but never the first one
+    if (pos > 0 && m_config.lossInterval && (++m_streamPackets % m_config.lossInterval) == 0)
+      m_continuity[track.stream.pid] = (m_continuity[track.stream.pid] + 1) & 0x0f;
+    else
+      PutPacket(out, track.stream.pid, pos == 0, &m_pes[pos], n, true);
+    pos += n;
+  }
+}
+
+void TSGenerator::PutPacket(std::vector<unsigned char>& out, uint16_t pid, bool unitStart,
+        const unsigned char* data, size_t len, bool stuffing)
+{
+  unsigned char* p;
+  size_t start = out.size();
+  out.resize(start + m_config.packetSize, 0xff);
+  p = &out[start];
+  p[0] = 0x47;
+  p[1] = static_cast<unsigned char>((unitStart ? 0x40 : 0x00) | ((pid >> 8) & 0x1f));
+  p[2] = static_cast<unsigned char>(pid);
+  uint8_t cc = m_continuity[pid];
+  m_continuity[pid] = (cc + 1) & 0x0f;
+  p += 4;
+  if (stuffing && len < TS_PAYLOAD_SIZE)
+  {
+    // Adaptation field of stuffing bytes to complete the packet
+    size_t af = TS_PAYLOAD_SIZE - len - 1;
+    out[start + 3] = static_cast<unsigned char>(0x30 | cc);
+    *p++ = static_cast<unsigned char>(af);
+    if (af > 0)
+    {
+      *p = 0x00;
+      p += af;
+    }
+  }
+  else
+    out[start + 3] = static_cast<unsigned char>(0x10 | cc);
+  // PSI is stuffed after the section: the packet is prefilled with 0xff
+  memcpy(p, data, len);
+
+  ++m_packets;
+  if (m_config.junkInterval && (m_packets % m_config.junkInterval) == 0)
+    PutJunk(out);
+}
+
+void TSGenerator::PutJunk(std::vector<unsigned char>& out)
+{
+  // Some bytes which hold no sync byte
+  size_t len = 1 + Random() % (2 * TS_PACKET_SIZE);
+  for (size_t i = 0; i < len; ++i)
+  {
+    unsigned char c = static_cast<unsigned char>(Random());
+    out.push_back(c == 0x47 ? 0x48 : c);
+  }
+}
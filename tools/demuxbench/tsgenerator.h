@@ -0,0 +1,113 @@
+#pragma once
+/*
+ *      Copyright (C) 2005-2013 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301 USA
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum BENCH_CODEC
+{
+  BENCH_CODEC_MPEG2VIDEO = 0,
+  BENCH_CODEC_H264,
+  BENCH_CODEC_HEVC,
+  BENCH_CODEC_AAC,
+  BENCH_CODEC_AC3,
+  BENCH_CODEC_MPEGAUDIO,
+  BENCH_CODEC_TELETEXT,
+  BENCH_CODEC_COUNT
+};
+
+struct GeneratorStream
+{
+  BENCH_CODEC codec;
+  uint16_t pid;
+};
+
+struct GeneratorConfig
+{
+  GeneratorConfig();
+
+  unsigned packetSize;      ///< 188, 192, 204 or 208
+  uint16_t programNumber;
+  uint16_t pmtPid;
+  unsigned psiInterval;     ///< PAT and PMT are repeated every n packets
+  unsigned junkInterval;    ///< junk bytes are inserted every n packets, 0 for none
+  unsigned lossInterval;    ///< a packet of stream is lost every n ones, 0 for none
+  unsigned duration;        ///< length of the stream in seconds
+  unsigned seed;
+  std::vector<GeneratorStream> streams;
+};
+
+/**
+ * Builds a synthetic transport stream of one program, with elementary streams
+ * well formed enough for the parsers of the demuxer: video sequences and
+ * parameter sets, audio frame headers and teletext data units. The payloads
+ * are filler which never emulates a start code or a sync word.
+ */
+class TSGenerator
+{
+public:
+  explicit TSGenerator(const GeneratorConfig& config);
+
+  void Generate(std::vector<unsigned char>& out);
+
+  static const char* CodecName(BENCH_CODEC codec);
+  static bool ParseCodec(const std::string& name, BENCH_CODEC& codec);
+
+private:
+  struct Track
+  {
+    GeneratorStream stream;
+    uint64_t dts;
+    unsigned frame;
+  };
+
+  GeneratorConfig m_config;
+  std::vector<unsigned char> m_filler;
+  std::vector<unsigned char> m_au;
+  std::vector<unsigned char> m_pes;
+  uint8_t m_continuity[0x2000];
+  uint32_t m_random;
+  unsigned m_packets;
+  unsigned m_streamPackets;
+  unsigned m_lastPsi;
+
+  uint32_t Random();
+  void PutFiller(std::vector<unsigned char>& buf, size_t len);
+
+  void BuildAccessUnit(Track& track);
+  void BuildMPEG2Video(Track& track);
+  void BuildH264(Track& track);
+  void BuildHEVC(Track& track);
+  void BuildAAC(Track& track);
+  void BuildAC3(Track& track);
+  void BuildMPEGAudio(Track& track);
+  void BuildTeletext(Track& track);
+  uint64_t FrameDuration(BENCH_CODEC codec) const;
+
+  void PutPSI(std::vector<unsigned char>& out);
+  void PutSection(std::vector<unsigned char>& out, uint16_t pid, const std::vector<unsigned char>& section);
+  void PutPES(std::vector<unsigned char>& out, const Track& track);
+  void PutPacket(std::vector<unsigned char>& out, uint16_t pid, bool unitStart, const unsigned char* data, size_t len, bool stuffing);
+  void PutJunk(std::vector<unsigned char>& out);
+};
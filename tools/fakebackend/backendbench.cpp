@@ -0,0 +1,306 @@
+/*
+ *      Copyright (C) 2014 Jean-Luc Barriere
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301 USA
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+/*
+ * Benchmark of the clients of the library against the fake backend: the
+ * services API, the playback of recordings and the live TV. The backend runs
+ * in the process unless a host is given, and its faults are set by the same
+ * options as the server.
+ */
+
+#include "fakebackend.h"
+
+#include <mythdebug.h>
+#include <mythwsapi.h>
+#include <mythrecordingplayback.h>
+#include <mythlivetvplayback.h>
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#define BENCH_DEFAULT_RUNS        5
+#define BENCH_DEFAULT_RECORDINGS  4
+#define BENCH_DEFAULT_LIVE        5
+#define BENCH_READ_SIZE           0x10000
+
+namespace
+{
+  struct Timing
+  {
+    const char* name;
+    unsigned runs;
+    unsigned failures;
+    size_t items;
+    double min;
+    double max;
+    double total;
+
+    explicit Timing(const char* n) : name(n), runs(0), failures(0), items(0), min(0), max(0), total(0) { }
+
+    void Add(int64_t start, size_t count)
+    {
+      double ms = (Dataset::Now() - start) / 1000.0;
+      if (!count)
+      {
+        ++failures;
+        return;
+      }
+      if (!runs || ms < min)
+        min = ms;
+      if (ms > max)
+        max = ms;
+      total += ms;
+      items = count;
+      ++runs;
+    }
+
+    void Print() const
+    {
+      printf("  %-24s %9.2f %9.2f %9.2f ms %8u items %4u failed\n", name, min,
+              runs ? total / runs : 0.0, max, (unsigned)items, failures);
+    }
+  };
+
+  struct BenchConfig
+  {
+    std::string host;
+    unsigned protoPort;
+    unsigned wsPort;
+    unsigned runs;
+    unsigned recordings;
+    unsigned liveSeconds;
+    time_t guideStart;
+  };
+
+  void BenchServices(const BenchConfig& config)
+  {
+    Timing init("init");
+    Timing channels("GetChannelList");
+    Timing guide("GetProgramGuide");
+    Timing recorded("GetRecordedList");
+
+    for (unsigned i = 0; i < config.runs; ++i)
+    {
+      int64_t start = Dataset::Now();
+      Myth::WSAPI wsapi(config.host, config.wsPort, "0000");
+      init.Add(start, wsapi.CheckService() ? 1 : 0);
+      if (!wsapi.CheckService())
+        continue;
+
+      start = Dataset::Now();
+      Myth::ChannelListPtr chanList = wsapi.GetChannelList(DATASET_SOURCE_ID);
+      channels.Add(start, chanList->size());
+
+      start = Dataset::Now();
+      std::map<uint32_t, Myth::ProgramMapPtr> programs = wsapi.GetProgramGuide(config.guideStart, config.guideStart + 86400);
+      size_t count = 0;
+      for (std::map<uint32_t, Myth::ProgramMapPtr>::const_iterator it = programs.begin(); it != programs.end(); ++it)
+        count += it->second->size();
+      guide.Add(start, count);
+
+      start = Dataset::Now();
+      Myth::ProgramListPtr recList = wsapi.GetRecordedList();
+      recorded.Add(start, recList->size());
+    }
+
+    printf("services API (min avg max over %u runs)\n", config.runs);
+    init.Print();
+    channels.Print();
+    guide.Print();
+    recorded.Print();
+  }
+
+  void BenchRecordings(const BenchConfig& config)
+  {
+    Myth::WSAPI wsapi(config.host, config.wsPort, "0000");
+    Myth::ProgramListPtr recList = wsapi.GetRecordedList(config.recordings, true);
+    Myth::RecordingPlayback playback(config.host, config.protoPort);
+    std::vector<unsigned char> buf(BENCH_READ_SIZE);
+
+    printf("recording playback\n");
+    for (Myth::ProgramList::const_iterator it = recList->begin(); it != recList->end(); ++it)
+    {
+      const Myth::ProgramPtr& program = *it;
+      bool checked = (program->recording.storageGroup != DATASET_SG_LOCAL);
+      int64_t start = Dataset::Now();
+      if (!playback.IsOpen() && !playback.Open())
+      {
+        printf("  %-32s cannot connect\n", program->fileName.c_str());
+        continue;
+      }
+      if (!playback.OpenTransfer(program))
+      {
+        printf("  %-32s cannot open\n", program->fileName.c_str());
+        continue;
+      }
+      double openMs = (Dataset::Now() - start) / 1000.0;
+      int64_t size = playback.GetSize();
+      int64_t total = 0;
+      unsigned errors = 0;
+      start = Dataset::Now();
+      for (;;)
+      {
+        int64_t offset = playback.GetPosition();
+        int r = playback.Read(&buf[0], (unsigned)buf.size());
+        if (r <= 0)
+          break;
+        if (checked && !FileSource::CheckPattern(offset, &buf[0], r))
+          ++errors;
+        total += r;
+      }
+      double seconds = (Dataset::Now() - start) / 1000000.0;
+      printf("  %-32s open %8.2f ms %9.1f MB/s %10lld/%lld bytes %u bad reads\n", program->fileName.c_str(),
+              openMs, seconds > 0 ? total / (1024.0 * 1024.0) / seconds : 0.0, (long long)total,
+              (long long)size, errors);
+      playback.CloseTransfer();
+    }
+  }
+
+  void BenchLiveTV(const BenchConfig& config)
+  {
+    Myth::WSAPI wsapi(config.host, config.wsPort, "0000");
+    Myth::ChannelListPtr chanList = wsapi.GetChannelList(DATASET_SOURCE_ID);
+    if (chanList->empty())
+    {
+      printf("live TV: no channel\n");
+      return;
+    }
+    Myth::LiveTVPlayback playback(config.host, config.protoPort);
+    std::vector<unsigned char> buf(BENCH_READ_SIZE);
+
+    int64_t start = Dataset::Now();
+    if (!playback.SpawnLiveTV(chanList->front()))
+    {
+      printf("live TV: cannot tune channel %s\n", chanList->front()->chanNum.c_str());
+      return;
+    }
+    double tuneMs = (Dataset::Now() - start) / 1000.0;
+    int64_t total = 0;
+    start = Dataset::Now();
+    int64_t end = start + (int64_t)config.liveSeconds * 1000000;
+    while (Dataset::Now() < end)
+    {
+      int r = playback.Read(&buf[0], (unsigned)buf.size());
+      if (r < 0)
+        break;
+      total += r;
+    }
+    double seconds = (Dataset::Now() - start) / 1000000.0;
+    playback.StopLiveTV();
+    printf("live TV\n  channel %-24s tune %8.2f ms %9.1f KB/s %10lld bytes\n", chanList->front()->chanNum.c_str(),
+            tuneMs, seconds > 0 ? total / 1024.0 / seconds : 0.0, (long long)total);
+  }
+
+  void Usage(const char* name)
+  {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -H host              run against this backend, else a fake backend is started\n"
+            "  -n runs              runs of the services API (%u)\n"
+            "  -m number            recordings to read (%u)\n"
+            "  -t seconds           length of the live TV (%u)\n"
+            "  -C directory         capture the connections into the directory\n"
+            "  -P directory         replay the captures of the directory, instead of a backend\n"
+            "  -x percent           pace of the replay, 0 for no delay (100)\n"
+            "  -v                   debug messages of the library\n"
+            "Dataset and fake backend:\n",
+            name, BENCH_DEFAULT_RUNS, BENCH_DEFAULT_RECORDINGS, BENCH_DEFAULT_LIVE);
+    BackendOptionsUsage();
+  }
+}
+
+int main(int argc, char** argv)
+{
+  DatasetConfig datasetConfig;
+  BackendConfig backendConfig;
+  BenchConfig config;
+  config.host = "127.0.0.1";
+  config.runs = BENCH_DEFAULT_RUNS;
+  config.recordings = BENCH_DEFAULT_RECORDINGS;
+  config.liveSeconds = BENCH_DEFAULT_LIVE;
+  bool embedded = true;
+  const char* replay = NULL;
+  unsigned speed = 100;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string opt(argv[i]);
+    if (opt == "-v")
+    {
+      Myth::DBGAll();
+      continue;
+    }
+    if (opt.size() != 2 || opt[0] != '-' || i + 1 >= argc)
+    {
+      Usage(argv[0]);
+      return 1;
+    }
+    const char* arg = argv[++i];
+    unsigned value = static_cast<unsigned>(strtoul(arg, NULL, 0));
+    switch (opt[1])
+    {
+    case 'H': config.host = arg; embedded = false; break;
+    case 'n': config.runs = value; break;
+    case 'm': config.recordings = value; break;
+    case 't': config.liveSeconds = value; break;
+    case 'C': Myth::DBGCapture(arg); break;
+    case 'P': replay = arg; embedded = false; break;
+    case 'x': speed = value; break;
+    default:
+      if (!ParseBackendOption(opt[1], arg, datasetConfig, backendConfig))
+      {
+        Usage(argv[0]);
+        return 1;
+      }
+    }
+  }
+  signal(SIGPIPE, SIG_IGN);
+  if (replay)
+    Myth::DBGReplay(replay, speed);
+
+  // The same seed generates the same dataset as the remote fake backend
+  Dataset dataset(datasetConfig);
+  FakeBackend backend(dataset, backendConfig);
+  if (embedded && !backend.Start())
+    return 1;
+  config.protoPort = backendConfig.protoPort;
+  config.wsPort = backendConfig.wsPort;
+  config.guideStart = dataset.GetGuideStart();
+
+  BenchServices(config);
+  if (config.recordings)
+    BenchRecordings(config);
+  if (config.liveSeconds)
+    BenchLiveTV(config);
+
+  if (embedded)
+  {
+    backend.Stop();
+    BackendStats stats = backend.GetStats();
+    printf("backend: %llu protocol requests, %llu services requests, %.1f MB sent, %llu faults\n",
+            (unsigned long long)stats.protoRequests, (unsigned long long)stats.wsRequests,
+            stats.bytesSent / (1024.0 * 1024.0), (unsigned long long)stats.faults);
+  }
+  return 0;
+}
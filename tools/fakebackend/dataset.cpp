@@ -0,0 +1,466 @@
+/*
+ *      Copyright (C) 2014 Jean-Luc Barriere
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301 USA
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "dataset.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define TS_PACKET_SIZE    188
+
+static const char* const g_words[] =
+{
+  "the", "night", "river", "secret", "of", "city", "last", "summer", "journey", "house",
+  "garden", "storm", "island", "return", "kitchen", "mountain", "story", "family", "world", "game",
+  "ocean", "letter", "train", "winter", "lost", "and", "old", "new", "king", "detective",
+};
+
+static const char* const g_categories[] =
+{
+  "News", "Drama", "Documentary", "Comedy", "Sports", "Movie", "Kids", "Music",
+};
+
+/**
+ * The backend names a recording after its channel and its start time in UTC.
+ */
+static std::string MakeFileName(uint32_t chanId, time_t startTime)
+{
+  struct tm tm;
+  char buf[64];
+  gmtime_r(&startTime, &tm);
+  sprintf(buf, "%u_%04d%02d%02d%02d%02d%02d.ts", (unsigned)chanId, tm.tm_year + 1900, tm.tm_mon + 1,
+          tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+  return buf;
+}
+
+DatasetConfig::DatasetConfig()
+: hostName("fakebackend")
+, channels(50)
+, tuners(4)
+, guideDays(3)
+, slotMinutes(30)
+, recordings(200)
+, recordingSize(64 * 1024 * 1024)
+, liveRate(1000000)
+, seed(1)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+////
+//// Files
+////
+
+void FileSource::FillPattern(int64_t offset, unsigned char* buf, size_t n)
+{
+  uint64_t k = (uint64_t)offset / TS_PACKET_SIZE;
+  unsigned i = (unsigned)((uint64_t)offset % TS_PACKET_SIZE);
+  for (size_t p = 0; p < n; ++p)
+  {
+    switch (i)
+    {
+    case 0: buf[p] = 0x47; break;
+    case 1: buf[p] = 0x1f; break;
+    case 2: buf[p] = 0xff; break;
+    case 3: buf[p] = 0x10 | (unsigned char)(k & 0x0f); break;
+    default: buf[p] = (unsigned char)(k * 7 + i); break;
+    }
+    if (++i == TS_PACKET_SIZE)
+    {
+      i = 0;
+      ++k;
+    }
+  }
+}
+
+bool FileSource::CheckPattern(int64_t offset, const unsigned char* buf, size_t n)
+{
+  unsigned char ref[TS_PACKET_SIZE];
+  while (n > 0)
+  {
+    size_t s = (n > sizeof(ref) ? sizeof(ref) : n);
+    FillPattern(offset, ref, s);
+    if (memcmp(ref, buf, s) != 0)
+      return false;
+    offset += s;
+    buf += s;
+    n -= s;
+  }
+  return true;
+}
+
+size_t PatternFile::Read(int64_t offset, void* buf, size_t n)
+{
+  if (offset >= m_size)
+    return 0;
+  if ((int64_t)n > m_size - offset)
+    n = (size_t)(m_size - offset);
+  FillPattern(offset, static_cast<unsigned char*>(buf), n);
+  return n;
+}
+
+LiveFile::LiveFile(uint64_t rate)
+: m_rate(rate)
+, m_start(Dataset::Now())
+{
+}
+
+int64_t LiveFile::GetSize() const
+{
+  int64_t elapsed = Dataset::Now() - m_start;
+  int64_t size = (int64_t)(m_rate * (uint64_t)elapsed / 1000000);
+  // A recorder writes whole packets
+  return size - size % TS_PACKET_SIZE;
+}
+
+size_t LiveFile::Read(int64_t offset, void* buf, size_t n)
+{
+  int64_t size = GetSize();
+  if (offset >= size)
+    return 0;
+  if ((int64_t)n > size - offset)
+    n = (size_t)(size - offset);
+  FillPattern(offset, static_cast<unsigned char*>(buf), n);
+  return n;
+}
+
+LocalFile::LocalFile(const std::string& path)
+: m_file(fopen(path.c_str(), "rb"))
+, m_size(0)
+{
+  struct stat st;
+  if (m_file && fstat(fileno(m_file), &st) == 0)
+    m_size = st.st_size;
+}
+
+LocalFile::~LocalFile()
+{
+  if (m_file)
+    fclose(m_file);
+}
+
+size_t LocalFile::Read(int64_t offset, void* buf, size_t n)
+{
+  if (!m_file || offset >= m_size || fseeko(m_file, (off_t)offset, SEEK_SET) != 0)
+    return 0;
+  return fread(buf, 1, n, m_file);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+////
+//// Dataset
+////
+
+static bool StartsBefore(const Myth::ProgramPtr& a, const Myth::ProgramPtr& b)
+{
+  return a->startTime < b->startTime;
+}
+
+Dataset::Dataset(const DatasetConfig& config)
+: m_config(config)
+, m_guideStart(0)
+, m_random(config.seed ? config.seed : 1)
+, m_nextRecordedId(1)
+{
+  time_t now = time(NULL);
+  m_guideStart = now - now % 86400;
+  MakeChannels();
+  MakeGuide();
+  MakeRecordings();
+  if (!m_config.localDir.empty())
+    AddLocalFiles();
+  // As the backend lists them
+  std::stable_sort(m_recordings.begin(), m_recordings.end(), StartsBefore);
+}
+
+int64_t Dataset::Now()
+{
+  return (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint32_t Dataset::Random()
+{
+  // xorshift32
+  m_random ^= m_random << 13;
+  m_random ^= m_random >> 17;
+  m_random ^= m_random << 5;
+  return m_random;
+}
+
+std::string Dataset::MakeText(unsigned words)
+{
+  std::string text;
+  for (unsigned i = 0; i < words; ++i)
+  {
+    if (i)
+      text.push_back(' ');
+    text.append(g_words[Random() % (sizeof(g_words) / sizeof(g_words[0]))]);
+  }
+  if (!text.empty())
+    text[0] = (char)toupper(text[0]);
+  return text;
+}
+
+void Dataset::MakeChannels()
+{
+  char buf[64];
+  for (unsigned i = 0; i < m_config.channels; ++i)
+  {
+    Myth::ChannelPtr channel(new Myth::Channel());
+    channel->chanId = 1001 + i;
+    sprintf(buf, "%u", i + 1);
+    channel->chanNum = buf;
+    sprintf(buf, "FAKE%u", i + 1);
+    channel->callSign = buf;
+    sprintf(buf, "Fake channel %u", i + 1);
+    channel->channelName = buf;
+    channel->mplexId = 1 + i / 10;
+    channel->commFree = "false";
+    channel->sourceId = DATASET_SOURCE_ID;
+    channel->visible = true;
+    m_channels.push_back(channel);
+  }
+  for (unsigned i = 0; i < m_config.tuners; ++i)
+  {
+    DatasetInput input;
+    input.inputName = "DVBInput";
+    input.sourceId = DATASET_SOURCE_ID;
+    input.inputId = i + 1;
+    input.mplexId = 0;
+    input.liveTVOrder = (uint8_t)(i + 1);
+    m_inputs.push_back(input);
+  }
+}
+
+void Dataset::MakeGuide()
+{
+  char buf[64];
+  time_t end = m_guideStart + (time_t)m_config.guideDays * 86400;
+  time_t slot = (time_t)m_config.slotMinutes * 60;
+  m_guide.resize(m_channels.size());
+  for (size_t c = 0; c < m_channels.size(); ++c)
+  {
+    time_t start = m_guideStart;
+    while (start < end)
+    {
+      Myth::ProgramPtr program(new Myth::Program());
+      unsigned series = Random() % 1000;
+      program->startTime = start;
+      program->endTime = start + slot * (time_t)(1 + Random() % 4);
+      program->title = MakeText(1 + Random() % 4);
+      program->subTitle = MakeText(2 + Random() % 5);
+      program->description = MakeText(20 + Random() % 40);
+      program->season = (uint16_t)(1 + series % 9);
+      program->episode = (uint16_t)(1 + Random() % 24);
+      program->category = g_categories[Random() % (sizeof(g_categories) / sizeof(g_categories[0]))];
+      program->catType = (program->category == "Movie" ? "movie" : "series");
+      sprintf(buf, "FAKE%04u", series);
+      program->seriesId = buf;
+      sprintf(buf, "FAKE%04u%04u", series, (unsigned)program->episode);
+      program->programId = buf;
+      program->airdate = start;
+      program->lastModified = m_guideStart;
+      program->channel = *m_channels[c];
+      m_guide[c].push_back(program);
+      start = program->endTime;
+    }
+  }
+}
+
+Myth::ProgramPtr Dataset::MakeRecording(const Myth::Program& program, const std::string& fileName,
+                                        const std::string& storageGroup, int64_t fileSize)
+{
+  Myth::ProgramPtr recording(new Myth::Program(program));
+  recording->hostName = m_config.hostName;
+  recording->fileName = fileName;
+  recording->fileSize = fileSize;
+  recording->recording.recordId = 1 + m_nextRecordedId % 20;
+  recording->recording.status = Myth::RS_RECORDED;
+  recording->recording.recType = Myth::RT_AllRecord;
+  recording->recording.startTs = program.startTime;
+  recording->recording.endTs = program.endTime;
+  recording->recording.profile = "Default";
+  recording->recording.recGroup = "Default";
+  recording->recording.storageGroup = storageGroup;
+  recording->recording.playGroup = "Default";
+  recording->recording.recordedId = m_nextRecordedId++;
+  return recording;
+}
+
+void Dataset::MakeRecordings()
+{
+  time_t slot = (time_t)m_config.slotMinutes * 60;
+  time_t start = m_guideStart;
+  for (unsigned i = 0; i < m_config.recordings && !m_channels.empty(); ++i)
+  {
+    Myth::Program program;
+    program.endTime = start;
+    program.startTime = start = program.endTime - slot * (time_t)(1 + Random() % 4);
+    program.title = MakeText(1 + Random() % 4);
+    program.subTitle = MakeText(2 + Random() % 5);
+    program.description = MakeText(20 + Random() % 40);
+    program.season = (uint16_t)(1 + Random() % 9);
+    program.episode = (uint16_t)(1 + Random() % 24);
+    program.category = g_categories[Random() % (sizeof(g_categories) / sizeof(g_categories[0]))];
+    program.catType = "series";
+    program.airdate = program.startTime;
+    program.lastModified = program.endTime;
+    program.channel = *m_channels[i % m_channels.size()];
+    std::string fileName = MakeFileName(program.channel.chanId, program.startTime);
+    Myth::ProgramPtr recording = MakeRecording(program, fileName, DATASET_SG_DEFAULT, m_config.recordingSize);
+    m_recordings.push_back(recording);
+    m_files[fileName] = recording;
+  }
+}
+
+void Dataset::AddLocalFiles()
+{
+  DIR* dir = opendir(m_config.localDir.c_str());
+  if (!dir)
+  {
+    fprintf(stderr, "cannot open directory %s\n", m_config.localDir.c_str());
+    return;
+  }
+  time_t start = m_guideStart - 365 * 86400;
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != NULL)
+  {
+    struct stat st;
+    std::string path(m_config.localDir);
+    path.append("/").append(entry->d_name);
+    if (entry->d_name[0] == '.' || stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+      continue;
+    Myth::Program program;
+    program.startTime = start;
+    program.endTime = start + 3600;
+    program.title = entry->d_name;
+    program.catType = "movie";
+    program.airdate = program.startTime;
+    program.lastModified = program.endTime;
+    if (!m_channels.empty())
+      program.channel = *m_channels[0];
+    Myth::ProgramPtr recording = MakeRecording(program, entry->d_name, DATASET_SG_LOCAL, st.st_size);
+    m_recordings.push_back(recording);
+    m_files[entry->d_name] = recording;
+    m_localFiles[entry->d_name] = path;
+    start += 3600;
+  }
+  closedir(dir);
+}
+
+Myth::ChannelPtr Dataset::FindChannel(uint32_t chanId) const
+{
+  size_t i = ChannelIndex(chanId);
+  return (i < m_channels.size() ? m_channels[i] : Myth::ChannelPtr());
+}
+
+Myth::ChannelPtr Dataset::FindChannelByNum(const std::string& chanNum) const
+{
+  for (std::vector<Myth::ChannelPtr>::const_iterator it = m_channels.begin(); it != m_channels.end(); ++it)
+  {
+    if ((*it)->chanNum == chanNum)
+      return *it;
+  }
+  return Myth::ChannelPtr();
+}
+
+size_t Dataset::ChannelIndex(uint32_t chanId) const
+{
+  // Channels are numbered in sequence
+  size_t i = (size_t)(chanId - 1001);
+  return (chanId >= 1001 && i < m_channels.size() ? i : m_channels.size());
+}
+
+Myth::ProgramPtr Dataset::FindRecording(uint32_t recordedId) const
+{
+  for (std::vector<Myth::ProgramPtr>::const_iterator it = m_recordings.begin(); it != m_recordings.end(); ++it)
+  {
+    if ((*it)->recording.recordedId == recordedId)
+      return *it;
+  }
+  return Myth::ProgramPtr();
+}
+
+Myth::ProgramPtr Dataset::StartLive(const Myth::Channel& channel)
+{
+  Myth::OS::CLockGuard lock(m_mutex);
+  time_t now = time(NULL);
+  Myth::Program program;
+  size_t c = ChannelIndex(channel.chanId);
+  if (c < m_guide.size())
+  {
+    // Copy the program on air, if any
+    for (std::vector<Myth::ProgramPtr>::const_iterator it = m_guide[c].begin(); it != m_guide[c].end(); ++it)
+    {
+      if ((*it)->startTime <= now && (*it)->endTime > now)
+      {
+        program = **it;
+        break;
+      }
+    }
+  }
+  if (program.title.empty())
+    program.title = channel.channelName;
+  program.channel = channel;
+  std::string fileName = MakeFileName(channel.chanId, now);
+  Myth::ProgramPtr live = MakeRecording(program, fileName, DATASET_SG_LIVETV, 0);
+  live->recording.status = Myth::RS_RECORDING;
+  live->recording.recGroup = "LiveTV";
+  live->recording.startTs = now;
+  m_liveFiles[fileName] = FileSourcePtr(new LiveFile(m_config.liveRate));
+  return live;
+}
+
+void Dataset::StopLive(const std::string& fileName)
+{
+  Myth::OS::CLockGuard lock(m_mutex);
+  // Opened transfers keep their own reference
+  m_liveFiles.erase(fileName);
+}
+
+FileSourcePtr Dataset::OpenFile(const std::string& fileName, const std::string& storageGroup)
+{
+  if (storageGroup == DATASET_SG_LIVETV)
+  {
+    Myth::OS::CLockGuard lock(m_mutex);
+    std::map<std::string, FileSourcePtr>::const_iterator it = m_liveFiles.find(fileName);
+    return (it != m_liveFiles.end() ? it->second : FileSourcePtr());
+  }
+  std::map<std::string, std::string>::const_iterator lit = m_localFiles.find(fileName);
+  if (lit != m_localFiles.end())
+  {
+    LocalFile* file = new LocalFile(lit->second);
+    if (file->IsOpen())
+      return FileSourcePtr(file);
+    delete file;
+    return FileSourcePtr();
+  }
+  std::map<std::string, Myth::ProgramPtr>::const_iterator it = m_files.find(fileName);
+  if (it != m_files.end())
+    return FileSourcePtr(new PatternFile(it->second->fileSize));
+  return FileSourcePtr();
+}
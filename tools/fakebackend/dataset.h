@@ -0,0 +1,179 @@
+#pragma once
+/*
+ *      Copyright (C) 2014 Jean-Luc Barriere
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301 USA
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <mythtypes.h>
+#include <private/os/threads/mutex.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+#define DATASET_SOURCE_ID         1
+#define DATASET_SG_DEFAULT        "Default"
+#define DATASET_SG_LIVETV         "LiveTV"
+#define DATASET_SG_LOCAL          "Local"
+
+struct DatasetConfig
+{
+  DatasetConfig();
+
+  std::string hostName;     ///< name of the fake backend host
+  unsigned channels;
+  unsigned tuners;
+  unsigned guideDays;       ///< guide length, starting today at midnight UTC
+  unsigned slotMinutes;     ///< programs last from 1 to 4 slots
+  unsigned recordings;      ///< generated recordings
+  int64_t recordingSize;    ///< size of a generated recording in bytes
+  uint64_t liveRate;        ///< growth of a live recording in bytes per second
+  std::string localDir;     ///< files of this directory are served as recordings
+  unsigned seed;
+};
+
+struct DatasetInput
+{
+  std::string inputName;
+  uint32_t sourceId;
+  uint32_t inputId;
+  uint32_t mplexId;
+  uint8_t liveTVOrder;
+};
+
+/**
+ * The content of a file served by the fake backend. Generated files are null
+ * transport packets with a pattern depending on their offset, so a client can
+ * check what it reads.
+ */
+class FileSource
+{
+public:
+  virtual ~FileSource() { }
+  virtual int64_t GetSize() const = 0;
+  virtual size_t Read(int64_t offset, void* buf, size_t n) = 0;
+
+  static void FillPattern(int64_t offset, unsigned char* buf, size_t n);
+  static bool CheckPattern(int64_t offset, const unsigned char* buf, size_t n);
+};
+
+typedef Myth::shared_ptr<FileSource> FileSourcePtr;
+
+class PatternFile : public FileSource
+{
+public:
+  explicit PatternFile(int64_t size) : m_size(size) { }
+  int64_t GetSize() const { return m_size; }
+  size_t Read(int64_t offset, void* buf, size_t n);
+
+private:
+  int64_t m_size;
+};
+
+/**
+ * A live recording growing at a steady rate since its spawning.
+ */
+class LiveFile : public FileSource
+{
+public:
+  explicit LiveFile(uint64_t rate);
+  int64_t GetSize() const;
+  size_t Read(int64_t offset, void* buf, size_t n);
+
+private:
+  uint64_t m_rate;
+  int64_t m_start;
+};
+
+class LocalFile : public FileSource
+{
+public:
+  explicit LocalFile(const std::string& path);
+  ~LocalFile();
+  bool IsOpen() const { return m_file != NULL; }
+  int64_t GetSize() const { return m_size; }
+  size_t Read(int64_t offset, void* buf, size_t n);
+
+private:
+  FILE* m_file;
+  int64_t m_size;
+};
+
+/**
+ * The channels, guide and recordings of the fake backend, generated from a
+ * seed so two runs serve the same data.
+ */
+class Dataset
+{
+public:
+  explicit Dataset(const DatasetConfig& config);
+
+  const DatasetConfig& GetConfig() const { return m_config; }
+  time_t GetGuideStart() const { return m_guideStart; }
+
+  const std::vector<Myth::ChannelPtr>& GetChannels() const { return m_channels; }
+  const std::vector<DatasetInput>& GetInputs() const { return m_inputs; }
+  const std::vector<Myth::ProgramPtr>& GetGuide(size_t chanIndex) const { return m_guide[chanIndex]; }
+  const std::vector<Myth::ProgramPtr>& GetRecordings() const { return m_recordings; }
+
+  Myth::ChannelPtr FindChannel(uint32_t chanId) const;
+  Myth::ChannelPtr FindChannelByNum(const std::string& chanNum) const;
+  size_t ChannelIndex(uint32_t chanId) const;
+  Myth::ProgramPtr FindRecording(uint32_t recordedId) const;
+
+  /**
+   * Start a live recording of the channel and return its program.
+   */
+  Myth::ProgramPtr StartLive(const Myth::Channel& channel);
+  void StopLive(const std::string& fileName);
+
+  /**
+   * Open the content of a recording, or of a live recording.
+   * @return the file, or a null pointer when it doesn't exist
+   */
+  FileSourcePtr OpenFile(const std::string& fileName, const std::string& storageGroup);
+
+  static int64_t Now();
+
+private:
+  DatasetConfig m_config;
+  time_t m_guideStart;
+  uint32_t m_random;
+  std::vector<Myth::ChannelPtr> m_channels;
+  std::vector<DatasetInput> m_inputs;
+  std::vector<std::vector<Myth::ProgramPtr> > m_guide;
+  std::vector<Myth::ProgramPtr> m_recordings;
+  std::map<std::string, Myth::ProgramPtr> m_files;
+  std::map<std::string, std::string> m_localFiles;
+
+  Myth::OS::CMutex m_mutex;
+  std::map<std::string, FileSourcePtr> m_liveFiles;
+  uint32_t m_nextRecordedId;
+
+  uint32_t Random();
+  std::string MakeText(unsigned words);
+  void MakeChannels();
+  void MakeGuide();
+  void MakeRecordings();
+  void AddLocalFiles();
+  Myth::ProgramPtr MakeRecording(const Myth::Program& program, const std::string& fileName,
+                                 const std::string& storageGroup, int64_t fileSize);
+};
@@ -0,0 +1,1484 @@
+/*
+ *      Copyright (C) 2014 Jean-Luc Barriere
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301 USA
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "fakebackend.h"
+
+#include <private/builtin.h>
+#include <private/socket.h>
+#include <private/socketpoll.h>
+#include <proto/mythprotobase.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+
+#define MAX_SESSIONS          256
+#define LISTEN_QUEUE_SIZE     64
+#define POLL_TIMEOUT          250     // ms
+#define TICK_INTERVAL         100     // ms
+#define MESSAGE_MAXSIZE       0x100000
+#define HTTP_HEADER_MAXSIZE   0x4000
+#define DATA_CHUNK_SIZE       0x10000
+
+#define SEP                   PROTO_STR_SEPARATOR
+
+BackendConfig::BackendConfig()
+: protoPort(6543)
+, wsPort(6544)
+, tuneDelay(500)
+, sizeInterval(1000)
+, latency(0)
+, jitter(0)
+, bandwidth(0)
+, errorRate(0)
+, seed(1)
+{
+}
+
+bool ParseBackendOption(char opt, const char* arg, DatasetConfig& dataset, BackendConfig& backend)
+{
+  unsigned value = (unsigned)strtoul(arg, NULL, 0);
+  switch (opt)
+  {
+  case 'c': dataset.channels = value; break;
+  case 'u': dataset.tuners = value; break;
+  case 'g': dataset.guideDays = value; break;
+  case 'r': dataset.recordings = value; break;
+  case 'z': dataset.recordingSize = (int64_t)value * 1024 * 1024; break;
+  case 'R': dataset.liveRate = (uint64_t)value * 1024; break;
+  case 'd': dataset.localDir = arg; break;
+  case 's': dataset.seed = backend.seed = value; break;
+  case 'p': backend.protoPort = value; break;
+  case 'w': backend.wsPort = value; break;
+  case 'T': backend.tuneDelay = value; break;
+  case 'l': backend.latency = value; break;
+  case 'j': backend.jitter = value; break;
+  case 'b': backend.bandwidth = value * 1024; break;
+  case 'e': backend.errorRate = value; break;
+  default:
+    return false;
+  }
+  return true;
+}
+
+void BackendOptionsUsage()
+{
+  DatasetConfig dataset;
+  BackendConfig backend;
+  fprintf(stderr,
+          "  -c number            channels (%u)\n"
+          "  -u number            tuners (%u)\n"
+          "  -g days              length of the guide (%u)\n"
+          "  -r number            recordings (%u)\n"
+          "  -z MB                size of a recording (%u)\n"
+          "  -R KB/s              growth of a live recording (%u)\n"
+          "  -d directory         serve its files as recordings too\n"
+          "  -s seed              seed of the dataset and of the faults (%u)\n"
+          "  -p port              port of the Myth protocol (%u)\n"
+          "  -w port              port of the services API (%u)\n"
+          "  -T ms                delay to tune a live TV (%u)\n"
+          "  -l ms                latency of each reply (%u)\n"
+          "  -j ms                random jitter added to the latency (%u)\n"
+          "  -b KB/s              bandwidth of each data stream, 0 for unlimited (%u)\n"
+          "  -e number            failed requests per 1000 (%u)\n",
+          dataset.channels, dataset.tuners, dataset.guideDays, dataset.recordings,
+          (unsigned)(dataset.recordingSize / (1024 * 1024)), (unsigned)(dataset.liveRate / 1024),
+          dataset.seed, backend.protoPort, backend.wsPort, backend.tuneDelay, backend.latency,
+          backend.jitter, backend.bandwidth / 1024, backend.errorRate);
+}
+
+static void Split(const std::string& str, const char* delimiter, std::vector<std::string>& tokens)
+{
+  size_t len = strlen(delimiter);
+  size_t pos = 0, end;
+  while ((end = str.find(delimiter, pos)) != std::string::npos)
+  {
+    tokens.push_back(str.substr(pos, end - pos));
+    pos = end + len;
+  }
+  tokens.push_back(str.substr(pos));
+}
+
+static std::string ToString(int64_t num)
+{
+  char buf[32];
+  int64_to_string(num, buf);
+  return buf;
+}
+
+namespace
+{
+  /**
+   * Paces a data stream at a given rate. A stream idle for a while restarts
+   * its window, so it doesn't burst after a pause.
+   */
+  class Throttle
+  {
+  public:
+    explicit Throttle(unsigned rate) : m_rate(rate), m_start(0), m_last(0), m_bytes(0) { }
+
+    void Pass(size_t n)
+    {
+      if (!m_rate)
+        return;
+      int64_t now = Dataset::Now();
+      if (now - m_last > 1000000)
+      {
+        m_start = now;
+        m_bytes = 0;
+      }
+      m_bytes += n;
+      int64_t due = m_start + (int64_t)(m_bytes * 1000000 / m_rate);
+      if (due > now)
+        usleep((useconds_t)(due - now));
+      m_last = (due > now ? due : now);
+    }
+
+  private:
+    uint64_t m_rate;
+    int64_t m_start;
+    int64_t m_last;
+    uint64_t m_bytes;
+  };
+
+  /**
+   * An accepted socket, telling whether it holds received bytes not consumed
+   * yet: polling the handle would miss them.
+   */
+  class SessionSocket : public Myth::TcpSocket
+  {
+  public:
+    bool HasPendingData() const { return BufferedData() > 0; }
+  };
+
+  /**
+   * Writes the objects of the services API. As the backend does, all the
+   * values are strings.
+   */
+  class JSONWriter
+  {
+  public:
+    explicit JSONWriter(std::string& out) : m_out(out) { m_first.push_back(true); }
+
+    void BeginObject(const char* name = NULL)
+    {
+      Key(name);
+      m_out.push_back('{');
+      m_first.push_back(true);
+    }
+
+    void EndObject()
+    {
+      m_out.push_back('}');
+      m_first.pop_back();
+    }
+
+    void BeginArray(const char* name)
+    {
+      Key(name);
+      m_out.push_back('[');
+      m_first.push_back(true);
+    }
+
+    void EndArray()
+    {
+      m_out.push_back(']');
+      m_first.pop_back();
+    }
+
+    void Value(const char* name, const std::string& value)
+    {
+      Key(name);
+      m_out.push_back('"');
+      for (std::string::const_iterator it = value.begin(); it != value.end(); ++it)
+      {
+        switch (*it)
+        {
+        case '"': m_out.append("\\\""); break;
+        case '\\': m_out.append("\\\\"); break;
+        case '\n': m_out.append("\\n"); break;
+        case '\r': m_out.append("\\r"); break;
+        case '\t': m_out.append("\\t"); break;
+        default:
+          if ((unsigned char)*it < 0x20)
+          {
+            char buf[8];
+            sprintf(buf, "\\u%04x", (unsigned)*it);
+            m_out.append(buf);
+          }
+          else
+            m_out.push_back(*it);
+        }
+      }
+      m_out.push_back('"');
+    }
+
+    void Value(const char* name, const char* value) { Value(name, std::string(value)); }
+    void Value(const char* name, int64_t value) { Value(name, ToString(value)); }
+    void Value(const char* name, uint32_t value) { Value(name, ToString(value)); }
+    void Value(const char* name, int value) { Value(name, ToString(value)); }
+    void Value(const char* name, bool value) { Value(name, value ? "true" : "false"); }
+
+    void Time(const char* name, time_t value)
+    {
+      char buf[32];
+      time_to_iso8601utc(value, buf);
+      Value(name, buf);
+    }
+
+  private:
+    std::string& m_out;
+    std::vector<bool> m_first;
+
+    void Key(const char* name)
+    {
+      if (!m_first.back())
+        m_out.push_back(',');
+      m_first.back() = false;
+      if (name)
+      {
+        m_out.push_back('"');
+        m_out.append(name);
+        m_out.append("\":");
+      }
+    }
+  };
+}
+
+///////////////////////////////////////////////////////////////////////////////
+////
+//// Internals
+////
+
+class FakeBackend::Connection
+{
+public:
+  explicit Connection(unsigned seed) : m_random(seed ? seed : 1) { }
+
+  SessionSocket socket;
+
+  bool SendMessage(const std::string& msg)
+  {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%-8u", (unsigned)msg.size());
+    std::string frame(buf);
+    frame.append(msg);
+    Myth::OS::CLockGuard lock(m_mutex);
+    return socket.SendData(frame.c_str(), frame.size());
+  }
+
+  bool SendData(const char* data, size_t n)
+  {
+    Myth::OS::CLockGuard lock(m_mutex);
+    return socket.SendData(data, n);
+  }
+
+  void Close()
+  {
+    Myth::OS::CLockGuard lock(m_mutex);
+    socket.Disconnect();
+  }
+
+  // Only the session thread draws the faults of its connection
+  uint32_t Random()
+  {
+    m_random ^= m_random << 13;
+    m_random ^= m_random >> 17;
+    m_random ^= m_random << 5;
+    return m_random;
+  }
+
+private:
+  Myth::OS::CMutex m_mutex;
+  uint32_t m_random;
+};
+
+struct FakeBackend::Transfer
+{
+  ConnectionPtr connection;   ///< the data socket
+  FileSourcePtr file;
+  int64_t position;
+  Throttle throttle;
+  std::vector<char> buffer;
+  Myth::OS::CMutex mutex;
+
+  Transfer(const ConnectionPtr& conn, const FileSourcePtr& src, unsigned bandwidth)
+  : connection(conn), file(src), position(0), throttle(bandwidth), buffer(DATA_CHUNK_SIZE) { }
+};
+
+struct FakeBackend::HttpRequest
+{
+  std::string method;
+  std::string path;
+  std::map<std::string, std::string> params;   ///< keyed in lower case
+  bool keepAlive;
+
+  HttpRequest() : keepAlive(false) { }
+
+  std::string Param(const char* name) const
+  {
+    std::string key(name);
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+    std::map<std::string, std::string>::const_iterator it = params.find(key);
+    return (it != params.end() ? it->second : std::string());
+  }
+
+  uint32_t ParamUInt(const char* name, uint32_t def) const
+  {
+    uint32_t num;
+    std::string val = Param(name);
+    return (!val.empty() && string_to_uint32(val.c_str(), &num) == 0 ? num : def);
+  }
+
+  time_t ParamTime(const char* name, time_t def) const
+  {
+    time_t t;
+    std::string val = Param(name);
+    return (!val.empty() && string_to_time(val.c_str(), &t) == 0 ? t : def);
+  }
+};
+
+struct FakeBackend::HttpResponse
+{
+  int status;
+  std::string contentType;
+  std::string body;
+  FileSourcePtr file;         ///< content streamed in place of the body
+
+  HttpResponse() : status(200), contentType("application/json; charset=UTF-8") { }
+};
+
+/**
+ * Serializes the programs as the backend does, using the codec of the library
+ * for the negotiated protocol version.
+ */
+class FakeBackend::ProgramInfoWriter : public Myth::ProtoBase
+{
+public:
+  ProgramInfoWriter() : ProtoBase("", 0) { m_protoVersion = FAKEBACKEND_PROTO_VERSION; }
+  bool Open() { return false; }
+  void Write(const Myth::Program& program, std::string& msg)
+  {
+    MakeProgramInfo(program, msg);
+    // The codec leaves the last field empty, as the backend ignores it. The
+    // reader needs a value.
+    msg.append("0");
+  }
+};
+
+class FakeBackend::Listener : public Myth::OS::CThread
+{
+public:
+  Listener(FakeBackend& backend, bool http) : m_backend(backend), m_http(http) { }
+
+  bool Bind(unsigned port)
+  {
+    return m_socket.Create(Myth::SOCKET_AF_INET4) && m_socket.Bind(port) &&
+            m_socket.ListenConnection(LISTEN_QUEUE_SIZE);
+  }
+
+  Myth::TcpServerSocket& GetSocket() { return m_socket; }
+
+protected:
+  void* Process()
+  {
+    while (!IsStopped())
+    {
+      int r = Myth::SocketPoll::Wait(m_socket.GetHandle(), SOCKETPOLL_READ, POLL_TIMEOUT);
+      if (r > 0)
+        m_backend.Accept(*this, m_http);
+    }
+    return NULL;
+  }
+
+private:
+  FakeBackend& m_backend;
+  bool m_http;
+  Myth::TcpServerSocket m_socket;
+};
+
+class FakeBackend::Ticker : public Myth::OS::CThread
+{
+public:
+  explicit Ticker(FakeBackend& backend) : m_backend(backend) { }
+
+protected:
+  void* Process()
+  {
+    while (!IsStopped())
+    {
+      Sleep(TICK_INTERVAL);
+      m_backend.Tick();
+    }
+    return NULL;
+  }
+
+private:
+  FakeBackend& m_backend;
+};
+
+class FakeBackend::ProtoSession : public Myth::OS::CWorker
+{
+public:
+  ProtoSession(FakeBackend& backend, const ConnectionPtr& conn) : m_backend(backend), m_conn(conn) { }
+  void Process()
+  {
+    m_backend.RunProto(m_conn);
+    --m_backend.m_sessions;
+  }
+
+private:
+  FakeBackend& m_backend;
+  ConnectionPtr m_conn;
+};
+
+class FakeBackend::HttpSession : public Myth::OS::CWorker
+{
+public:
+  HttpSession(FakeBackend& backend, const ConnectionPtr& conn) : m_backend(backend), m_conn(conn) { }
+  void Process()
+  {
+    m_backend.RunHttp(m_conn);
+    --m_backend.m_sessions;
+  }
+
+private:
+  FakeBackend& m_backend;
+  ConnectionPtr m_conn;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+////
+//// Server
+////
+
+FakeBackend::FakeBackend(Dataset& dataset, const BackendConfig& config)
+: m_dataset(dataset)
+, m_config(config)
+, m_pool(MAX_SESSIONS)
+, m_protoListener(NULL)
+, m_wsListener(NULL)
+, m_ticker(NULL)
+, m_writer(new ProgramInfoWriter())
+, m_running(false)
+, m_stopped(true)
+, m_sessions(0)
+, m_serial(0)
+, m_nextFileId(1)
+, m_protoRequests(0)
+, m_wsRequests(0)
+, m_bytesSent(0)
+, m_faults(0)
+{
+}
+
+FakeBackend::~FakeBackend()
+{
+  Stop();
+  delete m_writer;
+}
+
+bool FakeBackend::Start()
+{
+  if (m_running)
+    return true;
+  m_recorders.assign(m_dataset.GetInputs().size(), Recorder());
+  m_protoListener = new Listener(*this, false);
+  m_wsListener = new Listener(*this, true);
+  if (!m_protoListener->Bind(m_config.protoPort) || !m_wsListener->Bind(m_config.wsPort))
+  {
+    fprintf(stderr, "cannot listen on ports %u and %u\n", m_config.protoPort, m_config.wsPort);
+    delete m_protoListener;
+    delete m_wsListener;
+    m_protoListener = m_wsListener = NULL;
+    return false;
+  }
+  m_stopped = false;
+  m_ticker = new Ticker(*this);
+  m_protoListener->StartThread();
+  m_wsListener->StartThread();
+  m_ticker->StartThread();
+  m_running = true;
+  return true;
+}
+
+void FakeBackend::Stop()
+{
+  if (!m_running)
+    return;
+  m_stopped = true;
+  m_protoListener->StopThread();
+  m_wsListener->StopThread();
+  m_ticker->StopThread();
+  // Sessions notice the stop on their next poll
+  while (m_sessions > 0)
+    usleep(10000);
+  delete m_protoListener;
+  delete m_wsListener;
+  delete m_ticker;
+  m_protoListener = m_wsListener = NULL;
+  m_ticker = NULL;
+  Myth::OS::CLockGuard lock(m_mutex);
+  m_transfers.clear();
+  m_eventConnections.clear();
+  m_recorders.clear();
+  m_running = false;
+}
+
+BackendStats FakeBackend::GetStats() const
+{
+  BackendStats stats;
+  stats.protoRequests = m_protoRequests;
+  stats.wsRequests = m_wsRequests;
+  stats.bytesSent = m_bytesSent;
+  stats.faults = m_faults;
+  return stats;
+}
+
+void FakeBackend::Accept(Listener& listener, bool http)
+{
+  ConnectionPtr conn(new Connection(m_config.seed + m_serial++));
+  if (!listener.GetSocket().AcceptConnection(conn->socket))
+    return;
+  ++m_sessions;
+  Myth::OS::CWorker* worker;
+  if (http)
+    worker = new HttpSession(*this, conn);
+  else
+    worker = new ProtoSession(*this, conn);
+  if (!m_pool.Enqueue(worker))
+  {
+    delete worker;
+    --m_sessions;
+    conn->Close();
+  }
+}
+
+/**
+ * Wait the configured latency before a reply, then draw whether the request
+ * fails.
+ * @return true when the request must fail
+ */
+bool FakeBackend::InjectFault(Connection& conn)
+{
+  unsigned delay = m_config.latency;
+  if (m_config.jitter)
+    delay += conn.Random() % (m_config.jitter + 1);
+  if (delay)
+    usleep(delay * 1000);
+  if (m_config.errorRate && conn.Random() % 1000 < m_config.errorRate)
+  {
+    ++m_faults;
+    return true;
+  }
+  return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+////
+//// Myth protocol
+////
+
+void FakeBackend::RunProto(const ConnectionPtr& conn)
+{
+  uint32_t fileId = 0;
+  bool events = false;
+  std::string msg;
+
+  while (!m_stopped)
+  {
+    if (!conn->socket.HasPendingData())
+    {
+      struct timeval tv = { 0, POLL_TIMEOUT * 1000 };
+      int r = conn->socket.Listen(&tv);
+      if (r == 0)
+        continue;
+      if (r < 0)
+        break;
+    }
+    char buf[9];
+    if (conn->socket.ReceiveData(buf, 8) != 8)
+      break;
+    buf[8] = '\0';
+    unsigned long len = strtoul(buf, NULL, 10);
+    if (len > MESSAGE_MAXSIZE)
+      break;
+    msg.resize(len);
+    if (len && conn->socket.ReceiveData(&msg[0], len) != len)
+      break;
+    ++m_protoRequests;
+    if (!HandleProto(conn, msg, fileId, events))
+      break;
+  }
+
+  {
+    Myth::OS::CLockGuard lock(m_mutex);
+    if (fileId)
+      m_transfers.erase(fileId);
+    if (events)
+      m_eventConnections.remove(conn);
+  }
+  conn->Close();
+}
+
+/**
+ * Reply a message of the protocol.
+ * @return false to close the connection
+ */
+bool FakeBackend::HandleProto(const ConnectionPtr& conn, const std::string& msg, uint32_t& fileId, bool& events)
+{
+  std::vector<std::string> fields;
+  std::vector<std::string> tokens;
+  Split(msg, SEP, fields);
+  Split(fields[0], " ", tokens);
+  const std::string& cmd = tokens[0];
+
+  if (cmd == "DONE")
+    return false;
+  if (InjectFault(*conn))
+    return false;
+
+  std::string reply;
+  if (cmd == "MYTH_PROTO_VERSION")
+  {
+    bool accept = (tokens.size() > 2 && tokens[1] == ToString(FAKEBACKEND_PROTO_VERSION) &&
+            tokens[2] == FAKEBACKEND_PROTO_TOKEN);
+    reply.append(accept ? "ACCEPT" : "REJECT").append(SEP).append(ToString(FAKEBACKEND_PROTO_VERSION));
+    // The client retries on a new connection
+    return conn->SendMessage(reply) && accept;
+  }
+  else if (cmd == "ANN")
+  {
+    if (tokens.size() > 1 && tokens[1] == "FileTransfer")
+      return AnnounceFileTransfer(conn, fields, fileId);
+    if (tokens.size() > 3 && tokens[1] == "Monitor" && tokens[3] == "1" && !events)
+    {
+      Myth::OS::CLockGuard lock(m_mutex);
+      m_eventConnections.push_back(conn);
+      events = true;
+    }
+    reply = "OK";
+  }
+  else if (cmd == "QUERY_FILETRANSFER" && tokens.size() > 1)
+    reply = QueryFileTransfer(fields, (uint32_t)strtoul(tokens[1].c_str(), NULL, 10));
+  else if (cmd == "QUERY_RECORDER" && tokens.size() > 1)
+    reply = QueryRecorder(fields, (unsigned)atoi(tokens[1].c_str()));
+  else if (cmd == "GET_RECORDER_FROM_NUM")
+  {
+    unsigned num = (fields.size() > 1 ? (unsigned)atoi(fields[1].c_str()) : 0);
+    if (num < 1 || num > m_recorders.size())
+      reply = "nohost";
+    else
+      reply.append(conn->socket.GetHostAddrInfo()).append(SEP).append(ToString(m_config.protoPort));
+  }
+  else if (cmd == "GET_FREE_INPUT_INFO")
+    reply = GetFreeInputInfo();
+  else if (cmd == "QUERY_FREE_SPACE_SUMMARY")
+    reply.append("1073741824").append(SEP).append("268435456");
+  else if (cmd == "BLOCK_SHUTDOWN" || cmd == "ALLOW_SHUTDOWN" || cmd == "QUERY_GENPIXMAP2")
+    reply = "OK";
+  else if (cmd == "QUERY_SETTING")
+    reply = "-1";
+  else
+    reply = "ERROR";
+  return conn->SendMessage(reply);
+}
+
+bool FakeBackend::AnnounceFileTransfer(const ConnectionPtr& conn, const std::vector<std::string>& fields, uint32_t& fileId)
+{
+  std::string pathName(fields.size() > 1 ? fields[1] : "");
+  std::string storageGroup(fields.size() > 2 ? fields[2] : "");
+  if (!pathName.empty() && pathName[0] == '/')
+    pathName.erase(0, 1);
+  FileSourcePtr file = m_dataset.OpenFile(pathName, storageGroup);
+  if (!file || fileId)
+    return conn->SendMessage("ERROR" SEP "filetransfer_unable_to_open");
+
+  TransferPtr transfer(new Transfer(conn, file, m_config.bandwidth));
+  {
+    Myth::OS::CLockGuard lock(m_mutex);
+    fileId = m_nextFileId++;
+    m_transfers[fileId] = transfer;
+  }
+  std::string reply("OK");
+  reply.append(SEP).append(ToString(fileId)).append(SEP).append(ToString(file->GetSize()));
+  return conn->SendMessage(reply);
+}
+
+std::string FakeBackend::QueryFileTransfer(const std::vector<std::string>& fields, uint32_t fileId)
+{
+  TransferPtr transfer;
+  {
+    Myth::OS::CLockGuard lock(m_mutex);
+    std::map<uint32_t, TransferPtr>::const_iterator it = m_transfers.find(fileId);
+    if (it != m_transfers.end())
+      transfer = it->second;
+  }
+  const std::string& query = (fields.size() > 1 ? fields[1] : fields[0]);
+  if (query == "IS_OPEN")
+    return (transfer ? "1" : "0");
+  if (!transfer)
+    return "-1";
+
+  Myth::OS::CLockGuard lock(transfer->mutex);
+  if (query == "REQUEST_BLOCK" && fields.size() > 2)
+  {
+    // The block is written on the data socket before the reply
+    size_t n = (size_t)strtoul(fields[2].c_str(), NULL, 10);
+    size_t sent = 0;
+    while (sent < n)
+    {
+      size_t s = std::min(n - sent, transfer->buffer.size());
+      s = transfer->file->Read(transfer->position, &transfer->buffer[0], s);
+      if (s == 0)
+        break;
+      transfer->throttle.Pass(s);
+      if (!transfer->connection->SendData(&transfer->buffer[0], s))
+        break;
+      transfer->position += s;
+      sent += s;
+    }
+    m_bytesSent += sent;
+    return ToString(sent);
+  }
+  if (query == "SEEK" && fields.size() > 4)
+  {
+    int64_t offset = 0, curpos = 0, position;
+    int8_t whence = 0;
+    int64_t size = transfer->file->GetSize();
+    if (string_to_int64(fields[2].c_str(), &offset) || string_to_int8(fields[3].c_str(), &whence) ||
+            string_to_int64(fields[4].c_str(), &curpos))
+      return "-1";
+    switch (whence)
+    {
+    case 0: position = offset; break;
+    case 1: position = curpos + offset; break;
+    case 2: position = size - offset; break;
+    default: return "-1";
+    }
+    if (position < 0 || position > size)
+      return "-1";
+    transfer->position = position;
+    return ToString(position);
+  }
+  if (query == "DONE")
+    return "OK";
+  return "ERROR";
+}
+
+std::string FakeBackend::QueryRecorder(const std::vector<std::string>& fields, unsigned num)
+{
+  if (num < 1 || num > m_recorders.size() || fields.size() < 2)
+    return "ERROR";
+  const std::string& query = fields[1];
+  Recorder& recorder = m_recorders[num - 1];
+
+  if (query == "SPAWN_LIVETV" && fields.size() > 4)
+  {
+    Myth::ChannelPtr channel = m_dataset.FindChannelByNum(fields[4]);
+    if (!channel)
+      return "ERROR";
+    Myth::ProgramPtr program = m_dataset.StartLive(*channel);
+    program->recording.encoderId = num;
+    Myth::OS::CLockGuard lock(m_mutex);
+    if (recorder.playing)
+      m_dataset.StopLive(recorder.program->fileName);
+    recorder.playing = true;
+    recorder.announced = false;
+    recorder.chainId = fields[2];
+    recorder.program = program;
+    recorder.file = m_dataset.OpenFile(program->fileName, DATASET_SG_LIVETV);
+    recorder.spawnTime = recorder.lastUpdate = Dataset::Now();
+    return "OK";
+  }
+  if (query == "STOP_LIVETV")
+  {
+    Myth::OS::CLockGuard lock(m_mutex);
+    if (recorder.playing)
+      m_dataset.StopLive(recorder.program->fileName);
+    recorder = Recorder();
+    return "OK";
+  }
+  if (query == "GET_CURRENT_RECORDING")
+  {
+    Myth::Program program;
+    {
+      Myth::OS::CLockGuard lock(m_mutex);
+      if (recorder.playing)
+      {
+        program = *recorder.program;
+        program.fileSize = recorder.file->GetSize();
+      }
+    }
+    std::string reply;
+    m_writer->Write(program, reply);
+    return reply;
+  }
+  if (query == "GET_FILE_POSITION")
+  {
+    Myth::OS::CLockGuard lock(m_mutex);
+    return ToString(recorder.playing ? recorder.file->GetSize() : 0);
+  }
+  if (query == "IS_RECORDING")
+  {
+    Myth::OS::CLockGuard lock(m_mutex);
+    return (recorder.playing ? "1" : "0");
+  }
+  if (query == "CHECK_CHANNEL")
+    return (fields.size() > 2 && m_dataset.FindChannelByNum(fields[2]) ? "1" : "0");
+  if (query == "SET_LIVE_RECORDING" || query == "FINISH_RECORDING")
+    return "OK";
+  return "ERROR";
+}
+
+std::string FakeBackend::GetFreeInputInfo()
+{
+  std::string reply;
+  const std::vector<DatasetInput>& inputs = m_dataset.GetInputs();
+  Myth::OS::CLockGuard lock(m_mutex);
+  for (size_t i = 0; i < inputs.size(); ++i)
+  {
+    if (m_recorders[i].playing)
+      continue;
+    const DatasetInput& input = inputs[i];
+    if (!reply.empty())
+      reply.append(SEP);
+    reply.append(input.inputName).append(SEP);
+    reply.append(ToString(input.sourceId)).append(SEP);
+    reply.append(ToString(input.inputId)).append(SEP);
+    reply.append(ToString(input.mplexId)).append(SEP);
+    reply.append(ToString(input.liveTVOrder)).append(SEP);
+    reply.append("Input ").append(ToString(input.inputId)).append(SEP); // displayName
+    reply.append("0").append(SEP); // recPriority
+    reply.append(ToString(input.inputId)).append(SEP); // schedOrder
+    reply.append("0").append(SEP); // quickTune
+    reply.append("0"); // chanid
+  }
+  return reply;
+}
+
+void FakeBackend::SendEvent(const std::string& subject)
+{
+  std::string msg("BACKEND_MESSAGE" SEP);
+  msg.append(subject).append(SEP "empty");
+  std::list<ConnectionPtr> connections;
+  {
+    Myth::OS::CLockGuard lock(m_mutex);
+    connections = m_eventConnections;
+  }
+  for (std::list<ConnectionPtr>::const_iterator it = connections.begin(); it != connections.end(); ++it)
+    (*it)->SendMessage(msg);
+}
+
+/**
+ * Run the live recordings: announce the chain of a spawned live TV once tuned,
+ * then notify the growth of its file.
+ */
+void FakeBackend::Tick()
+{
+  std::vector<std::string> events;
+  {
+    Myth::OS::CLockGuard lock(m_mutex);
+    int64_t now = Dataset::Now();
+    for (std::vector<Recorder>::iterator it = m_recorders.begin(); it != m_recorders.end(); ++it)
+    {
+      if (!it->playing)
+        continue;
+      if (!it->announced)
+      {
+        if (now - it->spawnTime < (int64_t)m_config.tuneDelay * 1000)
+          continue;
+        events.push_back("LIVETV_CHAIN UPDATE " + it->chainId);
+        it->announced = true;
+        it->lastUpdate = now;
+      }
+      else if (now - it->lastUpdate >= (int64_t)m_config.sizeInterval * 1000)
+      {
+        std::string event("UPDATE_FILE_SIZE ");
+        event.append(ToString(it->program->recording.recordedId)).append(" ");
+        event.append(ToString(it->file->GetSize()));
+        events.push_back(event);
+        it->lastUpdate = now;
+      }
+    }
+  }
+  for (std::vector<std::string>::const_iterator it = events.begin(); it != events.end(); ++it)
+    SendEvent(*it);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+////
+//// Services API
+////
+
+static std::string URLDecode(const std::string& str)
+{
+  std::string out;
+  for (size_t i = 0; i < str.size(); ++i)
+  {
+    if (str[i] == '+')
+      out.push_back(' ');
+    else if (str[i] == '%' && i + 2 < str.size() && isxdigit(str[i + 1]) && isxdigit(str[i + 2]))
+    {
+      out.push_back((char)strtol(str.substr(i + 1, 2).c_str(), NULL, 16));
+      i += 2;
+    }
+    else
+      out.push_back(str[i]);
+  }
+  return out;
+}
+
+static void ParseParams(const std::string& str, std::map<std::string, std::string>& params)
+{
+  std::vector<std::string> pairs;
+  Split(str, "&", pairs);
+  for (std::vector<std::string>::const_iterator it = pairs.begin(); it != pairs.end(); ++it)
+  {
+    size_t eq = it->find('=');
+    std::string key = URLDecode(it->substr(0, eq));
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+    if (!key.empty())
+      params[key] = (eq == std::string::npos ? std::string() : URLDecode(it->substr(eq + 1)));
+  }
+}
+
+template<typename T>
+static bool ReadHttpRequest(SessionSocket& socket, T& req)
+{
+  std::string head;
+  for (;;)
+  {
+    const char* data;
+    size_t s = socket.PeekData(&data);
+    if (s == 0)
+      return false;
+    size_t before = head.size();
+    head.append(data, s);
+    size_t end = head.find("\r\n\r\n", (before > 3 ? before - 3 : 0));
+    if (end != std::string::npos)
+    {
+      socket.ConsumeData(end + 4 - before);
+      head.resize(end + 2);
+      break;
+    }
+    socket.ConsumeData(s);
+    if (head.size() > HTTP_HEADER_MAXSIZE)
+      return false;
+  }
+
+  std::vector<std::string> lines;
+  Split(head, "\r\n", lines);
+  std::vector<std::string> request;
+  Split(lines[0], " ", request);
+  if (request.size() != 3)
+    return false;
+  req.method = request[0];
+  size_t q = request[1].find('?');
+  req.path = request[1].substr(0, q);
+  if (q != std::string::npos)
+    ParseParams(request[1].substr(q + 1), req.params);
+  req.keepAlive = (request[2] == "HTTP/1.1");
+
+  size_t contentLength = 0;
+  for (size_t i = 1; i < lines.size(); ++i)
+  {
+    size_t colon = lines[i].find(':');
+    if (colon == std::string::npos)
+      continue;
+    std::string name = lines[i].substr(0, colon);
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    size_t v = lines[i].find_first_not_of(' ', colon + 1);
+    std::string value = (v == std::string::npos ? std::string() : lines[i].substr(v));
+    if (name == "content-length")
+      contentLength = (size_t)strtoul(value.c_str(), NULL, 10);
+    else if (name == "connection")
+    {
+      std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+      req.keepAlive = (value == "keep-alive" || (req.keepAlive && value != "close"));
+    }
+  }
+  if (contentLength > MESSAGE_MAXSIZE)
+    return false;
+  if (contentLength)
+  {
+    std::string body(contentLength, '\0');
+    if (socket.ReceiveData(&body[0], contentLength) != contentLength)
+      return false;
+    ParseParams(body, req.params);
+  }
+  return true;
+}
+
+static const char* StatusText(int status)
+{
+  switch (status)
+  {
+  case 200: return "OK";
+  case 400: return "Bad Request";
+  case 404: return "Not Found";
+  case 503: return "Service Unavailable";
+  default: return "Internal Server Error";
+  }
+}
+
+void FakeBackend::RunHttp(const ConnectionPtr& conn)
+{
+  while (!m_stopped)
+  {
+    if (!conn->socket.HasPendingData())
+    {
+      struct timeval tv = { 0, POLL_TIMEOUT * 1000 };
+      int r = conn->socket.Listen(&tv);
+      if (r == 0)
+        continue;
+      if (r < 0)
+        break;
+    }
+    HttpRequest req;
+    if (!ReadHttpRequest(conn->socket, req))
+      break;
+    ++m_wsRequests;
+
+    HttpResponse resp;
+    if (InjectFault(*conn))
+    {
+      resp.status = 503;
+      resp.contentType = "text/plain";
+    }
+    else
+      Route(req, resp);
+
+    int64_t length = (resp.file ? resp.file->GetSize() : (int64_t)resp.body.size());
+    char buf[256];
+    snprintf(buf, sizeof(buf), "HTTP/1.1 %d %s\r\nServer: %s\r\nContent-Type: %s\r\n"
+            "Content-Length: %lld\r\nConnection: %s\r\n\r\n",
+            resp.status, StatusText(resp.status), m_dataset.GetConfig().hostName.c_str(),
+            resp.contentType.c_str(), (long long)length, (req.keepAlive ? "keep-alive" : "close"));
+    if (!conn->SendData(buf, strlen(buf)))
+      break;
+    if (req.method == "HEAD")
+      length = 0;
+
+    // Stream the content at the allowed rate
+    Throttle throttle(m_config.bandwidth);
+    std::vector<char> chunk(resp.file ? DATA_CHUNK_SIZE : 0);
+    int64_t sent = 0;
+    while (sent < length)
+    {
+      size_t s = (size_t)std::min<int64_t>(length - sent, DATA_CHUNK_SIZE);
+      const char* data;
+      if (resp.file)
+      {
+        if ((s = resp.file->Read(sent, &chunk[0], s)) == 0)
+          break;
+        data = &chunk[0];
+      }
+      else
+        data = resp.body.c_str() + sent;
+      throttle.Pass(s);
+      if (!conn->SendData(data, s))
+        break;
+      sent += s;
+    }
+    m_bytesSent += sent;
+    if (sent < length || !req.keepAlive)
+      break;
+  }
+  conn->Close();
+}
+
+void FakeBackend::Route(const HttpRequest& req, HttpResponse& resp)
+{
+  size_t slash = req.path.find('/', 1);
+  std::string service = req.path.substr(1, slash == std::string::npos ? std::string::npos : slash - 1);
+  std::string method = (slash == std::string::npos ? std::string() : req.path.substr(slash + 1));
+
+  if (method == "version")
+    ServiceVersion(service, resp);
+  else if (service == "Myth" && method == "GetHostName")
+  {
+    JSONWriter json(resp.body);
+    json.BeginObject();
+    json.Value("String", m_dataset.GetConfig().hostName);
+    json.EndObject();
+  }
+  else if (service == "Myth" && method == "GetConnectionInfo")
+    GetConnectionInfo(resp);
+  else if (service == "Capture" && method == "GetCaptureCardList")
+    GetCaptureCardList(resp);
+  else if (service == "Channel" && method == "GetVideoSourceList")
+    GetVideoSourceList(resp);
+  else if (service == "Channel" && method == "GetChannelInfoList")
+    GetChannelInfoList(req, resp);
+  else if (service == "Channel" && method == "GetChannelInfo")
+    GetChannelInfo(req, resp);
+  else if (service == "Guide" && method == "GetProgramGuide")
+    GetProgramGuide(req, resp);
+  else if (service == "Guide" && method == "GetProgramList")
+    GetProgramList(req, resp);
+  else if (service == "Dvr" && method == "GetRecordedList")
+    GetRecordedList(req, resp);
+  else if (service == "Dvr" && method == "GetRecorded")
+    GetRecorded(req, resp);
+  else if (service == "Content" && method == "GetFile")
+    GetFile(req, resp);
+  else
+  {
+    resp.status = 404;
+    resp.contentType = "text/plain";
+    resp.body = "unknown service";
+  }
+}
+
+static void WriteListHeader(JSONWriter& json, uint32_t startIndex, uint32_t count, uint32_t total)
+{
+  json.Value("StartIndex", startIndex);
+  json.Value("Count", count);
+  json.Value("TotalAvailable", total);
+  json.Time("AsOf", time(NULL));
+  json.Value("Version", "31.0");
+  json.Value("ProtoVer", (uint32_t)FAKEBACKEND_PROTO_VERSION);
+}
+
+static void WriteChannel(JSONWriter& json, const Myth::Channel& channel)
+{
+  json.Value("ChanId", channel.chanId);
+  json.Value("ChanNum", channel.chanNum);
+  json.Value("CallSign", channel.callSign);
+  json.Value("IconURL", channel.iconURL);
+  json.Value("ChannelName", channel.channelName);
+  json.Value("MplexId", channel.mplexId);
+  json.Value("CommFree", channel.commFree);
+  json.Value("ChanFilters", channel.chanFilters);
+  json.Value("SourceId", channel.sourceId);
+  json.Value("InputId", channel.inputId);
+  json.Value("Visible", channel.visible);
+}
+
+static void WriteRecording(JSONWriter& json, const Myth::Recording& recording)
+{
+  json.BeginObject("Recording");
+  json.Value("RecordedId", recording.recordedId);
+  json.Value("Status", (int)recording.status);
+  json.Value("Priority", (int)recording.priority);
+  json.Time("StartTs", recording.startTs);
+  json.Time("EndTs", recording.endTs);
+  json.Value("RecordId", recording.recordId);
+  json.Value("RecGroup", recording.recGroup);
+  json.Value("PlayGroup", recording.playGroup);
+  json.Value("StorageGroup", recording.storageGroup);
+  json.Value("RecType", (int)recording.recType);
+  json.Value("DupInType", (int)recording.dupInType);
+  json.Value("DupMethod", (int)recording.dupMethod);
+  json.Value("EncoderId", recording.encoderId);
+  json.Value("Profile", recording.profile);
+  json.EndObject();
+}
+
+/**
+ * Write a program. With details, its channel and recording are nested as in
+ * the lists of recordings.
+ */
+static void WriteProgram(JSONWriter& json, const Myth::Program& program, bool details)
+{
+  json.BeginObject();
+  json.Time("StartTime", program.startTime);
+  json.Time("EndTime", program.endTime);
+  json.Value("Title", program.title);
+  json.Value("SubTitle", program.subTitle);
+  json.Value("Category", program.category);
+  json.Value("CatType", program.catType);
+  json.Value("Repeat", program.repeat);
+  json.Value("VideoProps", (uint32_t)program.videoProps);
+  json.Value("AudioProps", (uint32_t)program.audioProps);
+  json.Value("SubProps", (uint32_t)program.subProps);
+  json.Value("SeriesId", program.seriesId);
+  json.Value("ProgramId", program.programId);
+  json.Value("Stars", program.stars);
+  json.Time("LastModified", program.lastModified);
+  json.Value("ProgramFlags", (uint32_t)program.programFlags);
+  json.Time("Airdate", program.airdate);
+  json.Value("Description", program.description);
+  json.Value("Inetref", program.inetref);
+  json.Value("Season", (uint32_t)program.season);
+  json.Value("Episode", (uint32_t)program.episode);
+  if (details)
+  {
+    json.Value("FileSize", program.fileSize);
+    json.Value("FileName", program.fileName);
+    json.Value("HostName", program.hostName);
+    json.BeginObject("Channel");
+    WriteChannel(json, program.channel);
+    json.EndObject();
+    WriteRecording(json, program.recording);
+    json.BeginObject("Artwork");
+    json.BeginArray("ArtworkInfos");
+    json.EndArray();
+    json.EndObject();
+  }
+  json.EndObject();
+}
+
+void FakeBackend::ServiceVersion(const std::string& service, HttpResponse& resp)
+{
+  // The versions of a backend 31
+  static const char* const versions[][2] =
+  {
+    { "Myth", "5.2" }, { "Capture", "1.5" }, { "Channel", "1.10" },
+    { "Guide", "2.4" }, { "Content", "1.33" }, { "Dvr", "6.9" },
+  };
+  for (size_t i = 0; i < sizeof(versions) / sizeof(versions[0]); ++i)
+  {
+    if (service == versions[i][0])
+    {
+      JSONWriter json(resp.body);
+      json.BeginObject();
+      json.Value("String", versions[i][1]);
+      json.EndObject();
+      return;
+    }
+  }
+  resp.status = 404;
+  resp.contentType = "text/plain";
+}
+
+void FakeBackend::GetConnectionInfo(HttpResponse& resp)
+{
+  JSONWriter json(resp.body);
+  json.BeginObject();
+  json.BeginObject("ConnectionInfo");
+  json.BeginObject("Version");
+  json.Value("Version", "v31.0");
+  json.Value("Branch", "fixes/31");
+  json.Value("Protocol", (uint32_t)FAKEBACKEND_PROTO_VERSION);
+  json.Value("Binary", "31.20200101-1");
+  json.Value("Schema", (uint32_t)FAKEBACKEND_SCHEMA_VERSION);
+  json.EndObject();
+  json.EndObject();
+  json.EndObject();
+}
+
+void FakeBackend::GetCaptureCardList(HttpResponse& resp)
+{
+  const std::vector<DatasetInput>& inputs = m_dataset.GetInputs();
+  JSONWriter json(resp.body);
+  json.BeginObject();
+  json.BeginObject("CaptureCardList");
+  json.BeginArray("CaptureCards");
+  for (std::vector<DatasetInput>::const_iterator it = inputs.begin(); it != inputs.end(); ++it)
+  {
+    json.BeginObject();
+    json.Value("CardId", it->inputId);
+    json.Value("CardType", "DVB");
+    json.Value("HostName", m_dataset.GetConfig().hostName);
+    json.EndObject();
+  }
+  json.EndArray();
+  json.EndObject();
+  json.EndObject();
+}
+
+void FakeBackend::GetVideoSourceList(HttpResponse& resp)
+{
+  JSONWriter json(resp.body);
+  json.BeginObject();
+  json.BeginObject("VideoSourceList");
+  json.Time("AsOf", time(NULL));
+  json.Value("Version", "31.0");
+  json.Value("ProtoVer", (uint32_t)FAKEBACKEND_PROTO_VERSION);
+  json.BeginArray("VideoSources");
+  json.BeginObject();
+  json.Value("Id", (uint32_t)DATASET_SOURCE_ID);
+  json.Value("SourceName", "Fake source");
+  json.EndObject();
+  json.EndArray();
+  json.EndObject();
+  json.EndObject();
+}
+
+void FakeBackend::GetChannelInfoList(const HttpRequest& req, HttpResponse& resp)
+{
+  const std::vector<Myth::ChannelPtr>& channels = m_dataset.GetChannels();
+  uint32_t sourceId = req.ParamUInt("SourceID", 0);
+  std::vector<Myth::ChannelPtr> list;
+  for (std::vector<Myth::ChannelPtr>::const_iterator it = channels.begin(); it != channels.end(); ++it)
+  {
+    if (!sourceId || (*it)->sourceId == sourceId)
+      list.push_back(*it);
+  }
+  uint32_t total = (uint32_t)list.size();
+  uint32_t start = std::min(req.ParamUInt("StartIndex", 0), total);
+  uint32_t count = std::min(req.ParamUInt("Count", total), total - start);
+
+  JSONWriter json(resp.body);
+  json.BeginObject();
+  json.BeginObject("ChannelInfoList");
+  WriteListHeader(json, start, count, total);
+  json.BeginArray("ChannelInfos");
+  for (uint32_t i = start; i < start + count; ++i)
+  {
+    json.BeginObject();
+    WriteChannel(json, *list[i]);
+    json.EndObject();
+  }
+  json.EndArray();
+  json.EndObject();
+  json.EndObject();
+}
+
+void FakeBackend::GetChannelInfo(const HttpRequest& req, HttpResponse& resp)
+{
+  Myth::ChannelPtr channel = m_dataset.FindChannel(req.ParamUInt("ChanID", 0));
+  if (!channel)
+  {
+    resp.status = 400;
+    resp.contentType = "text/plain";
+    return;
+  }
+  JSONWriter json(resp.body);
+  json.BeginObject();
+  json.BeginObject("ChannelInfo");
+  WriteChannel(json, *channel);
+  json.EndObject();
+  json.EndObject();
+}
+
+static bool EndsBefore(const Myth::ProgramPtr& program, time_t t)
+{
+  return program->endTime <= t;
+}
+
+void FakeBackend::GetProgramGuide(const HttpRequest& req, HttpResponse& resp)
+{
+  const std::vector<Myth::ChannelPtr>& channels = m_dataset.GetChannels();
+  time_t startTime = req.ParamTime("StartTime", m_dataset.GetGuideStart());
+  time_t endTime = req.ParamTime("EndTime", startTime + 86400);
+  uint32_t total = (uint32_t)channels.size();
+  uint32_t start = std::min(req.ParamUInt("StartIndex", 0), total);
+  uint32_t count = std::min(req.ParamUInt("Count", total), total - start);
+
+  JSONWriter json(resp.body);
+  json.BeginObject();
+  json.BeginObject("ProgramGuide");
+  json.Time("StartTime", startTime);
+  json.Time("EndTime", endTime);
+  json.Value("Details", true);
+  WriteListHeader(json, start, count, total);
+  json.BeginArray("Channels");
+  for (uint32_t i = start; i < start + count; ++i)
+  {
+    json.BeginObject();
+    WriteChannel(json, *channels[i]);
+    json.BeginArray("Programs");
+    // Programs are sorted and contiguous
+    const std::vector<Myth::ProgramPtr>& guide = m_dataset.GetGuide(i);
+    std::vector<Myth::ProgramPtr>::const_iterator it = std::lower_bound(guide.begin(), guide.end(), startTime, EndsBefore);
+    for (; it != guide.end() && (*it)->startTime < endTime; ++it)
+      WriteProgram(json, **it, false);
+    json.EndArray();
+    json.EndObject();
+  }
+  json.EndArray();
+  json.EndObject();
+  json.EndObject();
+}
+
+void FakeBackend::GetProgramList(const HttpRequest& req, HttpResponse& resp)
+{
+  size_t c = m_dataset.ChannelIndex(req.ParamUInt("ChanId", 0));
+  time_t startTime = req.ParamTime("StartTime", m_dataset.GetGuideStart());
+  time_t endTime = req.ParamTime("EndTime", startTime + 86400);
+  std::vector<Myth::ProgramPtr> list;
+  if (c < m_dataset.GetChannels().size())
+  {
+    const std::vector<Myth::ProgramPtr>& guide = m_dataset.GetGuide(c);
+    std::vector<Myth::ProgramPtr>::const_iterator it = std::lower_bound(guide.begin(), guide.end(), startTime, EndsBefore);
+    for (; it != guide.end() && (*it)->startTime < endTime; ++it)
+      list.push_back(*it);
+  }
+  uint32_t total = (uint32_t)list.size();
+  uint32_t start = std::min(req.ParamUInt("StartIndex", 0), total);
+  uint32_t count = std::min(req.ParamUInt("Count", total), total - start);
+
+  JSONWriter json(resp.body);
+  json.BeginObject();
+  json.BeginObject("ProgramList");
+  WriteListHeader(json, start, count, total);
+  json.BeginArray("Programs");
+  for (uint32_t i = start; i < start + count; ++i)
+    WriteProgram(json, *list[i], true);
+  json.EndArray();
+  json.EndObject();
+  json.EndObject();
+}
+
+void FakeBackend::GetRecordedList(const HttpRequest& req, HttpResponse& resp)
+{
+  const std::vector<Myth::ProgramPtr>& recordings = m_dataset.GetRecordings();
+  bool descending = (req.Param("Descending") == "true");
+  uint32_t total = (uint32_t)recordings.size();
+  uint32_t start = std::min(req.ParamUInt("StartIndex", 0), total);
+  uint32_t count = std::min(req.ParamUInt("Count", total), total - start);
+
+  JSONWriter json(resp.body);
+  json.BeginObject();
+  json.BeginObject("ProgramList");
+  WriteListHeader(json, start, count, total);
+  json.BeginArray("Programs");
+  // Recordings are sorted by start time
+  for (uint32_t i = start; i < start + count; ++i)
+    WriteProgram(json, *recordings[descending ? total - 1 - i : i], true);
+  json.EndArray();
+  json.EndObject();
+  json.EndObject();
+}
+
+void FakeBackend::GetRecorded(const HttpRequest& req, HttpResponse& resp)
+{
+  Myth::ProgramPtr program = m_dataset.FindRecording(req.ParamUInt("RecordedId", 0));
+  if (!program)
+  {
+    resp.status = 400;
+    resp.contentType = "text/plain";
+    return;
+  }
+  resp.body = "{\"Program\":";
+  JSONWriter json(resp.body);
+  WriteProgram(json, *program, true);
+  resp.body.push_back('}');
+}
+
+void FakeBackend::GetFile(const HttpRequest& req, HttpResponse& resp)
+{
+  resp.file = m_dataset.OpenFile(req.Param("FileName"), req.Param("StorageGroup"));
+  if (!resp.file)
+  {
+    resp.status = 404;
+    resp.contentType = "text/plain";
+    return;
+  }
+  resp.contentType = "application/octet-stream";
+}
@@ -0,0 +1,169 @@
+#pragma once
+/*
+ *      Copyright (C) 2014 Jean-Luc Barriere
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301 USA
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "dataset.h"
+
+#include <private/os/threads/threadpool.h>
+
+#include <atomic>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#define FAKEBACKEND_PROTO_VERSION   91
+#define FAKEBACKEND_PROTO_TOKEN     "BuzzOff"
+#define FAKEBACKEND_SCHEMA_VERSION  1364
+
+struct BackendConfig
+{
+  BackendConfig();
+
+  unsigned protoPort;       ///< port of the Myth protocol
+  unsigned wsPort;          ///< port of the services API
+  unsigned tuneDelay;       ///< ms before the chain of a spawned live TV is announced
+  unsigned sizeInterval;    ///< ms between the size updates of a live recording
+  unsigned latency;         ///< ms waited before each reply
+  unsigned jitter;          ///< random ms added to the latency, up to
+  unsigned bandwidth;       ///< bytes per second of each data stream, 0 for unlimited
+  unsigned errorRate;       ///< failed requests per 1000: dropped connection or HTTP 503
+  unsigned seed;
+};
+
+/**
+ * Parse an option of the dataset or of the backend.
+ * @return false when the option is unknown
+ */
+bool ParseBackendOption(char opt, const char* arg, DatasetConfig& dataset, BackendConfig& backend);
+void BackendOptionsUsage();
+
+struct BackendStats
+{
+  uint64_t protoRequests;
+  uint64_t wsRequests;
+  uint64_t bytesSent;
+  uint64_t faults;
+};
+
+/**
+ * A stand-in mythbackend serving a dataset on the Myth protocol and the
+ * services API. It speaks enough of both for the playbacks, the event handler
+ * and the services client of the library, and it can slow down or break its
+ * replies to reproduce a poor network or a busy backend.
+ */
+class FakeBackend
+{
+public:
+  FakeBackend(Dataset& dataset, const BackendConfig& config);
+  ~FakeBackend();
+
+  bool Start();
+  void Stop();
+  bool IsRunning() const { return m_running; }
+  BackendStats GetStats() const;
+
+  class Connection;
+  typedef Myth::shared_ptr<Connection> ConnectionPtr;
+
+private:
+  class Listener;
+  class Ticker;
+  class ProtoSession;
+  class HttpSession;
+  class ProgramInfoWriter;
+  struct Transfer;
+  struct HttpRequest;
+  struct HttpResponse;
+  friend class Listener;
+  friend class Ticker;
+  friend class ProtoSession;
+  friend class HttpSession;
+  typedef Myth::shared_ptr<Transfer> TransferPtr;
+
+  struct Recorder
+  {
+    bool playing;
+    bool announced;           ///< the chain update is sent
+    std::string chainId;
+    Myth::ProgramPtr program;
+    FileSourcePtr file;
+    int64_t spawnTime;
+    int64_t lastUpdate;
+
+    Recorder() : playing(false), announced(false), spawnTime(0), lastUpdate(0) { }
+  };
+
+  Dataset& m_dataset;
+  BackendConfig m_config;
+  Myth::OS::CThreadPool m_pool;
+  Listener* m_protoListener;
+  Listener* m_wsListener;
+  Ticker* m_ticker;
+  ProgramInfoWriter* m_writer;
+  bool m_running;
+  std::atomic<bool> m_stopped;
+  std::atomic<unsigned> m_sessions;
+  std::atomic<unsigned> m_serial;
+
+  mutable Myth::OS::CMutex m_mutex;
+  std::map<uint32_t, TransferPtr> m_transfers;
+  uint32_t m_nextFileId;
+  std::list<ConnectionPtr> m_eventConnections;
+  std::vector<Recorder> m_recorders;
+
+  std::atomic<uint64_t> m_protoRequests;
+  std::atomic<uint64_t> m_wsRequests;
+  std::atomic<uint64_t> m_bytesSent;
+  std::atomic<uint64_t> m_faults;
+
+  void Accept(Listener& listener, bool http);
+  bool InjectFault(Connection& conn);
+
+  // Myth protocol
+  void RunProto(const ConnectionPtr& conn);
+  bool HandleProto(const ConnectionPtr& conn, const std::string& msg, uint32_t& fileId, bool& events);
+  bool AnnounceFileTransfer(const ConnectionPtr& conn, const std::vector<std::string>& fields, uint32_t& fileId);
+  std::string QueryFileTransfer(const std::vector<std::string>& fields, uint32_t fileId);
+  std::string QueryRecorder(const std::vector<std::string>& fields, unsigned num);
+  std::string GetFreeInputInfo();
+  void SendEvent(const std::string& subject);
+  void Tick();
+
+  // Services API
+  void RunHttp(const ConnectionPtr& conn);
+  void Route(const HttpRequest& req, HttpResponse& resp);
+  void ServiceVersion(const std::string& service, HttpResponse& resp);
+  void GetConnectionInfo(HttpResponse& resp);
+  void GetCaptureCardList(HttpResponse& resp);
+  void GetVideoSourceList(HttpResponse& resp);
+  void GetChannelInfoList(const HttpRequest& req, HttpResponse& resp);
+  void GetChannelInfo(const HttpRequest& req, HttpResponse& resp);
+  void GetProgramGuide(const HttpRequest& req, HttpResponse& resp);
+  void GetProgramList(const HttpRequest& req, HttpResponse& resp);
+  void GetRecordedList(const HttpRequest& req, HttpResponse& resp);
+  void GetRecorded(const HttpRequest& req, HttpResponse& resp);
+  void GetFile(const HttpRequest& req, HttpResponse& resp);
+
+  // prevent copy
+  FakeBackend(const FakeBackend&);
+  FakeBackend& operator=(const FakeBackend&);
+};
@@ -0,0 +1,87 @@
+/*
+ *      Copyright (C) 2014 Jean-Luc Barriere
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 51 Franklin Street, Fifth Floor, Boston,
+ *  MA 02110-1301 USA
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+/*
+ * Runs the fake backend until interrupted, so the add-on or any client of the
+ * library can be pointed at it.
+ */
+
+#include "fakebackend.h"
+
+#include <csignal>
+#include <cstdio>
+#include <string>
+
+#include <unistd.h>
+
+static volatile sig_atomic_t g_interrupted = 0;
+
+static void OnSignal(int)
+{
+  g_interrupted = 1;
+}
+
+static void Usage(const char* name)
+{
+  fprintf(stderr, "Usage: %s [options]\n", name);
+  BackendOptionsUsage();
+}
+
+int main(int argc, char** argv)
+{
+  DatasetConfig datasetConfig;
+  BackendConfig backendConfig;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string opt(argv[i]);
+    if (opt.size() != 2 || opt[0] != '-' || i + 1 >= argc ||
+            !ParseBackendOption(opt[1], argv[i + 1], datasetConfig, backendConfig))
+    {
+      Usage(argv[0]);
+      return 1;
+    }
+    ++i;
+  }
+
+  signal(SIGINT, OnSignal);
+  signal(SIGTERM, OnSignal);
+  signal(SIGPIPE, SIG_IGN);
+
+  Dataset dataset(datasetConfig);
+  FakeBackend backend(dataset, backendConfig);
+  if (!backend.Start())
+    return 1;
+  printf("serving %u channels, %u recordings on ports %u and %u\n",
+          (unsigned)dataset.GetChannels().size(), (unsigned)dataset.GetRecordings().size(),
+          backendConfig.protoPort, backendConfig.wsPort);
+  fflush(stdout);
+
+  while (!g_interrupted)
+    usleep(100000);
+
+  backend.Stop();
+  BackendStats stats = backend.GetStats();
+  printf("%llu protocol requests, %llu services requests, %.1f MB sent, %llu faults\n",
+          (unsigned long long)stats.protoRequests, (unsigned long long)stats.wsRequests,
+          stats.bytesSent / (1024.0 * 1024.0), (unsigned long long)stats.faults);
+  return 0;
+}